@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+struct AliyunGatewayResult {
+  String response = "";
+  String errorCode = "";
+};
+
+struct AliyunGatewayStats {
+  uint32_t networkCalls = 0;
+  uint32_t cacheHits = 0;
+  uint32_t coalescedCalls = 0;
+  uint32_t invalidations = 0;
+};
+
+// Process-wide gate for Aliyun read calls. Identical reads that overlap share one
+// network round trip (single flight), and successful results are reused for a few
+// seconds, so the dashboard and the DDNS loop do not repeat the same TLS request.
+class AliyunApiGateway {
+ public:
+  using Fetcher = std::function<void(AliyunGatewayResult* result)>;
+
+  // Serves `key` from cache, from an identical in-flight call, or by running `fetch`.
+  // Waiting on someone else's call gives up after `timeoutMs` with "gateway_timeout".
+  static void execute(const String& key,
+                      const Fetcher& fetch,
+                      AliyunGatewayResult* result,
+                      uint32_t timeoutMs);
+  // Drops cached reads made with `credentialKey` (the key prefix used by writers).
+  static void invalidate(const String& credentialKey);
+  static void reset();
+  static AliyunGatewayStats getStats();
+
+ private:
+  static constexpr size_t kMaxEntries = 8;
+  static constexpr uint32_t kCacheTtlMs = 3000;
+
+  // One network call and the waiters sharing it. Outlives its cache entry so
+  // an invalidation cannot strand the waiters.
+  struct Flight {
+    Flight() : done(xSemaphoreCreateBinary()) {}
+    ~Flight() { vSemaphoreDelete(done); }
+    Flight(const Flight&) = delete;
+    Flight& operator=(const Flight&) = delete;
+
+    SemaphoreHandle_t done;
+    AliyunGatewayResult result;
+  };
+
+  struct Entry {
+    String key;
+    bool inFlight = true;
+    uint32_t generation = 0;
+    uint32_t completedAtMs = 0;
+    AliyunGatewayResult result;
+    std::shared_ptr<Flight> flight;
+  };
+
+  static std::vector<Entry>& entries();
+  static Entry* find(const String& key);
+  static void pruneLocked(uint32_t now);
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+enum class AliyunErrorClass { None, Throttled, Transient, ClockSkew, Auth, Client };
+
+struct AliyunBreakerStatus {
+  String accessKeyId = "";
+  String state = "CLOSED";
+  String lastErrorCode = "";
+  String lastErrorClass = "NONE";
+  uint32_t consecutiveFailures = 0;
+  uint32_t openCount = 0;
+  uint32_t shortCircuitCount = 0;
+  uint32_t retryInMs = 0;
+  uint32_t lastFailureAtMs = 0;
+};
+
+// Per-AccessKeyId circuit breaker shared by every AliyunDdnsClient instance, so web
+// handlers and the DDNS loop back off together when Aliyun throttles or rejects us.
+class AliyunCircuitBreaker {
+ public:
+  static AliyunErrorClass classifyError(const String& errorCode, int httpCode);
+  static String errorClassToText(AliyunErrorClass errorClass);
+
+  // Returns false while the breaker is open. After the backoff expires a single
+  // half-open probe is let through; concurrent callers keep short-circuiting.
+  static bool allowRequest(const String& accessKeyId, uint32_t now);
+  static void recordResult(const String& accessKeyId,
+                           AliyunErrorClass errorClass,
+                           const String& errorCode,
+                           uint32_t now);
+  static void reset();
+  // Forgets one credential, e.g. after its secret was replaced.
+  static void reset(const String& accessKeyId);
+  static std::vector<AliyunBreakerStatus> getStatuses(uint32_t now);
+
+ private:
+  static constexpr size_t kMaxEntries = 8;
+  static constexpr uint32_t kFailureThreshold = 3;
+  static constexpr uint32_t kBaseBackoffMs = 5000;
+  static constexpr uint32_t kMaxBackoffMs = 600000;
+  static constexpr uint32_t kAuthBackoffMs = 900000;
+
+  enum class State { Closed, Open, HalfOpen };
+
+  struct Entry {
+    String accessKeyId;
+    State state = State::Closed;
+    AliyunErrorClass lastErrorClass = AliyunErrorClass::None;
+    String lastErrorCode;
+    uint32_t consecutiveFailures = 0;
+    uint32_t openCount = 0;
+    uint32_t shortCircuitCount = 0;
+    uint32_t openUntilMs = 0;
+    uint32_t lastFailureAtMs = 0;
+    uint32_t lastUsedAtMs = 0;
+  };
+
+  static std::vector<Entry>& entries();
+  static Entry* findOrCreate(const String& accessKeyId, uint32_t now);
+  static uint32_t backoffMs(const Entry& entry);
+  static String stateToText(State state);
+};
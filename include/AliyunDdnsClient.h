@@ -1,12 +1,19 @@
 #pragma once
 
 #include <Arduino.h>
-#include <functional>
+#include <vector>
+
+struct AliyunGatewayResult;
+
+struct AliyunDomainRecord {
+  String recordId;
+  String rr;
+  String type;
+  String value;
+};
 
 class AliyunDdnsClient {
  public:
-  using UpdateCallback = std::function<void(const char* oldIp, const char* newIp)>;
-
   AliyunDdnsClient();
   ~AliyunDdnsClient() = default;
 
@@ -16,11 +23,12 @@ class AliyunDdnsClient {
              const String& domain,
              const String& subDomain = "@");
 
-  void update(uint32_t now, bool useLocalIp);
-  void onUpdate(UpdateCallback callback);
-
   // Aliyun DNS API (required parameters only)
   bool describeDomainRecords(const String& domainName);
+  // Lists every record of the zone matching typeKeyWord, following pagination.
+  bool describeDomainRecords(const String& domainName,
+                             const String& typeKeyWord,
+                             std::vector<AliyunDomainRecord>* records);
   bool describeDomainRecordInfo(const String& recordId,
                                 String* rr,
                                 String* type,
@@ -35,34 +43,39 @@ class AliyunDdnsClient {
                           const String& value);
   bool deleteDomainRecord(const String& recordId);
 
-  uint32_t getUpdateCount() const { return _updateCount; }
-  uint32_t getLastUpdateAt() const { return _lastUpdateAtMs; }
-  const String& getLastOldIp() const { return _lastOldIp; }
-  const String& getLastNewIp() const { return _lastNewIp; }
   const String& getLastApiResponse() const { return _lastApiResponse; }
   const String& getLastCreatedRecordId() const { return _lastCreatedRecordId; }
+  // Aliyun `Code` of the last failed call, `network_error`, `http_<status>` or `circuit_open`.
+  const String& getLastErrorCode() const { return _lastErrorCode; }
 
- private:
-  struct RecordInfo {
-    String recordId;
-    String value;
-  };
+  // Overrides the API base URL for every client, e.g. a local stand-in such as
+  // tools/aliyun_dns_stub.py. An empty value restores the public endpoint.
+  static void setEndpoint(const String& endpoint);
+  static const String& getEndpoint();
 
+ private:
   String generateTimestamp() const;
   String generateNonce() const;
   String urlEncode(const String& value) const;
   String calculateSignature(const String& method, const String& sortedParams) const;
   String sha1Hmac(const String& key, const String& data) const;
   String base64Encode(const uint8_t* data, size_t length) const;
-  const char* recordType() const;
   String buildCommonParams(const String& action) const;
+  String buildDescribeParams(const String& domainName,
+                             uint32_t pageNumber,
+                             const String& typeKeyWord) const;
   String buildSignedParams(const String& method, const String& rawParams) const;
-  bool sendSignedRequest(const String& method, const String& signedParams, String* response) const;
-  bool invokeApi(const String& method, const String& rawParams, String* response) const;
+  int sendSignedRequest(const String& method, const String& signedParams, String* response) const;
+  // Reads go through AliyunApiGateway; writes bypass it and invalidate its cache.
+  bool invokeApi(const String& method, const String& rawParams, String* response);
+  void performApiCall(const String& method,
+                      const String& rawParams,
+                      AliyunGatewayResult* result) const;
+  String gatewayCredentialKey() const;
+  String stripVolatileParams(const String& rawParams) const;
   bool parseJsonStringField(const String& response, const char* key, String* value) const;
-
-  bool fetchRecordInfo(RecordInfo* info);
-  bool updateRecord(const String& recordId, const String& newIp);
+  bool parseJsonNumberField(const String& response, const char* key, long* value) const;
+  bool parseDomainRecordList(const String& response, std::vector<AliyunDomainRecord>* records) const;
 
   String _accessKeyId;
   String _accessKeySecret;
@@ -70,14 +83,9 @@ class AliyunDdnsClient {
   String _subDomain;
   String _recordId;
 
-  UpdateCallback _updateCallback;
-
-  uint32_t _updateCount = 0;
-  uint32_t _lastUpdateAtMs = 0;
-  String _lastOldIp;
-  String _lastNewIp;
   String _lastApiResponse;
   String _lastCreatedRecordId;
+  String _lastErrorCode;
 
   bool _begun = false;
   bool _recordIdValid = false;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+
+#include "NetworkAccounting.h"
+#include "SharedHttpClient.h"
+
+struct AsyncHttpStats {
+  uint32_t submitted = 0;
+  uint32_t completed = 0;
+  uint32_t abandoned = 0;
+  uint32_t inlineFallbacks = 0;
+  uint32_t pending = 0;
+  uint32_t maxQueueWaitMs = 0;
+  uint32_t maxRunMs = 0;
+};
+
+// Handle to work queued on AsyncHttpClient. Poll ready() from tick(); the response
+// is only valid once ready() returns true. Dropping every copy of a pending handle
+// abandons the result, the request itself still runs to completion.
+class AsyncHttpFuture {
+ public:
+  AsyncHttpFuture() = default;
+
+  bool valid() const { return _state != nullptr; }
+  bool ready() const;
+  // True when an HTTP status was received; mirrors SharedHttpClient::perform().
+  bool ok() const;
+  const SharedHttpResponse& response() const;
+  uint32_t elapsedMs() const;
+  void reset() { _state.reset(); }
+
+ private:
+  friend class AsyncHttpClient;
+
+  struct State {
+    SharedHttpRequest request;
+    std::function<void()> job;
+    NetSubsystem subsystem = NetSubsystem::Other;
+    SharedHttpResponse response;
+    bool ok = false;
+    bool ready = false;
+    uint32_t queuedAtMs = 0;
+    uint32_t elapsedMs = 0;
+  };
+
+  std::shared_ptr<State> _state;
+};
+
+// Runs outbound HTTP(S) on a background task so loop() never waits on a socket.
+// Requests go through SharedHttpClient and keep its connection pool. Multi-request
+// sequences (signed Aliyun calls with retries, a full DDNS sync) are queued as jobs.
+// Work is charged to the NetworkAccounting subsystem that was current at submit time.
+class AsyncHttpClient {
+ public:
+  static AsyncHttpFuture submit(const SharedHttpRequest& request);
+  // `job` runs on the worker and must only touch state it owns or that is locked.
+  static AsyncHttpFuture submitJob(std::function<void()> job);
+  static AsyncHttpStats getStats();
+
+ private:
+  using StatePtr = std::shared_ptr<AsyncHttpFuture::State>;
+
+  static AsyncHttpFuture enqueue(const StatePtr& state);
+  static bool ensureWorker();
+  static void run(AsyncHttpFuture::State* state);
+  static void workerTask(void* context);
+};
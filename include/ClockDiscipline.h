@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+
+// What the clock learned about its crystal, kept across reboots.
+struct ClockDriftState {
+  // Rate error of the local clock in parts per billion; positive runs fast.
+  int32_t driftPpb = 0;
+  // Consecutive syncs whose offset the estimate predicted within error.
+  uint8_t confidence = 0;
+  // Current sync interval; 0 when unknown.
+  uint32_t intervalSeconds = 0;
+};
+
+// Turns successive NTP offsets into a drift estimate and a sync interval.
+// Small offsets are slewed, large ones stepped; between syncs the caller
+// slews driftCorrectionUs() so the residual offset measures the estimate's
+// error. The interval doubles while syncs land within the target and halves
+// when they miss it. Free of I/O apart from load() / save().
+class ClockDiscipline {
+ public:
+  // Offsets beyond this are stepped (the ntpd default).
+  static constexpr int64_t kStepThresholdUs = 128000;
+  static constexpr int64_t kTargetOffsetUs = 100000;
+  // Crystal error beyond this means the clock was set by someone else.
+  static constexpr int32_t kMaxDriftPpb = 500000;
+  // Shorter windows leave the estimate dominated by network jitter.
+  static constexpr uint32_t kMinDriftWindowSeconds = 900;
+
+  void setIntervalBounds(uint32_t minSeconds, uint32_t maxSeconds);
+  void restore(const ClockDriftState& state);
+  ClockDriftState state() const;
+
+  // Feeds the offset a sync measured at server time `serverUs`. True when the
+  // offset should be stepped rather than slewed.
+  bool addSample(int64_t serverUs, int64_t offsetUs, int64_t delayUs);
+  // Correction the estimate calls for after `elapsedUs` of local time.
+  int64_t driftCorrectionUs(int64_t elapsedUs) const;
+  uint32_t intervalSeconds() const { return _intervalSeconds; }
+  int32_t driftPpb() const { return _driftPpb; }
+  uint8_t confidence() const { return _confidence; }
+  // Whether the last addSample() changed what state() returns.
+  bool learned() const { return _learned; }
+
+  static bool load(ClockDriftState* state);
+  static bool save(const ClockDriftState& state);
+
+ private:
+  static constexpr const char* kNamespace = "time";
+  static constexpr const char* kDriftKey = "drift_ppb";
+  static constexpr const char* kConfidenceKey = "drift_n";
+  static constexpr const char* kIntervalKey = "poll_s";
+
+  uint32_t clampInterval(uint32_t seconds) const;
+
+  uint32_t _minIntervalSeconds = 3600;
+  uint32_t _maxIntervalSeconds = 3600;
+  uint32_t _intervalSeconds = 3600;
+  int32_t _driftPpb = 0;
+  uint8_t _confidence = 0;
+  bool _hasSample = false;
+  int64_t _lastSampleUs = 0;
+  bool _learned = false;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Bounds on Unix time learned from HTTP Date headers. A header names the second
+// the server stamped it, somewhere between sending the request and reading the
+// reply, so each one confines Unix time to a window of one second plus the round
+// trip. Windows of agreeing servers intersect and narrow; disagreeing ones
+// collect in a second window that replaces the estimate only once it has more
+// sources behind it. Both windows widen by kMaxDriftPpm of the time elapsed, so
+// honest servers keep overlapping them while the local crystal drifts.
+class CoarseClock {
+ public:
+  // Round trips beyond this say too little to be worth keeping.
+  static constexpr uint32_t kMaxRoundTripMs = 5000;
+  // Worst crystal error assumed between samples, in parts per million.
+  static constexpr uint32_t kMaxDriftPpm = 50;
+  // A window this old is moved forward, well before millis() can wrap past it.
+  static constexpr uint32_t kRebaseAfterMs = 24UL * 60UL * 60UL * 1000UL;
+
+  // False when the sample was rejected.
+  bool addSample(int64_t dateUnixSeconds, uint32_t requestStartMs, uint32_t responseAtMs);
+  // Keeps the windows anchored near `nowMs`; call at least once a day.
+  void refresh(uint32_t nowMs);
+  bool valid() const { return _agreed.sources > 0; }
+  // Middle of the window at `nowMs`.
+  int64_t unixMsAt(uint32_t nowMs) const;
+  // Half the window at `nowMs`: the most the middle can be off.
+  uint32_t uncertaintyMs(uint32_t nowMs) const;
+  // Whether a clock reading `unixMs` at `nowMs` lies inside the window.
+  bool contains(int64_t unixMs, uint32_t nowMs) const;
+  // Samples that agreed with the current window, including the first.
+  uint8_t sources() const { return _agreed.sources; }
+  void clear();
+
+ private:
+  struct Window {
+    // Unix ms bounds as of millis() == anchorMs.
+    int64_t lowUnixMs = 0;
+    int64_t highUnixMs = 0;
+    uint32_t anchorMs = 0;
+    uint8_t sources = 0;
+  };
+
+  // `window` as of `nowMs`: shifted by the elapsed time and widened for drift.
+  static Window moved(const Window& window, uint32_t nowMs);
+  // Narrows `window` by `sample`; false when they do not overlap.
+  static bool merge(Window* window, const Window& sample);
+
+  Window _agreed;
+  Window _candidate;
+};
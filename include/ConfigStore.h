@@ -40,12 +40,19 @@ struct DdnsRecordConfig {
 
 struct DdnsConfig {
   bool enabled = false;
+  // Public-IP records check at a pace learned from past IP changes, within the
+  // bounds below, instead of their fixed interval.
+  bool adaptiveInterval = false;
+  uint32_t adaptiveMinSeconds = 60;
+  uint32_t adaptiveMaxSeconds = 3600;
+  // Boards on one LAN with the same records elect one of them to sync.
+  bool lanCoordination = false;
   std::vector<DdnsRecordConfig> records;
 };
 
 class ConfigStore {
  public:
-  static constexpr size_t kMaxDdnsRecords = 5;
+  static constexpr size_t kMaxDdnsRecords = 64;
 
   ConfigStore() = default;
 
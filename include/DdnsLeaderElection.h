@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <vector>
+
+enum class DdnsLanRole : uint8_t {
+  // Coordination disabled: this board syncs on its own.
+  Off,
+  // No leader known yet; listening before claiming.
+  Candidate,
+  Follower,
+  Leader
+};
+
+struct DdnsLeaderStatus {
+  DdnsLanRole role = DdnsLanRole::Off;
+  uint32_t nodeId = 0;
+  uint32_t leaderId = 0;
+  // Empty while this board leads or no leader is known.
+  String leaderIp = "";
+  // Other boards of the same cluster heard within the lease.
+  uint32_t peerCount = 0;
+  // Times this board took over the role.
+  uint32_t takeovers = 0;
+};
+
+// Lets several boards on one LAN agree on which of them runs the DDNS syncs.
+// Every board multicasts an announcement each second; the leader's carries a
+// lease that followers honour until it runs out, after which the live board
+// with the lowest node id claims the role. Two leaders (a healed partition)
+// resolve the same way: the higher id steps down when it hears the lower one.
+// Boards only coordinate with others whose enabled records match (the cluster
+// id), so unrelated setups on the same LAN keep syncing on their own.
+class DdnsLeaderElection {
+ public:
+  static constexpr uint16_t kDefaultPort = 5380;
+  static constexpr uint32_t kAnnounceIntervalMs = 1000;
+  static constexpr uint32_t kLeaseMs = 5000;
+
+  DdnsLeaderElection();
+  ~DdnsLeaderElection();
+
+  // Starts the announcement task; without it isLeader() stays true.
+  bool start();
+  // Safe from any task. A disabled election always leads.
+  void configure(bool enabled, uint32_t clusterId);
+  bool isLeader() const;
+  DdnsLeaderStatus getStatus() const;
+
+  // Defaults to 239.255.53.80:kDefaultPort; call before start().
+  void setMulticastGroup(const IPAddress& group, uint16_t port);
+
+  static const char* roleName(DdnsLanRole role);
+
+ private:
+  static constexpr size_t kPacketSize = 16;
+  static constexpr size_t kMaxPeers = 8;
+  // Listen this long after enabling or reconnecting before claiming the role.
+  static constexpr uint32_t kDiscoveryMs = 3 * kAnnounceIntervalMs;
+  // A candidate that sees no lower board claim within this long claims anyway.
+  static constexpr uint32_t kClaimTimeoutMs = 2 * kLeaseMs;
+  static constexpr uint32_t kPollMs = 100;
+  static constexpr uint32_t kTaskStackSize = 4096;
+
+  struct Announcement {
+    uint32_t clusterId = 0;
+    uint32_t nodeId = 0;
+    bool leader = false;
+    uint16_t leaseMs = 0;
+  };
+
+  struct Peer {
+    uint32_t nodeId = 0;
+    IPAddress address;
+    uint32_t lastHeardMs = 0;
+  };
+
+  static size_t encode(const Announcement& announcement, uint8_t* packet, size_t capacity);
+  static bool decode(const uint8_t* packet, size_t length, Announcement* announcement);
+
+  static void task(void* context);
+  void run();
+  // State machine; callers hold _mutex. Kept free of I/O for the unit tests.
+  void resetRole(uint32_t now);
+  void handleAnnouncement(const Announcement& announcement, const IPAddress& from, uint32_t now);
+  // Advances the role; true when an announcement is due.
+  bool step(uint32_t now);
+  bool isLowestLiveNode() const;
+  Announcement ownAnnouncement() const;
+
+  SemaphoreHandle_t _mutex = nullptr;
+  SemaphoreHandle_t _stopped = nullptr;
+  bool _started = false;
+  bool _stopRequested = false;
+
+  IPAddress _group;
+  uint16_t _port = kDefaultPort;
+  bool _enabled = false;
+  uint32_t _clusterId = 0;
+  uint32_t _nodeId = 0;
+  DdnsLanRole _role = DdnsLanRole::Off;
+  uint32_t _roleSinceMs = 0;
+  uint32_t _claimAfterMs = 0;
+  uint32_t _leaderId = 0;
+  IPAddress _leaderAddress;
+  uint32_t _leaderExpiresAtMs = 0;
+  uint32_t _lastAnnouncedAtMs = 0;
+  bool _announcedOnce = false;
+  uint32_t _takeovers = 0;
+  std::vector<Peer> _peers;
+};
@@ -1,10 +1,17 @@
 #pragma once
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <vector>
 
 #include "ConfigStore.h"
 #include "AliyunDdnsClient.h"
+#include "DdnsLeaderElection.h"
+#include "DdnsStateStore.h"
+#include "DdnsSyncHistory.h"
+#include "IpChangeHistory.h"
 
 struct DdnsRecordRuntimeStatus {
   bool enabled = false;
@@ -13,6 +20,8 @@ struct DdnsRecordRuntimeStatus {
   String domain = "";
   String username = "";
   uint32_t updateIntervalSeconds = 300;
+  // Interval the next check was planned with; differs from the above when adaptive.
+  uint32_t checkIntervalSeconds = 0;
   bool useLocalIp = false;
   String state = "IDLE";
   String message = "";
@@ -20,6 +29,22 @@ struct DdnsRecordRuntimeStatus {
   String lastNewIp = "";
   uint32_t updateCount = 0;
   uint32_t lastUpdateAtMs = 0;
+  // Unix time of the last push, kept across reboots; 0 when unknown.
+  uint32_t lastUpdateAt = 0;
+};
+
+struct DdnsRecordSyncHistory {
+  String domain = "";
+  // Oldest first.
+  std::vector<DdnsSyncAttempt> attempts;
+  DdnsSyncSummary summary;
+};
+
+// Network events that make records due ahead of their interval.
+enum class DdnsTrigger : uint8_t {
+  WifiGotIp,
+  WifiLostIp,
+  PublicIpChanged
 };
 
 struct DdnsRuntimeStatus {
@@ -28,35 +53,127 @@ struct DdnsRuntimeStatus {
   bool wifiConnected = false;
   uint32_t activeRecordCount = 0;
   uint32_t totalUpdateCount = 0;
+  bool adaptiveInterval = false;
+  uint32_t ipChangeCount = 0;
+  // Unix time of the last recorded public IP change; 0 when none.
+  uint32_t lastIpChangeAt = 0;
+  uint32_t typicalIpChangeGapSeconds = 0;
+  // Syncs started early by a Wi-Fi or public IP event rather than the interval.
+  uint32_t eventSyncCount = 0;
+  bool lanCoordination = false;
+  String lanRole = "OFF";
+  // Address of the board that syncs while this one is a follower.
+  String lanLeaderIp = "";
+  uint32_t lanPeerCount = 0;
   String state = "DISABLED";
   String message = "DDNS disabled.";
 };
 
+// The sync engine runs on its own task once begin() has been called: config
+// changes, triggers and the Wi-Fi state reach it through a command queue, and
+// readers get the status it last published. Before begin() (unit tests,
+// benchmarks) the same work runs inline on the caller of tick().
 class DdnsService {
   public:
    static constexpr const char* kProviderId = "aliyun";
 
    DdnsService(ConfigStore& configStore);
+   ~DdnsService();
 
   void begin();
   void updateConfig(const DdnsConfig& config);
+  // O(1): only forwards Wi-Fi state changes to the engine.
   void tick(bool wifiConnected);
+  // Makes every record due on the engine's next pass regardless of its interval.
+  void requestSyncAll();
+  // Safe from any task. Bursts are debounced; the first engine pass after they
+  // settle makes the affected records due.
+  void notify(DdnsTrigger trigger);
+  bool isSyncInProgress() const;
 
   DdnsRuntimeStatus getStatus() const;
   std::vector<DdnsRecordRuntimeStatus> getRecordStatuses() const;
+  // At most `limit` records starting at `offset`; `total` receives the record count.
+  std::vector<DdnsRecordRuntimeStatus> getRecordStatuses(size_t offset,
+                                                         size_t limit,
+                                                         size_t* total) const;
+  // Same paging as getRecordStatuses(); `overall` summarizes every record's attempts.
+  std::vector<DdnsRecordSyncHistory> getSyncHistory(size_t offset,
+                                                    size_t limit,
+                                                    size_t* total,
+                                                    DdnsSyncSummary* overall) const;
 
  private:
+  enum class CommandType : uint8_t {
+    UpdateConfig,
+    WifiState,
+    SyncAll,
+    // Re-evaluates pending events and due records without changing anything.
+    Wake,
+    Stop
+  };
+
+  // Plain data so it can be copied through the FreeRTOS queue.
+  struct Command {
+    CommandType type = CommandType::Wake;
+    bool wifiConnected = false;
+    // Owned by the command; freed by whoever consumes it.
+    DdnsConfig* config = nullptr;
+  };
+
   struct RuntimeRecord {
     DdnsRecordConfig config;
-    AliyunDdnsClient client{};
+    String rootDomain = "";
+    String rr = "@";
+    String recordId = "";
     String state = "IDLE";
     String message = "";
     String lastOldIp = "";
     String lastNewIp = "";
     uint32_t updateCount = 0;
     uint32_t lastUpdateAtMs = 0;
+    uint32_t lastUpdateAt = 0;
+    // Value last confirmed on Aliyun; persisted with the RecordId.
+    String confirmedIp = "";
+    // Restored at boot: the first cycle skips Aliyun while the IP still matches.
+    bool trustConfirmedIp = false;
     bool firstSyncPending = true;
     uint32_t nextSyncDueAtMs = 0;
+    uint32_t checkIntervalSeconds = 0;
+    bool syncInFlight = false;
+    DdnsSyncHistory history;
+  };
+
+  // Copy of a due record handed to the background cycle, plus what the cycle found.
+  struct SyncItem {
+    size_t index = 0;
+    DdnsRecordConfig config;
+    String rootDomain = "";
+    String rr = "@";
+    String recordId = "";
+    String lastNewIp = "";
+    String confirmedIp = "";
+    bool trustConfirmedIp = false;
+    String message = "";
+    String oldIp = "";
+    bool updated = false;
+    // Aliyun holds lastNewIp, either found there or just pushed.
+    bool confirmed = false;
+    DdnsSyncOutcome outcome = DdnsSyncOutcome::ResolveFailed;
+    String errorCode = "";
+    uint32_t resolveMs = 0;
+    uint32_t apiMs = 0;
+    uint32_t totalMs = 0;
+    uint32_t changeToUpdateMs = 0;
+  };
+
+  struct SyncCycle {
+    std::vector<SyncItem> items;
+    uint32_t startedAtMs = 0;
+    // Unix time; 0 while the clock is unset.
+    uint32_t startedAt = 0;
+    // Public IPv4 seen by the cycle, fed to the change history.
+    String observedPublicIp = "";
   };
 
   static void normalizeRecord(DdnsRecordConfig* record);
@@ -64,15 +181,84 @@ class DdnsService {
   static bool isRecordConfigured(const DdnsRecordConfig& record);
   static bool recordsEqual(const DdnsRecordConfig& lhs, const DdnsRecordConfig& rhs);
   static bool configsEqual(const DdnsConfig& lhs, const DdnsConfig& rhs);
+  // Same for boards whose enabled records match, in any order.
+  static uint32_t clusterIdOf(const DdnsConfig& config);
 
-  void rebuildRuntimeRecords();
+  bool startEngine();
+  static void engineTask(void* context);
+  // Runs the command inline when the engine task is not running.
+  bool post(const Command& command);
+  void handleCommand(const Command& command);
+  void applyConfig(const DdnsConfig& normalized);
+  void markAllDue();
+  void runEngine();
+  void runPass();
+  void publishStatus();
+  DdnsRuntimeStatus buildStatus() const;
+  std::vector<DdnsRecordRuntimeStatus> buildRecordStatuses() const;
+  std::vector<DdnsRecordSyncHistory> buildSyncHistory() const;
+
+  RuntimeRecord makeRuntimeRecord(const DdnsRecordConfig& config);
+  // Keeps the live state of records that survived a config change. Collects the
+  // AccessKeyIds whose key pair was not in use before the change.
+  void reconcileRuntimeRecords(std::vector<String>* renewedAccessKeyIds);
+  void retuneRuntimeRecord(RuntimeRecord* runtime, const DdnsRecordConfig& config, uint32_t now);
+  void restoreBootState();
+  // Writes the persisted state when it differs from what was last written.
+  void persistState();
   void setState(const String& state, const String& message);
   void setRecordState(RuntimeRecord* record, const String& state, const String& message);
   void configureRuntimeRecord(RuntimeRecord* runtime);
+  // Blocks the engine for the whole cycle; commands queue up meanwhile.
+  void syncDueRecords(const std::vector<size_t>& dueIndices, uint32_t now);
+  // Touches nothing but `cycle`.
+  static void runSyncCycle(SyncCycle* cycle);
+  void finishSyncCycle(const SyncCycle& cycle);
+  void applyRecordUpdate(RuntimeRecord* record, const String& oldIp, const String& newIp);
+  uint32_t planIntervalSeconds(const DdnsRecordConfig& config) const;
+  void applyPendingEvents(uint32_t now);
+  // Schedules the first check of records that have none, spreading sync groups
+  // evenly so a save with many records does not fire them in one tick.
+  void staggerFirstSyncs(uint32_t now);
+  static void onPublicIpChanged(void* context);
+
+  // Quiet period after the last event, and the longest a burst may defer a sync.
+  static constexpr uint32_t kEventDebounceMs = 2000;
+  static constexpr uint32_t kMaxEventDelayMs = 10000;
 
    ConfigStore& _configStore;
    DdnsConfig _config;
    std::vector<RuntimeRecord> _runtimeRecords;
+   IpChangeHistory _ipHistory;
+   DdnsLeaderElection _election;
+   // Loaded by begin(), consumed by the first reconcile of the runtime records.
+   std::vector<DdnsPersistedRecord> _bootState;
+   bool _bootStatePending = false;
+   std::vector<DdnsPersistedRecord> _savedState;
+
+  QueueHandle_t _commands = nullptr;
+  SemaphoreHandle_t _engineStopped = nullptr;
+  // Last Wi-Fi state handed to the engine; only tick() touches it.
+  bool _postedWifiConnected = false;
+  bool _syncInProgress = false;
+
+  // Guards the published snapshot below.
+  SemaphoreHandle_t _statusMutex = nullptr;
+  DdnsRuntimeStatus _publishedStatus;
+  std::vector<DdnsRecordRuntimeStatus> _publishedRecords;
+  bool _publishedSyncInProgress = false;
+  std::vector<DdnsRecordSyncHistory> _publishedHistory;
+  DdnsSyncSummary _publishedSyncSummary;
+  // Set when a cycle or a config change touched the history; publishing copies
+  // it only then.
+  bool _historyDirty = true;
+
+  // Guarded by _eventMux; bits are 1 << DdnsTrigger.
+  portMUX_TYPE _eventMux = portMUX_INITIALIZER_UNLOCKED;
+  uint8_t _pendingEvents = 0;
+  uint32_t _firstEventAtMs = 0;
+  uint32_t _lastEventAtMs = 0;
+  uint32_t _eventSyncCount = 0;
 
   bool _begun = false;
   bool _wifiConnected = false;
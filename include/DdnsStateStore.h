@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+#include "ConfigStore.h"
+
+// What a DDNS record learned from Aliyun, kept across reboots and OTA.
+struct DdnsPersistedRecord {
+  // DdnsStateStore::identityOf() of the record config it belongs to.
+  uint32_t identity = 0;
+  String recordId = "";
+  // Last value confirmed on Aliyun, pushed or found up to date.
+  String confirmedIp = "";
+  // Unix time of the last push; 0 when unknown.
+  uint32_t lastUpdateAt = 0;
+  uint32_t updateCount = 0;
+};
+
+// Packs the per-record DDNS runtime state into one NVS blob. Entries are
+// matched back to records by identity, so reordering records keeps them and
+// changing a record's domain, AccessKeyId or IP source drops its entry.
+class DdnsStateStore {
+ public:
+  static uint32_t identityOf(const DdnsRecordConfig& record);
+
+  // False when nothing usable is stored; `records` is cleared either way.
+  static bool load(std::vector<DdnsPersistedRecord>* records);
+  static bool save(const std::vector<DdnsPersistedRecord>& records);
+  static void clear();
+
+ private:
+  static constexpr const char* kNamespace = "ddns_state";
+  static constexpr const char* kKey = "records";
+  static constexpr uint8_t kVersion = 1;
+  // Aliyun RecordIds are decimal strings of up to 20 digits.
+  static constexpr size_t kRecordIdLength = 24;
+
+  struct Header {
+    uint8_t version;
+    uint8_t count;
+    uint16_t reserved;
+  };
+
+  struct Entry {
+    uint32_t identity;
+    uint32_t confirmedIp;
+    uint32_t lastUpdateAt;
+    uint32_t updateCount;
+    char recordId[kRecordIdLength];
+  };
+};
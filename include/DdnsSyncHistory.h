@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+enum class DdnsSyncOutcome : uint8_t {
+  // Aliyun held an old address and took the new one.
+  Updated,
+  // Aliyun already held the address.
+  UpToDate,
+  // State restored at boot vouched for the address; Aliyun was not asked.
+  Unchanged,
+  ResolveFailed,
+  ListFailed,
+  NotFound,
+  UpdateFailed
+};
+
+// One sync attempt of one record. The IP lookup is shared by every record of a
+// cycle and the record listing by every record of a zone, so those phases are
+// charged in full to each record that waited for them.
+struct DdnsSyncAttempt {
+  // millis() when the cycle started.
+  uint32_t atMs = 0;
+  // Unix time when the cycle started; 0 while the clock is unset.
+  uint32_t at = 0;
+  DdnsSyncOutcome outcome = DdnsSyncOutcome::ResolveFailed;
+  uint32_t resolveMs = 0;
+  // DescribeDomainRecords plus UpdateDomainRecord, when made.
+  uint32_t apiMs = 0;
+  // Cycle start to this record's result, including records handled before it.
+  uint32_t totalMs = 0;
+  // Updated public records only: time since the address was adopted by the
+  // public IP observer; 0 otherwise.
+  uint32_t changeToUpdateMs = 0;
+  // Aliyun error code of ListFailed / UpdateFailed.
+  char errorCode[32] = {};
+};
+
+struct DdnsLatency {
+  uint32_t p50 = 0;
+  uint32_t p95 = 0;
+};
+
+struct DdnsSyncSummary {
+  uint32_t attempts = 0;
+  uint32_t failures = 0;
+  DdnsLatency resolveMs;
+  // Over attempts that called Aliyun.
+  DdnsLatency apiMs;
+  DdnsLatency totalMs;
+  // Over Updated attempts that know when the change was seen.
+  DdnsLatency changeToUpdateMs;
+};
+
+// Last kCapacity sync attempts of one record. Storage grows on first use, so
+// disabled records cost nothing.
+class DdnsSyncHistory {
+ public:
+  static constexpr size_t kCapacity = 8;
+
+  void record(const DdnsSyncAttempt& attempt);
+  // Oldest first.
+  std::vector<DdnsSyncAttempt> attempts() const;
+  size_t size() const { return _entries.size(); }
+  void clear();
+
+  static DdnsSyncSummary summarize(const std::vector<DdnsSyncAttempt>& attempts);
+  static bool isFailure(DdnsSyncOutcome outcome);
+  static const char* outcomeName(DdnsSyncOutcome outcome);
+
+ private:
+  std::vector<DdnsSyncAttempt> _entries;
+  // Slot the next attempt overwrites once the buffer is full.
+  size_t _next = 0;
+};
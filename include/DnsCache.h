@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+struct DnsCacheStats {
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t staleFallbacks = 0;
+  uint32_t prefetches = 0;
+  uint32_t lookups = 0;
+  uint32_t lookupFailures = 0;
+  uint32_t lastLookupMs = 0;
+  uint32_t maxLookupMs = 0;
+  uint32_t totalLookupMs = 0;
+  uint32_t entries = 0;
+};
+
+// Hostname cache in front of the lwIP resolver. Lookups run on a small background
+// task, so a caller can stop waiting on a slow resolver and fall back to the last
+// address that worked. Services prefetch hosts shortly before they need them.
+class DnsCache {
+ public:
+  static constexpr uint32_t kDefaultTimeoutMs = 3000;
+
+  // IP literals are returned as-is. Returns false only when no address is known.
+  static bool resolve(const String& host,
+                      IPAddress* address,
+                      uint32_t timeoutMs = kDefaultTimeoutMs);
+  // Starts a background lookup when `host` is missing or expires soon.
+  static void prefetch(const String& host);
+  static void prefetchUrl(const String& url);
+  static String hostOfUrl(const String& url);
+  static DnsCacheStats getStats();
+  static void clear();
+
+ private:
+  static constexpr size_t kMaxEntries = 8;
+  static constexpr size_t kMaxHostLength = 64;
+  // lwIP does not report record TTLs, so entries use one conservative lifetime.
+  static constexpr uint32_t kTtlMs = 300000;
+  static constexpr uint32_t kPrefetchWindowMs = 60000;
+  // With a last-known address available, wait this long for a fresh answer.
+  static constexpr uint32_t kStaleWaitMs = 1000;
+  static constexpr uint32_t kWaitPollMs = 10;
+
+  struct Entry {
+    String host;
+    IPAddress address;
+    bool valid = false;
+    bool lookupPending = false;
+    uint32_t resolvedAtMs = 0;
+    uint32_t generation = 0;
+    uint32_t lastUsedAtMs = 0;
+  };
+
+  static Entry* entries();
+  static Entry* findOrCreate(const String& host, uint32_t now);
+  static bool queueLookup(Entry* entry);
+  static void lookupTask(void* context);
+};
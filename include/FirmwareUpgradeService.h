@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 
+#include "AsyncHttpClient.h"
 #include "ConfigStore.h"
 
 struct FirmwareUpgradeStatus;
@@ -90,9 +91,17 @@ class FirmwareUpgradeService {
                            FirmwarePackageInfo* packageInfo,
                            String* errorCode,
                            String* detailMessage) const;
-  bool queryPackageFromBemfa(FirmwarePackageInfo* packageInfo,
-                             String* errorCode,
-                             String* detailMessage) const;
+  void startPackageQuery();
+  void pollPackageQuery();
+  bool finishPackageQuery(const SharedHttpResponse& response,
+                          FirmwarePackageInfo* packageInfo,
+                          String* errorCode,
+                          String* detailMessage) const;
+  void finishRequest(RequestAction action,
+                     const FirmwarePackageInfo& packageInfo,
+                     bool packageReady,
+                     String errorCode,
+                     String detailMessage);
   bool executeUpgrade(const FirmwarePackageInfo& packageInfo,
                       String* errorCode,
                       String* detailMessage);
@@ -125,6 +134,8 @@ class FirmwareUpgradeService {
   TriggerSource _activeTrigger = TriggerSource::None;
   TriggerSource _lastTrigger = TriggerSource::None;
   RequestAction _pendingAction = RequestAction::None;
+  RequestAction _activeAction = RequestAction::None;
+  AsyncHttpFuture _lookupFuture;
   FirmwarePackageInfo _cachedPackageInfo;
   bool _hasCachedPackage = false;
 
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+
+struct GatewayIpStats {
+  // "UNKNOWN", "NAT_PMP", "UPNP" or "UNAVAILABLE".
+  String method = "UNKNOWN";
+  String gateway = "";
+  uint32_t natPmpAnswers = 0;
+  uint32_t upnpAnswers = 0;
+  uint32_t cacheHits = 0;
+  uint32_t failures = 0;
+  // Router answered with a private/CGNAT WAN address (double NAT).
+  uint32_t privateWan = 0;
+  uint32_t discoveries = 0;
+};
+
+// Asks the LAN gateway for its WAN address, via NAT-PMP (RFC 6886) or UPnP IGD
+// GetExternalIPAddress. The working method and the answer are cached; a gateway
+// without either protocol is not asked again until reset() or a new gateway.
+class GatewayIpProbe {
+ public:
+  static constexpr uint16_t kNatPmpPort = 5351;
+  static constexpr uint16_t kSsdpPort = 1900;
+
+  // True with a public IPv4 in `ipv4`; private WAN addresses are rejected.
+  static bool queryExternalIp(uint32_t timeoutMs, String* ipv4);
+  // Forgets the gateway, its method and the cached address (Wi-Fi reconnect).
+  static void reset();
+  // Points both protocols at `host` (unicast SSDP) instead of the DHCP gateway;
+  // an empty host restores auto-discovery. For local stand-ins.
+  static void setGateway(const String& host,
+                         uint16_t natPmpPort = kNatPmpPort,
+                         uint16_t ssdpPort = kSsdpPort);
+  static GatewayIpStats getStats();
+
+  static bool isPublicIpv4(const IPAddress& address);
+
+ private:
+  enum class Method : uint8_t { Unknown, NatPmp, Upnp, Unavailable };
+
+  static constexpr uint32_t kCacheTtlMs = 60000;
+  // A gateway that spoke neither protocol is retried after this long.
+  static constexpr uint32_t kUnavailableRetryMs = 30UL * 60UL * 1000UL;
+  static constexpr uint32_t kNatPmpTimeoutMs = 600;
+  static constexpr uint32_t kSsdpTimeoutMs = 1000;
+
+  static bool queryNatPmp(const IPAddress& gateway, uint32_t timeoutMs, IPAddress* external);
+  static bool queryUpnp(const IPAddress& gateway, uint32_t timeoutMs, IPAddress* external);
+  static bool discoverUpnpControl(const IPAddress& gateway, uint32_t timeoutMs);
+  static bool parseNatPmpResponse(const uint8_t* packet, size_t length, IPAddress* external);
+  static String parseSsdpLocation(const uint8_t* packet, size_t length);
+  static bool parseUpnpDescription(const String& location,
+                                   const String& description,
+                                   String* controlUrl,
+                                   String* serviceType);
+  static bool parseExternalIpResponse(const String& body, IPAddress* external);
+  static const char* methodName(Method method);
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <memory>
+
+struct SharedHttpRequest;
+struct SharedHttpResponse;
+
+// Thin platform seams. Each interface mirrors the Arduino API it replaces, so
+// services keep their call shape and only swap the type. ESP32 implementations
+// live in HalEsp32.cpp, Linux ones (native env) in HalLinux.cpp; tests and host
+// benchmarks may install their own through the Hal setters.
+
+class HalClock {
+ public:
+  virtual ~HalClock() = default;
+  virtual uint32_t millis() = 0;
+  virtual void delay(uint32_t ms) = 0;
+  // Wall clock in microseconds since the Unix epoch.
+  virtual int64_t unixTimeUs() = 0;
+  // Steps the wall clock; a slew still in progress is dropped.
+  virtual bool setUnixTimeUs(int64_t unixUs) = 0;
+  // Moves the wall clock by `offsetUs` gradually, on top of any unfinished slew.
+  virtual bool slewUnixTimeUs(int64_t offsetUs) = 0;
+};
+
+class HalWifiStatus {
+ public:
+  virtual ~HalWifiStatus() = default;
+  virtual bool isConnected() = 0;
+  virtual IPAddress localIp() = 0;
+  virtual IPAddress gatewayIp() = 0;
+  virtual bool hostByName(const char* host, IPAddress* address) = 0;
+};
+
+// Outbound HTTP(S) transport behind SharedHttpClient.
+class HalHttpClient {
+ public:
+  virtual ~HalHttpClient() = default;
+  // Returns true when an HTTP status was received (any code).
+  virtual bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) = 0;
+  virtual void closeIdleConnections() {}
+  virtual void closeAll() {}
+};
+
+// One open namespace, Preferences-style. Typed getters keep the on-flash NVS types.
+class HalKeyValueStore {
+ public:
+  virtual ~HalKeyValueStore() = default;
+  virtual bool begin(const char* name, bool readOnly) = 0;
+  virtual void end() = 0;
+  virtual bool isKey(const char* key) = 0;
+  virtual bool remove(const char* key) = 0;
+  virtual bool getBool(const char* key, bool defaultValue) = 0;
+  virtual size_t putBool(const char* key, bool value) = 0;
+  virtual uint8_t getUChar(const char* key, uint8_t defaultValue) = 0;
+  virtual size_t putUChar(const char* key, uint8_t value) = 0;
+  virtual uint16_t getUShort(const char* key, uint16_t defaultValue) = 0;
+  virtual size_t putUShort(const char* key, uint16_t value) = 0;
+  virtual int32_t getInt(const char* key, int32_t defaultValue) = 0;
+  virtual size_t putInt(const char* key, int32_t value) = 0;
+  virtual uint32_t getUInt(const char* key, uint32_t defaultValue) = 0;
+  virtual size_t putUInt(const char* key, uint32_t value) = 0;
+  virtual uint32_t getULong(const char* key, uint32_t defaultValue) = 0;
+  virtual size_t putULong(const char* key, uint32_t value) = 0;
+  virtual String getString(const char* key, const String& defaultValue) = 0;
+  virtual size_t putString(const char* key, const String& value) = 0;
+  virtual size_t getBytesLength(const char* key) = 0;
+  virtual size_t getBytes(const char* key, void* buffer, size_t length) = 0;
+  virtual size_t putBytes(const char* key, const void* value, size_t length) = 0;
+};
+
+// Connectionless socket, WiFiUDP-style.
+class HalUdpSocket {
+ public:
+  virtual ~HalUdpSocket() = default;
+  virtual bool begin(uint16_t localPort) = 0;
+  // Binds `port` and joins the IPv4 multicast group; false where unsupported.
+  virtual bool beginMulticast(const IPAddress& /*group*/, uint16_t /*port*/) { return false; }
+  virtual void stop() = 0;
+  virtual bool beginPacket(const IPAddress& address, uint16_t port) = 0;
+  virtual size_t write(const uint8_t* data, size_t length) = 0;
+  virtual bool endPacket() = 0;
+  // Size of the next datagram, 0 when none is waiting. Never blocks.
+  virtual int parsePacket() = 0;
+  virtual int read(uint8_t* buffer, size_t length) = 0;
+  virtual IPAddress remoteIP() = 0;
+  virtual uint16_t remotePort() = 0;
+};
+
+class Hal {
+ public:
+  using KeyValueStoreFactory = HalKeyValueStore* (*)();
+  using UdpSocketFactory = HalUdpSocket* (*)();
+
+  static HalClock& clock();
+  static HalWifiStatus& wifi();
+  static HalHttpClient& http();
+  static std::unique_ptr<HalKeyValueStore> createKeyValueStore();
+  static std::unique_ptr<HalUdpSocket> createUdpSocket();
+
+  // Overrides for tests and host runs; nullptr restores the platform default.
+  static void setClock(HalClock* clock);
+  static void setWifiStatus(HalWifiStatus* wifi);
+  static void setHttpClient(HalHttpClient* http);
+  static void setKeyValueStoreFactory(KeyValueStoreFactory factory);
+  static void setUdpSocketFactory(UdpSocketFactory factory);
+
+ private:
+  // Provided by the platform file compiled into the current environment.
+  static HalClock& defaultClock();
+  static HalWifiStatus& defaultWifiStatus();
+  static HalHttpClient& defaultHttpClient();
+  static HalKeyValueStore* createDefaultKeyValueStore();
+  static HalUdpSocket* createDefaultUdpSocket();
+};
+
+// Stack handle over Hal::createKeyValueStore(); drop-in for a local Preferences.
+class KeyValueStore {
+ public:
+  KeyValueStore() : _store(Hal::createKeyValueStore()) {}
+
+  bool begin(const char* name, bool readOnly = false) { return _store->begin(name, readOnly); }
+  void end() { _store->end(); }
+  bool isKey(const char* key) { return _store->isKey(key); }
+  bool remove(const char* key) { return _store->remove(key); }
+  bool getBool(const char* key, bool defaultValue = false) {
+    return _store->getBool(key, defaultValue);
+  }
+  size_t putBool(const char* key, bool value) { return _store->putBool(key, value); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) {
+    return _store->getUChar(key, defaultValue);
+  }
+  size_t putUChar(const char* key, uint8_t value) { return _store->putUChar(key, value); }
+  uint16_t getUShort(const char* key, uint16_t defaultValue = 0) {
+    return _store->getUShort(key, defaultValue);
+  }
+  size_t putUShort(const char* key, uint16_t value) { return _store->putUShort(key, value); }
+  int32_t getInt(const char* key, int32_t defaultValue = 0) {
+    return _store->getInt(key, defaultValue);
+  }
+  size_t putInt(const char* key, int32_t value) { return _store->putInt(key, value); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0) {
+    return _store->getUInt(key, defaultValue);
+  }
+  size_t putUInt(const char* key, uint32_t value) { return _store->putUInt(key, value); }
+  uint32_t getULong(const char* key, uint32_t defaultValue = 0) {
+    return _store->getULong(key, defaultValue);
+  }
+  size_t putULong(const char* key, uint32_t value) { return _store->putULong(key, value); }
+  String getString(const char* key, const String& defaultValue = String()) {
+    return _store->getString(key, defaultValue);
+  }
+  size_t putString(const char* key, const String& value) { return _store->putString(key, value); }
+  size_t getBytesLength(const char* key) { return _store->getBytesLength(key); }
+  size_t getBytes(const char* key, void* buffer, size_t length) {
+    return _store->getBytes(key, buffer, length);
+  }
+  size_t putBytes(const char* key, const void* value, size_t length) {
+    return _store->putBytes(key, value, length);
+  }
+
+ private:
+  std::unique_ptr<HalKeyValueStore> _store;
+};
+
+// Stack handle over Hal::createUdpSocket(); drop-in for a local WiFiUDP.
+class UdpSocket {
+ public:
+  UdpSocket() : _socket(Hal::createUdpSocket()) {}
+
+  bool begin(uint16_t localPort) { return _socket->begin(localPort); }
+  bool beginMulticast(const IPAddress& group, uint16_t port) {
+    return _socket->beginMulticast(group, port);
+  }
+  void stop() { _socket->stop(); }
+  bool beginPacket(const IPAddress& address, uint16_t port) {
+    return _socket->beginPacket(address, port);
+  }
+  size_t write(const uint8_t* data, size_t length) { return _socket->write(data, length); }
+  bool endPacket() { return _socket->endPacket(); }
+  int parsePacket() { return _socket->parsePacket(); }
+  int read(uint8_t* buffer, size_t length) { return _socket->read(buffer, length); }
+  IPAddress remoteIP() { return _socket->remoteIP(); }
+  uint16_t remotePort() { return _socket->remotePort(); }
+
+ private:
+  std::unique_ptr<HalUdpSocket> _socket;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Persisted log of when the public IPv4 changed, used to plan how often DDNS
+// checks it: often around times of day the address changed before (nightly PPPoE
+// redials), rarely while it has been stable. Times are Unix seconds.
+class IpChangeHistory {
+ public:
+  static constexpr size_t kMaxChanges = 16;
+  // Wall-clock times before 2021-01-01 mean the clock has not been set yet.
+  static constexpr uint32_t kMinValidUnixTime = 1609459200;
+
+  void load();
+  // Feeds one observed address; true when it differs from the previous one.
+  bool observe(const String& ipv4, uint32_t unixTime);
+  // Seconds until the next check, within [minSeconds, maxSeconds]; `baseSeconds`
+  // is the interval right after a change or while the clock is unknown.
+  uint32_t planIntervalSeconds(uint32_t unixTime,
+                               uint32_t baseSeconds,
+                               uint32_t minSeconds,
+                               uint32_t maxSeconds) const;
+
+  size_t changeCount() const { return _count; }
+  uint32_t lastChangeAt() const { return _count == 0 ? 0 : _changes[_count - 1]; }
+  // Median time between recorded changes; 0 with fewer than two.
+  uint32_t typicalGapSeconds() const;
+  void clear();
+
+ private:
+  static constexpr const char* kNamespace = "ddns_hist";
+  static constexpr const char* kKey = "changes";
+  static constexpr uint8_t kVersion = 1;
+  static constexpr uint32_t kSecondsPerDay = 86400;
+  // Two changes this close in time of day mark a recurring change window.
+  static constexpr uint32_t kHotWindowSeconds = 20 * 60;
+  // While stable, check once per this fraction of the stable period...
+  static constexpr uint32_t kStabilityDivisor = 24;
+  // ...but at least this many times per typical gap between changes.
+  static constexpr uint32_t kChecksPerGap = 16;
+
+  struct Stored {
+    uint8_t version;
+    uint8_t count;
+    uint16_t reserved;
+    uint32_t startedAt;
+    uint32_t lastIp;
+    uint32_t changes[kMaxChanges];
+  };
+
+  bool isHotTimeOfDay(uint32_t secondOfDay) const;
+  // 0 when `unixTime` is inside a change window.
+  uint32_t secondsUntilHotWindow(uint32_t unixTime) const;
+  void save() const;
+
+  uint32_t _startedAt = 0;
+  uint32_t _lastIp = 0;
+  uint32_t _changes[kMaxChanges] = {};
+  size_t _count = 0;
+};
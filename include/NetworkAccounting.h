@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+
+enum class NetSubsystem : uint8_t {
+  Ddns,
+  PublicIp,
+  Ota,
+  BemfaMqtt,
+  Ntp,
+  HostProbe,
+  WakeOnLan,
+  WebPortal,
+  Other,
+  Count
+};
+
+// Byte counts are application payload (HTTP bodies, URLs, UDP datagrams, MQTT
+// messages); TCP/TLS framing and HTTP headers are not visible at this layer.
+struct NetSubsystemCounters {
+  uint32_t bytesIn = 0;
+  uint32_t bytesOut = 0;
+  uint32_t requests = 0;
+  uint32_t connections = 0;
+  uint32_t tlsHandshakes = 0;
+  uint32_t dnsLookups = 0;
+  uint32_t failures = 0;
+  uint32_t blockedMs = 0;
+};
+
+// Per-subsystem network I/O counters. Services open a Scope around their network
+// work; shared layers (SharedHttpClient, DnsCache) charge the subsystem of the
+// calling task, so nested calls such as a DDNS sync resolving the public IP are
+// attributed to the innermost scope.
+class NetworkAccounting {
+ public:
+  class Scope {
+   public:
+    explicit Scope(NetSubsystem subsystem);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    NetSubsystem _previous;
+  };
+
+  static NetSubsystem current();
+  static const char* subsystemName(NetSubsystem subsystem);
+
+  static void addTransfer(uint32_t bytesIn, uint32_t bytesOut);
+  static void addConnection(bool tls);
+  static void addDnsLookup();
+  static void addFailure();
+  static void addBlockedMs(uint32_t elapsedMs);
+  // Charges a transfer to `subsystem` regardless of the current scope.
+  static void addTransferTo(NetSubsystem subsystem, uint32_t bytesIn, uint32_t bytesOut);
+  // Bytes only: for datagrams that answer a request already counted on send,
+  // or that arrive unsolicited.
+  static void addReceived(uint32_t bytesIn);
+  static void addReceivedTo(NetSubsystem subsystem, uint32_t bytesIn);
+
+  static NetSubsystemCounters getCounters(NetSubsystem subsystem);
+  static void reset();
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "PublicIpService.h"
+
+enum class PublicIpConfidence : uint8_t {
+  None,
+  // Reported by one source (or the same source on consecutive checks).
+  Single,
+  // Two independent sources reported the same address.
+  Agreed
+};
+
+struct PublicIpObservation {
+  String ipv4 = "";
+  String source = "";
+  // Second source that agreed with `source`; empty when unconfirmed.
+  String confirmedBy = "";
+  PublicIpConfidence confidence = PublicIpConfidence::None;
+  // Last time a source reported `ipv4`.
+  uint32_t checkedAtMs = 0;
+  uint32_t changedAtMs = 0;
+};
+
+struct PublicIpObserverStats {
+  uint32_t lookups = 0;
+  uint32_t cacheHits = 0;
+  uint32_t changes = 0;
+  // Lookups of a second source to confirm a change.
+  uint32_t confirmations = 0;
+  // The second source reported a different address than the first.
+  uint32_t disagreements = 0;
+  // Reported changes not adopted (yet) for lack of agreement.
+  uint32_t heldChanges = 0;
+};
+
+// Single owner of the current public IPv4. Consumers read the cached observation
+// instead of resolving on their own; a stale one is refreshed by the first caller
+// while concurrent callers wait for its answer. With agreement required, a new
+// address is adopted only once a second source confirms it, or the first source
+// repeats it while no other source answers.
+class PublicIpObserver {
+ public:
+  static constexpr uint32_t kDefaultMaxAgeMs = 60000;
+
+  // Called after an adopted change, on the task that refreshed; keep it short.
+  using ChangeListener = void (*)(void* context);
+
+  // Public IPv4, from the cache when the observation is younger than maxAgeMs.
+  // useLocalIp returns the station address and bypasses the cache.
+  static String resolve(bool useLocalIp = false,
+                        uint32_t timeoutMs = PublicIpService::kDefaultTimeoutMs,
+                        uint32_t maxAgeMs = kDefaultMaxAgeMs);
+  static PublicIpObservation getObservation();
+  static PublicIpObserverStats getStats();
+
+  static void setChangeListener(ChangeListener listener, void* context);
+  // Clears the listener if it was registered with `context`.
+  static void removeChangeListener(void* context);
+
+  static void setRequireAgreement(bool required);
+  static bool getRequireAgreement();
+
+  // The next resolve asks again; the old address stays for comparison.
+  static void onWifiReconnected();
+  // Forgets the observation and statistics.
+  static void reset();
+
+  static const char* confidenceName(PublicIpConfidence confidence);
+
+ private:
+  // Checks in a row a lone source must repeat a new address when nobody can confirm it.
+  static constexpr uint8_t kUnconfirmedRepeats = 2;
+
+  static String refresh(uint32_t timeoutMs);
+  static PublicIpSource confirm(PublicIpSource primary,
+                                const String& ipv4,
+                                uint32_t startMs,
+                                uint32_t timeoutMs,
+                                bool* contradicted);
+};
@@ -1,17 +1,81 @@
 #pragma once
 
 #include <Arduino.h>
+#include <vector>
+
+#include "UdpPublicIpProbe.h"
+
+enum class PublicIpDiscoveryMode : uint8_t {
+  // The router's WAN address (NAT-PMP / UPnP IGD), then UdpFirst.
+  GatewayFirst,
+  // STUN, then a DNS echo query, then the HTTPS echo endpoints.
+  UdpFirst,
+  HttpsOnly
+};
+
+// Which kind of service answered a resolve.
+enum class PublicIpSource : uint8_t { None, Gateway, Stun, DnsEcho, Https };
+
+struct PublicIpDiscoveryStats {
+  uint32_t gatewayAnswers = 0;
+  uint32_t stunAnswers = 0;
+  uint32_t dnsEchoAnswers = 0;
+  // Resolves where both UDP probes went unanswered.
+  uint32_t udpFailures = 0;
+  // Resolves that skipped UDP because of an earlier failure.
+  uint32_t udpSkipped = 0;
+  uint32_t httpsFallbacks = 0;
+};
+
+struct PublicIpEndpointStats {
+  String url = "";
+  // Smoothed request latency; failures count as the full timeout. 0 = no sample yet.
+  uint32_t latencyEwmaMs = 0;
+  uint32_t successes = 0;
+  uint32_t failures = 0;
+  // Resolves this endpoint answered first.
+  uint32_t wins = 0;
+};
 
 class PublicIpService {
  public:
   static constexpr uint32_t kDefaultTimeoutMs = 5000;
 
+  // Tries the sources of the discovery mode in order (gateway, UDP probes); when
+  // none answers, asks the HTTPS echo endpoints fastest-first and fires the next one when the current
+  // one fails or lags its usual latency; the first valid IPv4 wins.
   static String resolveIpv4(bool useLocalIp = false,
                             uint32_t timeoutMs = kDefaultTimeoutMs);
   static String resolve(bool useLocalIp = false,
                         uint32_t timeoutMs = kDefaultTimeoutMs);
+  // Public IPv4 as resolveIpv4() finds it, reporting which source answered.
+  static String resolveWithSource(uint32_t timeoutMs, PublicIpSource* source);
+  // Asks one source only (e.g. to cross-check another); "" when it does not answer.
+  static String resolveFrom(PublicIpSource source, uint32_t timeoutMs = kDefaultTimeoutMs);
+  // Whether the current discovery mode uses `source` at all.
+  static bool isSourceEnabled(PublicIpSource source);
+  static const char* sourceName(PublicIpSource source);
+
+  static void setDiscoveryMode(PublicIpDiscoveryMode mode);
+  static PublicIpDiscoveryMode getDiscoveryMode();
+  // An empty host restores the public default.
+  static void setStunServer(const String& host,
+                            uint16_t port = UdpPublicIpProbe::kDefaultStunPort);
+  static void setDnsEchoServer(const String& server,
+                               uint16_t port = UdpPublicIpProbe::kDefaultDnsPort);
+
+  static std::vector<PublicIpEndpointStats> getEndpointStats();
+  static PublicIpDiscoveryStats getDiscoveryStats();
+  // Clears endpoint and discovery statistics and any UDP backoff.
+  static void resetEndpointStats();
+  // The LAN may have changed: rediscover the gateway and retry UDP probes.
+  static void onWifiReconnected();
+
+  // Warms DnsCache for the IP echo services ahead of a resolve.
+  static void prefetchHosts();
 
  private:
+  static String resolveOverUdp(uint32_t startMs, uint32_t timeoutMs, PublicIpSource* source);
   static String fetchFromUrl(const char* url, uint32_t timeoutMs);
   static String extractIpv4FromText(const String& response);
 };
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+#include <vector>
+
+class HTTPClient;
+class HalHttpClient;
+class WiFiClient;
+
+struct SharedHttpHeader {
+  String name;
+  String value;
+};
+
+struct SharedHttpRequest {
+  String method = "GET";
+  String url = "";
+  String body = "";
+  String contentType = "";
+  String userAgent = "";
+  // Sent in addition to Content-Type / User-Agent (e.g. SOAPAction).
+  std::vector<SharedHttpHeader> headers;
+  uint32_t timeoutMs = 10000;
+  bool followRedirects = false;
+};
+
+struct SharedHttpResponse {
+  int httpCode = -1;
+  String body = "";
+  // Date is collected on every response so callers can learn server time.
+  String dateHeader = "";
+  bool reusedConnection = false;
+};
+
+struct SharedHttpStats {
+  uint32_t requests = 0;
+  uint32_t connectionsOpened = 0;
+  uint32_t connectionsReused = 0;
+  uint32_t tlsHandshakes = 0;
+  uint32_t handshakesAvoided = 0;
+  uint32_t staleRetries = 0;
+  uint32_t pooledConnections = 0;
+};
+
+// HTTP(S) client shared by the outbound services. Requests go to Hal::http(); on
+// ESP32 that is the pool below, which keeps one keep-alive connection per origin
+// so repeated calls to the same host skip the TCP and TLS handshake. A connection
+// is used by one request at a time; overlapping requests to a busy origin fall
+// back to a one-shot connection.
+class SharedHttpClient {
+ public:
+  // Told about every response that carries a Date header, on the requesting task.
+  using DateListener = void (*)(const String& httpDate,
+                                uint32_t requestStartMs,
+                                uint32_t responseAtMs,
+                                void* context);
+
+  // Returns true when an HTTP status was received (any code).
+  static bool perform(const SharedHttpRequest& request, SharedHttpResponse* response);
+  // Releases pooled connections idle for longer than kIdleTimeoutMs; call from loop().
+  static void closeIdleConnections();
+  static void closeAll();
+  static SharedHttpStats getStats();
+  // The keep-alive pool as a HalHttpClient; ESP32 builds only.
+  static HalHttpClient& pooledTransport();
+
+  static void setDateListener(DateListener listener, void* context);
+  // Clears the listener only if it was registered with `context`.
+  static void removeDateListener(void* context);
+  // IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+  static bool parseHttpDate(const String& value, time_t* unixTime);
+
+ private:
+  class PooledTransport;
+
+  static constexpr size_t kMaxPooledOrigins = 3;
+  // A pooled TLS session pins ~40 KB of heap, so idle ones are not kept for long.
+  static constexpr uint32_t kIdleTimeoutMs = 15000;
+
+  struct Slot {
+    String origin;
+    bool secure = false;
+    bool busy = false;
+    uint32_t lastUsedAtMs = 0;
+    WiFiClient* client = nullptr;
+    HTTPClient* http = nullptr;
+  };
+
+  static bool exchange(const SharedHttpRequest& request, SharedHttpResponse* response);
+  static void closeIdleSlots();
+  static void closeAllSlots();
+  static Slot* slots();
+  static Slot* acquireSlot(const String& origin, bool secure, uint32_t now);
+  static void releaseSlot(Slot* slot);
+  static void closeSlot(Slot* slot);
+  static int sendOnce(HTTPClient& http,
+                      WiFiClient& client,
+                      bool secure,
+                      const SharedHttpRequest& request,
+                      SharedHttpResponse* response);
+  static bool connectResolved(WiFiClient& client,
+                              bool secure,
+                              const String& url,
+                              uint32_t timeoutMs);
+  static String originOf(const String& url, bool* secure);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+struct SntpSample {
+  String server = "";
+  // Add to the local clock to get the server's time.
+  int64_t offsetUs = 0;
+  // Network round trip, minus the time the server held the request.
+  int64_t delayUs = 0;
+  uint8_t stratum = 0;
+};
+
+// SNTP (RFC 4330) over several servers at once. Each reply yields offset and
+// delay from all four timestamps: t1 request sent, t2 received by the server,
+// t3 reply sent by the server, t4 reply received.
+class SntpClient {
+ public:
+  static constexpr uint16_t kPort = 123;
+  static constexpr size_t kPacketSize = 48;
+  static constexpr size_t kMaxServers = 4;
+
+  // Sends one request to each server back to back and collects the replies that
+  // arrive within timeoutMs; returns how many answered. Blocks the calling task,
+  // which should be a background one: replies are timestamped while polling.
+  static size_t query(const char* const* servers,
+                      size_t count,
+                      uint32_t timeoutMs,
+                      std::vector<SntpSample>* samples);
+  // Lowest delay wins: it bounds the offset error most tightly (delay / 2).
+  static bool selectBest(const std::vector<SntpSample>& samples, SntpSample* best);
+
+  // Wall clock in microseconds since the Unix epoch, as kept by HalClock.
+  static int64_t localClockUs();
+  static uint64_t unixUsToNtp(int64_t unixUs);
+  // Timestamps before 1970 in NTP era 0 are taken as era 1 (after 2036).
+  static int64_t ntpToUnixUs(uint64_t ntp);
+  static void buildRequest(uint64_t transmitNtp, uint8_t* packet);
+  // Rejects replies that are not a server answer to the request sent at
+  // `requestNtp` (mode, stratum, leap alarm, echoed transmit timestamp).
+  static bool parseResponse(const uint8_t* packet,
+                            size_t length,
+                            uint64_t requestNtp,
+                            int64_t t1Us,
+                            int64_t t4Us,
+                            SntpSample* sample);
+
+ private:
+  static constexpr uint32_t kPollMs = 1;
+};
@@ -1,35 +1,67 @@
 ﻿#pragma once
 
 #include <Arduino.h>
+#include <memory>
+
+#include "ClockDiscipline.h"
+#include "CoarseClock.h"
 
 class TimeService {
  public:
   TimeService() = default;
+  ~TimeService();
 
   void begin();
   void tick(bool wifiConnected);
+  // Starts a background round against several servers; tick() applies the
+  // result. False when WiFi is down or a round is already running.
   bool sync(bool wifiConnected);
 
   bool isSynced() const { return _synced; }
+  // NTP synced, or set from HTTP Date headers while NTP is unavailable.
+  bool hasValidTime() const { return _synced || _hasCoarseTime; }
+  // "NTP", "HTTP_DATE" or "NONE".
+  String getTimeSource() const;
+  uint32_t getCoarseUncertaintyMs() const;
+  uint8_t getCoarseSources() const;
   uint32_t getUnixTime() const;
   uint64_t getUnixTimeMs() const;
   String getFormattedTime() const;
   uint32_t getLastSyncTime() const { return _lastSyncTime; }
+  int32_t getDriftPpb() const { return _discipline.driftPpb(); }
+  uint8_t getDriftConfidence() const { return _discipline.confidence(); }
+  uint32_t getSyncIntervalSeconds() const { return _discipline.intervalSeconds(); }
+  // Offset the last sync corrected.
+  int32_t getLastOffsetMs() const { return _lastOffsetMs; }
   String getState() const { return _state; }
   String getMessage() const { return _message; }
 
+  // Longest interval the adaptive schedule may reach.
   void setSyncInterval(uint32_t intervalSeconds);
 
  private:
-  static constexpr uint16_t kNtpPort = 123;
   static constexpr uint32_t kNtpTimeoutMs = 5000;
-  static constexpr uint32_t kDefaultSyncIntervalSeconds = 86400;
+  static constexpr size_t kParallelServers = 3;
+  static constexpr uint32_t kDefaultSyncIntervalSeconds = 4 * 86400;
   static constexpr uint32_t kMinSyncIntervalSeconds = 3600;
+  // Keeps due times comparable as signed millis() differences.
+  static constexpr uint32_t kMaxSyncIntervalSeconds = 7 * 86400;
+  static constexpr uint32_t kDriftSlewIntervalMs = 60000;
   static constexpr uint32_t kRetryIntervalSeconds = 300;
 
-  bool queryNtpServer(const char* server, uint32_t* unixTime);
-  uint32_t ntpToUnix(uint32_t ntpSeconds, uint32_t ntpFraction);
-  uint32_t parseNtpPacket(const uint8_t* packet, size_t length);
+  struct SntpRound;
+
+  static void roundTask(void* context);
+  static void runRound(SntpRound* round);
+  bool roundFinished() const;
+  void finishRound();
+  static void onHttpDate(const String& httpDate,
+                         uint32_t requestStartMs,
+                         uint32_t responseAtMs,
+                         void* context);
+  void applyHttpDate();
+  static void stepClock(int64_t offsetUs);
+  static bool slewClock(int64_t offsetUs);
   void setState(const String& state, const String& message);
 
   uint32_t _syncIntervalSeconds = kDefaultSyncIntervalSeconds;
@@ -40,7 +72,13 @@ class TimeService {
   uint32_t _lastSyncAttemptMs = 0;
   uint32_t _nextSyncDueMs = 0;
   uint32_t _serverIndex = 0;
-  uint32_t _timeOffset = 0;
+  int32_t _lastOffsetMs = 0;
+  uint32_t _lastDriftSlewMs = 0;
+  ClockDiscipline _discipline;
+  // Fed from whichever task made the request; guarded by gDateMux.
+  CoarseClock _coarse;
+  bool _hasCoarseTime = false;
+  std::shared_ptr<SntpRound> _round;
 
   String _state = "DISABLED";
   String _message = "Time service not started.";
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+// Learns the public IPv4 from a single UDP exchange instead of an HTTPS request:
+// a STUN Binding request (RFC 5389) or an A query for an echo name such as
+// myip.opendns.com sent to a resolver that answers with the querying address.
+class UdpPublicIpProbe {
+ public:
+  static constexpr uint16_t kDefaultStunPort = 3478;
+  static constexpr uint16_t kDefaultDnsPort = 53;
+
+  static bool queryStun(const String& host, uint16_t port, uint32_t timeoutMs, String* ipv4);
+  static bool queryDnsEcho(const String& server,
+                           uint16_t port,
+                           const String& name,
+                           uint32_t timeoutMs,
+                           String* ipv4);
+
+  using ResponseParser = std::function<bool(const uint8_t* packet, size_t length)>;
+
+  // Sends `request` to host:port, repeating it every kRetransmitMs, until `parse`
+  // accepts a reply or the timeout passes. Replies from other peers are ignored
+  // unless `anyPeer` is set (multicast queries are answered by unicast).
+  static bool exchange(const String& host,
+                       uint16_t port,
+                       const uint8_t* request,
+                       size_t requestLength,
+                       uint32_t timeoutMs,
+                       const ResponseParser& parse,
+                       bool anyPeer = false);
+
+ private:
+  static constexpr size_t kStunHeaderSize = 20;
+  static constexpr size_t kStunTransactionIdSize = 12;
+  static constexpr uint32_t kStunMagicCookie = 0x2112A442;
+  static constexpr size_t kMaxDatagramSize = 1024;
+  // UDP has no delivery guarantee; the request is repeated at this interval.
+  static constexpr uint32_t kRetransmitMs = 300;
+  static constexpr uint32_t kPollMs = 5;
+
+  static size_t buildStunRequest(const uint8_t* transactionId, uint8_t* packet, size_t capacity);
+  static bool parseStunResponse(const uint8_t* packet,
+                                size_t length,
+                                const uint8_t* transactionId,
+                                String* ipv4);
+  static size_t buildDnsQuery(uint16_t id, const String& name, uint8_t* packet, size_t capacity);
+  static bool parseDnsResponse(const uint8_t* packet, size_t length, uint16_t id, String* ipv4);
+};
@@ -9,6 +9,11 @@ struct WifiNetworkInfo {
   bool secured;
 };
 
+enum class WifiLinkEvent : uint8_t { GotIp, LostIp };
+
+// Runs on the Wi-Fi event task: keep it short and thread-safe.
+using WifiLinkEventCallback = void (*)(WifiLinkEvent event, void* context);
+
 struct WifiScanResult {
   std::vector<WifiNetworkInfo> networks;
   bool fromCache = false;
@@ -23,6 +28,8 @@ class WifiService {
   bool connectTo(const String& ssid, const String& password, uint32_t timeoutMs = 15000);
   bool reconnectFromStored(uint32_t timeoutMs = 15000);
   void tick();
+  // Reports station GOT_IP / LOST_IP (and disconnects) as they happen.
+  void setLinkEventCallback(WifiLinkEventCallback callback, void* context = nullptr);
 
   bool isConnected() const;
   bool isConnecting() const;
@@ -54,4 +61,7 @@ class WifiService {
   String _connectTargetSsid;
   String _connectTargetPassword;
   String _lastMessage = "Not connected.";
+  WifiLinkEventCallback _linkEventCallback = nullptr;
+  void* _linkEventContext = nullptr;
+  bool _linkEventsRegistered = false;
 };
@@ -0,0 +1,50 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+std::mutex gGeneratorMutex;
+
+std::mt19937& generator() {
+  static std::mt19937 instance(std::random_device{}());
+  return instance;
+}
+}  // namespace
+
+// Truncated to 32 bits so wrap-around matches the ESP32 core.
+unsigned long micros() {
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count());
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+long random(long max) {
+  return max <= 0 ? 0 : random(0, max);
+}
+
+long random(long min, long max) {
+  if (max <= min) {
+    return min;
+  }
+  std::uniform_int_distribution<long> distribution(min, max - 1);
+  std::lock_guard<std::mutex> lock(gGeneratorMutex);
+  return distribution(generator());
+}
+
+void randomSeed(unsigned long seed) {
+  std::lock_guard<std::mutex> lock(gGeneratorMutex);
+  generator().seed(static_cast<std::mt19937::result_type>(seed));
+}
+
+uint32_t esp_random() {
+  std::lock_guard<std::mutex> lock(gGeneratorMutex);
+  return static_cast<uint32_t>(generator()());
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+
+typedef bool boolean;
+
+#define PROGMEM
+#define LOW 0
+#define HIGH 1
+
+// millis() and delay() are defined by the platform HAL (src/HalLinux.cpp) so an
+// injected HalClock drives every service on the host.
+unsigned long millis();
+void delay(uint32_t ms);
+unsigned long micros();
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
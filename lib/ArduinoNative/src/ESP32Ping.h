@@ -0,0 +1,16 @@
+#pragma once
+
+#include "IPAddress.h"
+
+// Raw ICMP needs CAP_NET_RAW on Linux, so host builds report every ping as lost
+// and HostProbeService falls back to its TCP probe.
+class PingClass {
+ public:
+  bool ping(const IPAddress& address, unsigned char count = 5) {
+    (void)address;
+    (void)count;
+    return false;
+  }
+};
+
+extern PingClass Ping;
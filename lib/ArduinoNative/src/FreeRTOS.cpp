@@ -0,0 +1,172 @@
+#include <pthread.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+struct NativeSemaphore {
+  std::mutex mutex;
+  std::condition_variable available;
+  unsigned int count = 0;
+};
+
+struct NativeQueue {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length = 0;
+  size_t itemSize = 0;
+};
+
+namespace {
+template <typename Predicate>
+bool waitFor(std::condition_variable& condition,
+             std::unique_lock<std::mutex>& lock,
+             TickType_t ticksToWait,
+             Predicate predicate) {
+  if (ticksToWait == portMAX_DELAY) {
+    condition.wait(lock, predicate);
+    return true;
+  }
+  return condition.wait_for(lock, std::chrono::milliseconds(ticksToWait), predicate);
+}
+}  // namespace
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  NativeSemaphore* semaphore = new NativeSemaphore();
+  semaphore->count = 1;
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return new NativeSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  if (!waitFor(semaphore->available, lock, ticksToWait, [semaphore]() {
+        return semaphore->count > 0;
+      })) {
+    return pdFALSE;
+  }
+  semaphore->count -= 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count > 0) {
+      return pdFALSE;
+    }
+    semaphore->count = 1;
+  }
+  semaphore->available.notify_one();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete semaphore;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  NativeQueue* queue = new NativeQueue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!waitFor(queue->changed, lock, ticksToWait, [queue]() {
+        return queue->items.size() < queue->length;
+      })) {
+    return pdFALSE;
+  }
+  const uint8_t* bytes = static_cast<const uint8_t*>(item);
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  lock.unlock();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+  return xQueueSend(queue, item, ticksToWait);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!waitFor(queue->changed, lock, ticksToWait, [queue]() { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  lock.unlock();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return static_cast<UBaseType_t>(queue->items.size());
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+  delete queue;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task,
+                       const char* name,
+                       uint32_t stackDepth,
+                       void* parameters,
+                       UBaseType_t priority,
+                       TaskHandle_t* createdTask) {
+  (void)stackDepth;
+  (void)priority;
+  std::thread worker([task, parameters]() { task(parameters); });
+  if (name != nullptr) {
+    char threadName[16];
+    strncpy(threadName, name, sizeof(threadName) - 1);
+    threadName[sizeof(threadName) - 1] = '\0';
+    pthread_setname_np(worker.native_handle(), threadName);
+  }
+  if (createdTask != nullptr) {
+    *createdTask = reinterpret_cast<TaskHandle_t>(worker.native_handle());
+  }
+  worker.detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task,
+                                   const char* name,
+                                   uint32_t stackDepth,
+                                   void* parameters,
+                                   UBaseType_t priority,
+                                   TaskHandle_t* createdTask,
+                                   BaseType_t core) {
+  (void)core;
+  return xTaskCreate(task, name, stackDepth, parameters, priority, createdTask);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr) {
+    pthread_exit(nullptr);
+  }
+}
+
+TickType_t xTaskGetTickCount() {
+  return millis();
+}
@@ -0,0 +1,66 @@
+#include "IPAddress.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) {
+  _bytes[0] = first;
+  _bytes[1] = second;
+  _bytes[2] = third;
+  _bytes[3] = fourth;
+}
+
+IPAddress::IPAddress(uint32_t address) {
+  memcpy(_bytes, &address, sizeof(_bytes));
+}
+
+bool IPAddress::fromString(const char* address) {
+  if (address == nullptr) {
+    return false;
+  }
+
+  uint8_t parsed[4] = {0, 0, 0, 0};
+  int part = 0;
+  int value = -1;
+  for (const char* cursor = address;; ++cursor) {
+    const char c = *cursor;
+    if (c >= '0' && c <= '9') {
+      value = (value < 0 ? 0 : value * 10) + (c - '0');
+      if (value > 255) {
+        return false;
+      }
+      continue;
+    }
+    if ((c != '.' && c != '\0') || value < 0 || part > 3) {
+      return false;
+    }
+    parsed[part++] = static_cast<uint8_t>(value);
+    value = -1;
+    if (c == '\0') {
+      break;
+    }
+  }
+  if (part != 4) {
+    return false;
+  }
+  memcpy(_bytes, parsed, sizeof(_bytes));
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+  return String(buffer);
+}
+
+IPAddress::operator uint32_t() const {
+  uint32_t address = 0;
+  memcpy(&address, _bytes, sizeof(address));
+  return address;
+}
+
+bool IPAddress::operator==(const IPAddress& other) const {
+  return memcmp(_bytes, other._bytes, sizeof(_bytes)) == 0;
+}
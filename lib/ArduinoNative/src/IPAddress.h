@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "WString.h"
+
+class IPAddress {
+ public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+  // Network byte order, as lwIP and the ESP32 core store it.
+  IPAddress(uint32_t address);
+
+  bool fromString(const char* address);
+  bool fromString(const String& address) { return fromString(address.c_str()); }
+  String toString() const;
+
+  operator uint32_t() const;
+  bool operator==(const IPAddress& other) const;
+  bool operator!=(const IPAddress& other) const { return !(*this == other); }
+  uint8_t operator[](int index) const { return _bytes[index & 3]; }
+  uint8_t& operator[](int index) { return _bytes[index & 3]; }
+
+ private:
+  uint8_t _bytes[4];
+};
+
+extern const IPAddress INADDR_NONE;
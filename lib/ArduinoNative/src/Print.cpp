@@ -0,0 +1,67 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+HardwareSerial Serial;
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  for (size_t index = 0; index < size; ++index) {
+    written += write(buffer[index]);
+  }
+  return written;
+}
+
+size_t Print::print(const String& value) {
+  return write(reinterpret_cast<const uint8_t*>(value.c_str()), value.length());
+}
+
+size_t Print::print(const char* value) {
+  return value != nullptr ? write(reinterpret_cast<const uint8_t*>(value), strlen(value)) : 0;
+}
+
+size_t Print::print(char value) {
+  return write(static_cast<uint8_t>(value));
+}
+
+size_t Print::print(int value) {
+  return print(String(value));
+}
+
+size_t Print::print(unsigned int value) {
+  return print(String(value));
+}
+
+size_t Print::print(long value) {
+  return print(String(value));
+}
+
+size_t Print::print(unsigned long value) {
+  return print(String(value));
+}
+
+size_t Print::println() {
+  return print("\r\n");
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length <= 0) {
+    return 0;
+  }
+  return print(buffer);
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+  return fputc(value, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
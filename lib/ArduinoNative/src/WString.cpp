@@ -0,0 +1,304 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+
+namespace {
+std::string formatUnsigned(unsigned long long value, unsigned char base) {
+  if (base < 2 || base > 36) {
+    base = 10;
+  }
+  if (value == 0) {
+    return "0";
+  }
+  std::string digits;
+  while (value > 0) {
+    const unsigned digit = static_cast<unsigned>(value % base);
+    digits.insert(digits.begin(), static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10));
+    value /= base;
+  }
+  return digits;
+}
+
+std::string formatSigned(long long value, unsigned char base) {
+  if (value < 0 && base == 10) {
+    return "-" + formatUnsigned(0ULL - static_cast<unsigned long long>(value), base);
+  }
+  return formatUnsigned(static_cast<unsigned long long>(value), base);
+}
+
+std::string formatFloating(double value, unsigned int decimalPlaces) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", static_cast<int>(decimalPlaces), value);
+  return buffer;
+}
+}  // namespace
+
+String::String(unsigned char value, unsigned char base) : _value(formatUnsigned(value, base)) {}
+String::String(int value, unsigned char base) : _value(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _value(formatUnsigned(value, base)) {}
+String::String(long value, unsigned char base) : _value(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _value(formatUnsigned(value, base)) {}
+String::String(long long value, unsigned char base) : _value(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base)
+    : _value(formatUnsigned(value, base)) {}
+String::String(float value, unsigned int decimalPlaces)
+    : _value(formatFloating(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces)
+    : _value(formatFloating(value, decimalPlaces)) {}
+
+String& String::operator=(const char* value) {
+  _value = value != nullptr ? value : "";
+  return *this;
+}
+
+bool String::reserve(unsigned int size) {
+  _value.reserve(size);
+  return true;
+}
+
+char String::charAt(unsigned int index) const {
+  return index < _value.size() ? _value[index] : '\0';
+}
+
+char& String::operator[](unsigned int index) {
+  static char dummy = '\0';
+  if (index >= _value.size()) {
+    dummy = '\0';
+    return dummy;
+  }
+  return _value[index];
+}
+
+void String::setCharAt(unsigned int index, char value) {
+  if (index < _value.size()) {
+    _value[index] = value;
+  }
+}
+
+int String::indexOf(char value, unsigned int from) const {
+  const size_t found = _value.find(value, from);
+  return found == std::string::npos ? -1 : static_cast<int>(found);
+}
+
+int String::indexOf(const String& value, unsigned int from) const {
+  if (from > _value.size()) {
+    return -1;
+  }
+  const size_t found = _value.find(value._value, from);
+  return found == std::string::npos ? -1 : static_cast<int>(found);
+}
+
+int String::lastIndexOf(char value) const {
+  const size_t found = _value.rfind(value);
+  return found == std::string::npos ? -1 : static_cast<int>(found);
+}
+
+int String::lastIndexOf(char value, unsigned int from) const {
+  const size_t found = _value.rfind(value, from);
+  return found == std::string::npos ? -1 : static_cast<int>(found);
+}
+
+int String::lastIndexOf(const String& value) const {
+  const size_t found = _value.rfind(value._value);
+  return found == std::string::npos ? -1 : static_cast<int>(found);
+}
+
+String String::substring(unsigned int from) const {
+  return substring(from, length());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    const unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= _value.size()) {
+    return String();
+  }
+  if (to > _value.size()) {
+    to = static_cast<unsigned int>(_value.size());
+  }
+  return String(_value.substr(from, to - from));
+}
+
+void String::trim() {
+  size_t begin = 0;
+  while (begin < _value.size() && isspace(static_cast<unsigned char>(_value[begin]))) {
+    ++begin;
+  }
+  size_t end = _value.size();
+  while (end > begin && isspace(static_cast<unsigned char>(_value[end - 1]))) {
+    --end;
+  }
+  _value = _value.substr(begin, end - begin);
+}
+
+void String::toLowerCase() {
+  for (char& c : _value) {
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  }
+}
+
+void String::toUpperCase() {
+  for (char& c : _value) {
+    c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+  }
+}
+
+void String::replace(char find, char replacement) {
+  for (char& c : _value) {
+    if (c == find) {
+      c = replacement;
+    }
+  }
+}
+
+void String::replace(const String& find, const String& replacement) {
+  if (find._value.empty()) {
+    return;
+  }
+  size_t position = 0;
+  while ((position = _value.find(find._value, position)) != std::string::npos) {
+    _value.replace(position, find._value.size(), replacement._value);
+    position += replacement._value.size();
+  }
+}
+
+void String::remove(unsigned int index) {
+  if (index < _value.size()) {
+    _value.erase(index);
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < _value.size()) {
+    _value.erase(index, count);
+  }
+}
+
+bool String::startsWith(const String& prefix) const {
+  return _value.compare(0, prefix._value.size(), prefix._value) == 0;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+  return offset <= _value.size() &&
+         _value.compare(offset, prefix._value.size(), prefix._value) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return suffix._value.size() <= _value.size() &&
+         _value.compare(_value.size() - suffix._value.size(), suffix._value.size(),
+                        suffix._value) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+  return _value.size() == other._value.size() &&
+         strncasecmp(_value.c_str(), other._value.c_str(), _value.size()) == 0;
+}
+
+long String::toInt() const {
+  return strtol(_value.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const {
+  return strtof(_value.c_str(), nullptr);
+}
+
+double String::toDouble() const {
+  return strtod(_value.c_str(), nullptr);
+}
+
+void String::getBytes(unsigned char* buffer, unsigned int size, unsigned int index) const {
+  toCharArray(reinterpret_cast<char*>(buffer), size, index);
+}
+
+void String::toCharArray(char* buffer, unsigned int size, unsigned int index) const {
+  if (buffer == nullptr || size == 0) {
+    return;
+  }
+  if (index >= _value.size()) {
+    buffer[0] = '\0';
+    return;
+  }
+  const size_t count = std::min<size_t>(size - 1, _value.size() - index);
+  memcpy(buffer, _value.data() + index, count);
+  buffer[count] = '\0';
+}
+
+bool String::concat(const String& value) {
+  _value += value._value;
+  return true;
+}
+
+bool String::concat(const char* value) {
+  if (value == nullptr) {
+    return false;
+  }
+  _value += value;
+  return true;
+}
+
+bool String::concat(const char* value, unsigned int length) {
+  if (value == nullptr) {
+    return false;
+  }
+  _value.append(value, length);
+  return true;
+}
+
+bool String::concat(char value) {
+  _value += value;
+  return true;
+}
+
+String& String::operator+=(const String& value) {
+  concat(value);
+  return *this;
+}
+
+String& String::operator+=(const char* value) {
+  concat(value);
+  return *this;
+}
+
+String& String::operator+=(char value) {
+  concat(value);
+  return *this;
+}
+
+String operator+(const String& lhs, const String& rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const String& lhs, const char* rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const char* lhs, const String& rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const String& lhs, char rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(char lhs, const String& rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <type_traits>
+
+// Arduino String for host builds, backed by std::string. Only the members the
+// services use are provided; semantics follow the ESP32 core.
+class String {
+ public:
+  String(const char* value = "") : _value(value != nullptr ? value : "") {}
+  String(const char* value, size_t length) : _value(value != nullptr ? value : "", length) {}
+  String(const String& other) = default;
+  String(String&& other) noexcept = default;
+  explicit String(const std::string& value) : _value(value) {}
+  explicit String(char value) : _value(1, value) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+  ~String() = default;
+
+  String& operator=(const String& other) = default;
+  String& operator=(String&& other) noexcept = default;
+  String& operator=(const char* value);
+
+  unsigned int length() const { return static_cast<unsigned int>(_value.size()); }
+  bool isEmpty() const { return _value.empty(); }
+  const char* c_str() const { return _value.c_str(); }
+  bool reserve(unsigned int size);
+  void clear() { _value.clear(); }
+
+  char charAt(unsigned int index) const;
+  char operator[](unsigned int index) const { return charAt(index); }
+  char& operator[](unsigned int index);
+  void setCharAt(unsigned int index, char value);
+
+  int indexOf(char value, unsigned int from = 0) const;
+  int indexOf(const String& value, unsigned int from = 0) const;
+  int indexOf(const char* value, unsigned int from = 0) const { return indexOf(String(value), from); }
+  int lastIndexOf(char value) const;
+  int lastIndexOf(char value, unsigned int from) const;
+  int lastIndexOf(const String& value) const;
+  String substring(unsigned int from) const;
+  String substring(unsigned int from, unsigned int to) const;
+
+  void trim();
+  void toLowerCase();
+  void toUpperCase();
+  void replace(char find, char replacement);
+  void replace(const String& find, const String& replacement);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+
+  bool startsWith(const String& prefix) const;
+  bool startsWith(const String& prefix, unsigned int offset) const;
+  bool endsWith(const String& suffix) const;
+  bool equals(const String& other) const { return _value == other._value; }
+  bool equalsIgnoreCase(const String& other) const;
+  int compareTo(const String& other) const { return _value.compare(other._value); }
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+  void getBytes(unsigned char* buffer, unsigned int size, unsigned int index = 0) const;
+  void toCharArray(char* buffer, unsigned int size, unsigned int index = 0) const;
+
+  bool concat(const String& value);
+  bool concat(const char* value);
+  bool concat(const char* value, unsigned int length);
+  bool concat(char value);
+
+  String& operator+=(const String& value);
+  String& operator+=(const char* value);
+  String& operator+=(char value);
+  template <typename T,
+            typename = typename std::enable_if<std::is_arithmetic<T>::value &&
+                                               !std::is_same<T, char>::value>::type>
+  String& operator+=(T value) {
+    return *this += String(value);
+  }
+
+  bool operator==(const String& other) const { return _value == other._value; }
+  bool operator==(const char* other) const { return _value == (other != nullptr ? other : ""); }
+  bool operator!=(const String& other) const { return !(*this == other); }
+  bool operator!=(const char* other) const { return !(*this == other); }
+  bool operator<(const String& other) const { return _value < other._value; }
+  bool operator>(const String& other) const { return _value > other._value; }
+  bool operator<=(const String& other) const { return _value <= other._value; }
+  bool operator>=(const String& other) const { return _value >= other._value; }
+
+ private:
+  std::string _value;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+String operator+(char lhs, const String& rhs);
+template <typename T,
+          typename = typename std::enable_if<std::is_arithmetic<T>::value &&
+                                             !std::is_same<T, char>::value>::type>
+String operator+(const String& lhs, T rhs) {
+  return lhs + String(rhs);
+}
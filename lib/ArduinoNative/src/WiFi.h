@@ -0,0 +1,5 @@
+#pragma once
+
+// Host builds read Wi-Fi state through HalWifiStatus; only the client is needed.
+#include "IPAddress.h"
+#include "WiFiClient.h"
@@ -0,0 +1,58 @@
+#include "WiFiClient.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ESP32Ping.h"
+
+PingClass Ping;
+
+WiFiClient::~WiFiClient() {
+  stop();
+}
+
+int WiFiClient::connect(const IPAddress& address, uint16_t port, int32_t timeoutMs) {
+  stop();
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (_fd < 0) {
+    return 0;
+  }
+
+  sockaddr_in target = {};
+  target.sin_family = AF_INET;
+  target.sin_port = htons(port);
+  target.sin_addr.s_addr = static_cast<uint32_t>(address);
+
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+  if (::connect(_fd, reinterpret_cast<sockaddr*>(&target), sizeof(target)) != 0) {
+    if (errno != EINPROGRESS) {
+      stop();
+      return 0;
+    }
+    pollfd descriptor = {_fd, POLLOUT, 0};
+    int error = 0;
+    socklen_t errorLength = sizeof(error);
+    if (poll(&descriptor, 1, timeoutMs) != 1 ||
+        getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0 || error != 0) {
+      stop();
+      return 0;
+    }
+  }
+  return 1;
+}
+
+uint8_t WiFiClient::connected() {
+  return _fd >= 0 ? 1 : 0;
+}
+
+void WiFiClient::stop() {
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+  }
+}
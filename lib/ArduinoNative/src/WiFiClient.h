@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "IPAddress.h"
+
+// Blocking TCP client over POSIX sockets; covers the connect probe only.
+class WiFiClient {
+ public:
+  WiFiClient() = default;
+  virtual ~WiFiClient();
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+
+  int connect(const IPAddress& address, uint16_t port, int32_t timeoutMs);
+  uint8_t connected();
+  void stop();
+
+ private:
+  int _fd = -1;
+};
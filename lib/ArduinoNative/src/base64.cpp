@@ -0,0 +1,25 @@
+#include "base64.h"
+
+namespace {
+constexpr const char* kAlphabet =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}  // namespace
+
+String base64::encode(const uint8_t* data, size_t length) {
+  String encoded;
+  encoded.reserve(static_cast<unsigned int>((length + 2) / 3 * 4));
+  for (size_t index = 0; index < length; index += 3) {
+    const uint32_t chunk = (static_cast<uint32_t>(data[index]) << 16) |
+                           (index + 1 < length ? static_cast<uint32_t>(data[index + 1]) << 8 : 0) |
+                           (index + 2 < length ? static_cast<uint32_t>(data[index + 2]) : 0);
+    encoded += kAlphabet[(chunk >> 18) & 0x3F];
+    encoded += kAlphabet[(chunk >> 12) & 0x3F];
+    encoded += index + 1 < length ? kAlphabet[(chunk >> 6) & 0x3F] : '=';
+    encoded += index + 2 < length ? kAlphabet[chunk & 0x3F] : '=';
+  }
+  return encoded;
+}
+
+String base64::encode(const String& text) {
+  return encode(reinterpret_cast<const uint8_t*>(text.c_str()), text.length());
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WString.h"
+
+class base64 {
+ public:
+  static String encode(const uint8_t* data, size_t length);
+  static String encode(const String& text);
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <mutex>
+
+// FreeRTOS surface used by the services, mapped onto std::thread primitives.
+// One tick is one millisecond.
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define tskNO_AFFINITY 0x7fffffff
+
+struct portMUX_TYPE {
+  std::mutex mutex;
+};
+#define portMUX_INITIALIZER_UNLOCKED \
+  {}
+
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) {
+  mux->mutex.lock();
+}
+
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) {
+  mux->mutex.unlock();
+}
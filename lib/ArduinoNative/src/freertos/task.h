@@ -0,0 +1,25 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+// Tasks run on detached threads; stack size and priority are ignored.
+BaseType_t xTaskCreate(TaskFunction_t task,
+                       const char* name,
+                       uint32_t stackDepth,
+                       void* parameters,
+                       UBaseType_t priority,
+                       TaskHandle_t* createdTask);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task,
+                                   const char* name,
+                                   uint32_t stackDepth,
+                                   void* parameters,
+                                   UBaseType_t priority,
+                                   TaskHandle_t* createdTask,
+                                   BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+// Only deleting the calling task (nullptr) is supported.
+void vTaskDelete(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
@@ -0,0 +1,169 @@
+#include "md.h"
+
+#include <string.h>
+
+namespace {
+constexpr size_t kBlockSize = 64;
+constexpr size_t kDigestSize = 20;
+const mbedtls_md_info_t kSha1Info = {MBEDTLS_MD_SHA1};
+
+uint32_t rotateLeft(uint32_t value, unsigned bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+void sha1Reset(mbedtls_md_context_t* context) {
+  context->state[0] = 0x67452301;
+  context->state[1] = 0xEFCDAB89;
+  context->state[2] = 0x98BADCFE;
+  context->state[3] = 0x10325476;
+  context->state[4] = 0xC3D2E1F0;
+  context->totalLength = 0;
+  context->blockLength = 0;
+}
+
+void sha1Block(mbedtls_md_context_t* context, const uint8_t* block) {
+  uint32_t words[80];
+  for (int index = 0; index < 16; ++index) {
+    words[index] = (static_cast<uint32_t>(block[index * 4]) << 24) |
+                   (static_cast<uint32_t>(block[index * 4 + 1]) << 16) |
+                   (static_cast<uint32_t>(block[index * 4 + 2]) << 8) |
+                   static_cast<uint32_t>(block[index * 4 + 3]);
+  }
+  for (int index = 16; index < 80; ++index) {
+    words[index] = rotateLeft(
+        words[index - 3] ^ words[index - 8] ^ words[index - 14] ^ words[index - 16], 1);
+  }
+
+  uint32_t a = context->state[0];
+  uint32_t b = context->state[1];
+  uint32_t c = context->state[2];
+  uint32_t d = context->state[3];
+  uint32_t e = context->state[4];
+  for (int index = 0; index < 80; ++index) {
+    uint32_t f = 0;
+    uint32_t k = 0;
+    if (index < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else if (index < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else if (index < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    const uint32_t next = rotateLeft(a, 5) + f + e + k + words[index];
+    e = d;
+    d = c;
+    c = rotateLeft(b, 30);
+    b = a;
+    a = next;
+  }
+  context->state[0] += a;
+  context->state[1] += b;
+  context->state[2] += c;
+  context->state[3] += d;
+  context->state[4] += e;
+}
+
+void sha1Update(mbedtls_md_context_t* context, const uint8_t* input, size_t length) {
+  context->totalLength += length;
+  while (length > 0) {
+    const size_t take = kBlockSize - context->blockLength < length
+                            ? kBlockSize - context->blockLength
+                            : length;
+    memcpy(context->block + context->blockLength, input, take);
+    context->blockLength += take;
+    input += take;
+    length -= take;
+    if (context->blockLength == kBlockSize) {
+      sha1Block(context, context->block);
+      context->blockLength = 0;
+    }
+  }
+}
+
+void sha1Finish(mbedtls_md_context_t* context, uint8_t* output) {
+  const uint64_t bitLength = context->totalLength * 8;
+  const uint8_t pad = 0x80;
+  const uint8_t zero = 0;
+  sha1Update(context, &pad, 1);
+  while (context->blockLength != 56) {
+    sha1Update(context, &zero, 1);
+  }
+  uint8_t lengthBytes[8];
+  for (int index = 0; index < 8; ++index) {
+    lengthBytes[index] = static_cast<uint8_t>(bitLength >> (56 - index * 8));
+  }
+  sha1Update(context, lengthBytes, sizeof(lengthBytes));
+  for (int index = 0; index < 5; ++index) {
+    output[index * 4] = static_cast<uint8_t>(context->state[index] >> 24);
+    output[index * 4 + 1] = static_cast<uint8_t>(context->state[index] >> 16);
+    output[index * 4 + 2] = static_cast<uint8_t>(context->state[index] >> 8);
+    output[index * 4 + 3] = static_cast<uint8_t>(context->state[index]);
+  }
+}
+}  // namespace
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type) {
+  return type == MBEDTLS_MD_SHA1 ? &kSha1Info : nullptr;
+}
+
+void mbedtls_md_init(mbedtls_md_context_t* context) {
+  memset(context, 0, sizeof(*context));
+}
+
+int mbedtls_md_setup(mbedtls_md_context_t* context, const mbedtls_md_info_t* info, int hmac) {
+  if (info == nullptr || hmac == 0) {
+    return -1;
+  }
+  context->info = info;
+  return 0;
+}
+
+int mbedtls_md_hmac_starts(mbedtls_md_context_t* context,
+                           const unsigned char* key,
+                           size_t keyLength) {
+  uint8_t keyBlock[kBlockSize];
+  memset(keyBlock, 0, sizeof(keyBlock));
+  if (keyLength > kBlockSize) {
+    sha1Reset(context);
+    sha1Update(context, key, keyLength);
+    sha1Finish(context, keyBlock);
+  } else {
+    memcpy(keyBlock, key, keyLength);
+  }
+
+  uint8_t innerKeyPad[kBlockSize];
+  for (size_t index = 0; index < kBlockSize; ++index) {
+    innerKeyPad[index] = keyBlock[index] ^ 0x36;
+    context->outerKeyPad[index] = keyBlock[index] ^ 0x5C;
+  }
+  sha1Reset(context);
+  sha1Update(context, innerKeyPad, sizeof(innerKeyPad));
+  return 0;
+}
+
+int mbedtls_md_hmac_update(mbedtls_md_context_t* context,
+                           const unsigned char* input,
+                           size_t length) {
+  sha1Update(context, input, length);
+  return 0;
+}
+
+int mbedtls_md_hmac_finish(mbedtls_md_context_t* context, unsigned char* output) {
+  uint8_t innerDigest[kDigestSize];
+  sha1Finish(context, innerDigest);
+  sha1Reset(context);
+  sha1Update(context, context->outerKeyPad, kBlockSize);
+  sha1Update(context, innerDigest, sizeof(innerDigest));
+  sha1Finish(context, output);
+  return 0;
+}
+
+void mbedtls_md_free(mbedtls_md_context_t* context) {
+  memset(context, 0, sizeof(*context));
+}
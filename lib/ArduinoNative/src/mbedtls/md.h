@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The HMAC-SHA1 slice of the mbedTLS message digest API the Aliyun signer uses.
+typedef enum { MBEDTLS_MD_NONE = 0, MBEDTLS_MD_SHA1 = 4 } mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t {
+  mbedtls_md_type_t type;
+} mbedtls_md_info_t;
+
+typedef struct mbedtls_md_context_t {
+  const mbedtls_md_info_t* info;
+  uint32_t state[5];
+  uint64_t totalLength;
+  uint8_t block[64];
+  size_t blockLength;
+  uint8_t outerKeyPad[64];
+} mbedtls_md_context_t;
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type);
+void mbedtls_md_init(mbedtls_md_context_t* context);
+int mbedtls_md_setup(mbedtls_md_context_t* context, const mbedtls_md_info_t* info, int hmac);
+int mbedtls_md_hmac_starts(mbedtls_md_context_t* context, const unsigned char* key, size_t keyLength);
+int mbedtls_md_hmac_update(mbedtls_md_context_t* context, const unsigned char* input, size_t length);
+int mbedtls_md_hmac_finish(mbedtls_md_context_t* context, unsigned char* output);
+void mbedtls_md_free(mbedtls_md_context_t* context);
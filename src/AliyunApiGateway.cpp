@@ -0,0 +1,154 @@
+#include "AliyunApiGateway.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace {
+SemaphoreHandle_t gatewayMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+class GatewayLock {
+ public:
+  GatewayLock() { xSemaphoreTake(gatewayMutex(), portMAX_DELAY); }
+  ~GatewayLock() { xSemaphoreGive(gatewayMutex()); }
+};
+
+AliyunGatewayStats gStats;
+uint32_t gNextGeneration = 1;
+}  // namespace
+
+std::vector<AliyunApiGateway::Entry>& AliyunApiGateway::entries() {
+  static std::vector<Entry> instance;
+  return instance;
+}
+
+void AliyunApiGateway::execute(const String& key,
+                               const Fetcher& fetch,
+                               AliyunGatewayResult* result,
+                               uint32_t timeoutMs) {
+  if (result == nullptr || !fetch) {
+    return;
+  }
+
+  uint32_t generation = 0;
+  std::shared_ptr<Flight> flight;
+  {
+    GatewayLock lock;
+    const uint32_t now = millis();
+    pruneLocked(now);
+
+    Entry* entry = find(key);
+    if (entry != nullptr && !entry->inFlight) {
+      gStats.cacheHits += 1;
+      *result = entry->result;
+      return;
+    }
+
+    if (entry == nullptr) {
+      Entry created;
+      created.key = key;
+      created.generation = gNextGeneration++;
+      created.flight = std::make_shared<Flight>();
+      entries().push_back(created);
+      generation = created.generation;
+      flight = created.flight;
+    } else {
+      gStats.coalescedCalls += 1;
+      flight = entry->flight;
+    }
+  }
+
+  if (generation != 0) {
+    AliyunGatewayResult fetched;
+    fetch(&fetched);
+
+    {
+      GatewayLock lock;
+      gStats.networkCalls += 1;
+      Entry* entry = find(key);
+      if (entry != nullptr && entry->generation == generation) {
+        entry->inFlight = false;
+        entry->result = fetched;
+        entry->flight.reset();
+        // Failures reach the current waiters but are never served from cache.
+        entry->completedAtMs = fetched.errorCode.isEmpty() ? millis() : millis() - kCacheTtlMs;
+      }
+      flight->result = fetched;
+    }
+    xSemaphoreGive(flight->done);
+    *result = fetched;
+    return;
+  }
+
+  // Each waiter hands the signal on to the next, so one give wakes them all.
+  if (xSemaphoreTake(flight->done, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
+    result->response = "";
+    result->errorCode = "gateway_timeout";
+    return;
+  }
+  xSemaphoreGive(flight->done);
+  GatewayLock lock;
+  *result = flight->result;
+}
+
+void AliyunApiGateway::invalidate(const String& credentialKey) {
+  GatewayLock lock;
+  std::vector<Entry>& registry = entries();
+  for (size_t index = registry.size(); index > 0; --index) {
+    if (registry[index - 1].key.startsWith(credentialKey)) {
+      registry.erase(registry.begin() + (index - 1));
+      gStats.invalidations += 1;
+    }
+  }
+}
+
+void AliyunApiGateway::reset() {
+  GatewayLock lock;
+  entries().clear();
+  gStats = AliyunGatewayStats();
+}
+
+AliyunGatewayStats AliyunApiGateway::getStats() {
+  GatewayLock lock;
+  return gStats;
+}
+
+AliyunApiGateway::Entry* AliyunApiGateway::find(const String& key) {
+  std::vector<Entry>& registry = entries();
+  for (size_t index = 0; index < registry.size(); ++index) {
+    if (registry[index].key == key) {
+      return &registry[index];
+    }
+  }
+  return nullptr;
+}
+
+void AliyunApiGateway::pruneLocked(uint32_t now) {
+  std::vector<Entry>& registry = entries();
+  for (size_t index = registry.size(); index > 0; --index) {
+    const Entry& entry = registry[index - 1];
+    if (!entry.inFlight && now - entry.completedAtMs >= kCacheTtlMs) {
+      registry.erase(registry.begin() + (index - 1));
+    }
+  }
+
+  // In-flight entries are never evicted; their waiters depend on them.
+  while (registry.size() >= kMaxEntries) {
+    size_t victim = registry.size();
+    for (size_t index = 0; index < registry.size(); ++index) {
+      if (registry[index].inFlight) {
+        continue;
+      }
+      if (victim == registry.size() ||
+          static_cast<int32_t>(registry[index].completedAtMs - registry[victim].completedAtMs) < 0) {
+        victim = index;
+      }
+    }
+    if (victim == registry.size()) {
+      break;
+    }
+    registry.erase(registry.begin() + victim);
+  }
+}
@@ -0,0 +1,236 @@
+#include "AliyunCircuitBreaker.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace {
+SemaphoreHandle_t registryMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+class RegistryLock {
+ public:
+  RegistryLock() { xSemaphoreTake(registryMutex(), portMAX_DELAY); }
+  ~RegistryLock() { xSemaphoreGive(registryMutex()); }
+};
+}  // namespace
+
+std::vector<AliyunCircuitBreaker::Entry>& AliyunCircuitBreaker::entries() {
+  static std::vector<Entry> instance;
+  return instance;
+}
+
+AliyunErrorClass AliyunCircuitBreaker::classifyError(const String& errorCode, int httpCode) {
+  if (errorCode.isEmpty()) {
+    if (httpCode == 200) {
+      return AliyunErrorClass::None;
+    }
+    if (httpCode <= 0 || httpCode >= 500) {
+      return AliyunErrorClass::Transient;
+    }
+    return AliyunErrorClass::Client;
+  }
+
+  if (errorCode.startsWith("Throttling")) {
+    return AliyunErrorClass::Throttled;
+  }
+  if (errorCode.startsWith("InvalidTimeStamp") || errorCode == "SignatureNonceUsed") {
+    return AliyunErrorClass::ClockSkew;
+  }
+  if (errorCode.startsWith("InvalidAccessKeyId") || errorCode.startsWith("Forbidden") ||
+      errorCode == "SignatureDoesNotMatch" || errorCode == "IncompleteSignature" ||
+      errorCode == "InvalidAccessKeySecret") {
+    return AliyunErrorClass::Auth;
+  }
+  if (errorCode == "ServiceUnavailable" || errorCode == "InternalError" ||
+      errorCode == "UnknownError" || errorCode == "network_error" || httpCode >= 500 ||
+      httpCode <= 0) {
+    return AliyunErrorClass::Transient;
+  }
+
+  // Business errors (duplicate record, bad RR, ...) mean the API itself is healthy.
+  return AliyunErrorClass::Client;
+}
+
+String AliyunCircuitBreaker::errorClassToText(AliyunErrorClass errorClass) {
+  switch (errorClass) {
+    case AliyunErrorClass::None:
+      return "NONE";
+    case AliyunErrorClass::Throttled:
+      return "THROTTLED";
+    case AliyunErrorClass::Transient:
+      return "TRANSIENT";
+    case AliyunErrorClass::ClockSkew:
+      return "CLOCK_SKEW";
+    case AliyunErrorClass::Auth:
+      return "AUTH";
+    case AliyunErrorClass::Client:
+      return "CLIENT";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+bool AliyunCircuitBreaker::allowRequest(const String& accessKeyId, uint32_t now) {
+  RegistryLock lock;
+  Entry* entry = findOrCreate(accessKeyId, now);
+  if (entry == nullptr) {
+    return true;
+  }
+
+  if (entry->state == State::Closed) {
+    return true;
+  }
+
+  if (entry->state == State::Open && static_cast<int32_t>(now - entry->openUntilMs) >= 0) {
+    entry->state = State::HalfOpen;
+    return true;
+  }
+
+  entry->shortCircuitCount += 1;
+  return false;
+}
+
+void AliyunCircuitBreaker::recordResult(const String& accessKeyId,
+                                        AliyunErrorClass errorClass,
+                                        const String& errorCode,
+                                        uint32_t now) {
+  RegistryLock lock;
+  Entry* entry = findOrCreate(accessKeyId, now);
+  if (entry == nullptr) {
+    return;
+  }
+
+  if (errorClass == AliyunErrorClass::None || errorClass == AliyunErrorClass::Client) {
+    entry->state = State::Closed;
+    entry->consecutiveFailures = 0;
+    entry->openCount = 0;
+    return;
+  }
+
+  entry->consecutiveFailures += 1;
+  entry->lastErrorClass = errorClass;
+  entry->lastErrorCode = errorCode;
+  entry->lastFailureAtMs = now;
+
+  // Throttling and auth errors are explicit server verdicts; trip immediately.
+  const bool tripNow = errorClass == AliyunErrorClass::Throttled ||
+                       errorClass == AliyunErrorClass::Auth || entry->state == State::HalfOpen ||
+                       entry->consecutiveFailures >= kFailureThreshold;
+  if (!tripNow) {
+    return;
+  }
+
+  entry->openCount += 1;
+  entry->state = State::Open;
+  entry->openUntilMs = now + backoffMs(*entry);
+}
+
+void AliyunCircuitBreaker::reset() {
+  RegistryLock lock;
+  entries().clear();
+}
+
+void AliyunCircuitBreaker::reset(const String& accessKeyId) {
+  RegistryLock lock;
+  std::vector<Entry>& registry = entries();
+  for (size_t index = registry.size(); index > 0; --index) {
+    if (registry[index - 1].accessKeyId == accessKeyId) {
+      registry.erase(registry.begin() + (index - 1));
+    }
+  }
+}
+
+std::vector<AliyunBreakerStatus> AliyunCircuitBreaker::getStatuses(uint32_t now) {
+  RegistryLock lock;
+  std::vector<AliyunBreakerStatus> statuses;
+  statuses.reserve(entries().size());
+  for (size_t index = 0; index < entries().size(); ++index) {
+    const Entry& entry = entries()[index];
+    AliyunBreakerStatus status;
+    status.accessKeyId = entry.accessKeyId;
+    status.state = stateToText(entry.state);
+    status.lastErrorCode = entry.lastErrorCode;
+    status.lastErrorClass = errorClassToText(entry.lastErrorClass);
+    status.consecutiveFailures = entry.consecutiveFailures;
+    status.openCount = entry.openCount;
+    status.shortCircuitCount = entry.shortCircuitCount;
+    status.lastFailureAtMs = entry.lastFailureAtMs;
+    if (entry.state == State::Open && static_cast<int32_t>(entry.openUntilMs - now) > 0) {
+      status.retryInMs = entry.openUntilMs - now;
+    }
+    statuses.push_back(status);
+  }
+  return statuses;
+}
+
+AliyunCircuitBreaker::Entry* AliyunCircuitBreaker::findOrCreate(const String& accessKeyId,
+                                                                uint32_t now) {
+  if (accessKeyId.isEmpty()) {
+    return nullptr;
+  }
+
+  std::vector<Entry>& registry = entries();
+  for (size_t index = 0; index < registry.size(); ++index) {
+    if (registry[index].accessKeyId == accessKeyId) {
+      registry[index].lastUsedAtMs = now;
+      return &registry[index];
+    }
+  }
+
+  if (registry.size() >= kMaxEntries) {
+    // Evict the least recently used closed entry; open breakers must keep their state.
+    size_t victim = registry.size();
+    for (size_t index = 0; index < registry.size(); ++index) {
+      if (registry[index].state != State::Closed) {
+        continue;
+      }
+      if (victim == registry.size() ||
+          static_cast<int32_t>(registry[index].lastUsedAtMs - registry[victim].lastUsedAtMs) < 0) {
+        victim = index;
+      }
+    }
+    if (victim == registry.size()) {
+      return nullptr;
+    }
+    registry.erase(registry.begin() + victim);
+  }
+
+  Entry entry;
+  entry.accessKeyId = accessKeyId;
+  entry.lastUsedAtMs = now;
+  registry.push_back(entry);
+  return &registry.back();
+}
+
+uint32_t AliyunCircuitBreaker::backoffMs(const Entry& entry) {
+  if (entry.lastErrorClass == AliyunErrorClass::Auth) {
+    return kAuthBackoffMs;
+  }
+
+  uint32_t backoff = kBaseBackoffMs;
+  for (uint32_t step = 1; step < entry.openCount && backoff < kMaxBackoffMs; ++step) {
+    backoff *= 2;
+  }
+  if (backoff > kMaxBackoffMs) {
+    backoff = kMaxBackoffMs;
+  }
+
+  // Equal jitter: keep half of the window, randomize the other half.
+  const uint32_t half = backoff / 2;
+  return half + static_cast<uint32_t>(random(static_cast<long>(half) + 1));
+}
+
+String AliyunCircuitBreaker::stateToText(State state) {
+  switch (state) {
+    case State::Closed:
+      return "CLOSED";
+    case State::Open:
+      return "OPEN";
+    case State::HalfOpen:
+      return "HALF_OPEN";
+    default:
+      return "UNKNOWN";
+  }
+}
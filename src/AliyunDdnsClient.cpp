@@ -1,9 +1,11 @@
 #include "AliyunDdnsClient.h"
 
-#include "PublicIpService.h"
+#include "AliyunApiGateway.h"
+#include "AliyunCircuitBreaker.h"
+#include "Hal.h"
+#include "NetworkAccounting.h"
+#include "SharedHttpClient.h"
 #include <HTTPClient.h>
-#include <WiFi.h>
-#include <WiFiClientSecure.h>
 #include <algorithm>
 #include <base64.h>
 #include <ctype.h>
@@ -17,8 +19,12 @@ constexpr uint32_t kRequestTimeoutMs = 10000;
 constexpr const char* kSignatureMethod = "HMAC-SHA1";
 constexpr const char* kSignatureVersion = "1.0";
 constexpr const char* kApiVersion = "2015-01-09";
-constexpr const char* kRecordTypeIpv4 = "A";
 constexpr const char* kUserAgent = "ESP32-Aliyun-DDNS/1.0";
+// Aliyun caps PageSize at 500; one page covers any realistic home zone.
+constexpr uint32_t kDescribePageSize = 500;
+constexpr uint32_t kDescribeMaxPages = 10;
+
+String gEndpoint = kAliyunDnsEndpoint;
 }  // namespace
 
 AliyunDdnsClient::AliyunDdnsClient() {}
@@ -35,68 +41,58 @@ void AliyunDdnsClient::begin(const String& accessKeyId,
   _recordIdValid = false;
   _lastApiResponse = "";
   _lastCreatedRecordId = "";
+  _lastErrorCode = "";
   _begun = true;
 }
 
-void AliyunDdnsClient::update(uint32_t now, bool useLocalIp) {
-  (void)now;
-  if (!_begun) {
-    return;
-  }
-
-  const time_t currentTime = time(nullptr);
-  if (currentTime < 1609459200) {
-    return;
-  }
-
-  const String newIp = PublicIpService::resolve(useLocalIp, kRequestTimeoutMs / 2);
-  if (newIp.isEmpty()) {
-    return;
+bool AliyunDdnsClient::describeDomainRecords(const String& domainName) {
+  if (domainName.isEmpty()) {
+    return false;
   }
 
-  RecordInfo recordInfo;
-  if (!fetchRecordInfo(&recordInfo)) {
-    return;
-  }
+  // Same parameters as the first page of the listing overload, so the dashboard
+  // and the DDNS loop share one gateway entry.
+  const String params = buildDescribeParams(domainName, 1, "");
 
-  if (recordInfo.value == newIp) {
-    return;
+  _lastApiResponse = "";
+  if (!invokeApi("GET", params, &_lastApiResponse)) {
+    return false;
   }
+  return _lastApiResponse.indexOf("\"DomainRecords\"") != -1;
+}
 
-  const String oldIp = recordInfo.value;
-  if (!updateRecord(recordInfo.recordId, newIp)) {
-    return;
+bool AliyunDdnsClient::describeDomainRecords(const String& domainName,
+                                             const String& typeKeyWord,
+                                             std::vector<AliyunDomainRecord>* records) {
+  if (domainName.isEmpty() || records == nullptr) {
+    return false;
   }
 
-  _updateCount++;
-  _lastUpdateAtMs = millis();
-  _lastOldIp = oldIp;
-  _lastNewIp = newIp;
-  _recordId = recordInfo.recordId;
-  _recordIdValid = !_recordId.isEmpty();
+  records->clear();
+  for (uint32_t pageNumber = 1; pageNumber <= kDescribeMaxPages; ++pageNumber) {
+    const String params = buildDescribeParams(domainName, pageNumber, typeKeyWord);
 
-  if (_updateCallback) {
-    _updateCallback(_lastOldIp.c_str(), _lastNewIp.c_str());
-  }
-}
+    _lastApiResponse = "";
+    if (!invokeApi("GET", params, &_lastApiResponse)) {
+      return false;
+    }
+    if (_lastApiResponse.indexOf("\"DomainRecords\"") == -1) {
+      return false;
+    }
 
-void AliyunDdnsClient::onUpdate(UpdateCallback callback) {
-  _updateCallback = callback;
-}
+    const size_t countBefore = records->size();
+    if (!parseDomainRecordList(_lastApiResponse, records)) {
+      return false;
+    }
 
-bool AliyunDdnsClient::describeDomainRecords(const String& domainName) {
-  if (domainName.isEmpty()) {
-    return false;
+    long totalCount = 0;
+    if (!parseJsonNumberField(_lastApiResponse, "TotalCount", &totalCount) ||
+        records->size() >= static_cast<size_t>(totalCount) || records->size() == countBefore) {
+      break;
+    }
   }
 
-  String params = buildCommonParams("DescribeDomainRecords");
-  params += "&DomainName=" + urlEncode(domainName);
-
-  _lastApiResponse = "";
-  if (!invokeApi("GET", params, &_lastApiResponse)) {
-    return false;
-  }
-  return _lastApiResponse.indexOf("\"DomainRecords\"") != -1;
+  return true;
 }
 
 bool AliyunDdnsClient::describeDomainRecordInfo(const String& recordId,
@@ -236,9 +232,20 @@ bool AliyunDdnsClient::deleteDomainRecord(const String& recordId) {
   return true;
 }
 
+void AliyunDdnsClient::setEndpoint(const String& endpoint) {
+  gEndpoint = endpoint.isEmpty() ? String(kAliyunDnsEndpoint) : endpoint;
+  if (!gEndpoint.endsWith("/")) {
+    gEndpoint += "/";
+  }
+}
+
+const String& AliyunDdnsClient::getEndpoint() {
+  return gEndpoint;
+}
+
 String AliyunDdnsClient::generateTimestamp() const {
-  time_t now;
-  time(&now);
+  // TimeService keeps this clock on NTP, or on the HTTP Date window until NTP answers.
+  const time_t now = static_cast<time_t>(Hal::clock().unixTimeUs() / 1000000);
   struct tm timeinfo;
   gmtime_r(&now, &timeinfo);
 
@@ -299,10 +306,6 @@ String AliyunDdnsClient::base64Encode(const uint8_t* data, size_t length) const
   return base64::encode(data, length);
 }
 
-const char* AliyunDdnsClient::recordType() const {
-  return kRecordTypeIpv4;
-}
-
 String AliyunDdnsClient::buildCommonParams(const String& action) const {
   if (action.isEmpty()) {
     return "";
@@ -319,6 +322,19 @@ String AliyunDdnsClient::buildCommonParams(const String& action) const {
   return params;
 }
 
+String AliyunDdnsClient::buildDescribeParams(const String& domainName,
+                                             uint32_t pageNumber,
+                                             const String& typeKeyWord) const {
+  String params = buildCommonParams("DescribeDomainRecords");
+  params += "&DomainName=" + urlEncode(domainName);
+  params += "&PageNumber=" + String(pageNumber);
+  params += "&PageSize=" + String(kDescribePageSize);
+  if (!typeKeyWord.isEmpty()) {
+    params += "&TypeKeyWord=" + urlEncode(typeKeyWord);
+  }
+  return params;
+}
+
 String AliyunDdnsClient::buildSignedParams(const String& method, const String& rawParams) const {
   if (rawParams.isEmpty()) {
     return "";
@@ -350,51 +366,36 @@ String AliyunDdnsClient::buildSignedParams(const String& method, const String& r
   return sortedParams;
 }
 
-bool AliyunDdnsClient::sendSignedRequest(const String& method,
-                                         const String& signedParams,
-                                         String* response) const {
+int AliyunDdnsClient::sendSignedRequest(const String& method,
+                                        const String& signedParams,
+                                        String* response) const {
   if (response == nullptr || signedParams.isEmpty()) {
-    return false;
+    return -1;
   }
 
-  WiFiClientSecure client;
-  client.setInsecure();
-
-  HTTPClient http;
-  http.setConnectTimeout(kRequestTimeoutMs);
-  http.setTimeout(kRequestTimeoutMs);
-  http.setUserAgent(kUserAgent);
-
-  int code = -1;
+  SharedHttpRequest request;
+  request.method = method;
+  request.timeoutMs = kRequestTimeoutMs;
+  request.userAgent = kUserAgent;
   if (method == "GET") {
-    const String url = String(kAliyunDnsEndpoint) + "?" + signedParams;
-    if (!http.begin(client, url)) {
-      return false;
-    }
-    code = http.GET();
+    request.url = getEndpoint() + "?" + signedParams;
   } else if (method == "POST") {
-    if (!http.begin(client, String(kAliyunDnsEndpoint))) {
-      return false;
-    }
-    http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-    code = http.POST(signedParams);
+    request.url = getEndpoint();
+    request.body = signedParams;
+    request.contentType = "application/x-www-form-urlencoded";
   } else {
-    return false;
+    return -1;
   }
 
-  if (code > 0) {
-    *response = http.getString();
-  } else {
-    *response = "";
-  }
-
-  http.end();
-  return code == HTTP_CODE_OK;
+  SharedHttpResponse httpResponse;
+  SharedHttpClient::perform(request, &httpResponse);
+  *response = httpResponse.body;
+  return httpResponse.httpCode;
 }
 
 bool AliyunDdnsClient::invokeApi(const String& method,
                                  const String& rawParams,
-                                 String* response) const {
+                                 String* response) {
   if (response == nullptr || rawParams.isEmpty()) {
     return false;
   }
@@ -402,20 +403,87 @@ bool AliyunDdnsClient::invokeApi(const String& method,
     return false;
   }
 
+  NetworkAccounting::Scope accountingScope(NetSubsystem::Ddns);
+  AliyunGatewayResult result;
+  if (method == "GET") {
+    const String key = gatewayCredentialKey() + method + "\n" + stripVolatileParams(rawParams);
+    AliyunApiGateway::execute(
+        key,
+        [this, &method, &rawParams](AliyunGatewayResult* fetched) {
+          performApiCall(method, rawParams, fetched);
+        },
+        &result,
+        kRequestTimeoutMs);
+  } else {
+    performApiCall(method, rawParams, &result);
+    // Any write may change what cached reads of this account return.
+    AliyunApiGateway::invalidate(gatewayCredentialKey());
+  }
+
+  *response = result.response;
+  _lastErrorCode = result.errorCode;
+  return result.errorCode.isEmpty();
+}
+
+void AliyunDdnsClient::performApiCall(const String& method,
+                                      const String& rawParams,
+                                      AliyunGatewayResult* result) const {
+  if (!AliyunCircuitBreaker::allowRequest(_accessKeyId, millis())) {
+    result->response = "";
+    result->errorCode = "circuit_open";
+    return;
+  }
+
   const String signedParams = buildSignedParams(method, rawParams);
   if (signedParams.isEmpty()) {
-    return false;
+    result->errorCode = "unknown_error";
+    return;
   }
 
-  if (!sendSignedRequest(method, signedParams, response)) {
-    return false;
-  }
+  const int httpCode = sendSignedRequest(method, signedParams, &result->response);
 
   // Aliyun errors include top-level Code + Message.
-  if (response->indexOf("\"Code\":\"") != -1 && response->indexOf("\"Message\":\"") != -1) {
-    return false;
+  String errorCode;
+  const String& response = result->response;
+  if (response.indexOf("\"Code\":\"") != -1 && response.indexOf("\"Message\":\"") != -1) {
+    parseJsonStringField(response, "Code", &errorCode);
+    if (errorCode.isEmpty()) {
+      errorCode = "unknown_error";
+    }
+  } else if (httpCode <= 0) {
+    errorCode = "network_error";
+  } else if (httpCode != HTTP_CODE_OK) {
+    errorCode = "http_" + String(httpCode);
   }
-  return true;
+
+  result->errorCode = errorCode;
+  AliyunCircuitBreaker::recordResult(_accessKeyId,
+                                     AliyunCircuitBreaker::classifyError(errorCode, httpCode),
+                                     errorCode,
+                                     millis());
+}
+
+String AliyunDdnsClient::gatewayCredentialKey() const {
+  return _accessKeyId + "\n" + _accessKeySecret + "\n";
+}
+
+String AliyunDdnsClient::stripVolatileParams(const String& rawParams) const {
+  String stable;
+  unsigned int start = 0;
+  while (start < rawParams.length()) {
+    const int separator = rawParams.indexOf('&', start);
+    const unsigned int end =
+        separator == -1 ? rawParams.length() : static_cast<unsigned int>(separator);
+    const String pair = rawParams.substring(start, end);
+    if (!pair.startsWith("Timestamp=") && !pair.startsWith("SignatureNonce=")) {
+      if (!stable.isEmpty()) {
+        stable += "&";
+      }
+      stable += pair;
+    }
+    start = end + 1;
+  }
+  return stable;
 }
 
 bool AliyunDdnsClient::parseJsonStringField(const String& response,
@@ -441,61 +509,87 @@ bool AliyunDdnsClient::parseJsonStringField(const String& response,
   return true;
 }
 
-bool AliyunDdnsClient::fetchRecordInfo(RecordInfo* info) {
-  if (info == nullptr || _domain.isEmpty() || _subDomain.isEmpty()) {
+bool AliyunDdnsClient::parseJsonNumberField(const String& response,
+                                            const char* key,
+                                            long* value) const {
+  if (key == nullptr || value == nullptr) {
     return false;
   }
 
-  String params = buildCommonParams("DescribeDomainRecords");
-  params += "&DomainName=" + urlEncode(_domain);
-  params += "&RRKeyWord=" + urlEncode(_subDomain);
-  params += "&TypeKeyWord=" + urlEncode(String(recordType()));
-
-  String response;
-  if (!invokeApi("GET", params, &response)) {
+  const String pattern = String("\"") + key + "\":";
+  int start = response.indexOf(pattern);
+  if (start == -1) {
     return false;
   }
+  start += pattern.length();
 
-  info->recordId = "";
-  info->value = "";
-  if (!parseJsonStringField(response, "RecordId", &info->recordId) ||
-      !parseJsonStringField(response, "Value", &info->value)) {
-    return false;
+  int end = start;
+  while (end < static_cast<int>(response.length()) && isdigit(response.charAt(end))) {
+    ++end;
   }
-  if (info->recordId.isEmpty() || info->value.isEmpty()) {
+  if (end == start) {
     return false;
   }
 
-  _recordId = info->recordId;
-  _recordIdValid = true;
+  *value = response.substring(start, end).toInt();
   return true;
 }
 
-bool AliyunDdnsClient::updateRecord(const String& recordId, const String& newIp) {
-  if (recordId.isEmpty() || newIp.isEmpty()) {
+bool AliyunDdnsClient::parseDomainRecordList(const String& response,
+                                             std::vector<AliyunDomainRecord>* records) const {
+  if (records == nullptr) {
     return false;
   }
 
-  String params = buildCommonParams("UpdateDomainRecord");
-  params += "&RecordId=" + urlEncode(recordId);
-  params += "&RR=" + urlEncode(_subDomain);
-  params += "&Type=" + urlEncode(String(recordType()));
-  params += "&Value=" + urlEncode(newIp);
-
-  String response;
-  if (!invokeApi("POST", params, &response)) {
+  const int domainRecordsPos = response.indexOf("\"DomainRecords\"");
+  if (domainRecordsPos == -1) {
     return false;
   }
-
-  String updatedRecordId;
-  if (!parseJsonStringField(response, "RecordId", &updatedRecordId) || updatedRecordId.isEmpty()) {
-    return false;
+  const int recordKeyPos = response.indexOf("\"Record\"", domainRecordsPos);
+  if (recordKeyPos == -1) {
+    return true;
   }
-  if (updatedRecordId != recordId) {
+  const int arrayStart = response.indexOf('[', recordKeyPos);
+  if (arrayStart == -1) {
     return false;
   }
 
-  _recordId = updatedRecordId;
-  _recordIdValid = true;
+  // Record entries are flat objects. Quoted text is skipped so a brace in a Remark
+  // cannot split an entry.
+  int objectStart = -1;
+  bool inString = false;
+  bool escaped = false;
+  for (int index = arrayStart + 1; index < static_cast<int>(response.length()); ++index) {
+    const char c = response.charAt(index);
+    if (inString) {
+      if (escaped) {
+        escaped = false;
+      } else if (c == '\\') {
+        escaped = true;
+      } else if (c == '"') {
+        inString = false;
+      }
+      continue;
+    }
+
+    if (c == '"') {
+      inString = true;
+    } else if (c == '{') {
+      objectStart = index;
+    } else if (c == '}' && objectStart != -1) {
+      const String item = response.substring(objectStart, index + 1);
+      AliyunDomainRecord record;
+      if (parseJsonStringField(item, "RecordId", &record.recordId) &&
+          parseJsonStringField(item, "RR", &record.rr)) {
+        parseJsonStringField(item, "Type", &record.type);
+        parseJsonStringField(item, "Value", &record.value);
+        records->push_back(record);
+      }
+      objectStart = -1;
+    } else if (c == ']') {
+      break;
+    }
+  }
+
   return true;
 }
@@ -0,0 +1,163 @@
+#include "AsyncHttpClient.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+namespace {
+// mbedTLS handshakes need far more stack than the DnsCache worker.
+constexpr uint32_t kWorkerStackSize = 8192;
+constexpr UBaseType_t kWorkerPriority = 1;
+constexpr UBaseType_t kQueueLength = 8;
+
+portMUX_TYPE gStateMux = portMUX_INITIALIZER_UNLOCKED;
+AsyncHttpStats gStats;
+QueueHandle_t gWorkQueue = nullptr;
+
+SemaphoreHandle_t workerMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+class WorkerLock {
+ public:
+  WorkerLock() { xSemaphoreTake(workerMutex(), portMAX_DELAY); }
+  ~WorkerLock() { xSemaphoreGive(workerMutex()); }
+};
+}  // namespace
+
+bool AsyncHttpFuture::ready() const {
+  if (_state == nullptr) {
+    return false;
+  }
+  portENTER_CRITICAL(&gStateMux);
+  const bool isReady = _state->ready;
+  portEXIT_CRITICAL(&gStateMux);
+  return isReady;
+}
+
+bool AsyncHttpFuture::ok() const {
+  return ready() && _state->ok;
+}
+
+const SharedHttpResponse& AsyncHttpFuture::response() const {
+  static const SharedHttpResponse kEmpty;
+  return ready() ? _state->response : kEmpty;
+}
+
+uint32_t AsyncHttpFuture::elapsedMs() const {
+  return ready() ? _state->elapsedMs : 0;
+}
+
+AsyncHttpFuture AsyncHttpClient::submit(const SharedHttpRequest& request) {
+  StatePtr state = std::make_shared<AsyncHttpFuture::State>();
+  state->request = request;
+  return enqueue(state);
+}
+
+AsyncHttpFuture AsyncHttpClient::submitJob(std::function<void()> job) {
+  StatePtr state = std::make_shared<AsyncHttpFuture::State>();
+  state->job = std::move(job);
+  return enqueue(state);
+}
+
+AsyncHttpStats AsyncHttpClient::getStats() {
+  portENTER_CRITICAL(&gStateMux);
+  const AsyncHttpStats stats = gStats;
+  portEXIT_CRITICAL(&gStateMux);
+  return stats;
+}
+
+AsyncHttpFuture AsyncHttpClient::enqueue(const StatePtr& state) {
+  state->subsystem = NetworkAccounting::current();
+  state->queuedAtMs = millis();
+
+  AsyncHttpFuture future;
+  future._state = state;
+
+  portENTER_CRITICAL(&gStateMux);
+  gStats.submitted += 1;
+  gStats.pending += 1;
+  portEXIT_CRITICAL(&gStateMux);
+
+  StatePtr* item = new StatePtr(state);
+  if (!ensureWorker() || xQueueSend(gWorkQueue, &item, 0) != pdTRUE) {
+    // Without a worker the caller still gets a ready future, at the cost of blocking once.
+    delete item;
+    portENTER_CRITICAL(&gStateMux);
+    gStats.inlineFallbacks += 1;
+    portEXIT_CRITICAL(&gStateMux);
+    run(state.get());
+  }
+  return future;
+}
+
+bool AsyncHttpClient::ensureWorker() {
+  // Two first submits at once must not both start a worker.
+  WorkerLock lock;
+  if (gWorkQueue != nullptr) {
+    return true;
+  }
+
+  QueueHandle_t queue = xQueueCreate(kQueueLength, sizeof(StatePtr*));
+  if (queue == nullptr) {
+    return false;
+  }
+  if (xTaskCreate(workerTask, "http_async", kWorkerStackSize, queue, kWorkerPriority, nullptr) !=
+      pdPASS) {
+    vQueueDelete(queue);
+    return false;
+  }
+  gWorkQueue = queue;
+  return true;
+}
+
+void AsyncHttpClient::run(AsyncHttpFuture::State* state) {
+  const uint32_t startMs = millis();
+  const uint32_t queueWaitMs = startMs - state->queuedAtMs;
+
+  {
+    NetworkAccounting::Scope accountingScope(state->subsystem);
+    if (state->job) {
+      state->job();
+      state->job = nullptr;
+      state->ok = true;
+    } else {
+      state->ok = SharedHttpClient::perform(state->request, &state->response);
+    }
+  }
+  const uint32_t runMs = millis() - startMs;
+  state->elapsedMs = millis() - state->queuedAtMs;
+
+  // Readers only look at the result after observing `ready` under the same lock.
+  portENTER_CRITICAL(&gStateMux);
+  state->ready = true;
+  gStats.completed += 1;
+  gStats.pending -= 1;
+  if (queueWaitMs > gStats.maxQueueWaitMs) {
+    gStats.maxQueueWaitMs = queueWaitMs;
+  }
+  if (runMs > gStats.maxRunMs) {
+    gStats.maxRunMs = runMs;
+  }
+  portEXIT_CRITICAL(&gStateMux);
+}
+
+void AsyncHttpClient::workerTask(void* context) {
+  QueueHandle_t queue = static_cast<QueueHandle_t>(context);
+  StatePtr* item = nullptr;
+  while (true) {
+    if (xQueueReceive(queue, &item, portMAX_DELAY) != pdTRUE || item == nullptr) {
+      continue;
+    }
+
+    run(item->get());
+    if (item->use_count() == 1) {
+      portENTER_CRITICAL(&gStateMux);
+      gStats.abandoned += 1;
+      portEXIT_CRITICAL(&gStateMux);
+    }
+    delete item;
+  }
+}
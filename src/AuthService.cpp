@@ -1,10 +1,11 @@
 #include "AuthService.h"
 
 #include <ESPAsyncWebServer.h>
-#include <Preferences.h>
 #include <esp_system.h>
 #include <time.h>
 
+#include "Hal.h"
+
 namespace {
 constexpr const char* kAuthNamespace = "esp32auth";
 constexpr const char* kPasswordKey = "pwd_plain";
@@ -162,7 +163,7 @@ void AuthService::clearSession() {
   _sessionExpiryMs = 0;
   _sessionExpiryUnix = 0;
 
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kAuthNamespace, false)) {
     return;
   }
@@ -173,7 +174,7 @@ void AuthService::clearSession() {
 }
 
 bool AuthService::loadStoredPassword() {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kAuthNamespace, true)) {
     return false;
   }
@@ -190,7 +191,7 @@ bool AuthService::loadStoredPassword() {
 }
 
 bool AuthService::persistPassword(const String& password) const {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kAuthNamespace, false)) {
     return false;
   }
@@ -201,7 +202,7 @@ bool AuthService::persistPassword(const String& password) const {
 }
 
 bool AuthService::loadStoredSession() {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kAuthNamespace, true)) {
     return false;
   }
@@ -235,7 +236,7 @@ bool AuthService::loadStoredSession() {
 }
 
 bool AuthService::persistSession(const String& token, uint32_t expiryUnix) const {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kAuthNamespace, false)) {
     return false;
   }
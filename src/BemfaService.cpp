@@ -1,7 +1,11 @@
 #include "BemfaService.h"
 
+#include "DnsCache.h"
+#include "NetworkAccounting.h"
+
 #include <ESP.h>
 #include <cstdio>
+#include <cstring>
 
 BemfaService* g_bemfaServiceInstance = nullptr;
 
@@ -64,6 +68,7 @@ void BemfaService::updateConfig(const BemfaConfig& config) {
 }
 
 void BemfaService::tick(bool wifiConnected) {
+  NetworkAccounting::Scope accountingScope(NetSubsystem::BemfaMqtt);
   _wifiConnected = wifiConnected;
 
   if (!_begun) {
@@ -142,6 +147,9 @@ bool BemfaService::publishStatus(const String& payload) {
   const String topic = publishTopic();
   const bool published = _mqttClient.publish(topic.c_str(), normalizedPayload.c_str());
   if (published) {
+    NetworkAccounting::addTransferTo(NetSubsystem::BemfaMqtt,
+                                     0,
+                                     topic.length() + normalizedPayload.length());
     _lastPublish = normalizedPayload;
     _lastPublishAtMs = millis();
   }
@@ -223,8 +231,17 @@ bool BemfaService::connectBroker() {
     return false;
   }
 
+  // A cached address keeps reconnects working while the resolver is slow.
+  IPAddress brokerAddress;
+  if (DnsCache::resolve(_config.host, &brokerAddress)) {
+    _mqttClient.setServer(brokerAddress, _config.port);
+  } else {
+    _mqttClient.setServer(_config.host.c_str(), _config.port);
+  }
+
   bool connected = false;
   int connectRc = -1;
+  const uint32_t connectStartMs = millis();
 
   // Preferred by Bemfa docs: use UID as MQTT ClientID, username/password can be empty.
   const String clientIdByUid = _config.uid;
@@ -238,7 +255,9 @@ bool BemfaService::connectBroker() {
     connectRc = _mqttClient.state();
   }
 
+  NetworkAccounting::addBlockedMs(millis() - connectStartMs);
   if (!connected) {
+    NetworkAccounting::addFailure();
     _mqttConnected = false;
     setState("ERROR", "MQTT connect failed, rc=" + String(connectRc));
     return false;
@@ -252,6 +271,7 @@ bool BemfaService::connectBroker() {
     return false;
   }
 
+  NetworkAccounting::addConnection(false);
   _mqttConnected = true;
   _reconnectCount += 1;
   _lastConnectAtMs = millis();
@@ -272,6 +292,7 @@ void BemfaService::onMqttMessage(char* topic, const uint8_t* payload, unsigned i
   if (topic == nullptr || payload == nullptr || length == 0) {
     return;
   }
+  NetworkAccounting::addReceivedTo(NetSubsystem::BemfaMqtt, strlen(topic) + length);
 
   const String receivedTopic = String(topic);
   const String expectedSetTopic = subscribeTopic();
@@ -0,0 +1,122 @@
+#include "ClockDiscipline.h"
+
+#include "Hal.h"
+
+namespace {
+constexpr double kPpbPerUnit = 1e9;
+constexpr int64_t kMicrosPerSecond = 1000000;
+// Residuals within the measurement error plus this confirm the estimate.
+constexpr double kAgreementPpb = 1000.0;
+
+int64_t absolute(int64_t value) { return value < 0 ? -value : value; }
+double absolute(double value) { return value < 0 ? -value : value; }
+}  // namespace
+
+void ClockDiscipline::setIntervalBounds(uint32_t minSeconds, uint32_t maxSeconds) {
+  _minIntervalSeconds = minSeconds;
+  _maxIntervalSeconds = maxSeconds < minSeconds ? minSeconds : maxSeconds;
+  _intervalSeconds = clampInterval(_intervalSeconds);
+}
+
+void ClockDiscipline::restore(const ClockDriftState& state) {
+  _driftPpb = state.driftPpb;
+  if (_driftPpb > kMaxDriftPpb || _driftPpb < -kMaxDriftPpb) {
+    _driftPpb = 0;
+  }
+  _confidence = _driftPpb == 0 ? 0 : state.confidence;
+  _intervalSeconds = clampInterval(state.intervalSeconds);
+}
+
+ClockDriftState ClockDiscipline::state() const {
+  ClockDriftState state;
+  state.driftPpb = _driftPpb;
+  state.confidence = _confidence;
+  state.intervalSeconds = _intervalSeconds;
+  return state;
+}
+
+bool ClockDiscipline::addSample(int64_t serverUs, int64_t offsetUs, int64_t delayUs) {
+  const ClockDriftState before = state();
+  const bool step = absolute(offsetUs) > kStepThresholdUs;
+  if (!_hasSample) {
+    // The first offset after boot is wherever the clock started; nothing to learn.
+    _hasSample = true;
+    _lastSampleUs = serverUs;
+    _learned = false;
+    return step;
+  }
+
+  const int64_t windowUs = serverUs - _lastSampleUs;
+  _lastSampleUs = serverUs;
+  if (windowUs >= static_cast<int64_t>(kMinDriftWindowSeconds) * kMicrosPerSecond) {
+    // The clock was slewed by the estimate all along, so what is left over is
+    // the estimate's own error. A fast clock ends up ahead: negative offset.
+    const double residualPpb = -static_cast<double>(offsetUs) * kPpbPerUnit / windowUs;
+    const double errorPpb = static_cast<double>(delayUs / 2) * kPpbPerUnit / windowUs;
+    const double estimatePpb = _driftPpb + residualPpb;
+    if (absolute(estimatePpb) > kMaxDriftPpb) {
+      _confidence = 0;
+    } else {
+      if (absolute(residualPpb) <= errorPpb + kAgreementPpb) {
+        _confidence = _confidence < 255 ? _confidence + 1 : 255;
+      } else {
+        _confidence = 0;
+      }
+      // A confirmed estimate only moves halfway, so one noisy sync cannot undo it.
+      _driftPpb = static_cast<int32_t>(_confidence > 1 ? _driftPpb + residualPpb / 2 : estimatePpb);
+    }
+  }
+
+  if (absolute(offsetUs) > kTargetOffsetUs) {
+    _intervalSeconds = clampInterval(_intervalSeconds / 2);
+  } else if (absolute(offsetUs) <= kTargetOffsetUs / 2 && _confidence > 0) {
+    _intervalSeconds = _intervalSeconds >= _maxIntervalSeconds / 2 ? _maxIntervalSeconds
+                                                                   : _intervalSeconds * 2;
+  }
+
+  const ClockDriftState after = state();
+  _learned = after.driftPpb != before.driftPpb || after.confidence != before.confidence ||
+             after.intervalSeconds != before.intervalSeconds;
+  return step;
+}
+
+int64_t ClockDiscipline::driftCorrectionUs(int64_t elapsedUs) const {
+  return -static_cast<int64_t>(static_cast<double>(_driftPpb) * elapsedUs / kPpbPerUnit);
+}
+
+bool ClockDiscipline::load(ClockDriftState* state) {
+  KeyValueStore preferences;
+  if (!preferences.begin(kNamespace, true)) {
+    return false;
+  }
+  const bool stored = preferences.isKey(kIntervalKey);
+  if (stored) {
+    state->driftPpb = preferences.getInt(kDriftKey, 0);
+    state->confidence = preferences.getUChar(kConfidenceKey, 0);
+    state->intervalSeconds = preferences.getUInt(kIntervalKey, 0);
+  }
+  preferences.end();
+  return stored;
+}
+
+bool ClockDiscipline::save(const ClockDriftState& state) {
+  KeyValueStore preferences;
+  if (!preferences.begin(kNamespace, false)) {
+    return false;
+  }
+  const bool written = preferences.putInt(kDriftKey, state.driftPpb) > 0 &&
+                       preferences.putUChar(kConfidenceKey, state.confidence) > 0 &&
+                       preferences.putUInt(kIntervalKey, state.intervalSeconds) > 0;
+  preferences.end();
+  return written;
+}
+
+uint32_t ClockDiscipline::clampInterval(uint32_t seconds) const {
+  if (seconds < _minIntervalSeconds) {
+    return _minIntervalSeconds;
+  }
+  if (seconds > _maxIntervalSeconds) {
+    return _maxIntervalSeconds;
+  }
+  return seconds;
+}
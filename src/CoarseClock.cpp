@@ -0,0 +1,109 @@
+#include "CoarseClock.h"
+
+namespace {
+constexpr int64_t kMillisPerSecond = 1000;
+constexpr int64_t kPpmDivisor = 1000000;
+}  // namespace
+
+bool CoarseClock::addSample(int64_t dateUnixSeconds, uint32_t requestStartMs, uint32_t responseAtMs) {
+  const uint32_t roundTripMs = responseAtMs - requestStartMs;
+  if (dateUnixSeconds <= 0 || roundTripMs > kMaxRoundTripMs) {
+    return false;
+  }
+
+  // Stamped at some point in [date, date + 1 s) of server time, which fell
+  // between requestStartMs and responseAtMs of local time.
+  Window sample;
+  sample.lowUnixMs = dateUnixSeconds * kMillisPerSecond;
+  sample.highUnixMs = sample.lowUnixMs + kMillisPerSecond + roundTripMs;
+  sample.anchorMs = responseAtMs;
+  sample.sources = 1;
+  if (merge(&_agreed, sample)) {
+    return true;
+  }
+
+  // One server with a wrong clock must not undo what the others agreed on;
+  // its window only takes over once more servers back it.
+  if (!merge(&_candidate, sample)) {
+    _candidate = sample;
+  }
+  if (_candidate.sources > _agreed.sources) {
+    _agreed = _candidate;
+    _candidate = Window();
+  }
+  return true;
+}
+
+void CoarseClock::refresh(uint32_t nowMs) {
+  Window* windows[] = {&_agreed, &_candidate};
+  for (Window* window : windows) {
+    if (window->sources > 0 &&
+        static_cast<int32_t>(nowMs - window->anchorMs) > static_cast<int32_t>(kRebaseAfterMs)) {
+      *window = moved(*window, nowMs);
+    }
+  }
+}
+
+int64_t CoarseClock::unixMsAt(uint32_t nowMs) const {
+  const Window window = moved(_agreed, nowMs);
+  return window.lowUnixMs + (window.highUnixMs - window.lowUnixMs) / 2;
+}
+
+uint32_t CoarseClock::uncertaintyMs(uint32_t nowMs) const {
+  const Window window = moved(_agreed, nowMs);
+  return static_cast<uint32_t>((window.highUnixMs - window.lowUnixMs + 1) / 2);
+}
+
+bool CoarseClock::contains(int64_t unixMs, uint32_t nowMs) const {
+  if (_agreed.sources == 0) {
+    return false;
+  }
+  const Window window = moved(_agreed, nowMs);
+  return unixMs >= window.lowUnixMs && unixMs <= window.highUnixMs;
+}
+
+void CoarseClock::clear() {
+  _agreed = Window();
+  _candidate = Window();
+}
+
+CoarseClock::Window CoarseClock::moved(const Window& window, uint32_t nowMs) {
+  // Signed: samples may land slightly out of order.
+  const int64_t elapsedMs = static_cast<int32_t>(nowMs - window.anchorMs);
+  const int64_t spanMs = elapsedMs < 0 ? -elapsedMs : elapsedMs;
+  const int64_t driftMs = (spanMs * kMaxDriftPpm + kPpmDivisor - 1) / kPpmDivisor;
+
+  Window result = window;
+  result.lowUnixMs += elapsedMs - driftMs;
+  result.highUnixMs += elapsedMs + driftMs;
+  result.anchorMs = nowMs;
+  return result;
+}
+
+bool CoarseClock::merge(Window* window, const Window& sample) {
+  if (window->sources == 0) {
+    *window = sample;
+    return true;
+  }
+
+  // Compare both at the later anchor, so the older one carries the drift allowance.
+  const uint32_t atMs =
+      static_cast<int32_t>(sample.anchorMs - window->anchorMs) > 0 ? sample.anchorMs : window->anchorMs;
+  Window current = moved(*window, atMs);
+  const Window incoming = moved(sample, atMs);
+  if (incoming.highUnixMs < current.lowUnixMs || incoming.lowUnixMs > current.highUnixMs) {
+    return false;
+  }
+
+  if (incoming.lowUnixMs > current.lowUnixMs) {
+    current.lowUnixMs = incoming.lowUnixMs;
+  }
+  if (incoming.highUnixMs < current.highUnixMs) {
+    current.highUnixMs = incoming.highUnixMs;
+  }
+  if (current.sources < 255) {
+    current.sources += 1;
+  }
+  *window = current;
+  return true;
+}
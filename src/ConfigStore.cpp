@@ -1,6 +1,8 @@
 #include "ConfigStore.h"
 
-#include <Preferences.h>
+#include <vector>
+
+#include "Hal.h"
 
 namespace {
 constexpr const char* kProviderId = "aliyun";
@@ -21,7 +23,17 @@ constexpr const char* kOtaAutoCheckIntervalMinutesKey = "ota_auto_min";
 constexpr const char* kOtaInstalledVersionCodeKey = "ota_ver";
 
 constexpr const char* kDdnsEnabledKey = "ddns_en";
+constexpr const char* kDdnsRecordsKey = "ddns_recs";
+// Before the packed layout every record took seven "dd<i>_*" keys, at most five records.
 constexpr const char* kDdnsCountKey = "ddns_cnt";
+constexpr size_t kLegacyDdnsRecords = 5;
+constexpr uint8_t kDdnsRecordsVersion = 1;
+constexpr uint8_t kDdnsRecordEnabledFlag = 0x01;
+constexpr uint8_t kDdnsRecordLocalIpFlag = 0x02;
+constexpr const char* kDdnsAdaptiveKey = "ddns_ad";
+constexpr const char* kDdnsAdaptiveMinKey = "ddns_amin";
+constexpr const char* kDdnsAdaptiveMaxKey = "ddns_amax";
+constexpr const char* kDdnsLanCoordinationKey = "ddns_lan";
 
 constexpr uint32_t kDefaultDdnsIntervalSeconds = 300;
 constexpr uint32_t kMinDdnsIntervalSeconds = 30;
@@ -52,6 +64,19 @@ String normalizeDdnsProvider(const String& provider) {
   return String(kProviderId);
 }
 
+void normalizeDdnsAdaptiveBounds(DdnsConfig* config) {
+  const DdnsConfig defaults;
+  if (!isValidDdnsIntervalSeconds(config->adaptiveMinSeconds)) {
+    config->adaptiveMinSeconds = defaults.adaptiveMinSeconds;
+  }
+  if (!isValidDdnsIntervalSeconds(config->adaptiveMaxSeconds)) {
+    config->adaptiveMaxSeconds = defaults.adaptiveMaxSeconds;
+  }
+  if (config->adaptiveMaxSeconds < config->adaptiveMinSeconds) {
+    config->adaptiveMaxSeconds = config->adaptiveMinSeconds;
+  }
+}
+
 void normalizeDdnsRecord(DdnsRecordConfig* record) {
   if (record == nullptr) {
     return;
@@ -67,10 +92,86 @@ void normalizeDdnsRecord(DdnsRecordConfig* record) {
 String ddnsRecordKey(size_t index, const char* suffix) {
   return "dd" + String(index) + "_" + String(suffix);
 }
+
+// Packed records: version, count, then per record flags, interval (LE) and the
+// length-prefixed domain, AccessKeyId and secret. The provider is always Aliyun.
+void appendDdnsString(std::vector<uint8_t>* blob, const String& value) {
+  const size_t length = value.length() > UINT8_MAX ? UINT8_MAX : value.length();
+  blob->push_back(static_cast<uint8_t>(length));
+  blob->insert(blob->end(), value.c_str(), value.c_str() + length);
+}
+
+bool readDdnsString(const std::vector<uint8_t>& blob, size_t* offset, String* value) {
+  if (*offset >= blob.size() || *offset + 1 + blob[*offset] > blob.size()) {
+    return false;
+  }
+  const size_t length = blob[*offset];
+  *value = "";
+  value->reserve(length);
+  for (size_t i = 0; i < length; ++i) {
+    *value += static_cast<char>(blob[*offset + 1 + i]);
+  }
+  *offset += 1 + length;
+  return true;
+}
+
+std::vector<uint8_t> packDdnsRecords(const std::vector<DdnsRecordConfig>& records, size_t count) {
+  std::vector<uint8_t> blob;
+  blob.push_back(kDdnsRecordsVersion);
+  blob.push_back(static_cast<uint8_t>(count));
+  for (size_t index = 0; index < count; ++index) {
+    DdnsRecordConfig record = records[index];
+    normalizeDdnsRecord(&record);
+    uint8_t flags = 0;
+    flags |= record.enabled ? kDdnsRecordEnabledFlag : 0;
+    flags |= record.useLocalIp ? kDdnsRecordLocalIpFlag : 0;
+    blob.push_back(flags);
+    for (uint8_t shift = 0; shift < 32; shift += 8) {
+      blob.push_back(static_cast<uint8_t>(record.updateIntervalSeconds >> shift));
+    }
+    appendDdnsString(&blob, record.domain);
+    appendDdnsString(&blob, record.username);
+    appendDdnsString(&blob, record.password);
+  }
+  return blob;
+}
+
+bool unpackDdnsRecords(const std::vector<uint8_t>& blob,
+                       size_t maxRecords,
+                       std::vector<DdnsRecordConfig>* records) {
+  if (blob.size() < 2 || blob[0] != kDdnsRecordsVersion) {
+    return false;
+  }
+  const size_t count = blob[1] <= maxRecords ? blob[1] : maxRecords;
+  size_t offset = 2;
+  records->reserve(count);
+  for (size_t index = 0; index < count; ++index) {
+    if (offset + 5 > blob.size()) {
+      return false;
+    }
+    DdnsRecordConfig record;
+    const uint8_t flags = blob[offset];
+    record.enabled = (flags & kDdnsRecordEnabledFlag) != 0;
+    record.useLocalIp = (flags & kDdnsRecordLocalIpFlag) != 0;
+    record.updateIntervalSeconds = 0;
+    for (uint8_t byte = 0; byte < 4; ++byte) {
+      record.updateIntervalSeconds |= static_cast<uint32_t>(blob[offset + 1 + byte]) << (8 * byte);
+    }
+    offset += 5;
+    if (!readDdnsString(blob, &offset, &record.domain) ||
+        !readDdnsString(blob, &offset, &record.username) ||
+        !readDdnsString(blob, &offset, &record.password)) {
+      return false;
+    }
+    normalizeDdnsRecord(&record);
+    records->push_back(record);
+  }
+  return true;
+}
 }  // namespace
 
 ComputerConfig ConfigStore::loadComputerConfig() const {
-  Preferences preferences;
+  KeyValueStore preferences;
   ComputerConfig config{"192.168.1.100", "00:11:22:33:44:55", 3389};
 
   if (!preferences.begin(kNamespace, true)) {
@@ -86,7 +187,7 @@ ComputerConfig ConfigStore::loadComputerConfig() const {
 }
 
 bool ConfigStore::saveComputerConfig(const ComputerConfig& config) const {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kNamespace, false)) {
     return false;
   }
@@ -100,7 +201,7 @@ bool ConfigStore::saveComputerConfig(const ComputerConfig& config) const {
 }
 
 BemfaConfig ConfigStore::loadBemfaConfig() const {
-  Preferences preferences;
+  KeyValueStore preferences;
   BemfaConfig config;
 
   if (!preferences.begin(kNamespace, true)) {
@@ -127,7 +228,7 @@ BemfaConfig ConfigStore::loadBemfaConfig() const {
 }
 
 bool ConfigStore::saveBemfaConfig(const BemfaConfig& config) const {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kNamespace, false)) {
     return false;
   }
@@ -144,7 +245,7 @@ bool ConfigStore::saveBemfaConfig(const BemfaConfig& config) const {
 }
 
 SystemConfig ConfigStore::loadSystemConfig() const {
-  Preferences preferences;
+  KeyValueStore preferences;
   SystemConfig config;
 
   if (!preferences.begin(kNamespace, true)) {
@@ -171,7 +272,7 @@ SystemConfig ConfigStore::loadSystemConfig() const {
 }
 
 bool ConfigStore::saveSystemConfig(const SystemConfig& config) const {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kNamespace, false)) {
     return false;
   }
@@ -195,7 +296,7 @@ bool ConfigStore::saveSystemConfig(const SystemConfig& config) const {
 }
 
 DdnsConfig ConfigStore::loadDdnsConfig() const {
-  Preferences preferences;
+  KeyValueStore preferences;
   DdnsConfig config;
 
   if (!preferences.begin(kNamespace, true)) {
@@ -203,9 +304,27 @@ DdnsConfig ConfigStore::loadDdnsConfig() const {
   }
 
   config.enabled = preferences.getBool(kDdnsEnabledKey, config.enabled);
+  config.adaptiveInterval = preferences.getBool(kDdnsAdaptiveKey, config.adaptiveInterval);
+  config.adaptiveMinSeconds = preferences.getUInt(kDdnsAdaptiveMinKey, config.adaptiveMinSeconds);
+  config.adaptiveMaxSeconds = preferences.getUInt(kDdnsAdaptiveMaxKey, config.adaptiveMaxSeconds);
+  normalizeDdnsAdaptiveBounds(&config);
+  config.lanCoordination = preferences.getBool(kDdnsLanCoordinationKey, config.lanCoordination);
+
+  const size_t packedLength = preferences.getBytesLength(kDdnsRecordsKey);
+  if (packedLength > 0) {
+    std::vector<uint8_t> blob(packedLength);
+    if (preferences.getBytes(kDdnsRecordsKey, blob.data(), packedLength) != packedLength ||
+        !unpackDdnsRecords(blob, kMaxDdnsRecords, &config.records)) {
+      config.records.clear();
+    }
+    preferences.end();
+    return config;
+  }
+
+  // Records saved before the packed layout; the next save converts them.
   const uint8_t rawCount = preferences.getUChar(kDdnsCountKey, 0);
   const size_t count =
-      rawCount <= kMaxDdnsRecords ? static_cast<size_t>(rawCount) : kMaxDdnsRecords;
+      rawCount <= kLegacyDdnsRecords ? static_cast<size_t>(rawCount) : kLegacyDdnsRecords;
 
   config.records.reserve(count);
   for (size_t index = 0; index < count; ++index) {
@@ -229,7 +348,7 @@ DdnsConfig ConfigStore::loadDdnsConfig() const {
 }
 
 bool ConfigStore::saveDdnsConfig(const DdnsConfig& config) const {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kNamespace, false)) {
     return false;
   }
@@ -237,37 +356,33 @@ bool ConfigStore::saveDdnsConfig(const DdnsConfig& config) const {
   const size_t recordCount =
       config.records.size() <= kMaxDdnsRecords ? config.records.size() : kMaxDdnsRecords;
 
+  DdnsConfig bounds = config;
+  normalizeDdnsAdaptiveBounds(&bounds);
   preferences.putBool(kDdnsEnabledKey, config.enabled);
-  preferences.putUChar(kDdnsCountKey, static_cast<uint8_t>(recordCount));
-
-  for (size_t index = 0; index < recordCount; ++index) {
-    DdnsRecordConfig record = config.records[index];
-    normalizeDdnsRecord(&record);
-    preferences.putBool(ddnsRecordKey(index, "en").c_str(), record.enabled);
-    preferences.putString(ddnsRecordKey(index, "pv").c_str(), record.provider);
-    preferences.putString(ddnsRecordKey(index, "dm").c_str(), record.domain);
-    preferences.putString(ddnsRecordKey(index, "ur").c_str(), record.username);
-    preferences.putString(ddnsRecordKey(index, "pw").c_str(), record.password);
-    // RecordId is now auto-discovered at runtime and no longer persisted.
-    preferences.remove(ddnsRecordKey(index, "ri").c_str());
-    preferences.putUInt(ddnsRecordKey(index, "iv").c_str(), record.updateIntervalSeconds);
-    preferences.putBool(ddnsRecordKey(index, "li").c_str(), record.useLocalIp);
-    // Cleanup legacy IPv6 flag key.
-    preferences.remove(ddnsRecordKey(index, "v6").c_str());
-  }
-
-  for (size_t index = recordCount; index < kMaxDdnsRecords; ++index) {
-    preferences.remove(ddnsRecordKey(index, "en").c_str());
-    preferences.remove(ddnsRecordKey(index, "pv").c_str());
-    preferences.remove(ddnsRecordKey(index, "dm").c_str());
-    preferences.remove(ddnsRecordKey(index, "ur").c_str());
-    preferences.remove(ddnsRecordKey(index, "pw").c_str());
-    preferences.remove(ddnsRecordKey(index, "ri").c_str());
-    preferences.remove(ddnsRecordKey(index, "iv").c_str());
-    preferences.remove(ddnsRecordKey(index, "li").c_str());
-    preferences.remove(ddnsRecordKey(index, "v6").c_str());
+  preferences.putBool(kDdnsAdaptiveKey, config.adaptiveInterval);
+  preferences.putUInt(kDdnsAdaptiveMinKey, bounds.adaptiveMinSeconds);
+  preferences.putUInt(kDdnsAdaptiveMaxKey, bounds.adaptiveMaxSeconds);
+  preferences.putBool(kDdnsLanCoordinationKey, config.lanCoordination);
+  const std::vector<uint8_t> blob = packDdnsRecords(config.records, recordCount);
+  const bool written = preferences.putBytes(kDdnsRecordsKey, blob.data(), blob.size()) == blob.size();
+
+  // Drop the per-key layout, including keys of older firmware (RecordId, IPv6 flag),
+  // once the packed copy is safely written.
+  if (written) {
+    preferences.remove(kDdnsCountKey);
+    for (size_t index = 0; index < kLegacyDdnsRecords; ++index) {
+      preferences.remove(ddnsRecordKey(index, "en").c_str());
+      preferences.remove(ddnsRecordKey(index, "pv").c_str());
+      preferences.remove(ddnsRecordKey(index, "dm").c_str());
+      preferences.remove(ddnsRecordKey(index, "ur").c_str());
+      preferences.remove(ddnsRecordKey(index, "pw").c_str());
+      preferences.remove(ddnsRecordKey(index, "ri").c_str());
+      preferences.remove(ddnsRecordKey(index, "iv").c_str());
+      preferences.remove(ddnsRecordKey(index, "li").c_str());
+      preferences.remove(ddnsRecordKey(index, "v6").c_str());
+    }
   }
 
   preferences.end();
-  return true;
+  return written;
 }
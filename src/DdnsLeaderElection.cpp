@@ -0,0 +1,342 @@
+#include "DdnsLeaderElection.h"
+
+#include <cstring>
+#include <freertos/task.h>
+
+#include "Hal.h"
+#include "NetworkAccounting.h"
+
+namespace {
+const uint8_t kMagic[4] = {'D', 'L', 'E', '1'};
+constexpr uint8_t kFlagLeader = 0x01;
+constexpr UBaseType_t kTaskPriority = 1;
+
+class MutexLock {
+ public:
+  explicit MutexLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+  }
+  ~MutexLock() { xSemaphoreGive(_mutex); }
+
+ private:
+  SemaphoreHandle_t _mutex;
+};
+
+uint32_t readUint32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+void writeUint32(uint8_t* data, uint32_t value) {
+  data[0] = static_cast<uint8_t>(value >> 24);
+  data[1] = static_cast<uint8_t>(value >> 16);
+  data[2] = static_cast<uint8_t>(value >> 8);
+  data[3] = static_cast<uint8_t>(value);
+}
+}  // namespace
+
+DdnsLeaderElection::DdnsLeaderElection()
+    : _mutex(xSemaphoreCreateMutex()), _group(239, 255, 53, 80) {
+  while (_nodeId == 0) {
+    _nodeId = esp_random();
+  }
+}
+
+DdnsLeaderElection::~DdnsLeaderElection() {
+  if (_started) {
+    {
+      MutexLock lock(_mutex);
+      _stopRequested = true;
+    }
+    xSemaphoreTake(_stopped, portMAX_DELAY);
+    vSemaphoreDelete(_stopped);
+  }
+  vSemaphoreDelete(_mutex);
+}
+
+bool DdnsLeaderElection::start() {
+  if (_started) {
+    return true;
+  }
+  _stopped = xSemaphoreCreateBinary();
+  if (_stopped == nullptr) {
+    return false;
+  }
+  if (xTaskCreate(task, "ddns_lan", kTaskStackSize, this, kTaskPriority, nullptr) != pdPASS) {
+    vSemaphoreDelete(_stopped);
+    _stopped = nullptr;
+    return false;
+  }
+  MutexLock lock(_mutex);
+  _started = true;
+  return true;
+}
+
+void DdnsLeaderElection::configure(bool enabled, uint32_t clusterId) {
+  MutexLock lock(_mutex);
+  if (enabled == _enabled && clusterId == _clusterId) {
+    return;
+  }
+  _enabled = enabled;
+  _clusterId = clusterId;
+  _peers.clear();
+  resetRole(millis());
+}
+
+bool DdnsLeaderElection::isLeader() const {
+  MutexLock lock(_mutex);
+  // Without the task nobody can coordinate, so the board acts alone.
+  return !_started || _role == DdnsLanRole::Off || _role == DdnsLanRole::Leader;
+}
+
+DdnsLeaderStatus DdnsLeaderElection::getStatus() const {
+  MutexLock lock(_mutex);
+  DdnsLeaderStatus status;
+  status.role = _role;
+  status.nodeId = _nodeId;
+  status.leaderId = _leaderId;
+  if (_role == DdnsLanRole::Follower) {
+    status.leaderIp = _leaderAddress.toString();
+  }
+  status.peerCount = static_cast<uint32_t>(_peers.size());
+  status.takeovers = _takeovers;
+  return status;
+}
+
+void DdnsLeaderElection::setMulticastGroup(const IPAddress& group, uint16_t port) {
+  MutexLock lock(_mutex);
+  _group = group;
+  _port = port;
+}
+
+const char* DdnsLeaderElection::roleName(DdnsLanRole role) {
+  switch (role) {
+    case DdnsLanRole::Candidate:
+      return "CANDIDATE";
+    case DdnsLanRole::Follower:
+      return "FOLLOWER";
+    case DdnsLanRole::Leader:
+      return "LEADER";
+    case DdnsLanRole::Off:
+    default:
+      return "OFF";
+  }
+}
+
+size_t DdnsLeaderElection::encode(const Announcement& announcement,
+                                  uint8_t* packet,
+                                  size_t capacity) {
+  if (capacity < kPacketSize) {
+    return 0;
+  }
+  memcpy(packet, kMagic, sizeof(kMagic));
+  writeUint32(packet + 4, announcement.clusterId);
+  writeUint32(packet + 8, announcement.nodeId);
+  packet[12] = announcement.leader ? kFlagLeader : 0;
+  packet[13] = 0;
+  packet[14] = static_cast<uint8_t>(announcement.leaseMs >> 8);
+  packet[15] = static_cast<uint8_t>(announcement.leaseMs & 0xFF);
+  return kPacketSize;
+}
+
+bool DdnsLeaderElection::decode(const uint8_t* packet, size_t length, Announcement* announcement) {
+  if (length != kPacketSize || memcmp(packet, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+  announcement->clusterId = readUint32(packet + 4);
+  announcement->nodeId = readUint32(packet + 8);
+  announcement->leader = (packet[12] & kFlagLeader) != 0;
+  announcement->leaseMs = static_cast<uint16_t>((packet[14] << 8) | packet[15]);
+  return announcement->nodeId != 0;
+}
+
+void DdnsLeaderElection::task(void* context) {
+  DdnsLeaderElection* election = static_cast<DdnsLeaderElection*>(context);
+  election->run();
+  xSemaphoreGive(election->_stopped);
+  vTaskDelete(nullptr);
+}
+
+void DdnsLeaderElection::run() {
+  UdpSocket socket;
+  bool open = false;
+  while (true) {
+    bool enabled = false;
+    IPAddress group;
+    uint16_t port = 0;
+    {
+      MutexLock lock(_mutex);
+      if (_stopRequested) {
+        break;
+      }
+      enabled = _enabled;
+      group = _group;
+      port = _port;
+    }
+
+    if (!enabled || !Hal::wifi().isConnected()) {
+      if (open) {
+        socket.stop();
+        open = false;
+      }
+      delay(kPollMs);
+      continue;
+    }
+    if (!open) {
+      open = socket.beginMulticast(group, port);
+      if (!open) {
+        delay(kPollMs);
+        continue;
+      }
+      // Joined (again): what was known before the link went away is stale.
+      MutexLock lock(_mutex);
+      _peers.clear();
+      resetRole(millis());
+    }
+
+    uint8_t packet[kPacketSize];
+    int size = 0;
+    while ((size = socket.parsePacket()) > 0) {
+      const int length = socket.read(packet, sizeof(packet));
+      NetworkAccounting::addReceivedTo(NetSubsystem::Ddns, static_cast<uint32_t>(size));
+      Announcement announcement;
+      if (size == static_cast<int>(kPacketSize) && decode(packet, length, &announcement)) {
+        MutexLock lock(_mutex);
+        handleAnnouncement(announcement, socket.remoteIP(), millis());
+      }
+    }
+
+    bool announce = false;
+    Announcement own;
+    {
+      MutexLock lock(_mutex);
+      announce = step(millis());
+      own = ownAnnouncement();
+    }
+    if (announce) {
+      const size_t length = encode(own, packet, sizeof(packet));
+      if (socket.beginPacket(group, port) && socket.write(packet, length) == length &&
+          socket.endPacket()) {
+        NetworkAccounting::addTransferTo(NetSubsystem::Ddns, 0, static_cast<uint32_t>(length));
+      }
+    }
+    delay(kPollMs);
+  }
+  socket.stop();
+}
+
+void DdnsLeaderElection::resetRole(uint32_t now) {
+  _role = _enabled ? DdnsLanRole::Candidate : DdnsLanRole::Off;
+  _roleSinceMs = now;
+  _claimAfterMs = now + kDiscoveryMs;
+  _leaderId = 0;
+  _leaderAddress = IPAddress();
+  _leaderExpiresAtMs = 0;
+  _announcedOnce = false;
+}
+
+void DdnsLeaderElection::handleAnnouncement(const Announcement& announcement,
+                                            const IPAddress& from,
+                                            uint32_t now) {
+  if (!_enabled || announcement.clusterId != _clusterId || announcement.nodeId == _nodeId) {
+    return;
+  }
+
+  bool known = false;
+  for (size_t i = 0; i < _peers.size(); ++i) {
+    if (_peers[i].nodeId == announcement.nodeId) {
+      _peers[i].address = from;
+      _peers[i].lastHeardMs = now;
+      known = true;
+      break;
+    }
+  }
+  if (!known && _peers.size() < kMaxPeers) {
+    Peer peer;
+    peer.nodeId = announcement.nodeId;
+    peer.address = from;
+    peer.lastHeardMs = now;
+    _peers.push_back(peer);
+  }
+
+  if (!announcement.leader) {
+    return;
+  }
+  // Of two leaders the lower id wins; the other one steps down on hearing it.
+  if (_role == DdnsLanRole::Leader && announcement.nodeId > _nodeId) {
+    return;
+  }
+  const bool leaseValid = static_cast<int32_t>(now - _leaderExpiresAtMs) < 0;
+  if (_role == DdnsLanRole::Follower && leaseValid && announcement.nodeId > _leaderId) {
+    return;
+  }
+  if (_role != DdnsLanRole::Follower) {
+    _role = DdnsLanRole::Follower;
+    _roleSinceMs = now;
+  }
+  _leaderId = announcement.nodeId;
+  _leaderAddress = from;
+  _leaderExpiresAtMs = now + announcement.leaseMs;
+}
+
+bool DdnsLeaderElection::step(uint32_t now) {
+  if (!_enabled) {
+    return false;
+  }
+
+  for (size_t i = _peers.size(); i > 0; --i) {
+    if (now - _peers[i - 1].lastHeardMs >= kLeaseMs) {
+      _peers.erase(_peers.begin() + (i - 1));
+    }
+  }
+
+  if (_role == DdnsLanRole::Follower && static_cast<int32_t>(now - _leaderExpiresAtMs) >= 0) {
+    // The peers kept listening the whole time, so the next one may claim at once.
+    for (size_t i = 0; i < _peers.size(); ++i) {
+      if (_peers[i].nodeId == _leaderId) {
+        _peers.erase(_peers.begin() + i);
+        break;
+      }
+    }
+    _role = DdnsLanRole::Candidate;
+    _roleSinceMs = now;
+    _claimAfterMs = now;
+    _leaderId = 0;
+    _leaderAddress = IPAddress();
+  }
+
+  if (_role == DdnsLanRole::Candidate && static_cast<int32_t>(now - _claimAfterMs) >= 0 &&
+      (isLowestLiveNode() || now - _roleSinceMs >= kClaimTimeoutMs)) {
+    _role = DdnsLanRole::Leader;
+    _roleSinceMs = now;
+    _leaderId = _nodeId;
+    _takeovers += 1;
+    // Tell the others right away instead of at the next interval.
+    _announcedOnce = false;
+  }
+
+  if (_announcedOnce && now - _lastAnnouncedAtMs < kAnnounceIntervalMs) {
+    return false;
+  }
+  _announcedOnce = true;
+  _lastAnnouncedAtMs = now;
+  return true;
+}
+
+bool DdnsLeaderElection::isLowestLiveNode() const {
+  for (size_t i = 0; i < _peers.size(); ++i) {
+    if (_peers[i].nodeId < _nodeId) {
+      return false;
+    }
+  }
+  return true;
+}
+
+DdnsLeaderElection::Announcement DdnsLeaderElection::ownAnnouncement() const {
+  Announcement announcement;
+  announcement.clusterId = _clusterId;
+  announcement.nodeId = _nodeId;
+  announcement.leader = _role == DdnsLanRole::Leader;
+  announcement.leaseMs = announcement.leader ? static_cast<uint16_t>(kLeaseMs) : 0;
+  return announcement;
+}
@@ -1,18 +1,94 @@
 #include "DdnsService.h"
+#include "AliyunCircuitBreaker.h"
 #include "AliyunDdnsClient.h"
 #include "ConfigStore.h"
+#include "DnsCache.h"
+#include "NetworkAccounting.h"
+#include "PublicIpObserver.h"
 #include "PublicIpService.h"
 
-DdnsService::DdnsService(ConfigStore& configStore) : _configStore(configStore) {}
+DdnsService::DdnsService(ConfigStore& configStore)
+    : _configStore(configStore), _statusMutex(xSemaphoreCreateMutex())
+{
+  publishStatus();
+}
+
+DdnsService::~DdnsService()
+{
+  PublicIpObserver::removeChangeListener(this);
+  if (_commands != nullptr)
+  {
+    // The engine finishes its current cycle first; it must not outlive `this`.
+    Command stop;
+    stop.type = CommandType::Stop;
+    xQueueSend(_commands, &stop, portMAX_DELAY);
+    xSemaphoreTake(_engineStopped, portMAX_DELAY);
+
+    // Commands that never reached the engine still own their config.
+    Command pending;
+    while (xQueueReceive(_commands, &pending, 0) == pdTRUE)
+    {
+      if (pending.type == CommandType::UpdateConfig)
+      {
+        delete pending.config;
+      }
+    }
+    vSemaphoreDelete(_engineStopped);
+    vQueueDelete(_commands);
+  }
+  vSemaphoreDelete(_statusMutex);
+}
 
 #include <algorithm>
+#include <cstring>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <time.h>
 
 namespace
 {
   constexpr const char *kProviderId = "aliyun";
+  constexpr const char *kRecordTypeIpv4 = "A";
   constexpr uint32_t kDefaultDdnsIntervalSeconds = 300;
   constexpr uint32_t kMinDdnsIntervalSeconds = 30;
   constexpr uint32_t kMaxDdnsIntervalSeconds = 86400;
+  constexpr uint32_t kDnsPrefetchLeadMs = 30000;
+  // Signed Aliyun calls go through mbedTLS, like the AsyncHttpClient worker.
+  constexpr uint32_t kEngineStackSize = 8192;
+  constexpr UBaseType_t kEnginePriority = 1;
+  constexpr UBaseType_t kCommandQueueLength = 8;
+  // The engine wakes at least this often to check due records and settled events.
+  constexpr uint32_t kEnginePollMs = 1000;
+  // First syncs of new records are spread over this window, one slot per sync group.
+  constexpr uint32_t kFirstSyncSpreadMs = 30000;
+  // Each cycle lands up to this fraction (per mille) of the interval early or late,
+  // so records started together drift apart instead of staying in lockstep.
+  constexpr long kIntervalJitterPermille = 50;
+
+  class MutexLock
+  {
+  public:
+    explicit MutexLock(SemaphoreHandle_t mutex) : _mutex(mutex)
+    {
+      xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+    ~MutexLock() { xSemaphoreGive(_mutex); }
+
+  private:
+    SemaphoreHandle_t _mutex;
+  };
+
+  long drawIntervalJitterPermille()
+  {
+    return random(-kIntervalJitterPermille, kIntervalJitterPermille + 1);
+  }
+
+  // `intervalSeconds` in ms, moved early or late by `jitterPermille` of itself.
+  uint32_t jitteredIntervalMs(uint32_t intervalSeconds, long jitterPermille)
+  {
+    return intervalSeconds * 1000UL + static_cast<int32_t>(intervalSeconds) * jitterPermille;
+  }
 
   bool isValidIntervalSeconds(uint32_t value)
   {
@@ -56,6 +132,21 @@ namespace
     subDomain = fullDomain.substring(0, firstDotPos);
     rootDomain = fullDomain.substring(firstDotPos + 1);
   }
+
+  // Records sharing credentials and root domain are served by one DescribeDomainRecords call.
+  String syncGroupKey(const DdnsRecordConfig &config, const String &rootDomain)
+  {
+    return config.username + "\n" + config.password + "\n" + rootDomain;
+  }
+
+  struct SyncGroup
+  {
+    String key;
+    String username;
+    String password;
+    String rootDomain;
+    std::vector<size_t> members;
+  };
 } // namespace
 
 void DdnsService::configureRuntimeRecord(RuntimeRecord* runtime) {
@@ -65,14 +156,8 @@ void DdnsService::configureRuntimeRecord(RuntimeRecord* runtime) {
   
   // For Aliyun, username = AccessKeyId, password = AccessKeySecret
   // domain is the full domain (e.g., "www.hupokeji.top")
-  String rootDomain, subDomain;
-  splitDomain(runtime->config.domain, rootDomain, subDomain);
-  runtime->client.begin(
-    runtime->config.username,
-    runtime->config.password,
-    rootDomain,
-    subDomain
-  );
+  splitDomain(runtime->config.domain, runtime->rootDomain, runtime->rr);
+  runtime->recordId = "";
 }
 
 
@@ -83,19 +168,134 @@ void DdnsService::begin()
     return;
   }
   _begun = true;
+  _ipHistory.load();
+  _bootStatePending = DdnsStateStore::load(&_bootState);
+  _savedState = _bootState;
+  PublicIpObserver::setChangeListener(&DdnsService::onPublicIpChanged, this);
+  _election.start();
+  startEngine();
+}
+
+bool DdnsService::startEngine()
+{
+  QueueHandle_t queue = xQueueCreate(kCommandQueueLength, sizeof(Command));
+  SemaphoreHandle_t stopped = xSemaphoreCreateBinary();
+  if (queue == nullptr || stopped == nullptr)
+  {
+    if (queue != nullptr)
+    {
+      vQueueDelete(queue);
+    }
+    if (stopped != nullptr)
+    {
+      vSemaphoreDelete(stopped);
+    }
+    return false;
+  }
+
+  // Everything the engine touches from here on belongs to it.
+  _commands = queue;
+  _engineStopped = stopped;
+  if (xTaskCreate(engineTask, "ddns_engine", kEngineStackSize, this, kEnginePriority, nullptr) !=
+      pdPASS)
+  {
+    // Without the task, calls keep running inline on the caller.
+    _commands = nullptr;
+    _engineStopped = nullptr;
+    vQueueDelete(queue);
+    vSemaphoreDelete(stopped);
+    return false;
+  }
+  return true;
+}
+
+void DdnsService::engineTask(void *context)
+{
+  DdnsService *service = static_cast<DdnsService *>(context);
+  Command command;
+  while (true)
+  {
+    if (xQueueReceive(service->_commands, &command, pdMS_TO_TICKS(kEnginePollMs)) == pdTRUE)
+    {
+      if (command.type == CommandType::Stop)
+      {
+        break;
+      }
+      service->handleCommand(command);
+    }
+    service->runEngine();
+  }
+  xSemaphoreGive(service->_engineStopped);
+  vTaskDelete(nullptr);
+}
+
+bool DdnsService::post(const Command &command)
+{
+  if (_commands == nullptr)
+  {
+    handleCommand(command);
+    publishStatus();
+    return true;
+  }
+  return xQueueSend(_commands, &command, 0) == pdTRUE;
+}
+
+void DdnsService::handleCommand(const Command &command)
+{
+  switch (command.type)
+  {
+  case CommandType::UpdateConfig:
+    applyConfig(*command.config);
+    delete command.config;
+    break;
+  case CommandType::WifiState:
+    _wifiConnected = command.wifiConnected;
+    break;
+  case CommandType::SyncAll:
+    markAllDue();
+    break;
+  case CommandType::Wake:
+  case CommandType::Stop:
+  default:
+    break;
+  }
 }
 
 void DdnsService::updateConfig(const DdnsConfig &config)
 {
-  const DdnsConfig normalized = normalizeConfig(config);
+  Command command;
+  command.type = CommandType::UpdateConfig;
+  command.config = new DdnsConfig(normalizeConfig(config));
+  // A full queue must not lose a config change; wait for the engine to drain it.
+  if (_commands == nullptr)
+  {
+    post(command);
+  }
+  else
+  {
+    xQueueSend(_commands, &command, portMAX_DELAY);
+  }
+}
+
+void DdnsService::applyConfig(const DdnsConfig &normalized)
+{
   if (configsEqual(_config, normalized))
   {
     return;
   }
 
   _config = normalized;
-  _totalUpdateCount = 0;
-  rebuildRuntimeRecords();
+  _election.configure(_config.enabled && _config.lanCoordination, clusterIdOf(_config));
+  // New credentials deserve a fresh attempt instead of waiting out an auth backoff;
+  // unchanged ones keep their breaker, even while it is open.
+  std::vector<String> renewedAccessKeyIds;
+  reconcileRuntimeRecords(&renewedAccessKeyIds);
+  for (size_t index = 0; index < renewedAccessKeyIds.size(); ++index)
+  {
+    AliyunCircuitBreaker::reset(renewedAccessKeyIds[index]);
+  }
+  _historyDirty = true;
+  persistState();
 
   if (!_config.enabled)
   {
@@ -125,12 +325,35 @@ void DdnsService::updateConfig(const DdnsConfig &config)
 
 void DdnsService::tick(bool wifiConnected)
 {
-  if (!_begun)
+  if (_commands == nullptr)
+  {
+    _wifiConnected = wifiConnected;
+    runEngine();
+    return;
+  }
+  if (wifiConnected == _postedWifiConnected)
+  {
+    return;
+  }
+
+  Command command;
+  command.type = CommandType::WifiState;
+  command.wifiConnected = wifiConnected;
+  if (post(command))
   {
-    begin();
+    _postedWifiConnected = wifiConnected;
   }
+}
 
-  _wifiConnected = wifiConnected;
+void DdnsService::runEngine()
+{
+  runPass();
+  publishStatus();
+}
+
+void DdnsService::runPass()
+{
+  NetworkAccounting::Scope accountingScope(NetSubsystem::Ddns);
 
   if (!_config.enabled)
   {
@@ -171,7 +394,7 @@ void DdnsService::tick(bool wifiConnected)
     return;
   }
 
-  if (!wifiConnected)
+  if (!_wifiConnected)
   {
     setState("WAIT_WIFI", "WiFi disconnected.");
     for (size_t index = 0; index < _runtimeRecords.size(); ++index)
@@ -193,7 +416,30 @@ void DdnsService::tick(bool wifiConnected)
     return;
   }
 
+  if (!_election.isLeader())
+  {
+    const DdnsLeaderStatus leader = _election.getStatus();
+    setState("STANDBY",
+             leader.leaderIp.isEmpty() ? String("Electing a DDNS leader on the LAN.")
+                                       : "DDNS synced by LAN leader " + leader.leaderIp + ".");
+    for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+    {
+      RuntimeRecord &record = _runtimeRecords[index];
+      if (record.config.enabled && isRecordConfigured(record.config))
+      {
+        setRecordState(&record, "STANDBY", "Synced by the LAN leader.");
+      }
+    }
+    return;
+  }
+
   const uint32_t now = millis();
+  applyPendingEvents(now);
+  staggerFirstSyncs(now);
+
+  std::vector<size_t> dueIndices;
+  bool prefetchAliyun = false;
+  bool prefetchPublicIp = false;
   for (size_t index = 0; index < _runtimeRecords.size(); ++index)
   {
     RuntimeRecord &record = _runtimeRecords[index];
@@ -209,15 +455,13 @@ void DdnsService::tick(bool wifiConnected)
       continue;
     }
 
-    const uint32_t intervalMs = record.config.updateIntervalSeconds * 1000UL;
-    if (record.nextSyncDueAtMs == 0)
+    const bool shouldSync = static_cast<int32_t>(now - record.nextSyncDueAtMs) >= 0;
+
+    if (record.syncInFlight)
     {
-      record.nextSyncDueAtMs = now;
+      setRecordState(&record, "RUNNING", "Sync in progress...");
     }
-    const bool shouldSync =
-        record.firstSyncPending || static_cast<int32_t>(now - record.nextSyncDueAtMs) >= 0;
-
-    if (!record.lastNewIp.isEmpty())
+    else if (!record.lastNewIp.isEmpty())
     {
       setRecordState(&record, "RUNNING", "Last synced IP: " + record.lastNewIp + ".");
     }
@@ -230,41 +474,658 @@ void DdnsService::tick(bool wifiConnected)
       setRecordState(&record, "RUNNING", "Monitoring public IP changes.");
     }
 
-    if (!shouldSync)
+    if (shouldSync && !record.syncInFlight)
+    {
+      dueIndices.push_back(index);
+    }
+    else if (static_cast<int32_t>(record.nextSyncDueAtMs - now) <=
+             static_cast<int32_t>(kDnsPrefetchLeadMs))
+    {
+      prefetchAliyun = true;
+      prefetchPublicIp = prefetchPublicIp || !record.config.useLocalIp;
+    }
+  }
+
+  // Resolve the hosts of the upcoming cycle in the background so it does not wait on DNS.
+  if (prefetchAliyun)
+  {
+    DnsCache::prefetchUrl(AliyunDdnsClient::getEndpoint());
+  }
+  if (prefetchPublicIp)
+  {
+    PublicIpService::prefetchHosts();
+  }
+
+  setState("RUNNING", "DDNS running.");
+  if (!dueIndices.empty())
+  {
+    syncDueRecords(dueIndices, now);
+  }
+}
+
+void DdnsService::staggerFirstSyncs(uint32_t now)
+{
+  // Records sharing credentials and root domain are synced by one Describe call,
+  // so slots go to those groups rather than to single records.
+  std::vector<String> groups;
+  std::vector<size_t> waiting;
+  for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+  {
+    const RuntimeRecord &record = _runtimeRecords[index];
+    if (!record.config.enabled || !isRecordConfigured(record.config))
     {
       continue;
     }
+    const String key = syncGroupKey(record.config, record.rootDomain);
+    if (std::find(groups.begin(), groups.end(), key) == groups.end())
+    {
+      groups.push_back(key);
+    }
+    if (record.nextSyncDueAtMs == 0)
+    {
+      waiting.push_back(index);
+    }
+  }
 
-    const String observedIp = PublicIpService::resolve(record.config.useLocalIp);
-    if (!observedIp.isEmpty())
+  for (size_t position = 0; position < waiting.size(); ++position)
+  {
+    RuntimeRecord &record = _runtimeRecords[waiting[position]];
+    const String key = syncGroupKey(record.config, record.rootDomain);
+    const size_t slot = std::find(groups.begin(), groups.end(), key) - groups.begin();
+    record.nextSyncDueAtMs = now + static_cast<uint32_t>(slot * kFirstSyncSpreadMs / groups.size());
+    // 0 means "not scheduled yet".
+    if (record.nextSyncDueAtMs == 0)
     {
-      record.lastNewIp = observedIp;
+      record.nextSyncDueAtMs = 1;
     }
+  }
+}
 
-    const uint32_t updateCountBefore = record.updateCount;
-    record.client.update(now, record.config.useLocalIp);
+void DdnsService::requestSyncAll()
+{
+  Command command;
+  command.type = CommandType::SyncAll;
+  post(command);
+}
+
+void DdnsService::markAllDue()
+{
+  const uint32_t now = millis();
+  for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+  {
+    _runtimeRecords[index].nextSyncDueAtMs = now;
+  }
+}
+
+void DdnsService::notify(DdnsTrigger trigger)
+{
+  const uint32_t now = millis();
+  portENTER_CRITICAL(&_eventMux);
+  if (_pendingEvents == 0)
+  {
+    _firstEventAtMs = now;
+  }
+  _pendingEvents |= static_cast<uint8_t>(1U << static_cast<uint8_t>(trigger));
+  _lastEventAtMs = now;
+  portEXIT_CRITICAL(&_eventMux);
+
+  if (_commands != nullptr)
+  {
+    Command command;
+    command.type = CommandType::Wake;
+    xQueueSend(_commands, &command, 0);
+  }
+}
+
+void DdnsService::onPublicIpChanged(void *context)
+{
+  static_cast<DdnsService *>(context)->notify(DdnsTrigger::PublicIpChanged);
+}
+
+void DdnsService::applyPendingEvents(uint32_t now)
+{
+  uint8_t events = 0;
+  portENTER_CRITICAL(&_eventMux);
+  // Wi-Fi flaps and the public IP change that follows a redial arrive together;
+  // wait for them to settle so they cost one cycle.
+  if (_pendingEvents != 0 &&
+      (now - _lastEventAtMs >= kEventDebounceMs || now - _firstEventAtMs >= kMaxEventDelayMs))
+  {
+    events = _pendingEvents;
+    _pendingEvents = 0;
+  }
+  portEXIT_CRITICAL(&_eventMux);
+  if (events == 0)
+  {
+    return;
+  }
+
+  const uint8_t wifiEvents =
+      static_cast<uint8_t>((1U << static_cast<uint8_t>(DdnsTrigger::WifiGotIp)) |
+                           (1U << static_cast<uint8_t>(DdnsTrigger::WifiLostIp)));
+  // A new lease can change the station address and the public one alike.
+  const bool allRecords = (events & wifiEvents) != 0;
+  const String publicIp = PublicIpObserver::getObservation().ipv4;
+  for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+  {
+    RuntimeRecord &record = _runtimeRecords[index];
+    if (!record.config.enabled || !isRecordConfigured(record.config) || record.syncInFlight)
+    {
+      continue;
+    }
+    // Only public records that do not already carry the new address.
+    if (!allRecords && (record.config.useLocalIp || record.lastNewIp == publicIp))
+    {
+      continue;
+    }
+    if (static_cast<int32_t>(now - record.nextSyncDueAtMs) < 0)
+    {
+      _eventSyncCount += 1;
+    }
+    record.nextSyncDueAtMs = now;
+  }
+}
+
+void DdnsService::syncDueRecords(const std::vector<size_t> &dueIndices, uint32_t now)
+{
+  SyncCycle cycle;
+  cycle.items.reserve(dueIndices.size());
+  // One draw per cycle: records due together stay together, so a group keeps
+  // sharing its DescribeDomainRecords call.
+  const long jitterPermille = drawIntervalJitterPermille();
+  for (size_t index = 0; index < dueIndices.size(); ++index)
+  {
+    RuntimeRecord &record = _runtimeRecords[dueIndices[index]];
     record.firstSyncPending = false;
-    record.nextSyncDueAtMs = now + intervalMs;
+    record.checkIntervalSeconds = planIntervalSeconds(record.config);
+    record.nextSyncDueAtMs = now + jitteredIntervalMs(record.checkIntervalSeconds, jitterPermille);
+    record.syncInFlight = true;
+    setRecordState(&record, "RUNNING", "Sync in progress...");
 
-    if (record.updateCount == updateCountBefore)
+    SyncItem item;
+    item.index = dueIndices[index];
+    item.config = record.config;
+    item.rootDomain = record.rootDomain;
+    item.rr = record.rr;
+    item.recordId = record.recordId;
+    item.lastNewIp = record.lastNewIp;
+    item.confirmedIp = record.confirmedIp;
+    item.trustConfirmedIp = record.trustConfirmedIp;
+    record.trustConfirmedIp = false;
+    cycle.items.push_back(item);
+  }
+
+  // Readers see the records in flight while the cycle holds the engine.
+  _syncInProgress = true;
+  publishStatus();
+  runSyncCycle(&cycle);
+  finishSyncCycle(cycle);
+  _syncInProgress = false;
+}
+
+void DdnsService::finishSyncCycle(const SyncCycle &cycle)
+{
+  const bool ipChanged =
+      !cycle.observedPublicIp.isEmpty() &&
+      _ipHistory.observe(cycle.observedPublicIp, static_cast<uint32_t>(time(nullptr)));
+
+  for (size_t index = 0; index < cycle.items.size(); ++index)
+  {
+    const SyncItem &item = cycle.items[index];
+    if (item.index >= _runtimeRecords.size())
     {
-      if (record.lastNewIp.isEmpty())
+      continue;
+    }
+
+    RuntimeRecord &record = _runtimeRecords[item.index];
+    record.syncInFlight = false;
+    DdnsSyncAttempt attempt;
+    attempt.atMs = cycle.startedAtMs;
+    attempt.at = cycle.startedAt;
+    attempt.outcome = item.outcome;
+    attempt.resolveMs = item.resolveMs;
+    attempt.apiMs = item.apiMs;
+    attempt.totalMs = item.totalMs;
+    attempt.changeToUpdateMs = item.changeToUpdateMs;
+    strncpy(attempt.errorCode, item.errorCode.c_str(), sizeof(attempt.errorCode) - 1);
+    record.history.record(attempt);
+    _historyDirty = true;
+    record.recordId = item.recordId;
+    record.lastNewIp = item.lastNewIp;
+    if (item.confirmed)
+    {
+      record.confirmedIp = item.lastNewIp;
+    }
+    if (item.updated)
+    {
+      applyRecordUpdate(&record, item.oldIp, item.lastNewIp);
+    }
+    else if (!item.message.isEmpty())
+    {
+      setRecordState(&record, "RUNNING", item.message);
+    }
+  }
+
+  // A change resets the learned pace; waiting out a long stable-period interval
+  // would miss a follow-up change.
+  if (ipChanged && _config.adaptiveInterval)
+  {
+    const uint32_t now = millis();
+    const long jitterPermille = drawIntervalJitterPermille();
+    for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+    {
+      RuntimeRecord &record = _runtimeRecords[index];
+      if (record.syncInFlight || record.config.useLocalIp)
       {
-        setRecordState(&record, "RUNNING", "Sync attempted; waiting provider callback for latest IP.");
+        continue;
       }
-      else
+      record.checkIntervalSeconds = planIntervalSeconds(record.config);
+      record.nextSyncDueAtMs = now + jitteredIntervalMs(record.checkIntervalSeconds, jitterPermille);
+    }
+  }
+
+  persistState();
+}
+
+void DdnsService::restoreBootState()
+{
+  for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+  {
+    RuntimeRecord &record = _runtimeRecords[index];
+    const uint32_t identity = DdnsStateStore::identityOf(record.config);
+    for (size_t stateIndex = 0; stateIndex < _bootState.size(); ++stateIndex)
+    {
+      const DdnsPersistedRecord &state = _bootState[stateIndex];
+      if (state.identity != identity)
       {
-        setRecordState(&record,
-                       "RUNNING",
-                       "Sync attempted; provider callback pending. Detected IP: " + record.lastNewIp + ".");
+        continue;
       }
+      record.recordId = state.recordId;
+      record.confirmedIp = state.confirmedIp;
+      record.lastNewIp = state.confirmedIp;
+      record.lastUpdateAt = state.lastUpdateAt;
+      record.updateCount = state.updateCount;
+      record.trustConfirmedIp = !state.recordId.isEmpty() && !state.confirmedIp.isEmpty();
+      break;
     }
   }
+  _bootState.clear();
+  _bootStatePending = false;
+}
 
-  setState("RUNNING", "DDNS running.");
+void DdnsService::persistState()
+{
+  // Without begin() (unit tests, benchmarks) nothing was loaded and nothing is written.
+  if (!_begun)
+  {
+    return;
+  }
+
+  std::vector<DdnsPersistedRecord> state;
+  state.reserve(_runtimeRecords.size());
+  for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+  {
+    const RuntimeRecord &record = _runtimeRecords[index];
+    if (record.recordId.isEmpty() && record.confirmedIp.isEmpty() && record.updateCount == 0)
+    {
+      continue;
+    }
+    DdnsPersistedRecord entry;
+    entry.identity = DdnsStateStore::identityOf(record.config);
+    entry.recordId = record.recordId;
+    entry.confirmedIp = record.confirmedIp;
+    entry.lastUpdateAt = record.lastUpdateAt;
+    entry.updateCount = record.updateCount;
+    state.push_back(entry);
+  }
+
+  bool unchanged = state.size() == _savedState.size();
+  for (size_t index = 0; unchanged && index < state.size(); ++index)
+  {
+    const DdnsPersistedRecord &lhs = state[index];
+    const DdnsPersistedRecord &rhs = _savedState[index];
+    unchanged = lhs.identity == rhs.identity && lhs.recordId == rhs.recordId &&
+                lhs.confirmedIp == rhs.confirmedIp && lhs.lastUpdateAt == rhs.lastUpdateAt &&
+                lhs.updateCount == rhs.updateCount;
+  }
+  // Flash wear: a steady state writes nothing.
+  if (unchanged)
+  {
+    return;
+  }
+  if (DdnsStateStore::save(state))
+  {
+    _savedState.swap(state);
+  }
+}
+
+bool DdnsService::isSyncInProgress() const
+{
+  MutexLock lock(_statusMutex);
+  return _publishedSyncInProgress;
+}
+
+void DdnsService::runSyncCycle(SyncCycle *cycle)
+{
+  cycle->startedAtMs = millis();
+  const uint32_t unixTime = static_cast<uint32_t>(time(nullptr));
+  cycle->startedAt = unixTime >= IpChangeHistory::kMinValidUnixTime ? unixTime : 0;
+
+  std::vector<SyncGroup> groups;
+  for (size_t index = 0; index < cycle->items.size(); ++index)
+  {
+    const SyncItem &item = cycle->items[index];
+    const String key = syncGroupKey(item.config, item.rootDomain);
+    SyncGroup *group = nullptr;
+    for (size_t groupIndex = 0; groupIndex < groups.size(); ++groupIndex)
+    {
+      if (groups[groupIndex].key == key)
+      {
+        group = &groups[groupIndex];
+        break;
+      }
+    }
+    if (group == nullptr)
+    {
+      groups.push_back(SyncGroup{key, item.config.username, item.config.password, item.rootDomain, {}});
+      group = &groups.back();
+    }
+    group->members.push_back(index);
+  }
+
+  // Public and local IPs are resolved at most once per cycle, shared by every group.
+  String observedIps[2];
+  bool observedIpResolved[2] = {false, false};
+  uint32_t resolveMs[2] = {0, 0};
+  auto observedIpFor = [&](bool useLocalIp) -> const String &
+  {
+    const size_t slot = useLocalIp ? 1 : 0;
+    if (!observedIpResolved[slot])
+    {
+      const uint32_t resolveStartMs = millis();
+      observedIps[slot] = PublicIpObserver::resolve(useLocalIp);
+      resolveMs[slot] = millis() - resolveStartMs;
+      observedIpResolved[slot] = true;
+    }
+    return observedIps[slot];
+  };
+  auto finish = [&](SyncItem &item, DdnsSyncOutcome outcome)
+  {
+    item.outcome = outcome;
+    item.resolveMs = resolveMs[item.config.useLocalIp ? 1 : 0];
+    item.totalMs = millis() - cycle->startedAtMs;
+  };
+
+  for (size_t groupIndex = 0; groupIndex < groups.size(); ++groupIndex)
+  {
+    const SyncGroup &group = groups[groupIndex];
+
+    bool needsAliyun = false;
+    for (size_t memberIndex = 0; memberIndex < group.members.size(); ++memberIndex)
+    {
+      SyncItem &item = cycle->items[group.members[memberIndex]];
+      const String &observedIp = observedIpFor(item.config.useLocalIp);
+      if (observedIp.isEmpty())
+      {
+        item.message = "Failed to resolve public IP.";
+        finish(item, DdnsSyncOutcome::ResolveFailed);
+        continue;
+      }
+      item.lastNewIp = observedIp;
+      // State restored at boot already says Aliyun holds this address.
+      if (item.trustConfirmedIp && !item.recordId.isEmpty() && item.confirmedIp == observedIp)
+      {
+        item.confirmed = true;
+        item.message = "Record unchanged since last boot: " + observedIp + ".";
+        finish(item, DdnsSyncOutcome::Unchanged);
+        continue;
+      }
+      needsAliyun = true;
+    }
+    if (!needsAliyun)
+    {
+      continue;
+    }
+
+    AliyunDdnsClient client;
+    client.begin(group.username, group.password, group.rootDomain, "@");
+    std::vector<AliyunDomainRecord> zoneRecords;
+    const uint32_t describeStartMs = millis();
+    // No type filter: the unfiltered listing is shared with the dashboard through the
+    // Aliyun gateway, and members are matched on type below anyway.
+    const bool listed = client.describeDomainRecords(group.rootDomain, "", &zoneRecords);
+    const uint32_t describeMs = millis() - describeStartMs;
+    if (!listed)
+    {
+      for (size_t memberIndex = 0; memberIndex < group.members.size(); ++memberIndex)
+      {
+        SyncItem &item = cycle->items[group.members[memberIndex]];
+        if (observedIpFor(item.config.useLocalIp).isEmpty() || item.confirmed)
+        {
+          continue;
+        }
+        item.message = "Failed to list Aliyun records of " + group.rootDomain + " (" +
+                       client.getLastErrorCode() + ").";
+        item.errorCode = client.getLastErrorCode();
+        item.apiMs = describeMs;
+        finish(item, DdnsSyncOutcome::ListFailed);
+      }
+      continue;
+    }
+
+    for (size_t memberIndex = 0; memberIndex < group.members.size(); ++memberIndex)
+    {
+      SyncItem &item = cycle->items[group.members[memberIndex]];
+      const String &observedIp = observedIpFor(item.config.useLocalIp);
+      if (observedIp.isEmpty() || item.confirmed)
+      {
+        continue;
+      }
+      item.apiMs = describeMs;
+
+      const AliyunDomainRecord *zoneRecord = nullptr;
+      for (size_t zoneIndex = 0; zoneIndex < zoneRecords.size(); ++zoneIndex)
+      {
+        if (zoneRecords[zoneIndex].rr.equalsIgnoreCase(item.rr) &&
+            zoneRecords[zoneIndex].type == kRecordTypeIpv4)
+        {
+          zoneRecord = &zoneRecords[zoneIndex];
+          break;
+        }
+      }
+
+      if (zoneRecord == nullptr)
+      {
+        item.recordId = "";
+        item.message = "Record " + item.config.domain + " not found on Aliyun.";
+        finish(item, DdnsSyncOutcome::NotFound);
+        continue;
+      }
+
+      item.recordId = zoneRecord->recordId;
+      if (zoneRecord->value == observedIp)
+      {
+        item.confirmed = true;
+        item.message = "Record up to date: " + observedIp + ".";
+        finish(item, DdnsSyncOutcome::UpToDate);
+        continue;
+      }
+
+      const uint32_t updateStartMs = millis();
+      const bool pushed =
+          client.updateDomainRecord(zoneRecord->recordId, zoneRecord->rr, kRecordTypeIpv4, observedIp);
+      item.apiMs += millis() - updateStartMs;
+      if (!pushed)
+      {
+        item.message = "Failed to update Aliyun record (" + client.getLastErrorCode() + ").";
+        item.errorCode = client.getLastErrorCode();
+        finish(item, DdnsSyncOutcome::UpdateFailed);
+        continue;
+      }
+
+      item.updated = true;
+      item.confirmed = true;
+      item.oldIp = zoneRecord->value;
+      if (!item.config.useLocalIp)
+      {
+        const PublicIpObservation observation = PublicIpObserver::getObservation();
+        if (observation.ipv4 == observedIp)
+        {
+          item.changeToUpdateMs = std::max<uint32_t>(1, millis() - observation.changedAtMs);
+        }
+      }
+      finish(item, DdnsSyncOutcome::Updated);
+    }
+  }
+
+  if (observedIpResolved[0])
+  {
+    cycle->observedPublicIp = observedIps[0];
+  }
+}
+
+void DdnsService::applyRecordUpdate(RuntimeRecord *record, const String &oldIp, const String &newIp)
+{
+  if (record == nullptr)
+  {
+    return;
+  }
+
+  record->updateCount += 1;
+  record->lastUpdateAtMs = millis();
+  const uint32_t unixTime = static_cast<uint32_t>(time(nullptr));
+  record->lastUpdateAt = unixTime >= IpChangeHistory::kMinValidUnixTime ? unixTime : 0;
+  record->lastOldIp = oldIp;
+  record->lastNewIp = newIp;
+  record->firstSyncPending = false;
+  if (!record->lastOldIp.isEmpty())
+  {
+    setRecordState(record,
+                   "UPDATED",
+                   "IP changed from " + record->lastOldIp + " to " + record->lastNewIp + ".");
+  }
+  else
+  {
+    setRecordState(record, "UPDATED", "IP updated to " + record->lastNewIp + ".");
+  }
+
+  _totalUpdateCount += 1;
+  setState("RUNNING", "DDNS update completed.");
+}
+
+uint32_t DdnsService::planIntervalSeconds(const DdnsRecordConfig &config) const
+{
+  if (!_config.adaptiveInterval || config.useLocalIp)
+  {
+    return config.updateIntervalSeconds;
+  }
+  return _ipHistory.planIntervalSeconds(static_cast<uint32_t>(time(nullptr)),
+                                        config.updateIntervalSeconds,
+                                        _config.adaptiveMinSeconds,
+                                        _config.adaptiveMaxSeconds);
 }
 
 DdnsRuntimeStatus DdnsService::getStatus() const
+{
+  MutexLock lock(_statusMutex);
+  return _publishedStatus;
+}
+
+std::vector<DdnsRecordRuntimeStatus> DdnsService::getRecordStatuses() const
+{
+  MutexLock lock(_statusMutex);
+  return _publishedRecords;
+}
+
+std::vector<DdnsRecordSyncHistory> DdnsService::getSyncHistory(size_t offset,
+                                                               size_t limit,
+                                                               size_t *total,
+                                                               DdnsSyncSummary *overall) const
+{
+  MutexLock lock(_statusMutex);
+  if (total != nullptr)
+  {
+    *total = _publishedHistory.size();
+  }
+  if (overall != nullptr)
+  {
+    *overall = _publishedSyncSummary;
+  }
+  if (offset >= _publishedHistory.size())
+  {
+    return {};
+  }
+  const size_t end = offset + std::min(limit, _publishedHistory.size() - offset);
+  return std::vector<DdnsRecordSyncHistory>(_publishedHistory.begin() + offset,
+                                            _publishedHistory.begin() + end);
+}
+
+std::vector<DdnsRecordRuntimeStatus> DdnsService::getRecordStatuses(size_t offset,
+                                                                    size_t limit,
+                                                                    size_t *total) const
+{
+  MutexLock lock(_statusMutex);
+  if (total != nullptr)
+  {
+    *total = _publishedRecords.size();
+  }
+  if (offset >= _publishedRecords.size())
+  {
+    return {};
+  }
+  const size_t end = offset + std::min(limit, _publishedRecords.size() - offset);
+  return std::vector<DdnsRecordRuntimeStatus>(_publishedRecords.begin() + offset,
+                                              _publishedRecords.begin() + end);
+}
+
+void DdnsService::publishStatus()
+{
+  // Built outside the lock so readers only wait for the swap.
+  DdnsRuntimeStatus status = buildStatus();
+  std::vector<DdnsRecordRuntimeStatus> records = buildRecordStatuses();
+  const bool historyChanged = _historyDirty;
+  std::vector<DdnsRecordSyncHistory> history;
+  DdnsSyncSummary summary;
+  if (historyChanged)
+  {
+    history = buildSyncHistory();
+    std::vector<DdnsSyncAttempt> attempts;
+    for (size_t index = 0; index < history.size(); ++index)
+    {
+      attempts.insert(attempts.end(), history[index].attempts.begin(), history[index].attempts.end());
+    }
+    summary = DdnsSyncHistory::summarize(attempts);
+    _historyDirty = false;
+  }
+
+  MutexLock lock(_statusMutex);
+  _publishedStatus = status;
+  _publishedRecords.swap(records);
+  _publishedSyncInProgress = _syncInProgress;
+  if (historyChanged)
+  {
+    _publishedHistory.swap(history);
+    _publishedSyncSummary = summary;
+  }
+}
+
+std::vector<DdnsRecordSyncHistory> DdnsService::buildSyncHistory() const
+{
+  std::vector<DdnsRecordSyncHistory> history;
+  history.reserve(_runtimeRecords.size());
+  for (size_t index = 0; index < _runtimeRecords.size(); ++index)
+  {
+    const RuntimeRecord &runtime = _runtimeRecords[index];
+    DdnsRecordSyncHistory record;
+    record.domain = runtime.config.domain;
+    record.attempts = runtime.history.attempts();
+    record.summary = DdnsSyncHistory::summarize(record.attempts);
+    history.push_back(record);
+  }
+  return history;
+}
+
+DdnsRuntimeStatus DdnsService::buildStatus() const
 {
   DdnsRuntimeStatus status;
   status.enabled = _config.enabled;
@@ -272,6 +1133,16 @@ DdnsRuntimeStatus DdnsService::getStatus() const
   status.state = _state;
   status.message = _message;
   status.totalUpdateCount = _totalUpdateCount;
+  status.adaptiveInterval = _config.adaptiveInterval;
+  status.ipChangeCount = static_cast<uint32_t>(_ipHistory.changeCount());
+  status.lastIpChangeAt = _ipHistory.lastChangeAt();
+  status.typicalIpChangeGapSeconds = _ipHistory.typicalGapSeconds();
+  status.eventSyncCount = _eventSyncCount;
+  const DdnsLeaderStatus leader = _election.getStatus();
+  status.lanCoordination = _config.lanCoordination;
+  status.lanRole = DdnsLeaderElection::roleName(leader.role);
+  status.lanLeaderIp = leader.leaderIp;
+  status.lanPeerCount = leader.peerCount;
 
   uint32_t activeRecordCount = 0;
   for (size_t index = 0; index < _runtimeRecords.size(); ++index)
@@ -287,7 +1158,7 @@ DdnsRuntimeStatus DdnsService::getStatus() const
   return status;
 }
 
-std::vector<DdnsRecordRuntimeStatus> DdnsService::getRecordStatuses() const
+std::vector<DdnsRecordRuntimeStatus> DdnsService::buildRecordStatuses() const
 {
   std::vector<DdnsRecordRuntimeStatus> records;
   records.reserve(_runtimeRecords.size());
@@ -301,6 +1172,7 @@ std::vector<DdnsRecordRuntimeStatus> DdnsService::getRecordStatuses() const
     status.domain = runtime.config.domain;
     status.username = runtime.config.username;
     status.updateIntervalSeconds = runtime.config.updateIntervalSeconds;
+    status.checkIntervalSeconds = runtime.checkIntervalSeconds;
     status.useLocalIp = runtime.config.useLocalIp;
     status.state = runtime.state;
     status.message = runtime.message;
@@ -308,6 +1180,7 @@ std::vector<DdnsRecordRuntimeStatus> DdnsService::getRecordStatuses() const
     status.lastNewIp = runtime.lastNewIp;
     status.updateCount = runtime.updateCount;
     status.lastUpdateAtMs = runtime.lastUpdateAtMs;
+    status.lastUpdateAt = runtime.lastUpdateAt;
     records.push_back(status);
   }
   return records;
@@ -334,6 +1207,20 @@ DdnsConfig DdnsService::normalizeConfig(const DdnsConfig &config)
 {
   DdnsConfig normalized;
   normalized.enabled = config.enabled;
+  normalized.adaptiveInterval = config.adaptiveInterval;
+  normalized.lanCoordination = config.lanCoordination;
+  if (isValidIntervalSeconds(config.adaptiveMinSeconds))
+  {
+    normalized.adaptiveMinSeconds = config.adaptiveMinSeconds;
+  }
+  if (isValidIntervalSeconds(config.adaptiveMaxSeconds))
+  {
+    normalized.adaptiveMaxSeconds = config.adaptiveMaxSeconds;
+  }
+  if (normalized.adaptiveMaxSeconds < normalized.adaptiveMinSeconds)
+  {
+    normalized.adaptiveMaxSeconds = normalized.adaptiveMinSeconds;
+  }
 
   const size_t maxRecords = ConfigStore::kMaxDdnsRecords;
   const size_t count = std::min(config.records.size(), maxRecords);
@@ -379,9 +1266,27 @@ bool DdnsService::recordsEqual(const DdnsRecordConfig &lhs, const DdnsRecordConf
          lhs.useLocalIp == rhs.useLocalIp;
 }
 
+uint32_t DdnsService::clusterIdOf(const DdnsConfig &config)
+{
+  uint32_t clusterId = 0;
+  for (size_t index = 0; index < config.records.size(); ++index)
+  {
+    if (isRecordConfigured(config.records[index]))
+    {
+      // Summed so the record order does not matter.
+      clusterId += DdnsStateStore::identityOf(config.records[index]);
+    }
+  }
+  return clusterId;
+}
+
 bool DdnsService::configsEqual(const DdnsConfig &lhs, const DdnsConfig &rhs)
 {
-  if (lhs.enabled != rhs.enabled || lhs.records.size() != rhs.records.size())
+  if (lhs.enabled != rhs.enabled || lhs.adaptiveInterval != rhs.adaptiveInterval ||
+      lhs.adaptiveMinSeconds != rhs.adaptiveMinSeconds ||
+      lhs.adaptiveMaxSeconds != rhs.adaptiveMaxSeconds ||
+      lhs.lanCoordination != rhs.lanCoordination ||
+      lhs.records.size() != rhs.records.size())
   {
     return false;
   }
@@ -409,64 +1314,144 @@ void DdnsService::setRecordState(RuntimeRecord *record,
   record->message = message;
 }
 
-void DdnsService::rebuildRuntimeRecords()
+DdnsService::RuntimeRecord DdnsService::makeRuntimeRecord(const DdnsRecordConfig &config)
 {
-  _runtimeRecords.clear();
-  _runtimeRecords.reserve(_config.records.size());
+  RuntimeRecord runtime{};
+  runtime.config = config;
+  configureRuntimeRecord(&runtime);
 
-  for (size_t index = 0; index < _config.records.size(); ++index)
+  if (!runtime.config.enabled)
+  {
+    runtime.state = "DISABLED";
+    runtime.message = "Record disabled.";
+  }
+  else if (!isRecordConfigured(runtime.config))
   {
-    RuntimeRecord runtime{};
-    runtime.config = _config.records[index];
-    configureRuntimeRecord(&runtime);
+    runtime.state = "WAIT_CONFIG";
+    runtime.message = "Record config incomplete.";
+  }
+  else
+  {
+    runtime.state = "READY";
+    runtime.message = "Ready to sync.";
+  }
+  return runtime;
+}
+
+void DdnsService::reconcileRuntimeRecords(std::vector<String> *renewedAccessKeyIds)
+{
+  std::vector<RuntimeRecord> previous;
+  previous.swap(_runtimeRecords);
+  std::vector<bool> claimed(previous.size(), false);
+  std::vector<int> matches(_config.records.size(), -1);
 
-    if (!runtime.config.enabled)
+  // Identical records first, so reordering never re-keys anything; then records
+  // that kept their domain, account and IP source but changed other settings.
+  for (uint8_t pass = 0; pass < 2; ++pass)
+  {
+    for (size_t index = 0; index < _config.records.size(); ++index)
     {
-      runtime.state = "DISABLED";
-      runtime.message = "Record disabled.";
+      if (matches[index] >= 0)
+      {
+        continue;
+      }
+      const DdnsRecordConfig &config = _config.records[index];
+      const uint32_t identity = DdnsStateStore::identityOf(config);
+      for (size_t old = 0; old < previous.size(); ++old)
+      {
+        const bool same = pass == 0 ? recordsEqual(previous[old].config, config)
+                                    : DdnsStateStore::identityOf(previous[old].config) == identity;
+        if (!claimed[old] && same)
+        {
+          claimed[old] = true;
+          matches[index] = static_cast<int>(old);
+          break;
+        }
+      }
     }
-    else if (!isRecordConfigured(runtime.config))
+  }
+
+  const uint32_t now = millis();
+  _runtimeRecords.reserve(_config.records.size());
+  for (size_t index = 0; index < _config.records.size(); ++index)
+  {
+    const DdnsRecordConfig &config = _config.records[index];
+    bool keyPairInUse = !isRecordConfigured(config);
+    for (size_t old = 0; old < previous.size() && !keyPairInUse; ++old)
     {
-      runtime.state = "WAIT_CONFIG";
-      runtime.message = "Record config incomplete.";
+      keyPairInUse = previous[old].config.username == config.username &&
+                     previous[old].config.password == config.password;
     }
-    else
+    if (!keyPairInUse &&
+        std::find(renewedAccessKeyIds->begin(), renewedAccessKeyIds->end(), config.username) ==
+            renewedAccessKeyIds->end())
     {
-      runtime.state = "READY";
-      runtime.message = "Ready to sync.";
+      renewedAccessKeyIds->push_back(config.username);
     }
 
+    if (matches[index] < 0)
+    {
+      _runtimeRecords.push_back(makeRuntimeRecord(config));
+      continue;
+    }
+
+    RuntimeRecord runtime = previous[matches[index]];
+    if (!recordsEqual(runtime.config, config))
+    {
+      retuneRuntimeRecord(&runtime, config, now);
+    }
     _runtimeRecords.push_back(runtime);
   }
 
+  if (_bootStatePending)
+  {
+    restoreBootState();
+  }
+
+  _totalUpdateCount = 0;
   for (size_t index = 0; index < _runtimeRecords.size(); ++index)
   {
-    RuntimeRecord& record = _runtimeRecords[index];
-    auto onUpdateCallback = [this, index](const char *oldIp, const char *newIp)
-    {
-      if (index >= _runtimeRecords.size()) {
-        return;
-      }
+    _totalUpdateCount += _runtimeRecords[index].updateCount;
+  }
+}
 
-      RuntimeRecord& runtime = _runtimeRecords[index];
-      runtime.updateCount += 1;
-      runtime.lastUpdateAtMs = millis();
-      runtime.lastOldIp = oldIp != nullptr ? String(oldIp) : "";
-      runtime.lastNewIp = newIp != nullptr ? String(newIp) : "";
-      runtime.firstSyncPending = false;
-      if (!runtime.lastOldIp.isEmpty()) {
-        setRecordState(&runtime,
-                       "UPDATED",
-                       "IP changed from " + runtime.lastOldIp + " to " + runtime.lastNewIp + ".");
-      } else {
-        setRecordState(&runtime, "UPDATED", "IP updated to " + runtime.lastNewIp + ".");
-      }
+void DdnsService::retuneRuntimeRecord(RuntimeRecord *runtime,
+                                      const DdnsRecordConfig &config,
+                                      uint32_t now)
+{
+  const DdnsRecordConfig previous = runtime->config;
+  runtime->config = config;
+  // Same identity, so the domain differs at most in case: the RecordId stays valid.
+  splitDomain(config.domain, runtime->rootDomain, runtime->rr);
+
+  if (!config.enabled || !isRecordConfigured(config))
+  {
+    const RuntimeRecord idle = makeRuntimeRecord(config);
+    setRecordState(runtime, idle.state, idle.message);
+    runtime->firstSyncPending = true;
+    return;
+  }
 
-      _totalUpdateCount += 1;
-      setState("RUNNING", "DDNS update completed.");
-    };
+  // Re-enabled or new credentials: check right away.
+  if (!previous.enabled || !isRecordConfigured(previous) || previous.password != config.password)
+  {
+    runtime->firstSyncPending = true;
+    runtime->nextSyncDueAtMs = now;
+    setRecordState(runtime, "READY", "Ready to sync.");
+    return;
+  }
 
-    record.client.onUpdate(onUpdateCallback);
+  // A new interval keeps the phase of the last check instead of restarting it.
+  if (previous.updateIntervalSeconds != config.updateIntervalSeconds && !runtime->firstSyncPending)
+  {
+    const uint32_t lastCheckAtMs = runtime->nextSyncDueAtMs - runtime->checkIntervalSeconds * 1000UL;
+    runtime->checkIntervalSeconds = planIntervalSeconds(config);
+    runtime->nextSyncDueAtMs =
+        lastCheckAtMs + jitteredIntervalMs(runtime->checkIntervalSeconds, drawIntervalJitterPermille());
+    if (static_cast<int32_t>(runtime->nextSyncDueAtMs - now) < 0)
+    {
+      runtime->nextSyncDueAtMs = now;
+    }
   }
 }
 
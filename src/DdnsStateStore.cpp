@@ -0,0 +1,103 @@
+#include "DdnsStateStore.h"
+
+#include <cstring>
+
+#include "Hal.h"
+
+namespace {
+uint32_t fnv1a(uint32_t hash, const String& value) {
+  for (size_t i = 0; i < value.length(); ++i) {
+    hash ^= static_cast<uint8_t>(value[i]);
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+}  // namespace
+
+uint32_t DdnsStateStore::identityOf(const DdnsRecordConfig& record) {
+  String domain = record.domain;
+  domain.trim();
+  domain.toLowerCase();
+  uint32_t hash = fnv1a(2166136261UL, domain);
+  hash = fnv1a(hash, "\n" + record.username);
+  return fnv1a(hash, record.useLocalIp ? "\nlocal" : "\npublic");
+}
+
+bool DdnsStateStore::load(std::vector<DdnsPersistedRecord>* records) {
+  records->clear();
+  KeyValueStore preferences;
+  if (!preferences.begin(kNamespace, true)) {
+    return false;
+  }
+  const size_t length = preferences.getBytesLength(kKey);
+  std::vector<uint8_t> blob(length);
+  const bool read = length >= sizeof(Header) &&
+                    preferences.getBytes(kKey, blob.data(), length) == length;
+  preferences.end();
+  if (!read) {
+    return false;
+  }
+
+  Header header;
+  memcpy(&header, blob.data(), sizeof(header));
+  if (header.version != kVersion || length != sizeof(Header) + header.count * sizeof(Entry)) {
+    return false;
+  }
+
+  records->reserve(header.count);
+  for (size_t i = 0; i < header.count; ++i) {
+    Entry entry;
+    memcpy(&entry, blob.data() + sizeof(Header) + i * sizeof(Entry), sizeof(entry));
+    entry.recordId[kRecordIdLength - 1] = '\0';
+
+    DdnsPersistedRecord record;
+    record.identity = entry.identity;
+    record.recordId = entry.recordId;
+    record.confirmedIp = entry.confirmedIp == 0 ? String("") : IPAddress(entry.confirmedIp).toString();
+    record.lastUpdateAt = entry.lastUpdateAt;
+    record.updateCount = entry.updateCount;
+    records->push_back(record);
+  }
+  return true;
+}
+
+bool DdnsStateStore::save(const std::vector<DdnsPersistedRecord>& records) {
+  const size_t count = records.size() > UINT8_MAX ? UINT8_MAX : records.size();
+  std::vector<uint8_t> blob(sizeof(Header) + count * sizeof(Entry), 0);
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.version = kVersion;
+  header.count = static_cast<uint8_t>(count);
+  memcpy(blob.data(), &header, sizeof(header));
+
+  for (size_t i = 0; i < count; ++i) {
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.identity = records[i].identity;
+    IPAddress address;
+    entry.confirmedIp =
+        address.fromString(records[i].confirmedIp) ? static_cast<uint32_t>(address) : 0;
+    entry.lastUpdateAt = records[i].lastUpdateAt;
+    entry.updateCount = records[i].updateCount;
+    strncpy(entry.recordId, records[i].recordId.c_str(), kRecordIdLength - 1);
+    memcpy(blob.data() + sizeof(Header) + i * sizeof(Entry), &entry, sizeof(entry));
+  }
+
+  KeyValueStore preferences;
+  if (!preferences.begin(kNamespace, false)) {
+    return false;
+  }
+  const bool written = preferences.putBytes(kKey, blob.data(), blob.size()) == blob.size();
+  preferences.end();
+  return written;
+}
+
+void DdnsStateStore::clear() {
+  KeyValueStore preferences;
+  if (!preferences.begin(kNamespace, false)) {
+    return;
+  }
+  preferences.remove(kKey);
+  preferences.end();
+}
@@ -0,0 +1,108 @@
+#include "DdnsSyncHistory.h"
+
+#include <algorithm>
+
+namespace {
+// Nearest-rank percentile; `values` is sorted in place.
+uint32_t percentile(std::vector<uint32_t>* values, uint32_t percent) {
+  if (values->empty()) {
+    return 0;
+  }
+  std::sort(values->begin(), values->end());
+  const size_t rank = (values->size() * percent + 99) / 100;
+  return (*values)[rank == 0 ? 0 : rank - 1];
+}
+
+DdnsLatency latencyOf(std::vector<uint32_t>* values) {
+  DdnsLatency latency;
+  latency.p50 = percentile(values, 50);
+  latency.p95 = percentile(values, 95);
+  return latency;
+}
+
+bool calledAliyun(DdnsSyncOutcome outcome) {
+  return outcome != DdnsSyncOutcome::Unchanged && outcome != DdnsSyncOutcome::ResolveFailed;
+}
+}  // namespace
+
+void DdnsSyncHistory::record(const DdnsSyncAttempt& attempt) {
+  if (_entries.size() < kCapacity) {
+    if (_entries.empty()) {
+      _entries.reserve(kCapacity);
+    }
+    _entries.push_back(attempt);
+    return;
+  }
+  _entries[_next] = attempt;
+  _next = (_next + 1) % kCapacity;
+}
+
+std::vector<DdnsSyncAttempt> DdnsSyncHistory::attempts() const {
+  std::vector<DdnsSyncAttempt> ordered;
+  ordered.reserve(_entries.size());
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    ordered.push_back(_entries[(_next + i) % _entries.size()]);
+  }
+  return ordered;
+}
+
+void DdnsSyncHistory::clear() {
+  _entries.clear();
+  _entries.shrink_to_fit();
+  _next = 0;
+}
+
+DdnsSyncSummary DdnsSyncHistory::summarize(const std::vector<DdnsSyncAttempt>& attempts) {
+  DdnsSyncSummary summary;
+  std::vector<uint32_t> resolveMs;
+  std::vector<uint32_t> apiMs;
+  std::vector<uint32_t> totalMs;
+  std::vector<uint32_t> changeToUpdateMs;
+  resolveMs.reserve(attempts.size());
+  totalMs.reserve(attempts.size());
+  for (size_t i = 0; i < attempts.size(); ++i) {
+    const DdnsSyncAttempt& attempt = attempts[i];
+    summary.attempts += 1;
+    if (isFailure(attempt.outcome)) {
+      summary.failures += 1;
+    }
+    resolveMs.push_back(attempt.resolveMs);
+    totalMs.push_back(attempt.totalMs);
+    if (calledAliyun(attempt.outcome)) {
+      apiMs.push_back(attempt.apiMs);
+    }
+    if (attempt.outcome == DdnsSyncOutcome::Updated && attempt.changeToUpdateMs != 0) {
+      changeToUpdateMs.push_back(attempt.changeToUpdateMs);
+    }
+  }
+  summary.resolveMs = latencyOf(&resolveMs);
+  summary.apiMs = latencyOf(&apiMs);
+  summary.totalMs = latencyOf(&totalMs);
+  summary.changeToUpdateMs = latencyOf(&changeToUpdateMs);
+  return summary;
+}
+
+bool DdnsSyncHistory::isFailure(DdnsSyncOutcome outcome) {
+  return outcome != DdnsSyncOutcome::Updated && outcome != DdnsSyncOutcome::UpToDate &&
+         outcome != DdnsSyncOutcome::Unchanged;
+}
+
+const char* DdnsSyncHistory::outcomeName(DdnsSyncOutcome outcome) {
+  switch (outcome) {
+    case DdnsSyncOutcome::Updated:
+      return "UPDATED";
+    case DdnsSyncOutcome::UpToDate:
+      return "UP_TO_DATE";
+    case DdnsSyncOutcome::Unchanged:
+      return "UNCHANGED";
+    case DdnsSyncOutcome::ListFailed:
+      return "LIST_FAILED";
+    case DdnsSyncOutcome::NotFound:
+      return "NOT_FOUND";
+    case DdnsSyncOutcome::UpdateFailed:
+      return "UPDATE_FAILED";
+    case DdnsSyncOutcome::ResolveFailed:
+    default:
+      return "RESOLVE_FAILED";
+  }
+}
@@ -0,0 +1,265 @@
+#include "DnsCache.h"
+
+#include "Hal.h"
+#include "NetworkAccounting.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <cstring>
+
+namespace {
+constexpr uint32_t kLookupTaskStackSize = 4096;
+constexpr UBaseType_t kLookupTaskPriority = 1;
+constexpr UBaseType_t kLookupQueueLength = 8;
+
+SemaphoreHandle_t cacheMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+class CacheLock {
+ public:
+  CacheLock() { xSemaphoreTake(cacheMutex(), portMAX_DELAY); }
+  ~CacheLock() { xSemaphoreGive(cacheMutex()); }
+};
+
+DnsCacheStats gStats;
+QueueHandle_t gLookupQueue = nullptr;
+}  // namespace
+
+DnsCache::Entry* DnsCache::entries() {
+  static Entry instance[kMaxEntries];
+  return instance;
+}
+
+bool DnsCache::resolve(const String& host, IPAddress* address, uint32_t timeoutMs) {
+  if (address == nullptr || host.isEmpty() || host.length() >= kMaxHostLength) {
+    return false;
+  }
+
+  IPAddress literal;
+  if (literal.fromString(host)) {
+    *address = literal;
+    return true;
+  }
+
+  uint32_t generation = 0;
+  bool hasStale = false;
+  {
+    CacheLock lock;
+    const uint32_t now = millis();
+    Entry* entry = findOrCreate(host, now);
+    if (entry == nullptr) {
+      return false;
+    }
+    if (entry->valid && now - entry->resolvedAtMs < kTtlMs) {
+      gStats.hits += 1;
+      *address = entry->address;
+      return true;
+    }
+
+    gStats.misses += 1;
+    hasStale = entry->valid;
+    generation = entry->generation;
+    if (!entry->lookupPending && !queueLookup(entry)) {
+      if (hasStale) {
+        gStats.staleFallbacks += 1;
+        *address = entry->address;
+        return true;
+      }
+      return false;
+    }
+  }
+
+  const uint32_t waitMs = hasStale && timeoutMs > kStaleWaitMs ? kStaleWaitMs : timeoutMs;
+  const uint32_t startMs = millis();
+  while (true) {
+    {
+      CacheLock lock;
+      Entry* entry = findOrCreate(host, millis());
+      if (entry == nullptr) {
+        return false;
+      }
+      const bool answered = entry->generation != generation && !entry->lookupPending;
+      if (answered && entry->valid && millis() - entry->resolvedAtMs < kTtlMs) {
+        *address = entry->address;
+        return true;
+      }
+      if (answered || millis() - startMs >= waitMs) {
+        if (entry->valid) {
+          gStats.staleFallbacks += 1;
+          *address = entry->address;
+          return true;
+        }
+        return false;
+      }
+    }
+    delay(kWaitPollMs);
+  }
+}
+
+void DnsCache::prefetch(const String& host) {
+  if (host.isEmpty() || host.length() >= kMaxHostLength) {
+    return;
+  }
+  IPAddress literal;
+  if (literal.fromString(host)) {
+    return;
+  }
+
+  CacheLock lock;
+  const uint32_t now = millis();
+  Entry* entry = findOrCreate(host, now);
+  if (entry == nullptr || entry->lookupPending) {
+    return;
+  }
+  if (entry->valid && now - entry->resolvedAtMs + kPrefetchWindowMs < kTtlMs) {
+    return;
+  }
+  if (queueLookup(entry)) {
+    gStats.prefetches += 1;
+  }
+}
+
+void DnsCache::prefetchUrl(const String& url) {
+  prefetch(hostOfUrl(url));
+}
+
+String DnsCache::hostOfUrl(const String& url) {
+  const int schemeEnd = url.indexOf("://");
+  const int hostStart = schemeEnd == -1 ? 0 : schemeEnd + 3;
+  int hostEnd = hostStart;
+  while (hostEnd < static_cast<int>(url.length())) {
+    const char c = url.charAt(hostEnd);
+    if (c == '/' || c == ':' || c == '?') {
+      break;
+    }
+    ++hostEnd;
+  }
+  return url.substring(hostStart, hostEnd);
+}
+
+DnsCacheStats DnsCache::getStats() {
+  CacheLock lock;
+  DnsCacheStats stats = gStats;
+  stats.entries = 0;
+  const Entry* cache = entries();
+  for (size_t index = 0; index < kMaxEntries; ++index) {
+    if (cache[index].valid) {
+      stats.entries += 1;
+    }
+  }
+  return stats;
+}
+
+void DnsCache::clear() {
+  CacheLock lock;
+  Entry* cache = entries();
+  for (size_t index = 0; index < kMaxEntries; ++index) {
+    // Pending lookups keep their slot so the worker can still complete them.
+    if (!cache[index].lookupPending) {
+      cache[index] = Entry();
+    }
+  }
+  gStats = DnsCacheStats();
+}
+
+DnsCache::Entry* DnsCache::findOrCreate(const String& host, uint32_t now) {
+  Entry* cache = entries();
+  Entry* victim = nullptr;
+  for (size_t index = 0; index < kMaxEntries; ++index) {
+    Entry& entry = cache[index];
+    if (entry.host.equalsIgnoreCase(host)) {
+      entry.lastUsedAtMs = now;
+      return &entry;
+    }
+    if (entry.lookupPending) {
+      continue;
+    }
+    if (victim == nullptr || entry.host.isEmpty() ||
+        (!victim->host.isEmpty() &&
+         static_cast<int32_t>(entry.lastUsedAtMs - victim->lastUsedAtMs) < 0)) {
+      victim = &entry;
+    }
+  }
+
+  if (victim == nullptr) {
+    return nullptr;
+  }
+  *victim = Entry();
+  victim->host = host;
+  victim->lastUsedAtMs = now;
+  return victim;
+}
+
+bool DnsCache::queueLookup(Entry* entry) {
+  if (gLookupQueue == nullptr) {
+    QueueHandle_t queue = xQueueCreate(kLookupQueueLength, kMaxHostLength);
+    if (queue == nullptr) {
+      return false;
+    }
+    if (xTaskCreate(lookupTask, "dns_cache", kLookupTaskStackSize, queue,
+                    kLookupTaskPriority, nullptr) != pdPASS) {
+      vQueueDelete(queue);
+      return false;
+    }
+    gLookupQueue = queue;
+  }
+
+  char host[kMaxHostLength];
+  memset(host, 0, sizeof(host));
+  strncpy(host, entry->host.c_str(), sizeof(host) - 1);
+  if (xQueueSend(gLookupQueue, host, 0) != pdTRUE) {
+    return false;
+  }
+  // Charged to the subsystem that asked for the name, not to the worker task.
+  NetworkAccounting::addDnsLookup();
+  entry->lookupPending = true;
+  return true;
+}
+
+void DnsCache::lookupTask(void* context) {
+  QueueHandle_t queue = static_cast<QueueHandle_t>(context);
+  char host[kMaxHostLength];
+  while (true) {
+    if (xQueueReceive(queue, host, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    IPAddress address;
+    const uint32_t startMs = millis();
+    const bool resolved =
+        Hal::wifi().hostByName(host, &address) && address != IPAddress(0, 0, 0, 0);
+    const uint32_t elapsedMs = millis() - startMs;
+
+    CacheLock lock;
+    gStats.lookups += 1;
+    gStats.lastLookupMs = elapsedMs;
+    gStats.totalLookupMs += elapsedMs;
+    if (elapsedMs > gStats.maxLookupMs) {
+      gStats.maxLookupMs = elapsedMs;
+    }
+    if (!resolved) {
+      gStats.lookupFailures += 1;
+    }
+
+    Entry* cache = entries();
+    for (size_t index = 0; index < kMaxEntries; ++index) {
+      Entry& entry = cache[index];
+      if (!entry.host.equalsIgnoreCase(host)) {
+        continue;
+      }
+      entry.lookupPending = false;
+      entry.generation += 1;
+      if (resolved) {
+        entry.address = address;
+        entry.valid = true;
+        entry.resolvedAtMs = millis();
+      }
+      break;
+    }
+  }
+}
@@ -8,6 +8,10 @@
 #include <HTTPUpdate.h>
 #include <WiFiClient.h>
 
+#include "AsyncHttpClient.h"
+#include "NetworkAccounting.h"
+#include "SharedHttpClient.h"
+
 namespace {
 constexpr long kLookupSuccessCode = 5723007;
 constexpr long kLookupNoPackageCode = 5724009;
@@ -86,6 +90,11 @@ void FirmwareUpgradeService::tick(bool wifiConnected) {
     }
   }
 
+  if (_lookupFuture.valid()) {
+    pollPackageQuery();
+    return;
+  }
+
   if (!_pendingRequest || _busy) {
     return;
   }
@@ -129,21 +138,41 @@ void FirmwareUpgradeService::tick(bool wifiConnected) {
     return;
   }
 
-  FirmwarePackageInfo packageInfo;
-  bool packageReady = false;
-  String errorCode;
-  String detailMessage;
-
   if (action == RequestAction::Upgrade && _hasCachedPackage && _updateAvailable &&
       isVersionDifferentFromInstalled(_cachedPackageInfo)) {
-    packageInfo = _cachedPackageInfo;
-    packageReady = true;
-  } else {
-    setState("CHECKING", "Checking firmware metadata from Bemfa.");
-    packageReady = queryPackageFromBemfa(&packageInfo, &errorCode, &detailMessage);
-    _lastCheckAtMs = millis();
+    finishRequest(action, _cachedPackageInfo, true, "", "");
+    return;
   }
 
+  // The lookup runs on the AsyncHttpClient worker; tick() polls it from here on.
+  setState("CHECKING", "Checking firmware metadata from Bemfa.");
+  _activeAction = action;
+  startPackageQuery();
+}
+
+void FirmwareUpgradeService::pollPackageQuery() {
+  if (!_lookupFuture.ready()) {
+    return;
+  }
+
+  FirmwarePackageInfo packageInfo;
+  String errorCode;
+  String detailMessage;
+  const bool packageReady =
+      finishPackageQuery(_lookupFuture.response(), &packageInfo, &errorCode, &detailMessage);
+  _lookupFuture.reset();
+  _lastCheckAtMs = millis();
+
+  const RequestAction action = _activeAction;
+  _activeAction = RequestAction::None;
+  finishRequest(action, packageInfo, packageReady, errorCode, detailMessage);
+}
+
+void FirmwareUpgradeService::finishRequest(RequestAction action,
+                                           const FirmwarePackageInfo& packageInfo,
+                                           bool packageReady,
+                                           String errorCode,
+                                           String detailMessage) {
   if (!packageReady) {
     _busy = false;
     _lastFinishAtMs = millis();
@@ -681,35 +710,19 @@ bool FirmwareUpgradeService::parseLookupResponse(const String& body,
   return true;
 }
 
-bool FirmwareUpgradeService::queryPackageFromBemfa(FirmwarePackageInfo* packageInfo,
-                                                   String* errorCode,
-                                                   String* detailMessage) const {
-  if (!isConfigValid()) {
-    if (errorCode != nullptr) {
-      *errorCode = "ota_config_incomplete";
-    }
-    if (detailMessage != nullptr) {
-      *detailMessage = "OTA requires Bemfa UID and Topic.";
-    }
-    return false;
-  }
-
-  HTTPClient http;
-  http.setConnectTimeout(kHttpTimeoutMs);
-  http.setTimeout(kHttpTimeoutMs);
-
-  const String url = buildLookupUrl();
-  if (!http.begin(url)) {
-    if (errorCode != nullptr) {
-      *errorCode = "ota_lookup_http_failed";
-    }
-    if (detailMessage != nullptr) {
-      *detailMessage = "Failed to open Bemfa OTA endpoint.";
-    }
-    return false;
-  }
+void FirmwareUpgradeService::startPackageQuery() {
+  NetworkAccounting::Scope accountingScope(NetSubsystem::Ota);
+  SharedHttpRequest request;
+  request.url = buildLookupUrl();
+  request.timeoutMs = kHttpTimeoutMs;
+  _lookupFuture = AsyncHttpClient::submit(request);
+}
 
-  const int httpCode = http.GET();
+bool FirmwareUpgradeService::finishPackageQuery(const SharedHttpResponse& response,
+                                                FirmwarePackageInfo* packageInfo,
+                                                String* errorCode,
+                                                String* detailMessage) const {
+  const int httpCode = response.httpCode;
   if (httpCode <= 0) {
     if (errorCode != nullptr) {
       *errorCode = "ota_lookup_http_failed";
@@ -717,12 +730,10 @@ bool FirmwareUpgradeService::queryPackageFromBemfa(FirmwarePackageInfo* packageI
     if (detailMessage != nullptr) {
       *detailMessage = "Bemfa OTA request failed, code=" + String(httpCode) + ".";
     }
-    http.end();
     return false;
   }
 
-  const String body = http.getString();
-  http.end();
+  const String& body = response.body;
 
   if (httpCode != 200) {
     if (errorCode != nullptr) {
@@ -740,11 +751,19 @@ bool FirmwareUpgradeService::queryPackageFromBemfa(FirmwarePackageInfo* packageI
 bool FirmwareUpgradeService::executeUpgrade(const FirmwarePackageInfo& packageInfo,
                                             String* errorCode,
                                             String* detailMessage) {
+  NetworkAccounting::Scope accountingScope(NetSubsystem::Ota);
   WiFiClient client;
   httpUpdate.rebootOnUpdate(false);
   httpUpdate.onProgress([this](int current, int total) { onHttpUpdateProgress(current, total); });
 
+  const uint32_t downloadStartMs = millis();
   const t_httpUpdate_return result = httpUpdate.update(client, packageInfo.url);
+  NetworkAccounting::addBlockedMs(millis() - downloadStartMs);
+  NetworkAccounting::addConnection(packageInfo.url.startsWith("https://"));
+  NetworkAccounting::addTransfer(_progressBytes, packageInfo.url.length());
+  if (result == HTTP_UPDATE_FAILED) {
+    NetworkAccounting::addFailure();
+  }
 
   switch (result) {
     case HTTP_UPDATE_OK:
@@ -0,0 +1,412 @@
+#include "GatewayIpProbe.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "DnsCache.h"
+#include "Hal.h"
+#include "SharedHttpClient.h"
+#include "UdpPublicIpProbe.h"
+
+namespace {
+constexpr const char* kSsdpMulticastAddress = "239.255.255.250";
+constexpr const char* kIgdSearchTarget = "urn:schemas-upnp-org:device:InternetGatewayDevice:1";
+constexpr const char* const kWanServicePrefixes[] = {
+    "urn:schemas-upnp-org:service:WANIPConnection:",
+    "urn:schemas-upnp-org:service:WANPPPConnection:"};
+constexpr const char* kUserAgent = "ESP32-Gateway-IP/1.0";
+constexpr uint8_t kNatPmpOpExternalAddress = 0;
+constexpr uint8_t kNatPmpResponseFlag = 0x80;
+constexpr size_t kMaxSsdpResponseSize = 1024;
+
+// Guards the discovery state; held across a query so concurrent callers share one answer.
+SemaphoreHandle_t probeMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+class ProbeLock {
+ public:
+  ProbeLock() { xSemaphoreTake(probeMutex(), portMAX_DELAY); }
+  ~ProbeLock() { xSemaphoreGive(probeMutex()); }
+};
+
+String gGatewayHost = "";
+uint16_t gNatPmpPort = GatewayIpProbe::kNatPmpPort;
+uint16_t gSsdpPort = GatewayIpProbe::kSsdpPort;
+
+IPAddress gGateway;
+uint8_t gMethod = 0;
+uint32_t gUnavailableAtMs = 0;
+String gControlUrl = "";
+String gServiceType = "";
+String gCachedIp = "";
+bool gHaveCached = false;
+uint32_t gCachedAtMs = 0;
+GatewayIpStats gStats;
+
+uint32_t remainingMs(uint32_t startMs, uint32_t timeoutMs) {
+  const uint32_t elapsedMs = millis() - startMs;
+  return elapsedMs >= timeoutMs ? 0 : timeoutMs - elapsedMs;
+}
+
+String xmlElementText(const String& xml, const String& tag, int from, int* endOut) {
+  const String open = "<" + tag + ">";
+  const String close = "</" + tag + ">";
+  const int start = xml.indexOf(open, from);
+  if (start == -1) {
+    return "";
+  }
+  const int valueStart = start + open.length();
+  const int end = xml.indexOf(close, valueStart);
+  if (end == -1) {
+    return "";
+  }
+  if (endOut != nullptr) {
+    *endOut = end + close.length();
+  }
+  String value = xml.substring(valueStart, end);
+  value.trim();
+  return value;
+}
+
+// "http://host:port" of an absolute URL.
+String urlOrigin(const String& url) {
+  const int schemeEnd = url.indexOf("://");
+  if (schemeEnd == -1) {
+    return "";
+  }
+  const int pathStart = url.indexOf('/', schemeEnd + 3);
+  return pathStart == -1 ? url : url.substring(0, pathStart);
+}
+}  // namespace
+
+bool GatewayIpProbe::queryExternalIp(uint32_t timeoutMs, String* ipv4) {
+  if (ipv4 == nullptr || timeoutMs == 0) {
+    return false;
+  }
+
+  ProbeLock lock;
+  const uint32_t startMs = millis();
+  IPAddress gateway;
+  if (!gGatewayHost.isEmpty()) {
+    DnsCache::resolve(gGatewayHost, &gateway, timeoutMs);
+  } else {
+    gateway = Hal::wifi().gatewayIp();
+  }
+  if (static_cast<uint32_t>(gateway) == 0) {
+    gStats.failures += 1;
+    return false;
+  }
+
+  // A different gateway means a different network: start discovery over.
+  if (gateway != gGateway) {
+    gGateway = gateway;
+    gMethod = static_cast<uint8_t>(Method::Unknown);
+    gControlUrl = "";
+    gServiceType = "";
+    gHaveCached = false;
+  }
+
+  if (gHaveCached && millis() - gCachedAtMs < kCacheTtlMs) {
+    gStats.cacheHits += 1;
+    *ipv4 = gCachedIp;
+    return true;
+  }
+
+  Method method = static_cast<Method>(gMethod);
+  if (method == Method::Unavailable) {
+    if (millis() - gUnavailableAtMs < kUnavailableRetryMs) {
+      return false;
+    }
+    method = Method::Unknown;
+  }
+
+  IPAddress external;
+  Method answeredBy = Method::Unknown;
+  if (method == Method::Unknown || method == Method::NatPmp) {
+    uint32_t natPmpTimeoutMs = remainingMs(startMs, timeoutMs);
+    if (natPmpTimeoutMs > kNatPmpTimeoutMs) {
+      natPmpTimeoutMs = kNatPmpTimeoutMs;
+    }
+    if (natPmpTimeoutMs > 0 && queryNatPmp(gateway, natPmpTimeoutMs, &external)) {
+      answeredBy = Method::NatPmp;
+      gStats.natPmpAnswers += 1;
+    }
+  }
+  if (answeredBy == Method::Unknown && (method == Method::Unknown || method == Method::Upnp)) {
+    const uint32_t upnpTimeoutMs = remainingMs(startMs, timeoutMs);
+    if (upnpTimeoutMs > 0 && queryUpnp(gateway, upnpTimeoutMs, &external)) {
+      answeredBy = Method::Upnp;
+      gStats.upnpAnswers += 1;
+    }
+  }
+
+  if (answeredBy == Method::Unknown) {
+    gStats.failures += 1;
+    // A gateway that never answered is parked; one that used to answer is rediscovered.
+    gMethod = static_cast<uint8_t>(method == Method::Unknown ? Method::Unavailable
+                                                             : Method::Unknown);
+    gUnavailableAtMs = millis();
+    gControlUrl = "";
+    return false;
+  }
+
+  if (method == Method::Unknown) {
+    gStats.discoveries += 1;
+  }
+  if (!isPublicIpv4(external)) {
+    // Behind another NAT the router's WAN address is not what the internet sees.
+    gStats.privateWan += 1;
+    gMethod = static_cast<uint8_t>(Method::Unavailable);
+    gUnavailableAtMs = millis();
+    return false;
+  }
+
+  gMethod = static_cast<uint8_t>(answeredBy);
+  gCachedIp = external.toString();
+  gHaveCached = true;
+  gCachedAtMs = millis();
+  *ipv4 = gCachedIp;
+  return true;
+}
+
+void GatewayIpProbe::reset() {
+  ProbeLock lock;
+  gGateway = IPAddress();
+  gMethod = static_cast<uint8_t>(Method::Unknown);
+  gControlUrl = "";
+  gServiceType = "";
+  gHaveCached = false;
+}
+
+void GatewayIpProbe::setGateway(const String& host, uint16_t natPmpPort, uint16_t ssdpPort) {
+  {
+    ProbeLock lock;
+    gGatewayHost = host;
+    gNatPmpPort = natPmpPort;
+    gSsdpPort = ssdpPort;
+  }
+  reset();
+}
+
+GatewayIpStats GatewayIpProbe::getStats() {
+  ProbeLock lock;
+  GatewayIpStats stats = gStats;
+  stats.method = methodName(static_cast<Method>(gMethod));
+  stats.gateway = static_cast<uint32_t>(gGateway) == 0 ? String("") : gGateway.toString();
+  return stats;
+}
+
+bool GatewayIpProbe::isPublicIpv4(const IPAddress& address) {
+  const uint8_t a = address[0];
+  const uint8_t b = address[1];
+  if (a == 0 || a == 10 || a == 127 || a >= 224) {
+    return false;
+  }
+  if ((a == 169 && b == 254) || (a == 192 && b == 168) || (a == 172 && (b & 0xF0) == 16)) {
+    return false;
+  }
+  // 100.64.0.0/10 is carrier-grade NAT space.
+  return !(a == 100 && (b & 0xC0) == 64);
+}
+
+bool GatewayIpProbe::queryNatPmp(const IPAddress& gateway, uint32_t timeoutMs, IPAddress* external) {
+  const uint8_t request[2] = {0, kNatPmpOpExternalAddress};
+  return UdpPublicIpProbe::exchange(gateway.toString(), gNatPmpPort, request, sizeof(request),
+                                    timeoutMs, [external](const uint8_t* packet, size_t length) {
+                                      return parseNatPmpResponse(packet, length, external);
+                                    });
+}
+
+bool GatewayIpProbe::queryUpnp(const IPAddress& gateway, uint32_t timeoutMs, IPAddress* external) {
+  const uint32_t startMs = millis();
+  if (gControlUrl.isEmpty() && !discoverUpnpControl(gateway, timeoutMs)) {
+    return false;
+  }
+
+  const uint32_t requestTimeoutMs = remainingMs(startMs, timeoutMs);
+  if (requestTimeoutMs == 0) {
+    return false;
+  }
+
+  SharedHttpRequest request;
+  request.method = "POST";
+  request.url = gControlUrl;
+  request.timeoutMs = requestTimeoutMs;
+  request.userAgent = kUserAgent;
+  request.contentType = "text/xml; charset=\"utf-8\"";
+  request.headers.push_back({"SOAPAction", "\"" + gServiceType + "#GetExternalIPAddress\""});
+  request.body =
+      "<?xml version=\"1.0\"?>"
+      "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+      "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\"><s:Body>"
+      "<u:GetExternalIPAddress xmlns:u=\"" +
+      gServiceType + "\"></u:GetExternalIPAddress></s:Body></s:Envelope>";
+
+  SharedHttpResponse response;
+  if (!SharedHttpClient::perform(request, &response) || response.httpCode != 200 ||
+      !parseExternalIpResponse(response.body, external)) {
+    // The control URL may be stale (router reboot); look it up again next time.
+    gControlUrl = "";
+    return false;
+  }
+  return true;
+}
+
+bool GatewayIpProbe::discoverUpnpControl(const IPAddress& gateway, uint32_t timeoutMs) {
+  const uint32_t startMs = millis();
+  const bool multicast = gGatewayHost.isEmpty();
+  const String search = String("M-SEARCH * HTTP/1.1\r\n") + "HOST: " + kSsdpMulticastAddress +
+                        ":" + String(gSsdpPort) + "\r\n" +
+                        "MAN: \"ssdp:discover\"\r\n"
+                        "MX: 1\r\n"
+                        "ST: " + kIgdSearchTarget + "\r\n\r\n";
+
+  // Only the gateway's own description is of interest, not other UPnP routers on the LAN.
+  const String gatewayText = gateway.toString();
+  String location;
+  uint32_t ssdpTimeoutMs = timeoutMs < kSsdpTimeoutMs ? timeoutMs : kSsdpTimeoutMs;
+  const bool found = UdpPublicIpProbe::exchange(
+      multicast ? String(kSsdpMulticastAddress) : gatewayText, gSsdpPort,
+      reinterpret_cast<const uint8_t*>(search.c_str()), search.length(), ssdpTimeoutMs,
+      [&location, &gatewayText](const uint8_t* packet, size_t length) {
+        const String candidate = parseSsdpLocation(packet, length);
+        if (DnsCache::hostOfUrl(candidate) != gatewayText) {
+          return false;
+        }
+        location = candidate;
+        return true;
+      },
+      multicast);
+  if (!found) {
+    return false;
+  }
+
+  const uint32_t requestTimeoutMs = remainingMs(startMs, timeoutMs);
+  if (requestTimeoutMs == 0) {
+    return false;
+  }
+
+  SharedHttpRequest request;
+  request.url = location;
+  request.timeoutMs = requestTimeoutMs;
+  request.userAgent = kUserAgent;
+  SharedHttpResponse response;
+  if (!SharedHttpClient::perform(request, &response) || response.httpCode != 200) {
+    return false;
+  }
+  return parseUpnpDescription(location, response.body, &gControlUrl, &gServiceType);
+}
+
+bool GatewayIpProbe::parseNatPmpResponse(const uint8_t* packet,
+                                         size_t length,
+                                         IPAddress* external) {
+  if (packet == nullptr || external == nullptr || length < 12) {
+    return false;
+  }
+  const uint16_t resultCode = static_cast<uint16_t>((packet[2] << 8) | packet[3]);
+  if (packet[0] != 0 || packet[1] != (kNatPmpResponseFlag | kNatPmpOpExternalAddress) ||
+      resultCode != 0) {
+    return false;
+  }
+  *external = IPAddress(packet[8], packet[9], packet[10], packet[11]);
+  return true;
+}
+
+String GatewayIpProbe::parseSsdpLocation(const uint8_t* packet, size_t length) {
+  if (packet == nullptr || length == 0 || length >= kMaxSsdpResponseSize) {
+    return "";
+  }
+  char text[kMaxSsdpResponseSize];
+  memcpy(text, packet, length);
+  text[length] = '\0';
+  const String response(text);
+  if (!response.startsWith("HTTP/1.1 200")) {
+    return "";
+  }
+
+  int lineStart = 0;
+  while (lineStart < static_cast<int>(response.length())) {
+    int lineEnd = response.indexOf('\n', lineStart);
+    if (lineEnd == -1) {
+      lineEnd = response.length();
+    }
+    String line = response.substring(lineStart, lineEnd);
+    line.trim();
+    lineStart = lineEnd + 1;
+
+    const int colon = line.indexOf(':');
+    if (colon <= 0) {
+      continue;
+    }
+    String name = line.substring(0, colon);
+    name.trim();
+    if (name.equalsIgnoreCase("LOCATION")) {
+      String value = line.substring(colon + 1);
+      value.trim();
+      return value.startsWith("http://") ? value : String("");
+    }
+  }
+  return "";
+}
+
+bool GatewayIpProbe::parseUpnpDescription(const String& location,
+                                          const String& description,
+                                          String* controlUrl,
+                                          String* serviceType) {
+  if (controlUrl == nullptr || serviceType == nullptr) {
+    return false;
+  }
+
+  for (const char* prefix : kWanServicePrefixes) {
+    const int typeStart = description.indexOf(String("<serviceType>") + prefix);
+    if (typeStart == -1) {
+      continue;
+    }
+    int typeEnd = 0;
+    const String type = xmlElementText(description, "serviceType", typeStart, &typeEnd);
+    const int serviceEnd = description.indexOf("</service>", typeEnd);
+    int controlEnd = 0;
+    const String control = xmlElementText(description, "controlURL", typeEnd, &controlEnd);
+    if (type.isEmpty() || control.isEmpty() || (serviceEnd != -1 && controlEnd > serviceEnd)) {
+      continue;
+    }
+
+    if (control.startsWith("http://")) {
+      *controlUrl = control;
+    } else {
+      String base = xmlElementText(description, "URLBase", 0, nullptr);
+      base = urlOrigin(base.isEmpty() ? location : base);
+      if (base.isEmpty()) {
+        return false;
+      }
+      *controlUrl = base + (control.startsWith("/") ? "" : "/") + control;
+    }
+    *serviceType = type;
+    return true;
+  }
+  return false;
+}
+
+bool GatewayIpProbe::parseExternalIpResponse(const String& body, IPAddress* external) {
+  if (external == nullptr) {
+    return false;
+  }
+  const String value = xmlElementText(body, "NewExternalIPAddress", 0, nullptr);
+  return !value.isEmpty() && external->fromString(value);
+}
+
+const char* GatewayIpProbe::methodName(Method method) {
+  switch (method) {
+    case Method::NatPmp:
+      return "NAT_PMP";
+    case Method::Upnp:
+      return "UPNP";
+    case Method::Unavailable:
+      return "UNAVAILABLE";
+    case Method::Unknown:
+    default:
+      return "UNKNOWN";
+  }
+}
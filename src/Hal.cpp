@@ -0,0 +1,52 @@
+#include "Hal.h"
+
+namespace {
+HalClock* gClock = nullptr;
+HalWifiStatus* gWifi = nullptr;
+HalHttpClient* gHttp = nullptr;
+Hal::KeyValueStoreFactory gKeyValueStoreFactory = nullptr;
+Hal::UdpSocketFactory gUdpSocketFactory = nullptr;
+}  // namespace
+
+HalClock& Hal::clock() {
+  return gClock != nullptr ? *gClock : defaultClock();
+}
+
+HalWifiStatus& Hal::wifi() {
+  return gWifi != nullptr ? *gWifi : defaultWifiStatus();
+}
+
+HalHttpClient& Hal::http() {
+  return gHttp != nullptr ? *gHttp : defaultHttpClient();
+}
+
+std::unique_ptr<HalKeyValueStore> Hal::createKeyValueStore() {
+  return std::unique_ptr<HalKeyValueStore>(gKeyValueStoreFactory != nullptr
+                                               ? gKeyValueStoreFactory()
+                                               : createDefaultKeyValueStore());
+}
+
+std::unique_ptr<HalUdpSocket> Hal::createUdpSocket() {
+  return std::unique_ptr<HalUdpSocket>(gUdpSocketFactory != nullptr ? gUdpSocketFactory()
+                                                                    : createDefaultUdpSocket());
+}
+
+void Hal::setClock(HalClock* clock) {
+  gClock = clock;
+}
+
+void Hal::setWifiStatus(HalWifiStatus* wifi) {
+  gWifi = wifi;
+}
+
+void Hal::setHttpClient(HalHttpClient* http) {
+  gHttp = http;
+}
+
+void Hal::setKeyValueStoreFactory(KeyValueStoreFactory factory) {
+  gKeyValueStoreFactory = factory;
+}
+
+void Hal::setUdpSocketFactory(UdpSocketFactory factory) {
+  gUdpSocketFactory = factory;
+}
@@ -0,0 +1,168 @@
+#if defined(ARDUINO)
+
+#include "Hal.h"
+
+#include <Preferences.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <sys/time.h>
+
+#include "SharedHttpClient.h"
+
+namespace {
+constexpr int64_t kMicrosPerSecond = 1000000;
+
+timeval toTimeval(int64_t us) {
+  timeval tv;
+  tv.tv_sec = static_cast<time_t>(us / kMicrosPerSecond);
+  tv.tv_usec = static_cast<suseconds_t>(us % kMicrosPerSecond);
+  return tv;
+}
+
+class Esp32Clock : public HalClock {
+ public:
+  uint32_t millis() override { return ::millis(); }
+  void delay(uint32_t ms) override { ::delay(ms); }
+
+  int64_t unixTimeUs() override {
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * kMicrosPerSecond + tv.tv_usec;
+  }
+
+  bool setUnixTimeUs(int64_t unixUs) override {
+    const timeval tv = toTimeval(unixUs);
+    if (settimeofday(&tv, nullptr) != 0) {
+      return false;
+    }
+    // A slew still in progress was computed against the old time.
+    const timeval none = {0, 0};
+    adjtime(&none, nullptr);
+    return true;
+  }
+
+  bool slewUnixTimeUs(int64_t offsetUs) override {
+    // adjtime() replaces an unfinished adjustment, so carry its remainder over.
+    timeval pending = {0, 0};
+    if (adjtime(nullptr, &pending) != 0) {
+      return false;
+    }
+    const timeval delta = toTimeval(offsetUs + static_cast<int64_t>(pending.tv_sec) * kMicrosPerSecond +
+                                    pending.tv_usec);
+    return adjtime(&delta, nullptr) == 0;
+  }
+};
+
+class Esp32WifiStatus : public HalWifiStatus {
+ public:
+  bool isConnected() override { return WiFi.status() == WL_CONNECTED; }
+  IPAddress localIp() override { return WiFi.localIP(); }
+  IPAddress gatewayIp() override { return WiFi.gatewayIP(); }
+  bool hostByName(const char* host, IPAddress* address) override {
+    return address != nullptr && WiFi.hostByName(host, *address) == 1;
+  }
+};
+
+class Esp32KeyValueStore : public HalKeyValueStore {
+ public:
+  bool begin(const char* name, bool readOnly) override {
+    return _preferences.begin(name, readOnly);
+  }
+  void end() override { _preferences.end(); }
+  bool isKey(const char* key) override { return _preferences.isKey(key); }
+  bool remove(const char* key) override { return _preferences.remove(key); }
+  bool getBool(const char* key, bool defaultValue) override {
+    return _preferences.getBool(key, defaultValue);
+  }
+  size_t putBool(const char* key, bool value) override { return _preferences.putBool(key, value); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue) override {
+    return _preferences.getUChar(key, defaultValue);
+  }
+  size_t putUChar(const char* key, uint8_t value) override {
+    return _preferences.putUChar(key, value);
+  }
+  uint16_t getUShort(const char* key, uint16_t defaultValue) override {
+    return _preferences.getUShort(key, defaultValue);
+  }
+  size_t putUShort(const char* key, uint16_t value) override {
+    return _preferences.putUShort(key, value);
+  }
+  int32_t getInt(const char* key, int32_t defaultValue) override {
+    return _preferences.getInt(key, defaultValue);
+  }
+  size_t putInt(const char* key, int32_t value) override { return _preferences.putInt(key, value); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue) override {
+    return _preferences.getUInt(key, defaultValue);
+  }
+  size_t putUInt(const char* key, uint32_t value) override {
+    return _preferences.putUInt(key, value);
+  }
+  uint32_t getULong(const char* key, uint32_t defaultValue) override {
+    return _preferences.getULong(key, defaultValue);
+  }
+  size_t putULong(const char* key, uint32_t value) override {
+    return _preferences.putULong(key, value);
+  }
+  String getString(const char* key, const String& defaultValue) override {
+    return _preferences.getString(key, defaultValue);
+  }
+  size_t putString(const char* key, const String& value) override {
+    return _preferences.putString(key, value);
+  }
+  size_t getBytesLength(const char* key) override { return _preferences.getBytesLength(key); }
+  size_t getBytes(const char* key, void* buffer, size_t length) override {
+    return _preferences.getBytes(key, buffer, length);
+  }
+  size_t putBytes(const char* key, const void* value, size_t length) override {
+    return _preferences.putBytes(key, value, length);
+  }
+
+ private:
+  Preferences _preferences;
+};
+
+class Esp32UdpSocket : public HalUdpSocket {
+ public:
+  bool begin(uint16_t localPort) override { return _udp.begin(localPort) == 1; }
+  bool beginMulticast(const IPAddress& group, uint16_t port) override {
+    return _udp.beginMulticast(group, port) == 1;
+  }
+  void stop() override { _udp.stop(); }
+  bool beginPacket(const IPAddress& address, uint16_t port) override {
+    return _udp.beginPacket(address, port) == 1;
+  }
+  size_t write(const uint8_t* data, size_t length) override { return _udp.write(data, length); }
+  bool endPacket() override { return _udp.endPacket() == 1; }
+  int parsePacket() override { return _udp.parsePacket(); }
+  int read(uint8_t* buffer, size_t length) override { return _udp.read(buffer, length); }
+  IPAddress remoteIP() override { return _udp.remoteIP(); }
+  uint16_t remotePort() override { return _udp.remotePort(); }
+
+ private:
+  WiFiUDP _udp;
+};
+}  // namespace
+
+HalClock& Hal::defaultClock() {
+  static Esp32Clock instance;
+  return instance;
+}
+
+HalWifiStatus& Hal::defaultWifiStatus() {
+  static Esp32WifiStatus instance;
+  return instance;
+}
+
+HalHttpClient& Hal::defaultHttpClient() {
+  return SharedHttpClient::pooledTransport();
+}
+
+HalKeyValueStore* Hal::createDefaultKeyValueStore() {
+  return new Esp32KeyValueStore();
+}
+
+HalUdpSocket* Hal::createDefaultUdpSocket() {
+  return new Esp32UdpSocket();
+}
+
+#endif
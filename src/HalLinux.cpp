@@ -0,0 +1,743 @@
+#if !defined(ARDUINO)
+
+#include "Hal.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DnsCache.h"
+#include "SharedHttpClient.h"
+
+namespace {
+constexpr uint8_t kMaxRedirects = 5;
+constexpr size_t kMaxDatagramSize = 1500;
+// Key-value data is only written to disk when this variable names a file.
+constexpr const char* kStorePathEnv = "ESP32APP_NVS_PATH";
+
+class LinuxClock : public HalClock {
+ public:
+  uint32_t millis() override {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now() - _start)
+                                     .count());
+  }
+  void delay(uint32_t ms) override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+
+  // Steps and slews only move an offset held by this process; the host clock
+  // belongs to the workstation and is never touched. Slews apply at once.
+  int64_t unixTimeUs() override {
+    std::lock_guard<std::mutex> lock(_offsetMutex);
+    return hostUnixTimeUs() + _offsetUs;
+  }
+
+  bool setUnixTimeUs(int64_t unixUs) override {
+    std::lock_guard<std::mutex> lock(_offsetMutex);
+    _offsetUs = unixUs - hostUnixTimeUs();
+    return true;
+  }
+
+  bool slewUnixTimeUs(int64_t offsetUs) override {
+    std::lock_guard<std::mutex> lock(_offsetMutex);
+    _offsetUs += offsetUs;
+    return true;
+  }
+
+ private:
+  static int64_t hostUnixTimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  const std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+  std::mutex _offsetMutex;
+  int64_t _offsetUs = 0;
+};
+
+// The host is treated as an always-associated station on its first IPv4 interface.
+class LinuxWifiStatus : public HalWifiStatus {
+ public:
+  bool isConnected() override { return true; }
+
+  IPAddress localIp() override {
+    IPAddress address;
+    ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+      return address;
+    }
+    for (ifaddrs* entry = interfaces; entry != nullptr; entry = entry->ifa_next) {
+      if (entry->ifa_addr == nullptr || entry->ifa_addr->sa_family != AF_INET) {
+        continue;
+      }
+      const uint32_t raw = reinterpret_cast<sockaddr_in*>(entry->ifa_addr)->sin_addr.s_addr;
+      if ((ntohl(raw) >> 24) == 127) {
+        continue;
+      }
+      address = IPAddress(raw);
+      break;
+    }
+    freeifaddrs(interfaces);
+    return address;
+  }
+
+  // Default route from /proc/net/route (little-endian hex columns).
+  IPAddress gatewayIp() override {
+    IPAddress address;
+    FILE* routes = fopen("/proc/net/route", "r");
+    if (routes == nullptr) {
+      return address;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), routes) != nullptr) {
+      char interfaceName[32];
+      unsigned long destination = 0;
+      unsigned long gateway = 0;
+      if (sscanf(line, "%31s %lx %lx", interfaceName, &destination, &gateway) == 3 &&
+          destination == 0 && gateway != 0) {
+        address = IPAddress(static_cast<uint32_t>(gateway));
+        break;
+      }
+    }
+    fclose(routes);
+    return address;
+  }
+
+  bool hostByName(const char* host, IPAddress* address) override {
+    if (host == nullptr || address == nullptr) {
+      return false;
+    }
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr) {
+      return false;
+    }
+    *address = IPAddress(reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(result);
+    return true;
+  }
+};
+
+struct ParsedUrl {
+  bool secure = false;
+  String host;
+  uint16_t port = 80;
+  String path = "/";
+};
+
+bool parseUrl(const String& url, ParsedUrl* parsed) {
+  const int schemeEnd = url.indexOf("://");
+  if (schemeEnd <= 0) {
+    return false;
+  }
+  const String scheme = url.substring(0, schemeEnd);
+  parsed->secure = scheme == "https";
+  if (!parsed->secure && scheme != "http") {
+    return false;
+  }
+  parsed->port = parsed->secure ? 443 : 80;
+
+  const int authorityStart = schemeEnd + 3;
+  int pathStart = url.indexOf('/', authorityStart);
+  if (pathStart == -1) {
+    pathStart = url.length();
+  }
+  const String authority = url.substring(authorityStart, pathStart);
+  const int portSeparator = authority.indexOf(':');
+  parsed->host = portSeparator == -1 ? authority : authority.substring(0, portSeparator);
+  if (portSeparator != -1) {
+    parsed->port = static_cast<uint16_t>(authority.substring(portSeparator + 1).toInt());
+  }
+  parsed->path = pathStart < static_cast<int>(url.length()) ? url.substring(pathStart) : "/";
+  return !parsed->host.isEmpty() && parsed->port != 0;
+}
+
+// One request per connection over plain sockets. TLS is not linked into the host
+// build, so https:// URLs fail like an unreachable server; point services at local
+// stand-ins (tools/aliyun_dns_stub.py, ...) instead.
+class LinuxHttpClient : public HalHttpClient {
+ public:
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    response->httpCode = -1;
+    response->body = "";
+    response->dateHeader = "";
+    response->reusedConnection = false;
+
+    String url = request.url;
+    for (uint8_t hop = 0; hop <= kMaxRedirects; ++hop) {
+      String location;
+      if (!exchange(request, url, response, &location)) {
+        return false;
+      }
+      const bool redirect = response->httpCode >= 300 && response->httpCode < 400;
+      if (!request.followRedirects || !redirect || location.isEmpty()) {
+        return true;
+      }
+      url = location;
+    }
+    return true;
+  }
+
+ private:
+  static bool exchange(const SharedHttpRequest& request,
+                       const String& url,
+                       SharedHttpResponse* response,
+                       String* location) {
+    ParsedUrl target;
+    if (!parseUrl(url, &target) || target.secure) {
+      return false;
+    }
+    IPAddress address;
+    if (!DnsCache::resolve(target.host, &address, request.timeoutMs)) {
+      return false;
+    }
+
+    const int fd = connectTcp(address, target.port, request.timeoutMs);
+    if (fd < 0) {
+      return false;
+    }
+
+    String head = request.method + " " + target.path + " HTTP/1.1\r\n";
+    head += "Host: " + target.host;
+    if (target.port != 80) {
+      head += ":" + String(static_cast<unsigned int>(target.port));
+    }
+    head += "\r\nConnection: close\r\n";
+    if (!request.userAgent.isEmpty()) {
+      head += "User-Agent: " + request.userAgent + "\r\n";
+    }
+    if (!request.contentType.isEmpty()) {
+      head += "Content-Type: " + request.contentType + "\r\n";
+    }
+    for (const SharedHttpHeader& header : request.headers) {
+      head += header.name + ": " + header.value + "\r\n";
+    }
+    if (!request.body.isEmpty() || request.method != "GET") {
+      head += "Content-Length: " + String(request.body.length()) + "\r\n";
+    }
+    head += "\r\n";
+
+    const String payload = head + request.body;
+    std::string raw;
+    const bool exchanged = sendAll(fd, payload, request.timeoutMs) &&
+                           receiveAll(fd, request.timeoutMs, &raw);
+    close(fd);
+    return exchanged && parseResponse(raw, response, location);
+  }
+
+  static int connectTcp(const IPAddress& address, uint16_t port, uint32_t timeoutMs) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+      return -1;
+    }
+    sockaddr_in target = {};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(port);
+    target.sin_addr.s_addr = static_cast<uint32_t>(address);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&target), sizeof(target)) != 0) {
+      int error = 0;
+      socklen_t errorLength = sizeof(error);
+      pollfd descriptor = {fd, POLLOUT, 0};
+      if (errno != EINPROGRESS || poll(&descriptor, 1, static_cast<int>(timeoutMs)) != 1 ||
+          getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0 || error != 0) {
+        close(fd);
+        return -1;
+      }
+    }
+    return fd;
+  }
+
+  static bool sendAll(int fd, const String& payload, uint32_t timeoutMs) {
+    size_t sent = 0;
+    while (sent < payload.length()) {
+      pollfd descriptor = {fd, POLLOUT, 0};
+      if (poll(&descriptor, 1, static_cast<int>(timeoutMs)) != 1) {
+        return false;
+      }
+      const ssize_t written =
+          send(fd, payload.c_str() + sent, payload.length() - sent, MSG_NOSIGNAL);
+      if (written <= 0) {
+        return false;
+      }
+      sent += static_cast<size_t>(written);
+    }
+    return true;
+  }
+
+  static bool receiveAll(int fd, uint32_t timeoutMs, std::string* raw) {
+    char buffer[2048];
+    while (true) {
+      pollfd descriptor = {fd, POLLIN, 0};
+      if (poll(&descriptor, 1, static_cast<int>(timeoutMs)) != 1) {
+        return false;
+      }
+      const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+      if (received < 0) {
+        return false;
+      }
+      if (received == 0) {
+        return !raw->empty();
+      }
+      raw->append(buffer, static_cast<size_t>(received));
+    }
+  }
+
+  static bool parseResponse(const std::string& raw, SharedHttpResponse* response, String* location) {
+    const size_t headEnd = raw.find("\r\n\r\n");
+    if (headEnd == std::string::npos || raw.compare(0, 5, "HTTP/") != 0) {
+      return false;
+    }
+    const size_t statusStart = raw.find(' ');
+    if (statusStart == std::string::npos || statusStart > headEnd) {
+      return false;
+    }
+    response->httpCode = atoi(raw.c_str() + statusStart + 1);
+
+    bool chunked = false;
+    size_t lineStart = raw.find("\r\n") + 2;
+    while (lineStart < headEnd) {
+      const size_t lineEnd = raw.find("\r\n", lineStart);
+      const std::string line = raw.substr(lineStart, lineEnd - lineStart);
+      lineStart = lineEnd + 2;
+      const size_t colon = line.find(':');
+      if (colon == std::string::npos) {
+        continue;
+      }
+      const String name(line.substr(0, colon).c_str());
+      String value(line.substr(colon + 1).c_str());
+      value.trim();
+      if (name.equalsIgnoreCase("Date")) {
+        response->dateHeader = value;
+      } else if (name.equalsIgnoreCase("Location")) {
+        *location = value;
+      } else if (name.equalsIgnoreCase("Transfer-Encoding") && value.equalsIgnoreCase("chunked")) {
+        chunked = true;
+      }
+    }
+
+    const std::string body = raw.substr(headEnd + 4);
+    if (!chunked) {
+      response->body = String(body.c_str());
+      return response->httpCode > 0;
+    }
+
+    std::string decoded;
+    size_t cursor = 0;
+    while (cursor < body.size()) {
+      const size_t sizeEnd = body.find("\r\n", cursor);
+      if (sizeEnd == std::string::npos) {
+        break;
+      }
+      const size_t chunkSize = strtoul(body.c_str() + cursor, nullptr, 16);
+      if (chunkSize == 0 || sizeEnd + 2 + chunkSize > body.size()) {
+        break;
+      }
+      decoded.append(body, sizeEnd + 2, chunkSize);
+      cursor = sizeEnd + 2 + chunkSize + 2;
+    }
+    response->body = String(decoded.c_str());
+    return response->httpCode > 0;
+  }
+};
+
+// Mirrors NVS semantics: values are typed, and reading with another type misses.
+class LinuxKeyValueStore : public HalKeyValueStore {
+ public:
+  bool begin(const char* name, bool readOnly) override {
+    if (name == nullptr || name[0] == '\0') {
+      return false;
+    }
+    _namespace = name;
+    _readOnly = readOnly;
+    _open = true;
+    return true;
+  }
+  void end() override { _open = false; }
+
+  bool isKey(const char* key) override {
+    std::lock_guard<std::mutex> lock(storeMutex());
+    return find(key) != nullptr;
+  }
+
+  bool remove(const char* key) override {
+    if (!writable()) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(storeMutex());
+    const bool erased = store()[_namespace].erase(key) > 0;
+    if (erased) {
+      save();
+    }
+    return erased;
+  }
+
+  bool getBool(const char* key, bool defaultValue) override {
+    return getInteger(key, Type::U8, defaultValue ? 1 : 0) != 0;
+  }
+  size_t putBool(const char* key, bool value) override {
+    return putInteger(key, Type::U8, value ? 1 : 0, 1);
+  }
+  uint8_t getUChar(const char* key, uint8_t defaultValue) override {
+    return static_cast<uint8_t>(getInteger(key, Type::U8, defaultValue));
+  }
+  size_t putUChar(const char* key, uint8_t value) override {
+    return putInteger(key, Type::U8, value, 1);
+  }
+  uint16_t getUShort(const char* key, uint16_t defaultValue) override {
+    return static_cast<uint16_t>(getInteger(key, Type::U16, defaultValue));
+  }
+  size_t putUShort(const char* key, uint16_t value) override {
+    return putInteger(key, Type::U16, value, 2);
+  }
+  int32_t getInt(const char* key, int32_t defaultValue) override {
+    return static_cast<int32_t>(getInteger(key, Type::I32, static_cast<uint32_t>(defaultValue)));
+  }
+  size_t putInt(const char* key, int32_t value) override {
+    return putInteger(key, Type::I32, static_cast<uint32_t>(value), 4);
+  }
+  uint32_t getUInt(const char* key, uint32_t defaultValue) override {
+    return getInteger(key, Type::U32, defaultValue);
+  }
+  size_t putUInt(const char* key, uint32_t value) override {
+    return putInteger(key, Type::U32, value, 4);
+  }
+  // ESP32 Preferences stores ULong as a 32-bit NVS entry too.
+  uint32_t getULong(const char* key, uint32_t defaultValue) override {
+    return getInteger(key, Type::U32, defaultValue);
+  }
+  size_t putULong(const char* key, uint32_t value) override {
+    return putInteger(key, Type::U32, value, 4);
+  }
+
+  String getString(const char* key, const String& defaultValue) override {
+    std::lock_guard<std::mutex> lock(storeMutex());
+    const Entry* entry = find(key);
+    if (entry == nullptr || entry->type != Type::Str) {
+      return defaultValue;
+    }
+    return String(std::string(entry->bytes.begin(), entry->bytes.end()).c_str());
+  }
+  size_t putString(const char* key, const String& value) override {
+    return put(key, Type::Str, value.c_str(), value.length()) ? value.length() : 0;
+  }
+
+  size_t getBytesLength(const char* key) override {
+    std::lock_guard<std::mutex> lock(storeMutex());
+    const Entry* entry = find(key);
+    return entry != nullptr && entry->type == Type::Blob ? entry->bytes.size() : 0;
+  }
+  size_t getBytes(const char* key, void* buffer, size_t length) override {
+    std::lock_guard<std::mutex> lock(storeMutex());
+    const Entry* entry = find(key);
+    if (entry == nullptr || entry->type != Type::Blob || buffer == nullptr ||
+        length < entry->bytes.size()) {
+      return 0;
+    }
+    memcpy(buffer, entry->bytes.data(), entry->bytes.size());
+    return entry->bytes.size();
+  }
+  size_t putBytes(const char* key, const void* value, size_t length) override {
+    return put(key, Type::Blob, value, length) ? length : 0;
+  }
+
+ private:
+  enum class Type : uint8_t { U8, U16, I32, U32, Str, Blob };
+
+  struct Entry {
+    Type type = Type::Blob;
+    std::vector<uint8_t> bytes;
+  };
+
+  using Namespace = std::map<std::string, Entry>;
+
+  static std::mutex& storeMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::map<std::string, Namespace>& store() {
+    static std::map<std::string, Namespace> instance;
+    static bool loaded = false;
+    if (!loaded) {
+      loaded = true;
+      load(&instance);
+    }
+    return instance;
+  }
+
+  static void load(std::map<std::string, Namespace>* target) {
+    const char* path = getenv(kStorePathEnv);
+    FILE* file = path != nullptr && path[0] != '\0' ? fopen(path, "r") : nullptr;
+    if (file == nullptr) {
+      return;
+    }
+    char ns[32];
+    char key[32];
+    unsigned type = 0;
+    char hex[8192];
+    while (fscanf(file, "%31s %31s %u %8191s", ns, key, &type, hex) == 4) {
+      Entry entry;
+      entry.type = static_cast<Type>(type);
+      for (size_t index = 0; hex[index] != '\0' && hex[index + 1] != '\0'; index += 2) {
+        const char pair[3] = {hex[index], hex[index + 1], '\0'};
+        entry.bytes.push_back(static_cast<uint8_t>(strtoul(pair, nullptr, 16)));
+      }
+      (*target)[ns][key] = entry;
+    }
+    fclose(file);
+  }
+
+  static void save() {
+    const char* path = getenv(kStorePathEnv);
+    if (path == nullptr || path[0] == '\0') {
+      return;
+    }
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+      return;
+    }
+    for (const auto& ns : store()) {
+      for (const auto& item : ns.second) {
+        // Empty values are written as "-" so the line keeps four fields.
+        fprintf(file, "%s %s %u ", ns.first.c_str(), item.first.c_str(),
+                static_cast<unsigned>(item.second.type));
+        if (item.second.bytes.empty()) {
+          fputc('-', file);
+        }
+        for (uint8_t byte : item.second.bytes) {
+          fprintf(file, "%02x", byte);
+        }
+        fputc('\n', file);
+      }
+    }
+    fclose(file);
+  }
+
+  bool writable() const { return _open && !_readOnly; }
+
+  const Entry* find(const char* key) {
+    if (!_open || key == nullptr) {
+      return nullptr;
+    }
+    Namespace& ns = store()[_namespace];
+    const auto found = ns.find(key);
+    return found == ns.end() ? nullptr : &found->second;
+  }
+
+  uint32_t getInteger(const char* key, Type type, uint32_t defaultValue) {
+    std::lock_guard<std::mutex> lock(storeMutex());
+    const Entry* entry = find(key);
+    if (entry == nullptr || entry->type != type) {
+      return defaultValue;
+    }
+    uint32_t value = 0;
+    memcpy(&value, entry->bytes.data(), entry->bytes.size() < 4 ? entry->bytes.size() : 4);
+    return value;
+  }
+
+  size_t putInteger(const char* key, Type type, uint32_t value, size_t width) {
+    return put(key, type, &value, width) ? width : 0;
+  }
+
+  bool put(const char* key, Type type, const void* value, size_t length) {
+    // NVS keys are limited to 15 characters; keep the host build just as strict.
+    if (!writable() || key == nullptr || strlen(key) > 15) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(storeMutex());
+    Entry& entry = store()[_namespace][key];
+    entry.type = type;
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    entry.bytes.assign(bytes, bytes + length);
+    save();
+    return true;
+  }
+
+  std::string _namespace;
+  bool _readOnly = true;
+  bool _open = false;
+};
+
+class LinuxUdpSocket : public HalUdpSocket {
+ public:
+  ~LinuxUdpSocket() override { stop(); }
+
+  bool begin(uint16_t localPort) override {
+    stop();
+    if (!ensureSocket()) {
+      return false;
+    }
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(localPort);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    const int reuse = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(_fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+      stop();
+      return false;
+    }
+    return true;
+  }
+
+  bool beginMulticast(const IPAddress& group, uint16_t port) override {
+    if (!begin(port)) {
+      return false;
+    }
+    ip_mreq membership = {};
+    membership.imr_multiaddr.s_addr = static_cast<uint32_t>(group);
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+      stop();
+      return false;
+    }
+    // Several host instances on one machine hear each other.
+    const unsigned char loop = 1;
+    setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    return true;
+  }
+
+  void stop() override {
+    if (_fd >= 0) {
+      close(_fd);
+      _fd = -1;
+    }
+    _outgoing.clear();
+    _incoming.clear();
+    _readOffset = 0;
+  }
+
+  bool beginPacket(const IPAddress& address, uint16_t port) override {
+    if (!ensureSocket()) {
+      return false;
+    }
+    _target = {};
+    _target.sin_family = AF_INET;
+    _target.sin_port = htons(port);
+    _target.sin_addr.s_addr = static_cast<uint32_t>(address);
+    _outgoing.clear();
+    return true;
+  }
+
+  size_t write(const uint8_t* data, size_t length) override {
+    if (data == nullptr) {
+      return 0;
+    }
+    _outgoing.insert(_outgoing.end(), data, data + length);
+    return length;
+  }
+
+  bool endPacket() override {
+    if (_fd < 0) {
+      return false;
+    }
+    const ssize_t sent = sendto(_fd, _outgoing.data(), _outgoing.size(), 0,
+                                reinterpret_cast<sockaddr*>(&_target), sizeof(_target));
+    _outgoing.clear();
+    return sent >= 0;
+  }
+
+  int parsePacket() override {
+    if (_fd < 0) {
+      return 0;
+    }
+    _incoming.resize(kMaxDatagramSize);
+    _readOffset = 0;
+    socklen_t sourceLength = sizeof(_source);
+    const ssize_t received = recvfrom(_fd, _incoming.data(), _incoming.size(), MSG_DONTWAIT,
+                                      reinterpret_cast<sockaddr*>(&_source), &sourceLength);
+    if (received <= 0) {
+      _incoming.clear();
+      return 0;
+    }
+    _incoming.resize(static_cast<size_t>(received));
+    return static_cast<int>(received);
+  }
+
+  int read(uint8_t* buffer, size_t length) override {
+    if (buffer == nullptr || _readOffset >= _incoming.size()) {
+      return 0;
+    }
+    const size_t count =
+        length < _incoming.size() - _readOffset ? length : _incoming.size() - _readOffset;
+    memcpy(buffer, _incoming.data() + _readOffset, count);
+    _readOffset += count;
+    return static_cast<int>(count);
+  }
+
+  IPAddress remoteIP() override { return IPAddress(_source.sin_addr.s_addr); }
+  uint16_t remotePort() override { return ntohs(_source.sin_port); }
+
+ private:
+  bool ensureSocket() {
+    if (_fd >= 0) {
+      return true;
+    }
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) {
+      return false;
+    }
+    const int broadcast = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+    return true;
+  }
+
+  int _fd = -1;
+  sockaddr_in _target = {};
+  sockaddr_in _source = {};
+  std::vector<uint8_t> _outgoing;
+  std::vector<uint8_t> _incoming;
+  size_t _readOffset = 0;
+};
+}  // namespace
+
+unsigned long millis() {
+  return Hal::clock().millis();
+}
+
+void delay(uint32_t ms) {
+  Hal::clock().delay(ms);
+}
+
+HalClock& Hal::defaultClock() {
+  static LinuxClock instance;
+  return instance;
+}
+
+HalWifiStatus& Hal::defaultWifiStatus() {
+  static LinuxWifiStatus instance;
+  return instance;
+}
+
+HalHttpClient& Hal::defaultHttpClient() {
+  static LinuxHttpClient instance;
+  return instance;
+}
+
+HalKeyValueStore* Hal::createDefaultKeyValueStore() {
+  return new LinuxKeyValueStore();
+}
+
+HalUdpSocket* Hal::createDefaultUdpSocket() {
+  return new LinuxUdpSocket();
+}
+
+#endif
@@ -3,6 +3,8 @@
 #include <ESP32Ping.h>
 #include <WiFi.h>
 
+#include "NetworkAccounting.h"
+
 bool HostProbeService::isHostReachable(const String& hostIp, uint16_t port, uint32_t timeoutMs) const {
   if (port == 0) {
     return false;
@@ -13,13 +15,20 @@ bool HostProbeService::isHostReachable(const String& hostIp, uint16_t port, uint
     return false;
   }
 
+  NetworkAccounting::Scope accountingScope(NetSubsystem::HostProbe);
+  const uint32_t probeStartMs = millis();
   const bool pingReachable = Ping.ping(ip, 1);
 
   WiFiClient client;
   const bool tcpReachable = client.connect(ip, port, timeoutMs);
   if (tcpReachable) {
+    NetworkAccounting::addConnection(false);
     client.stop();
   }
-  
+  NetworkAccounting::addBlockedMs(millis() - probeStartMs);
+  if (!pingReachable && !tcpReachable) {
+    NetworkAccounting::addFailure();
+  }
+
   return pingReachable || tcpReachable;
 }
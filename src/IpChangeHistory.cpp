@@ -0,0 +1,176 @@
+#include "IpChangeHistory.h"
+
+#include <cstring>
+
+#include "Hal.h"
+
+namespace {
+uint32_t circularDistance(uint32_t a, uint32_t b, uint32_t period) {
+  const uint32_t forward = a >= b ? a - b : b - a;
+  return forward <= period / 2 ? forward : period - forward;
+}
+}  // namespace
+
+void IpChangeHistory::load() {
+  clear();
+  KeyValueStore preferences;
+  if (!preferences.begin(kNamespace, true)) {
+    return;
+  }
+  Stored stored;
+  const bool complete = preferences.getBytesLength(kKey) == sizeof(stored) &&
+                        preferences.getBytes(kKey, &stored, sizeof(stored)) == sizeof(stored);
+  preferences.end();
+  if (!complete || stored.version != kVersion || stored.count > kMaxChanges) {
+    return;
+  }
+
+  _startedAt = stored.startedAt;
+  _lastIp = stored.lastIp;
+  _count = stored.count;
+  memcpy(_changes, stored.changes, sizeof(_changes));
+}
+
+bool IpChangeHistory::observe(const String& ipv4, uint32_t unixTime) {
+  IPAddress address;
+  if (!address.fromString(ipv4)) {
+    return false;
+  }
+  const uint32_t ip = static_cast<uint32_t>(address);
+  const bool clockValid = unixTime >= kMinValidUnixTime;
+  if (_lastIp == 0) {
+    _lastIp = ip;
+    _startedAt = clockValid ? unixTime : 0;
+    save();
+    return false;
+  }
+  if (ip == _lastIp) {
+    if (_startedAt == 0 && clockValid) {
+      _startedAt = unixTime;
+      save();
+    }
+    return false;
+  }
+
+  _lastIp = ip;
+  if (clockValid) {
+    if (_count == kMaxChanges) {
+      memmove(_changes, _changes + 1, sizeof(_changes[0]) * (kMaxChanges - 1));
+      _count -= 1;
+    }
+    _changes[_count++] = unixTime;
+  }
+  save();
+  return true;
+}
+
+uint32_t IpChangeHistory::planIntervalSeconds(uint32_t unixTime,
+                                              uint32_t baseSeconds,
+                                              uint32_t minSeconds,
+                                              uint32_t maxSeconds) const {
+  if (maxSeconds < minSeconds) {
+    maxSeconds = minSeconds;
+  }
+  uint32_t interval = baseSeconds;
+  const uint32_t stableSince = _count > 0 ? lastChangeAt() : _startedAt;
+  if (unixTime >= kMinValidUnixTime && stableSince != 0 && unixTime > stableSince) {
+    const uint32_t backoff = (unixTime - stableSince) / kStabilityDivisor;
+    if (backoff > interval) {
+      interval = backoff;
+    }
+
+    const uint32_t gap = typicalGapSeconds();
+    if (gap > 0 && interval > gap / kChecksPerGap) {
+      interval = gap / kChecksPerGap;
+    }
+
+    const uint32_t untilWindow = secondsUntilHotWindow(unixTime);
+    if (untilWindow == 0) {
+      interval = minSeconds;
+    } else if (untilWindow < interval) {
+      interval = untilWindow;
+    }
+  }
+
+  if (interval < minSeconds) {
+    return minSeconds;
+  }
+  return interval > maxSeconds ? maxSeconds : interval;
+}
+
+uint32_t IpChangeHistory::typicalGapSeconds() const {
+  if (_count < 2) {
+    return 0;
+  }
+  uint32_t gaps[kMaxChanges - 1];
+  const size_t gapCount = _count - 1;
+  for (size_t i = 0; i < gapCount; ++i) {
+    gaps[i] = _changes[i + 1] - _changes[i];
+  }
+  // Insertion sort; at most 15 entries.
+  for (size_t i = 1; i < gapCount; ++i) {
+    const uint32_t value = gaps[i];
+    size_t j = i;
+    while (j > 0 && gaps[j - 1] > value) {
+      gaps[j] = gaps[j - 1];
+      --j;
+    }
+    gaps[j] = value;
+  }
+  return gaps[gapCount / 2];
+}
+
+void IpChangeHistory::clear() {
+  _startedAt = 0;
+  _lastIp = 0;
+  _count = 0;
+  memset(_changes, 0, sizeof(_changes));
+}
+
+bool IpChangeHistory::isHotTimeOfDay(uint32_t secondOfDay) const {
+  size_t nearby = 0;
+  for (size_t i = 0; i < _count; ++i) {
+    if (circularDistance(_changes[i] % kSecondsPerDay, secondOfDay, kSecondsPerDay) <=
+        kHotWindowSeconds) {
+      nearby += 1;
+    }
+  }
+  return nearby >= 2;
+}
+
+uint32_t IpChangeHistory::secondsUntilHotWindow(uint32_t unixTime) const {
+  const uint32_t now = unixTime % kSecondsPerDay;
+  uint32_t best = UINT32_MAX;
+  for (size_t i = 0; i < _count; ++i) {
+    const uint32_t center = _changes[i] % kSecondsPerDay;
+    if (!isHotTimeOfDay(center)) {
+      continue;
+    }
+    if (circularDistance(center, now, kSecondsPerDay) <= kHotWindowSeconds) {
+      return 0;
+    }
+    const uint32_t start = (center + kSecondsPerDay - kHotWindowSeconds) % kSecondsPerDay;
+    const uint32_t until = (start + kSecondsPerDay - now) % kSecondsPerDay;
+    if (until < best) {
+      best = until;
+    }
+  }
+  return best;
+}
+
+void IpChangeHistory::save() const {
+  Stored stored;
+  memset(&stored, 0, sizeof(stored));
+  stored.version = kVersion;
+  stored.count = static_cast<uint8_t>(_count);
+  stored.startedAt = _startedAt;
+  stored.lastIp = _lastIp;
+  memcpy(stored.changes, _changes, sizeof(stored.changes));
+
+  KeyValueStore preferences;
+  if (!preferences.begin(kNamespace, false)) {
+    return;
+  }
+  preferences.putBytes(kKey, &stored, sizeof(stored));
+  preferences.end();
+}
@@ -0,0 +1,119 @@
+#include "NetworkAccounting.h"
+
+#include <freertos/FreeRTOS.h>
+
+namespace {
+constexpr size_t kSubsystemCount = static_cast<size_t>(NetSubsystem::Count);
+
+portMUX_TYPE gCountersMux = portMUX_INITIALIZER_UNLOCKED;
+NetSubsystemCounters gCounters[kSubsystemCount];
+thread_local NetSubsystem tCurrentSubsystem = NetSubsystem::Other;
+
+NetSubsystemCounters& countersOf(NetSubsystem subsystem) {
+  const size_t index = static_cast<size_t>(subsystem);
+  return gCounters[index < kSubsystemCount ? index : static_cast<size_t>(NetSubsystem::Other)];
+}
+}  // namespace
+
+NetworkAccounting::Scope::Scope(NetSubsystem subsystem) : _previous(tCurrentSubsystem) {
+  tCurrentSubsystem = subsystem;
+}
+
+NetworkAccounting::Scope::~Scope() {
+  tCurrentSubsystem = _previous;
+}
+
+NetSubsystem NetworkAccounting::current() {
+  return tCurrentSubsystem;
+}
+
+const char* NetworkAccounting::subsystemName(NetSubsystem subsystem) {
+  switch (subsystem) {
+    case NetSubsystem::Ddns:
+      return "ddns";
+    case NetSubsystem::PublicIp:
+      return "public_ip";
+    case NetSubsystem::Ota:
+      return "ota";
+    case NetSubsystem::BemfaMqtt:
+      return "bemfa_mqtt";
+    case NetSubsystem::Ntp:
+      return "ntp";
+    case NetSubsystem::HostProbe:
+      return "host_probe";
+    case NetSubsystem::WakeOnLan:
+      return "wol";
+    case NetSubsystem::WebPortal:
+      return "web_portal";
+    default:
+      return "other";
+  }
+}
+
+void NetworkAccounting::addTransfer(uint32_t bytesIn, uint32_t bytesOut) {
+  addTransferTo(current(), bytesIn, bytesOut);
+}
+
+void NetworkAccounting::addTransferTo(NetSubsystem subsystem, uint32_t bytesIn, uint32_t bytesOut) {
+  portENTER_CRITICAL(&gCountersMux);
+  NetSubsystemCounters& counters = countersOf(subsystem);
+  counters.bytesIn += bytesIn;
+  counters.bytesOut += bytesOut;
+  counters.requests += 1;
+  portEXIT_CRITICAL(&gCountersMux);
+}
+
+void NetworkAccounting::addReceived(uint32_t bytesIn) {
+  addReceivedTo(current(), bytesIn);
+}
+
+void NetworkAccounting::addReceivedTo(NetSubsystem subsystem, uint32_t bytesIn) {
+  portENTER_CRITICAL(&gCountersMux);
+  countersOf(subsystem).bytesIn += bytesIn;
+  portEXIT_CRITICAL(&gCountersMux);
+}
+
+void NetworkAccounting::addConnection(bool tls) {
+  const NetSubsystem subsystem = current();
+  portENTER_CRITICAL(&gCountersMux);
+  NetSubsystemCounters& counters = countersOf(subsystem);
+  counters.connections += 1;
+  counters.tlsHandshakes += tls ? 1 : 0;
+  portEXIT_CRITICAL(&gCountersMux);
+}
+
+void NetworkAccounting::addDnsLookup() {
+  const NetSubsystem subsystem = current();
+  portENTER_CRITICAL(&gCountersMux);
+  countersOf(subsystem).dnsLookups += 1;
+  portEXIT_CRITICAL(&gCountersMux);
+}
+
+void NetworkAccounting::addFailure() {
+  const NetSubsystem subsystem = current();
+  portENTER_CRITICAL(&gCountersMux);
+  countersOf(subsystem).failures += 1;
+  portEXIT_CRITICAL(&gCountersMux);
+}
+
+void NetworkAccounting::addBlockedMs(uint32_t elapsedMs) {
+  const NetSubsystem subsystem = current();
+  portENTER_CRITICAL(&gCountersMux);
+  countersOf(subsystem).blockedMs += elapsedMs;
+  portEXIT_CRITICAL(&gCountersMux);
+}
+
+NetSubsystemCounters NetworkAccounting::getCounters(NetSubsystem subsystem) {
+  portENTER_CRITICAL(&gCountersMux);
+  const NetSubsystemCounters counters = countersOf(subsystem);
+  portEXIT_CRITICAL(&gCountersMux);
+  return counters;
+}
+
+void NetworkAccounting::reset() {
+  portENTER_CRITICAL(&gCountersMux);
+  for (size_t index = 0; index < kSubsystemCount; ++index) {
+    gCounters[index] = NetSubsystemCounters();
+  }
+  portEXIT_CRITICAL(&gCountersMux);
+}
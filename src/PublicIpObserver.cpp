@@ -0,0 +1,275 @@
+#include "PublicIpObserver.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace {
+constexpr PublicIpSource kConfirmationOrder[] = {PublicIpSource::Gateway, PublicIpSource::Stun,
+                                                 PublicIpSource::DnsEcho, PublicIpSource::Https};
+
+// Held across a refresh so concurrent callers share one lookup.
+SemaphoreHandle_t refreshMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+// Guards the observation; never held across network I/O.
+SemaphoreHandle_t stateMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+class MutexLock {
+ public:
+  explicit MutexLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+  }
+  ~MutexLock() { xSemaphoreGive(_mutex); }
+
+ private:
+  SemaphoreHandle_t _mutex;
+};
+
+bool gRequireAgreement = true;
+// Set until the first answer and after a reconnect: the next resolve must ask.
+bool gStale = true;
+uint32_t gLookedUpAtMs = 0;
+PublicIpObservation gObservation;
+String gCandidateIp = "";
+uint8_t gCandidateRepeats = 0;
+PublicIpObserverStats gStats;
+PublicIpObserver::ChangeListener gChangeListener = nullptr;
+void* gChangeListenerContext = nullptr;
+
+// Caller holds the state mutex.
+bool cachedAnswer(uint32_t maxAgeMs, String* ipv4) {
+  if (gStale || gObservation.ipv4.isEmpty() || millis() - gLookedUpAtMs >= maxAgeMs) {
+    return false;
+  }
+  gStats.cacheHits += 1;
+  *ipv4 = gObservation.ipv4;
+  return true;
+}
+
+// Caller holds the state mutex.
+void adopt(const String& ipv4, PublicIpSource source, PublicIpSource confirmedBy) {
+  const uint32_t now = millis();
+  if (!gObservation.ipv4.isEmpty()) {
+    gStats.changes += 1;
+  }
+  gObservation.ipv4 = ipv4;
+  gObservation.source = PublicIpService::sourceName(source);
+  gObservation.confirmedBy =
+      confirmedBy == PublicIpSource::None ? String("") : String(PublicIpService::sourceName(confirmedBy));
+  gObservation.confidence =
+      confirmedBy == PublicIpSource::None ? PublicIpConfidence::Single : PublicIpConfidence::Agreed;
+  gObservation.checkedAtMs = now;
+  gObservation.changedAtMs = now;
+  gCandidateIp = "";
+  gCandidateRepeats = 0;
+}
+}  // namespace
+
+String PublicIpObserver::resolve(bool useLocalIp, uint32_t timeoutMs, uint32_t maxAgeMs) {
+  if (useLocalIp) {
+    return PublicIpService::resolve(true, timeoutMs);
+  }
+
+  String ipv4;
+  {
+    MutexLock stateLock(stateMutex());
+    if (cachedAnswer(maxAgeMs, &ipv4)) {
+      return ipv4;
+    }
+  }
+
+  MutexLock refreshLock(refreshMutex());
+  String previousIp;
+  {
+    // Another caller may have refreshed while this one waited.
+    MutexLock stateLock(stateMutex());
+    if (cachedAnswer(maxAgeMs, &ipv4)) {
+      return ipv4;
+    }
+    previousIp = gObservation.ipv4;
+  }
+  ipv4 = refresh(timeoutMs);
+
+  ChangeListener listener = nullptr;
+  void* context = nullptr;
+  {
+    MutexLock stateLock(stateMutex());
+    if (!previousIp.isEmpty() && gObservation.ipv4 != previousIp) {
+      listener = gChangeListener;
+      context = gChangeListenerContext;
+    }
+  }
+  if (listener != nullptr) {
+    listener(context);
+  }
+  return ipv4;
+}
+
+String PublicIpObserver::refresh(uint32_t timeoutMs) {
+  const uint32_t startMs = millis();
+  PublicIpSource source = PublicIpSource::None;
+  const String ipv4 = PublicIpService::resolveWithSource(timeoutMs, &source);
+
+  String previousIp;
+  bool requireAgreement = false;
+  {
+    MutexLock stateLock(stateMutex());
+    gStats.lookups += 1;
+    if (ipv4.isEmpty()) {
+      return "";
+    }
+    previousIp = gObservation.ipv4;
+    requireAgreement = gRequireAgreement;
+    gLookedUpAtMs = millis();
+    gStale = false;
+
+    if (ipv4 == previousIp) {
+      // A different source reporting the same address confirms it after the fact.
+      const String sourceName = PublicIpService::sourceName(source);
+      if (sourceName != gObservation.source) {
+        gObservation.confirmedBy = gObservation.source;
+        gObservation.source = sourceName;
+        gObservation.confidence = PublicIpConfidence::Agreed;
+      }
+      gObservation.checkedAtMs = gLookedUpAtMs;
+      gCandidateIp = "";
+      gCandidateRepeats = 0;
+      return ipv4;
+    }
+    if (previousIp.isEmpty() || !requireAgreement) {
+      adopt(ipv4, source, PublicIpSource::None);
+      return ipv4;
+    }
+  }
+
+  bool contradicted = false;
+  const PublicIpSource confirmedBy = confirm(source, ipv4, startMs, timeoutMs, &contradicted);
+
+  MutexLock stateLock(stateMutex());
+  if (gObservation.ipv4 != previousIp) {
+    // reset() ran meanwhile; this answer is as good as a first one.
+    adopt(ipv4, source, confirmedBy);
+    return ipv4;
+  }
+  if (confirmedBy != PublicIpSource::None) {
+    adopt(ipv4, source, confirmedBy);
+    return ipv4;
+  }
+
+  if (contradicted) {
+    gStats.disagreements += 1;
+    gCandidateIp = "";
+    gCandidateRepeats = 0;
+  } else {
+    if (gCandidateIp != ipv4) {
+      gCandidateIp = ipv4;
+      gCandidateRepeats = 0;
+    }
+    gCandidateRepeats += 1;
+    if (gCandidateRepeats >= kUnconfirmedRepeats) {
+      adopt(ipv4, source, PublicIpSource::None);
+      return ipv4;
+    }
+  }
+  gStats.heldChanges += 1;
+  return previousIp;
+}
+
+PublicIpSource PublicIpObserver::confirm(PublicIpSource primary,
+                                         const String& ipv4,
+                                         uint32_t startMs,
+                                         uint32_t timeoutMs,
+                                         bool* contradicted) {
+  *contradicted = false;
+  for (const PublicIpSource candidate : kConfirmationOrder) {
+    if (candidate == primary || !PublicIpService::isSourceEnabled(candidate)) {
+      continue;
+    }
+    const uint32_t elapsedMs = millis() - startMs;
+    if (elapsedMs >= timeoutMs) {
+      break;
+    }
+
+    {
+      MutexLock stateLock(stateMutex());
+      gStats.confirmations += 1;
+    }
+    const String answer = PublicIpService::resolveFrom(candidate, timeoutMs - elapsedMs);
+    if (answer.isEmpty()) {
+      continue;
+    }
+    if (answer == ipv4) {
+      return candidate;
+    }
+    // Keep asking: one stale echo service must not veto a change the others see.
+    *contradicted = true;
+  }
+  return PublicIpSource::None;
+}
+
+PublicIpObservation PublicIpObserver::getObservation() {
+  MutexLock stateLock(stateMutex());
+  return gObservation;
+}
+
+PublicIpObserverStats PublicIpObserver::getStats() {
+  MutexLock stateLock(stateMutex());
+  return gStats;
+}
+
+void PublicIpObserver::setChangeListener(ChangeListener listener, void* context) {
+  MutexLock stateLock(stateMutex());
+  gChangeListener = listener;
+  gChangeListenerContext = context;
+}
+
+void PublicIpObserver::removeChangeListener(void* context) {
+  MutexLock stateLock(stateMutex());
+  if (gChangeListenerContext == context) {
+    gChangeListener = nullptr;
+    gChangeListenerContext = nullptr;
+  }
+}
+
+void PublicIpObserver::setRequireAgreement(bool required) {
+  MutexLock stateLock(stateMutex());
+  gRequireAgreement = required;
+}
+
+bool PublicIpObserver::getRequireAgreement() {
+  MutexLock stateLock(stateMutex());
+  return gRequireAgreement;
+}
+
+void PublicIpObserver::onWifiReconnected() {
+  PublicIpService::onWifiReconnected();
+  MutexLock stateLock(stateMutex());
+  gStale = true;
+}
+
+void PublicIpObserver::reset() {
+  MutexLock stateLock(stateMutex());
+  gStale = true;
+  gLookedUpAtMs = 0;
+  gObservation = PublicIpObservation();
+  gCandidateIp = "";
+  gCandidateRepeats = 0;
+  gStats = PublicIpObserverStats();
+}
+
+const char* PublicIpObserver::confidenceName(PublicIpConfidence confidence) {
+  switch (confidence) {
+    case PublicIpConfidence::Single:
+      return "SINGLE";
+    case PublicIpConfidence::Agreed:
+      return "AGREED";
+    case PublicIpConfidence::None:
+    default:
+      return "NONE";
+  }
+}
@@ -1,11 +1,18 @@
 #include "PublicIpService.h"
 
 #include <HTTPClient.h>
-#include <WiFi.h>
-#include <WiFiClientSecure.h>
 
 #include <ctype.h>
-#include <cstring>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <memory>
+
+#include "DnsCache.h"
+#include "GatewayIpProbe.h"
+#include "Hal.h"
+#include "NetworkAccounting.h"
+#include "SharedHttpClient.h"
 
 namespace
 {
@@ -38,13 +45,204 @@ namespace
 
   using ResolveUrlFetch = String (*)(const char *url, uint32_t timeoutMs);
 
-  String resolveFromUrlList(const char *const *urls,
-                            size_t urlCount,
-                            uint32_t startMs,
-                            uint32_t timeoutMs,
-                            ResolveUrlFetch fetch)
+  constexpr size_t kEndpointCount = arrayLength(kPublicIpv4Urls);
+  // Until an endpoint has a latency sample it ranks as if it took this long.
+  constexpr uint32_t kUnknownLatencyMs = 1000;
+  // The next endpoint is fired once the current one is this much slower than usual.
+  constexpr uint32_t kHedgeLatencyMultiplier = 2;
+  constexpr uint32_t kMinHedgeDelayMs = 250;
+  constexpr uint32_t kMaxHedgeDelayMs = 2000;
+  // EWMA weight of a new sample is 1 / kEwmaDivisor.
+  constexpr int32_t kEwmaDivisor = 4;
+  constexpr uint32_t kWaitPollMs = 10;
+  // Each attempt runs its own TLS handshake.
+  constexpr uint32_t kAttemptStackSize = 8192;
+  constexpr UBaseType_t kAttemptPriority = 1;
+  // Hedges started while another attempt is still running, across every resolve.
+  // Each one is an extra TLS handshake on the heap, so only one may be pending.
+  constexpr uint32_t kMaxPendingHedges = 1;
+
+  portMUX_TYPE gStateMux = portMUX_INITIALIZER_UNLOCKED;
+  PublicIpEndpointStats gEndpointStats[kEndpointCount];
+  uint32_t gPendingHedges = 0;
+
+  constexpr const char *kDefaultStunHost = "stun.cloudflare.com";
+  // resolver1.opendns.com; it answers myip.opendns.com with the querying address.
+  constexpr const char *kDefaultDnsEchoServer = "208.67.222.222";
+  constexpr const char *kDnsEchoName = "myip.opendns.com";
+  constexpr uint32_t kUdpProbeTimeoutMs = 800;
+  // When both UDP probes go unanswered (UDP filtered upstream), skip them for a while.
+  constexpr uint32_t kUdpBackoffMs = 10UL * 60UL * 1000UL;
+
+  // NAT-PMP answers in one round trip; UPnP needs SSDP plus two LAN HTTP requests.
+  constexpr uint32_t kGatewayTimeoutMs = 1600;
+
+  PublicIpDiscoveryMode gDiscoveryMode = PublicIpDiscoveryMode::GatewayFirst;
+  String gStunHost = kDefaultStunHost;
+  uint16_t gStunPort = UdpPublicIpProbe::kDefaultStunPort;
+  String gDnsEchoServer = kDefaultDnsEchoServer;
+  uint16_t gDnsEchoPort = UdpPublicIpProbe::kDefaultDnsPort;
+  PublicIpDiscoveryStats gDiscoveryStats;
+  bool gUdpBackoff = false;
+  uint32_t gUdpBackoffUntilMs = 0;
+
+  // Shared by the caller and every attempt of one resolve. Attempts outlive the
+  // caller when it returns early, so the race is reference counted.
+  struct HedgeRace
+  {
+    String ips[kEndpointCount];
+    size_t winnerIndex = kEndpointCount;
+    size_t finishedCount = 0;
+  };
+
+  using HedgeRacePtr = std::shared_ptr<HedgeRace>;
+
+  struct HedgeAttempt
+  {
+    HedgeRacePtr race;
+    size_t index = 0;
+    uint32_t timeoutMs = 0;
+    // Holds one of the kMaxPendingHedges slots until it finishes.
+    bool hedge = false;
+    NetSubsystem subsystem = NetSubsystem::PublicIp;
+    ResolveUrlFetch fetch = nullptr;
+  };
+
+  void recordSample(PublicIpEndpointStats *stats, uint32_t sampleMs, bool succeeded)
   {
-    for (size_t i = 0; i < urlCount; ++i)
+    if (stats->latencyEwmaMs == 0)
+    {
+      stats->latencyEwmaMs = sampleMs > 0 ? sampleMs : 1;
+    }
+    else
+    {
+      const int32_t delta = static_cast<int32_t>(sampleMs) - static_cast<int32_t>(stats->latencyEwmaMs);
+      stats->latencyEwmaMs = static_cast<uint32_t>(static_cast<int32_t>(stats->latencyEwmaMs) + delta / kEwmaDivisor);
+    }
+
+    if (succeeded)
+    {
+      stats->successes += 1;
+    }
+    else
+    {
+      stats->failures += 1;
+    }
+  }
+
+  void runAttempt(HedgeAttempt *attempt)
+  {
+    const char *url = kPublicIpv4Urls[attempt->index];
+    const uint32_t startMs = millis();
+    String ip;
+    {
+      NetworkAccounting::Scope accountingScope(attempt->subsystem);
+      ip = attempt->fetch(url, attempt->timeoutMs);
+    }
+    const uint32_t elapsedMs = millis() - startMs;
+    const bool succeeded = !ip.isEmpty();
+
+    // Written before the lock; the caller reads it only after seeing winnerIndex.
+    HedgeRace &race = *attempt->race;
+    race.ips[attempt->index] = ip;
+
+    portENTER_CRITICAL(&gStateMux);
+    PublicIpEndpointStats &stats = gEndpointStats[attempt->index];
+    // A failure counts as a full timeout so a dead endpoint sinks in the order.
+    recordSample(&stats, succeeded ? elapsedMs : attempt->timeoutMs, succeeded);
+    race.finishedCount += 1;
+    if (attempt->hedge)
+    {
+      gPendingHedges -= 1;
+    }
+    if (succeeded && race.winnerIndex == kEndpointCount)
+    {
+      race.winnerIndex = attempt->index;
+      stats.wins += 1;
+    }
+    portEXIT_CRITICAL(&gStateMux);
+  }
+
+  void attemptTask(void *context)
+  {
+    HedgeAttempt *attempt = static_cast<HedgeAttempt *>(context);
+    runAttempt(attempt);
+    delete attempt;
+    vTaskDelete(nullptr);
+  }
+
+  void launchAttempt(const HedgeRacePtr &race,
+                     size_t index,
+                     uint32_t timeoutMs,
+                     bool hedge,
+                     ResolveUrlFetch fetch)
+  {
+    HedgeAttempt *attempt = new HedgeAttempt();
+    attempt->race = race;
+    attempt->index = index;
+    attempt->timeoutMs = timeoutMs;
+    attempt->hedge = hedge;
+    attempt->subsystem = NetworkAccounting::current();
+    attempt->fetch = fetch;
+
+    if (xTaskCreate(attemptTask, "pubip_hedge", kAttemptStackSize, attempt, kAttemptPriority, nullptr) != pdPASS)
+    {
+      // Out of memory for another task: fall back to a sequential attempt.
+      runAttempt(attempt);
+      delete attempt;
+    }
+  }
+
+  // Endpoint indices, fastest latency estimate first; ties keep list order.
+  void orderEndpoints(size_t *order, uint32_t *latencyMs)
+  {
+    portENTER_CRITICAL(&gStateMux);
+    for (size_t i = 0; i < kEndpointCount; ++i)
+    {
+      const uint32_t ewmaMs = gEndpointStats[i].latencyEwmaMs;
+      latencyMs[i] = ewmaMs == 0 ? kUnknownLatencyMs : ewmaMs;
+    }
+    portEXIT_CRITICAL(&gStateMux);
+
+    for (size_t i = 0; i < kEndpointCount; ++i)
+    {
+      order[i] = i;
+    }
+    for (size_t i = 1; i < kEndpointCount; ++i)
+    {
+      const size_t current = order[i];
+      size_t j = i;
+      while (j > 0 && latencyMs[order[j - 1]] > latencyMs[current])
+      {
+        order[j] = order[j - 1];
+        --j;
+      }
+      order[j] = current;
+    }
+  }
+
+  uint32_t hedgeDelayMs(uint32_t latencyMs)
+  {
+    const uint32_t delayMs = latencyMs * kHedgeLatencyMultiplier;
+    if (delayMs < kMinHedgeDelayMs)
+    {
+      return kMinHedgeDelayMs;
+    }
+    return delayMs > kMaxHedgeDelayMs ? kMaxHedgeDelayMs : delayMs;
+  }
+
+  // Starts with the fastest endpoint and fires the next one when the current
+  // attempt fails or runs past its hedge delay. First valid IPv4 wins.
+  String resolveHedged(uint32_t startMs, uint32_t timeoutMs, ResolveUrlFetch fetch)
+  {
+    size_t order[kEndpointCount];
+    uint32_t latencyMs[kEndpointCount];
+    orderEndpoints(order, latencyMs);
+
+    HedgeRacePtr race = std::make_shared<HedgeRace>();
+    size_t launched = 0;
+    uint32_t nextLaunchAtMs = startMs;
+    while (true)
     {
       const uint32_t requestTimeoutMs = remainingTimeoutMs(startMs, timeoutMs);
       if (requestTimeoutMs == 0)
@@ -52,11 +250,45 @@ namespace
         break;
       }
 
-      const String ip = fetch(urls[i], requestTimeoutMs);
-      if (!ip.isEmpty())
+      portENTER_CRITICAL(&gStateMux);
+      const size_t winnerIndex = race->winnerIndex;
+      const size_t finishedCount = race->finishedCount;
+      portEXIT_CRITICAL(&gStateMux);
+
+      if (winnerIndex != kEndpointCount)
+      {
+        return race->ips[winnerIndex];
+      }
+
+      const bool allFailed = finishedCount == launched;
+      bool launch = launched < kEndpointCount &&
+                    (allFailed || static_cast<int32_t>(millis() - nextLaunchAtMs) >= 0);
+      // With an attempt still running this is a hedge; it waits for a free slot.
+      const bool hedge = launch && !allFailed;
+      if (hedge)
       {
-        return ip;
+        portENTER_CRITICAL(&gStateMux);
+        launch = gPendingHedges < kMaxPendingHedges;
+        if (launch)
+        {
+          gPendingHedges += 1;
+        }
+        portEXIT_CRITICAL(&gStateMux);
       }
+      if (launch)
+      {
+        const size_t index = order[launched];
+        launched += 1;
+        launchAttempt(race, index, requestTimeoutMs, hedge, fetch);
+        nextLaunchAtMs = millis() + hedgeDelayMs(latencyMs[index]);
+        continue;
+      }
+      if (launched == kEndpointCount && allFailed)
+      {
+        break;
+      }
+
+      delay(kWaitPollMs);
     }
 
     return "";
@@ -67,7 +299,7 @@ String PublicIpService::resolveIpv4(bool useLocalIp, uint32_t timeoutMs)
 {
   if (useLocalIp)
   {
-    const String ipv4 = WiFi.localIP().toString();
+    const String ipv4 = Hal::wifi().localIp().toString();
     if (ipv4 == "0.0.0.0")
     {
       return "";
@@ -75,59 +307,282 @@ String PublicIpService::resolveIpv4(bool useLocalIp, uint32_t timeoutMs)
     return ipv4;
   }
 
-  return resolveFromUrlList(kPublicIpv4Urls,
-                            arrayLength(kPublicIpv4Urls),
-                            millis(),
-                            timeoutMs,
-                            &PublicIpService::fetchFromUrl);
+  PublicIpSource source = PublicIpSource::None;
+  return resolveWithSource(timeoutMs, &source);
 }
 
-String PublicIpService::resolve(bool useLocalIp, uint32_t timeoutMs)
+String PublicIpService::resolveWithSource(uint32_t timeoutMs, PublicIpSource *source)
 {
-  return resolveIpv4(useLocalIp, timeoutMs);
+  NetworkAccounting::Scope accountingScope(NetSubsystem::PublicIp);
+  const uint32_t startMs = millis();
+  *source = PublicIpSource::None;
+  if (gDiscoveryMode == PublicIpDiscoveryMode::GatewayFirst)
+  {
+    uint32_t gatewayTimeoutMs = remainingTimeoutMs(startMs, timeoutMs);
+    if (gatewayTimeoutMs > kGatewayTimeoutMs)
+    {
+      gatewayTimeoutMs = kGatewayTimeoutMs;
+    }
+    String ipv4;
+    if (gatewayTimeoutMs > 0 && GatewayIpProbe::queryExternalIp(gatewayTimeoutMs, &ipv4))
+    {
+      portENTER_CRITICAL(&gStateMux);
+      gDiscoveryStats.gatewayAnswers += 1;
+      portEXIT_CRITICAL(&gStateMux);
+      *source = PublicIpSource::Gateway;
+      return ipv4;
+    }
+  }
+  if (gDiscoveryMode != PublicIpDiscoveryMode::HttpsOnly)
+  {
+    const String ipv4 = resolveOverUdp(startMs, timeoutMs, source);
+    if (!ipv4.isEmpty())
+    {
+      return ipv4;
+    }
+
+    portENTER_CRITICAL(&gStateMux);
+    gDiscoveryStats.httpsFallbacks += 1;
+    portEXIT_CRITICAL(&gStateMux);
+  }
+  const String ipv4 = resolveHedged(startMs, timeoutMs, &PublicIpService::fetchFromUrl);
+  if (!ipv4.isEmpty())
+  {
+    *source = PublicIpSource::Https;
+  }
+  return ipv4;
 }
 
-String PublicIpService::fetchFromUrl(const char *url, uint32_t timeoutMs)
+String PublicIpService::resolveFrom(PublicIpSource source, uint32_t timeoutMs)
 {
-  if (url == nullptr || timeoutMs == 0)
+  NetworkAccounting::Scope accountingScope(NetSubsystem::PublicIp);
+  const uint32_t startMs = millis();
+  const uint32_t udpTimeoutMs = timeoutMs < kUdpProbeTimeoutMs ? timeoutMs : kUdpProbeTimeoutMs;
+  String ipv4;
+  bool answered = false;
+  switch (source)
   {
-    return "";
+  case PublicIpSource::Gateway:
+    answered = GatewayIpProbe::queryExternalIp(
+        timeoutMs < kGatewayTimeoutMs ? timeoutMs : kGatewayTimeoutMs, &ipv4);
+    break;
+  case PublicIpSource::Stun:
+    answered = UdpPublicIpProbe::queryStun(gStunHost, gStunPort, udpTimeoutMs, &ipv4);
+    break;
+  case PublicIpSource::DnsEcho:
+    answered = UdpPublicIpProbe::queryDnsEcho(gDnsEchoServer, gDnsEchoPort, kDnsEchoName,
+                                              udpTimeoutMs, &ipv4);
+    break;
+  case PublicIpSource::Https:
+    ipv4 = resolveHedged(startMs, timeoutMs, &PublicIpService::fetchFromUrl);
+    answered = !ipv4.isEmpty();
+    break;
+  case PublicIpSource::None:
+  default:
+    break;
   }
+  return answered ? ipv4 : String("");
+}
 
-  WiFiClientSecure secureClient;
-  WiFiClient plainClient;
-  HTTPClient http;
-  http.setConnectTimeout(timeoutMs);
-  http.setTimeout(timeoutMs);
-  http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
-  http.setUserAgent(kUserAgent);
+bool PublicIpService::isSourceEnabled(PublicIpSource source)
+{
+  switch (source)
+  {
+  case PublicIpSource::Gateway:
+    return gDiscoveryMode == PublicIpDiscoveryMode::GatewayFirst;
+  case PublicIpSource::Stun:
+  case PublicIpSource::DnsEcho:
+    return gDiscoveryMode != PublicIpDiscoveryMode::HttpsOnly;
+  case PublicIpSource::Https:
+    return true;
+  case PublicIpSource::None:
+  default:
+    return false;
+  }
+}
 
-  const bool useHttps = std::strncmp(url, "https://", 8) == 0;
-  const bool begun = [&]()
+const char *PublicIpService::sourceName(PublicIpSource source)
+{
+  switch (source)
   {
-    if (useHttps)
-    {
-      secureClient.setInsecure();
-      return http.begin(secureClient, url);
-    }
-    return http.begin(plainClient, url);
-  }();
+  case PublicIpSource::Gateway:
+    return "GATEWAY";
+  case PublicIpSource::Stun:
+    return "STUN";
+  case PublicIpSource::DnsEcho:
+    return "DNS_ECHO";
+  case PublicIpSource::Https:
+    return "HTTPS";
+  case PublicIpSource::None:
+  default:
+    return "NONE";
+  }
+}
 
-  if (!begun)
+String PublicIpService::resolveOverUdp(uint32_t startMs, uint32_t timeoutMs, PublicIpSource *source)
+{
+  portENTER_CRITICAL(&gStateMux);
+  const bool backingOff = gUdpBackoff && static_cast<int32_t>(startMs - gUdpBackoffUntilMs) < 0;
+  if (backingOff)
+  {
+    gDiscoveryStats.udpSkipped += 1;
+  }
+  portEXIT_CRITICAL(&gStateMux);
+  if (backingOff)
   {
     return "";
   }
 
-  String ip = "";
-  const int httpCode = http.GET();
-  if (httpCode == HTTP_CODE_OK)
+  String ipv4;
+  uint32_t probeTimeoutMs = remainingTimeoutMs(startMs, timeoutMs);
+  if (probeTimeoutMs > kUdpProbeTimeoutMs)
   {
-    const String response = http.getString();
-    ip = extractIpv4FromText(response);
+    probeTimeoutMs = kUdpProbeTimeoutMs;
+  }
+  if (probeTimeoutMs > 0 && UdpPublicIpProbe::queryStun(gStunHost, gStunPort, probeTimeoutMs, &ipv4))
+  {
+    portENTER_CRITICAL(&gStateMux);
+    gDiscoveryStats.stunAnswers += 1;
+    gUdpBackoff = false;
+    portEXIT_CRITICAL(&gStateMux);
+    *source = PublicIpSource::Stun;
+    return ipv4;
   }
 
-  http.end();
-  return ip;
+  probeTimeoutMs = remainingTimeoutMs(startMs, timeoutMs);
+  if (probeTimeoutMs > kUdpProbeTimeoutMs)
+  {
+    probeTimeoutMs = kUdpProbeTimeoutMs;
+  }
+  if (probeTimeoutMs > 0 &&
+      UdpPublicIpProbe::queryDnsEcho(gDnsEchoServer, gDnsEchoPort, kDnsEchoName, probeTimeoutMs, &ipv4))
+  {
+    portENTER_CRITICAL(&gStateMux);
+    gDiscoveryStats.dnsEchoAnswers += 1;
+    gUdpBackoff = false;
+    portEXIT_CRITICAL(&gStateMux);
+    *source = PublicIpSource::DnsEcho;
+    return ipv4;
+  }
+
+  portENTER_CRITICAL(&gStateMux);
+  gDiscoveryStats.udpFailures += 1;
+  gUdpBackoff = true;
+  gUdpBackoffUntilMs = millis() + kUdpBackoffMs;
+  portEXIT_CRITICAL(&gStateMux);
+  return "";
+}
+
+void PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode mode)
+{
+  gDiscoveryMode = mode;
+}
+
+PublicIpDiscoveryMode PublicIpService::getDiscoveryMode()
+{
+  return gDiscoveryMode;
+}
+
+void PublicIpService::setStunServer(const String &host, uint16_t port)
+{
+  gStunHost = host.isEmpty() ? String(kDefaultStunHost) : host;
+  gStunPort = port;
+}
+
+void PublicIpService::setDnsEchoServer(const String &server, uint16_t port)
+{
+  gDnsEchoServer = server.isEmpty() ? String(kDefaultDnsEchoServer) : server;
+  gDnsEchoPort = port;
+}
+
+void PublicIpService::onWifiReconnected()
+{
+  GatewayIpProbe::reset();
+  portENTER_CRITICAL(&gStateMux);
+  gUdpBackoff = false;
+  portEXIT_CRITICAL(&gStateMux);
+}
+
+PublicIpDiscoveryStats PublicIpService::getDiscoveryStats()
+{
+  portENTER_CRITICAL(&gStateMux);
+  const PublicIpDiscoveryStats stats = gDiscoveryStats;
+  portEXIT_CRITICAL(&gStateMux);
+  return stats;
+}
+
+std::vector<PublicIpEndpointStats> PublicIpService::getEndpointStats()
+{
+  std::vector<PublicIpEndpointStats> stats(kEndpointCount);
+  portENTER_CRITICAL(&gStateMux);
+  for (size_t i = 0; i < kEndpointCount; ++i)
+  {
+    stats[i].latencyEwmaMs = gEndpointStats[i].latencyEwmaMs;
+    stats[i].successes = gEndpointStats[i].successes;
+    stats[i].failures = gEndpointStats[i].failures;
+    stats[i].wins = gEndpointStats[i].wins;
+  }
+  portEXIT_CRITICAL(&gStateMux);
+
+  for (size_t i = 0; i < kEndpointCount; ++i)
+  {
+    stats[i].url = kPublicIpv4Urls[i];
+  }
+  return stats;
+}
+
+void PublicIpService::resetEndpointStats()
+{
+  portENTER_CRITICAL(&gStateMux);
+  for (size_t i = 0; i < kEndpointCount; ++i)
+  {
+    gEndpointStats[i].latencyEwmaMs = 0;
+    gEndpointStats[i].successes = 0;
+    gEndpointStats[i].failures = 0;
+    gEndpointStats[i].wins = 0;
+  }
+  gDiscoveryStats = PublicIpDiscoveryStats();
+  gUdpBackoff = false;
+  portEXIT_CRITICAL(&gStateMux);
+}
+
+void PublicIpService::prefetchHosts()
+{
+  NetworkAccounting::Scope accountingScope(NetSubsystem::PublicIp);
+  if (gDiscoveryMode != PublicIpDiscoveryMode::HttpsOnly)
+  {
+    DnsCache::prefetch(gStunHost);
+  }
+  for (size_t i = 0; i < arrayLength(kPublicIpv4Urls); ++i)
+  {
+    DnsCache::prefetchUrl(kPublicIpv4Urls[i]);
+  }
+}
+
+String PublicIpService::resolve(bool useLocalIp, uint32_t timeoutMs)
+{
+  return resolveIpv4(useLocalIp, timeoutMs);
+}
+
+String PublicIpService::fetchFromUrl(const char *url, uint32_t timeoutMs)
+{
+  if (url == nullptr || timeoutMs == 0)
+  {
+    return "";
+  }
+
+  SharedHttpRequest request;
+  request.url = url;
+  request.timeoutMs = timeoutMs;
+  request.userAgent = kUserAgent;
+  request.followRedirects = true;
+
+  SharedHttpResponse response;
+  if (!SharedHttpClient::perform(request, &response) || response.httpCode != HTTP_CODE_OK)
+  {
+    return "";
+  }
+  return extractIpv4FromText(response.body);
 }
 
 String PublicIpService::extractIpv4FromText(const String &response)
@@ -0,0 +1,432 @@
+#include "SharedHttpClient.h"
+
+#include "DnsCache.h"
+#include "Hal.h"
+#include "NetworkAccounting.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(ARDUINO)
+#include <HTTPClient.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#endif
+
+namespace {
+constexpr const char* kDateHeader = "Date";
+
+SemaphoreHandle_t poolMutex() {
+  static SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+  return mutex;
+}
+
+class PoolLock {
+ public:
+  PoolLock() { xSemaphoreTake(poolMutex(), portMAX_DELAY); }
+  ~PoolLock() { xSemaphoreGive(poolMutex()); }
+};
+
+SharedHttpStats gStats;
+SharedHttpClient::DateListener gDateListener = nullptr;
+void* gDateListenerContext = nullptr;
+
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+  year -= month <= 2 ? 1 : 0;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+  const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+}  // namespace
+
+bool SharedHttpClient::perform(const SharedHttpRequest& request, SharedHttpResponse* response) {
+  if (response == nullptr || request.url.isEmpty()) {
+    return false;
+  }
+
+  {
+    PoolLock lock;
+    gStats.requests += 1;
+  }
+  const uint32_t startMs = millis();
+  const bool received = Hal::http().perform(request, response);
+  const uint32_t endMs = millis();
+  NetworkAccounting::addBlockedMs(endMs - startMs);
+  if (!received) {
+    NetworkAccounting::addFailure();
+    return false;
+  }
+
+  if (!response->dateHeader.isEmpty()) {
+    DateListener listener = nullptr;
+    void* context = nullptr;
+    {
+      PoolLock lock;
+      listener = gDateListener;
+      context = gDateListenerContext;
+    }
+    if (listener != nullptr) {
+      listener(response->dateHeader, startMs, endMs, context);
+    }
+  }
+
+  if (!response->reusedConnection) {
+    NetworkAccounting::addConnection(request.url.startsWith("https://"));
+  }
+  NetworkAccounting::addTransfer(response->body.length(),
+                                 request.url.length() + request.body.length());
+  return true;
+}
+
+void SharedHttpClient::setDateListener(DateListener listener, void* context) {
+  PoolLock lock;
+  gDateListener = listener;
+  gDateListenerContext = context;
+}
+
+void SharedHttpClient::removeDateListener(void* context) {
+  PoolLock lock;
+  if (gDateListenerContext == context) {
+    gDateListener = nullptr;
+    gDateListenerContext = nullptr;
+  }
+}
+
+bool SharedHttpClient::parseHttpDate(const String& value, time_t* unixTime) {
+  static const char* const kMonths[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  if (unixTime == nullptr) {
+    return false;
+  }
+
+  char monthText[4] = {0};
+  int day = 0;
+  int year = 0;
+  int hour = 0;
+  int minute = 0;
+  int second = 0;
+  const int commaPos = value.indexOf(',');
+  const String text = commaPos == -1 ? value : value.substring(commaPos + 1);
+  if (sscanf(text.c_str(), " %d %3s %d %d:%d:%d", &day, monthText, &year, &hour, &minute,
+             &second) != 6) {
+    return false;
+  }
+
+  unsigned month = 0;
+  for (unsigned index = 0; index < 12; ++index) {
+    if (strcmp(monthText, kMonths[index]) == 0) {
+      month = index + 1;
+      break;
+    }
+  }
+  if (month == 0 || day < 1 || day > 31 || year < 1970 || hour > 23 || minute > 59 ||
+      second > 60) {
+    return false;
+  }
+
+  const int64_t days = daysFromCivil(year, month, static_cast<unsigned>(day));
+  *unixTime = static_cast<time_t>(days * 86400 + hour * 3600 + minute * 60 + second);
+  return true;
+}
+
+void SharedHttpClient::closeIdleConnections() {
+  Hal::http().closeIdleConnections();
+}
+
+void SharedHttpClient::closeAll() {
+  Hal::http().closeAll();
+}
+
+SharedHttpStats SharedHttpClient::getStats() {
+  PoolLock lock;
+  SharedHttpStats stats = gStats;
+  stats.pooledConnections = 0;
+#if defined(ARDUINO)
+  Slot* pool = slots();
+  for (size_t index = 0; index < kMaxPooledOrigins; ++index) {
+    if (pool[index].client != nullptr && pool[index].client->connected()) {
+      stats.pooledConnections += 1;
+    }
+  }
+#endif
+  return stats;
+}
+
+#if defined(ARDUINO)
+class SharedHttpClient::PooledTransport : public HalHttpClient {
+ public:
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    return SharedHttpClient::exchange(request, response);
+  }
+  void closeIdleConnections() override { SharedHttpClient::closeIdleSlots(); }
+  void closeAll() override { SharedHttpClient::closeAllSlots(); }
+};
+
+HalHttpClient& SharedHttpClient::pooledTransport() {
+  static PooledTransport instance;
+  return instance;
+}
+
+SharedHttpClient::Slot* SharedHttpClient::slots() {
+  static Slot instance[kMaxPooledOrigins];
+  return instance;
+}
+
+bool SharedHttpClient::exchange(const SharedHttpRequest& request, SharedHttpResponse* response) {
+  response->httpCode = -1;
+  response->body = "";
+  response->dateHeader = "";
+  response->reusedConnection = false;
+
+  bool secure = false;
+  const String origin = originOf(request.url, &secure);
+  if (origin.isEmpty()) {
+    return false;
+  }
+
+  Slot* slot = nullptr;
+  {
+    PoolLock lock;
+    slot = acquireSlot(origin, secure, millis());
+  }
+
+  if (slot == nullptr) {
+    // Every slot is busy with another origin or request: use a one-shot connection.
+    WiFiClientSecure secureClient;
+    WiFiClient plainClient;
+    if (secure) {
+      secureClient.setInsecure();
+    }
+    WiFiClient& client = secure ? static_cast<WiFiClient&>(secureClient) : plainClient;
+    HTTPClient http;
+    http.setReuse(false);
+    response->httpCode = sendOnce(http, client, secure, request, response);
+
+    PoolLock lock;
+    if (response->httpCode > 0) {
+      gStats.connectionsOpened += 1;
+      gStats.tlsHandshakes += secure ? 1 : 0;
+    }
+    return response->httpCode > 0;
+  }
+
+  bool reused = slot->client->connected();
+  int httpCode = sendOnce(*slot->http, *slot->client, secure, request, response);
+  bool staleRetry = false;
+  if (httpCode <= 0 && reused) {
+    // The server closed the kept-alive connection in the meantime; dial again.
+    slot->client->stop();
+    staleRetry = true;
+    reused = false;
+    httpCode = sendOnce(*slot->http, *slot->client, secure, request, response);
+  }
+  response->httpCode = httpCode;
+  response->reusedConnection = reused && httpCode > 0;
+
+  PoolLock lock;
+  gStats.staleRetries += staleRetry ? 1 : 0;
+  if (httpCode > 0) {
+    if (reused) {
+      gStats.connectionsReused += 1;
+      gStats.handshakesAvoided += secure ? 1 : 0;
+    } else {
+      gStats.connectionsOpened += 1;
+      gStats.tlsHandshakes += secure ? 1 : 0;
+    }
+  } else {
+    slot->client->stop();
+  }
+  releaseSlot(slot);
+  return httpCode > 0;
+}
+
+void SharedHttpClient::closeIdleSlots() {
+  PoolLock lock;
+  const uint32_t now = millis();
+  Slot* pool = slots();
+  for (size_t index = 0; index < kMaxPooledOrigins; ++index) {
+    Slot& slot = pool[index];
+    if (slot.busy || slot.client == nullptr || now - slot.lastUsedAtMs < kIdleTimeoutMs) {
+      continue;
+    }
+    if (slot.client->connected()) {
+      slot.client->stop();
+    }
+  }
+}
+
+void SharedHttpClient::closeAllSlots() {
+  PoolLock lock;
+  Slot* pool = slots();
+  for (size_t index = 0; index < kMaxPooledOrigins; ++index) {
+    if (!pool[index].busy) {
+      closeSlot(&pool[index]);
+    }
+  }
+}
+
+SharedHttpClient::Slot* SharedHttpClient::acquireSlot(const String& origin,
+                                                      bool secure,
+                                                      uint32_t now) {
+  Slot* pool = slots();
+  Slot* candidate = nullptr;
+  for (size_t index = 0; index < kMaxPooledOrigins; ++index) {
+    Slot& slot = pool[index];
+    if (slot.origin == origin) {
+      if (slot.busy) {
+        return nullptr;
+      }
+      candidate = &slot;
+      break;
+    }
+    if (slot.busy) {
+      continue;
+    }
+    // Prefer an unused slot, otherwise the least recently used idle one.
+    if (candidate == nullptr || slot.origin.isEmpty() ||
+        (!candidate->origin.isEmpty() &&
+         static_cast<int32_t>(slot.lastUsedAtMs - candidate->lastUsedAtMs) < 0)) {
+      candidate = &slot;
+    }
+  }
+  if (candidate == nullptr) {
+    return nullptr;
+  }
+
+  if (candidate->origin != origin) {
+    closeSlot(candidate);
+    candidate->origin = origin;
+    candidate->secure = secure;
+  }
+  if (candidate->client == nullptr) {
+    if (secure) {
+      WiFiClientSecure* secureClient = new WiFiClientSecure();
+      secureClient->setInsecure();
+      candidate->client = secureClient;
+    } else {
+      candidate->client = new WiFiClient();
+    }
+    candidate->http = new HTTPClient();
+    candidate->http->setReuse(true);
+  }
+  if (now - candidate->lastUsedAtMs >= kIdleTimeoutMs && candidate->client->connected()) {
+    candidate->client->stop();
+  }
+
+  candidate->busy = true;
+  candidate->lastUsedAtMs = now;
+  return candidate;
+}
+
+void SharedHttpClient::releaseSlot(Slot* slot) {
+  slot->busy = false;
+  slot->lastUsedAtMs = millis();
+}
+
+void SharedHttpClient::closeSlot(Slot* slot) {
+  if (slot->client != nullptr) {
+    slot->client->stop();
+  }
+  delete slot->http;
+  delete slot->client;
+  slot->http = nullptr;
+  slot->client = nullptr;
+  slot->origin = "";
+  slot->secure = false;
+}
+
+int SharedHttpClient::sendOnce(HTTPClient& http,
+                               WiFiClient& client,
+                               bool secure,
+                               const SharedHttpRequest& request,
+                               SharedHttpResponse* response) {
+  // Dial through DnsCache so a slow resolver does not stall the request; HTTPClient
+  // then sees a live connection and uses it as is.
+  if (!client.connected() && !connectResolved(client, secure, request.url, request.timeoutMs)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+
+  http.setConnectTimeout(request.timeoutMs);
+  http.setTimeout(request.timeoutMs);
+  http.setFollowRedirects(request.followRedirects ? HTTPC_FORCE_FOLLOW_REDIRECTS
+                                                  : HTTPC_DISABLE_FOLLOW_REDIRECTS);
+  if (!request.userAgent.isEmpty()) {
+    http.setUserAgent(request.userAgent);
+  }
+
+  if (!http.begin(client, request.url)) {
+    return -1;
+  }
+
+  const char* headerKeys[] = {kDateHeader};
+  http.collectHeaders(headerKeys, 1);
+  if (!request.contentType.isEmpty()) {
+    http.addHeader("Content-Type", request.contentType);
+  }
+  for (const SharedHttpHeader& header : request.headers) {
+    http.addHeader(header.name, header.value);
+  }
+
+  const int httpCode = http.sendRequest(request.method.c_str(), request.body);
+  if (httpCode > 0) {
+    // Reading the whole body is what lets the connection be kept alive.
+    response->body = http.getString();
+    response->dateHeader = http.header(kDateHeader);
+  }
+
+  http.end();
+  return httpCode;
+}
+
+bool SharedHttpClient::connectResolved(WiFiClient& client,
+                                       bool secure,
+                                       const String& url,
+                                       uint32_t timeoutMs) {
+  const String host = DnsCache::hostOfUrl(url);
+  IPAddress address;
+  if (!DnsCache::resolve(host, &address, timeoutMs)) {
+    return false;
+  }
+
+  uint16_t port = secure ? 443 : 80;
+  const int hostStart = url.indexOf(host);
+  const int portPos = hostStart + host.length();
+  if (portPos < static_cast<int>(url.length()) && url.charAt(portPos) == ':') {
+    port = static_cast<uint16_t>(url.substring(portPos + 1).toInt());
+  }
+
+  if (secure) {
+    // Keep the hostname for SNI even though the socket goes to a cached address.
+    WiFiClientSecure& secureClient = static_cast<WiFiClientSecure&>(client);
+    secureClient.setHandshakeTimeout((timeoutMs + 999) / 1000);
+    return secureClient.connect(address, port, host.c_str(), nullptr, nullptr, nullptr) == 1;
+  }
+  return client.connect(address, port, static_cast<int32_t>(timeoutMs)) == 1;
+}
+
+String SharedHttpClient::originOf(const String& url, bool* secure) {
+  const int schemeEnd = url.indexOf("://");
+  if (schemeEnd <= 0) {
+    return "";
+  }
+
+  const String scheme = url.substring(0, schemeEnd);
+  if (scheme != "http" && scheme != "https") {
+    return "";
+  }
+  if (secure != nullptr) {
+    *secure = scheme == "https";
+  }
+
+  int hostEnd = url.indexOf('/', schemeEnd + 3);
+  if (hostEnd == -1) {
+    hostEnd = url.length();
+  }
+  return url.substring(0, hostEnd);
+}
+#endif
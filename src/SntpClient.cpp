@@ -0,0 +1,228 @@
+#include "SntpClient.h"
+
+#include <cstring>
+
+#include "DnsCache.h"
+#include "Hal.h"
+#include "NetworkAccounting.h"
+
+namespace {
+// Seconds from 1900-01-01 (NTP epoch) to 1970-01-01.
+constexpr uint64_t kNtpEpochOffset = 2208988800ULL;
+constexpr uint64_t kNtpEraSeconds = 1ULL << 32;
+constexpr int64_t kMicrosPerSecond = 1000000;
+constexpr uint8_t kModeClient = 3;
+constexpr uint8_t kModeServer = 4;
+constexpr uint8_t kVersion = 4;
+constexpr uint8_t kLeapAlarm = 3;
+constexpr size_t kOriginateOffset = 24;
+constexpr size_t kReceiveOffset = 32;
+constexpr size_t kTransmitOffset = 40;
+
+uint64_t readUint64(const uint8_t* data) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+
+void writeUint64(uint8_t* data, uint64_t value) {
+  for (size_t i = 8; i > 0; --i) {
+    data[i - 1] = static_cast<uint8_t>(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+struct PendingQuery {
+  const char* server = nullptr;
+  UdpSocket socket;
+  bool open = false;
+  bool answered = false;
+  uint64_t requestNtp = 0;
+  int64_t sentUs = 0;
+};
+}  // namespace
+
+size_t SntpClient::query(const char* const* servers,
+                         size_t count,
+                         uint32_t timeoutMs,
+                         std::vector<SntpSample>* samples) {
+  if (servers == nullptr || samples == nullptr) {
+    return 0;
+  }
+  if (count > kMaxServers) {
+    count = kMaxServers;
+  }
+
+  PendingQuery pending[kMaxServers];
+  IPAddress addresses[kMaxServers];
+  // Resolve everything first so the requests leave together.
+  uint32_t dnsTimeoutMs = DnsCache::kDefaultTimeoutMs;
+  if (timeoutMs < dnsTimeoutMs) {
+    dnsTimeoutMs = timeoutMs;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    pending[i].server = servers[i];
+    if (!DnsCache::resolve(servers[i], &addresses[i], dnsTimeoutMs)) {
+      NetworkAccounting::addFailure();
+      continue;
+    }
+    pending[i].open = pending[i].socket.begin(0);
+  }
+
+  size_t waiting = 0;
+  for (size_t i = 0; i < count; ++i) {
+    PendingQuery& query = pending[i];
+    if (!query.open) {
+      continue;
+    }
+    uint8_t packet[kPacketSize];
+    query.sentUs = localClockUs();
+    query.requestNtp = unixUsToNtp(query.sentUs);
+    buildRequest(query.requestNtp, packet);
+    if (!query.socket.beginPacket(addresses[i], kPort) ||
+        query.socket.write(packet, sizeof(packet)) != sizeof(packet) || !query.socket.endPacket()) {
+      NetworkAccounting::addFailure();
+      query.socket.stop();
+      query.open = false;
+      continue;
+    }
+    NetworkAccounting::addTransfer(0, kPacketSize);
+    waiting += 1;
+  }
+
+  size_t answered = 0;
+  const uint32_t startMs = millis();
+  while (waiting > 0 && millis() - startMs < timeoutMs) {
+    for (size_t i = 0; i < count; ++i) {
+      PendingQuery& query = pending[i];
+      if (!query.open || query.answered) {
+        continue;
+      }
+      int size = 0;
+      while (!query.answered && (size = query.socket.parsePacket()) > 0) {
+        // Taken before reading so the copy does not count as network delay.
+        const int64_t receivedUs = localClockUs();
+        uint8_t packet[kPacketSize];
+        const int length = query.socket.read(packet, sizeof(packet));
+        NetworkAccounting::addReceived(static_cast<uint32_t>(size));
+        SntpSample sample;
+        if (length > 0 && parseResponse(packet,
+                                        static_cast<size_t>(length),
+                                        query.requestNtp,
+                                        query.sentUs,
+                                        receivedUs,
+                                        &sample)) {
+          sample.server = query.server;
+          samples->push_back(sample);
+          query.answered = true;
+          answered += 1;
+          waiting -= 1;
+        }
+      }
+    }
+    if (waiting > 0) {
+      delay(kPollMs);
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    if (pending[i].open) {
+      if (!pending[i].answered) {
+        NetworkAccounting::addFailure();
+      }
+      pending[i].socket.stop();
+    }
+  }
+  return answered;
+}
+
+bool SntpClient::selectBest(const std::vector<SntpSample>& samples, SntpSample* best) {
+  if (samples.empty() || best == nullptr) {
+    return false;
+  }
+  size_t bestIndex = 0;
+  for (size_t i = 1; i < samples.size(); ++i) {
+    const SntpSample& sample = samples[i];
+    const SntpSample& current = samples[bestIndex];
+    // Equal delays: prefer the server closer to a reference clock.
+    if (sample.delayUs < current.delayUs ||
+        (sample.delayUs == current.delayUs && sample.stratum < current.stratum)) {
+      bestIndex = i;
+    }
+  }
+  *best = samples[bestIndex];
+  return true;
+}
+
+int64_t SntpClient::localClockUs() {
+  return Hal::clock().unixTimeUs();
+}
+
+uint64_t SntpClient::unixUsToNtp(int64_t unixUs) {
+  int64_t seconds = unixUs / kMicrosPerSecond;
+  int64_t micros = unixUs % kMicrosPerSecond;
+  if (micros < 0) {
+    seconds -= 1;
+    micros += kMicrosPerSecond;
+  }
+  const uint64_t ntpSeconds = static_cast<uint64_t>(seconds + static_cast<int64_t>(kNtpEpochOffset)) &
+                              (kNtpEraSeconds - 1);
+  const uint64_t fraction = (static_cast<uint64_t>(micros) << 32) / kMicrosPerSecond;
+  return (ntpSeconds << 32) | fraction;
+}
+
+int64_t SntpClient::ntpToUnixUs(uint64_t ntp) {
+  uint64_t seconds = ntp >> 32;
+  if (seconds < kNtpEpochOffset) {
+    seconds += kNtpEraSeconds;
+  }
+  const uint64_t micros = ((ntp & 0xFFFFFFFFULL) * kMicrosPerSecond) >> 32;
+  return static_cast<int64_t>(seconds - kNtpEpochOffset) * kMicrosPerSecond +
+         static_cast<int64_t>(micros);
+}
+
+void SntpClient::buildRequest(uint64_t transmitNtp, uint8_t* packet) {
+  memset(packet, 0, kPacketSize);
+  packet[0] = static_cast<uint8_t>((kVersion << 3) | kModeClient);
+  // The server echoes this back as the originate timestamp.
+  writeUint64(packet + kTransmitOffset, transmitNtp);
+}
+
+bool SntpClient::parseResponse(const uint8_t* packet,
+                               size_t length,
+                               uint64_t requestNtp,
+                               int64_t t1Us,
+                               int64_t t4Us,
+                               SntpSample* sample) {
+  if (packet == nullptr || sample == nullptr || length < kPacketSize) {
+    return false;
+  }
+  const uint8_t leap = packet[0] >> 6;
+  const uint8_t mode = packet[0] & 0x07;
+  const uint8_t stratum = packet[1];
+  // Stratum 0 is a kiss-o'-death; leap alarm means the server is unsynchronized.
+  if (mode != kModeServer || stratum == 0 || stratum > 15 || leap == kLeapAlarm) {
+    return false;
+  }
+  if (readUint64(packet + kOriginateOffset) != requestNtp) {
+    return false;
+  }
+  const uint64_t receiveNtp = readUint64(packet + kReceiveOffset);
+  const uint64_t transmitNtp = readUint64(packet + kTransmitOffset);
+  if (receiveNtp == 0 || transmitNtp == 0) {
+    return false;
+  }
+
+  const int64_t t2Us = ntpToUnixUs(receiveNtp);
+  const int64_t t3Us = ntpToUnixUs(transmitNtp);
+  sample->offsetUs = ((t2Us - t1Us) + (t3Us - t4Us)) / 2;
+  sample->delayUs = (t4Us - t1Us) - (t3Us - t2Us);
+  // Clock granularity on either side can push a LAN round trip below zero.
+  if (sample->delayUs < 0) {
+    sample->delayUs = 0;
+  }
+  sample->stratum = stratum;
+  return true;
+}
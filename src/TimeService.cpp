@@ -1,9 +1,14 @@
 ﻿#include "TimeService.h"
 
-#include <WiFi.h>
-#include <WiFiUdp.h>
+#include "DnsCache.h"
+#include "Hal.h"
+#include "NetworkAccounting.h"
+#include "SharedHttpClient.h"
+#include "SntpClient.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <time.h>
-#include <sys/time.h>
 
 #include <cstring>
 #include <stdlib.h>
@@ -18,10 +23,31 @@ constexpr const char* kAliyunNtpServers[] = {
     "ntp6.aliyun.com",
     "ntp7.aliyun.com"};
 constexpr size_t kAliyunNtpServerCount = sizeof(kAliyunNtpServers) / sizeof(kAliyunNtpServers[0]);
-constexpr uint32_t kNtpEpochOffset = 2208988800UL;
 constexpr uint32_t kMillisPerSecond = 1000UL;
+constexpr int64_t kMicrosPerSecond = 1000000;
+constexpr uint32_t kDnsPrefetchLeadMs = 30000;
+constexpr uint32_t kRoundStackSize = 4096;
+constexpr UBaseType_t kRoundPriority = 1;
+// A system clock before 2021-01-01 was never set; one Date header beats it.
+constexpr int64_t kMinValidUnixMs = 1609459200000LL;
+
+portMUX_TYPE gRoundMux = portMUX_INITIALIZER_UNLOCKED;
+portMUX_TYPE gDateMux = portMUX_INITIALIZER_UNLOCKED;
 }  // namespace
 
+// Shared with the round's task, which may outlive the service.
+struct TimeService::SntpRound {
+  const char* servers[SntpClient::kMaxServers] = {};
+  size_t count = 0;
+  std::vector<SntpSample> samples;
+  // Guarded by gRoundMux; samples are only read once it is set.
+  bool finished = false;
+};
+
+TimeService::~TimeService() {
+  SharedHttpClient::removeDateListener(this);
+}
+
 void TimeService::begin() {
   if (_begun) {
     return;
@@ -39,6 +65,13 @@ void TimeService::begin() {
     strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S %Z", localTm);
   }
 
+  _discipline.setIntervalBounds(kMinSyncIntervalSeconds, _syncIntervalSeconds);
+  ClockDriftState stored;
+  if (ClockDiscipline::load(&stored)) {
+    _discipline.restore(stored);
+  }
+  SharedHttpClient::setDateListener(onHttpDate, this);
+
   setState("READY", "Time service ready.");
 }
 
@@ -47,6 +80,26 @@ void TimeService::tick(bool wifiConnected) {
     begin();
   }
 
+  if (_round) {
+    if (!roundFinished()) {
+      return;
+    }
+    finishRound();
+  }
+
+  // Between syncs, slew away what the crystal is estimated to have drifted.
+  const uint32_t sinceSlewMs = millis() - _lastDriftSlewMs;
+  if (_synced && sinceSlewMs >= kDriftSlewIntervalMs) {
+    _lastDriftSlewMs += sinceSlewMs;
+    const int64_t correctionUs =
+        _discipline.driftCorrectionUs(static_cast<int64_t>(sinceSlewMs) * 1000);
+    if (correctionUs != 0) {
+      slewClock(correctionUs);
+    }
+  }
+
+  applyHttpDate();
+
   if (!wifiConnected) {
     if (_synced) {
       setState("SYNCED", "Time synced, WiFi disconnected.");
@@ -58,6 +111,18 @@ void TimeService::tick(bool wifiConnected) {
 
   const uint32_t now = millis();
 
+  NetworkAccounting::Scope accountingScope(NetSubsystem::Ntp);
+  // Warm the resolver shortly before the next sync or retry attempt.
+  const bool attemptScheduled = _synced ? _nextSyncDueMs != 0 : _lastSyncAttemptMs != 0;
+  const uint32_t nextAttemptMs =
+      _synced ? _nextSyncDueMs : _lastSyncAttemptMs + kRetryIntervalSeconds * kMillisPerSecond;
+  if (attemptScheduled &&
+      static_cast<int32_t>(nextAttemptMs - now) <= static_cast<int32_t>(kDnsPrefetchLeadMs)) {
+    for (size_t i = 0; i < kParallelServers; ++i) {
+      DnsCache::prefetch(kAliyunNtpServers[(_serverIndex + i) % kAliyunNtpServerCount]);
+    }
+  }
+
   if (!_synced) {
     if (_lastSyncAttemptMs == 0 ||
         static_cast<int32_t>(now - _lastSyncAttemptMs) >=
@@ -68,12 +133,12 @@ void TimeService::tick(bool wifiConnected) {
   }
 
   if (_nextSyncDueMs == 0) {
-    _nextSyncDueMs = now + _syncIntervalSeconds * kMillisPerSecond;
+    _nextSyncDueMs = now + _discipline.intervalSeconds() * kMillisPerSecond;
   }
 
+  // The round reschedules when it finishes.
   if (static_cast<int32_t>(now - _nextSyncDueMs) >= 0) {
     sync(wifiConnected);
-    _nextSyncDueMs = now + _syncIntervalSeconds * kMillisPerSecond;
   }
 }
 
@@ -82,87 +147,123 @@ bool TimeService::sync(bool wifiConnected) {
     setState("WAIT_WIFI", "Cannot sync: WiFi disconnected.");
     return false;
   }
+  if (_round) {
+    return false;
+  }
 
-  setState("SYNCING", "Syncing time with Aliyun NTP server...");
+  setState("SYNCING", "Syncing time with Aliyun NTP servers...");
   _lastSyncAttemptMs = millis();
 
-  bool success = false;
-  uint32_t unixTime = 0;
+  std::shared_ptr<SntpRound> round = std::make_shared<SntpRound>();
+  static_assert(kParallelServers <= SntpClient::kMaxServers, "round exceeds the client's sockets");
+  round->count = kParallelServers;
+  for (size_t i = 0; i < round->count; ++i) {
+    round->servers[i] = kAliyunNtpServers[(_serverIndex + i) % kAliyunNtpServerCount];
+  }
+  _round = round;
 
-  for (size_t i = 0; i < kAliyunNtpServerCount; ++i) {
-    const size_t index = (_serverIndex + i) % kAliyunNtpServerCount;
-    const char* server = kAliyunNtpServers[index];
+  std::shared_ptr<SntpRound>* context = new std::shared_ptr<SntpRound>(round);
+  if (xTaskCreate(roundTask, "sntp", kRoundStackSize, context, kRoundPriority, nullptr) != pdPASS) {
+    // Out of memory for another task: run the round here instead.
+    delete context;
+    runRound(round.get());
+  }
+  return true;
+}
 
-    if (queryNtpServer(server, &unixTime)) {
-      success = true;
-      _serverIndex = index;
-      break;
-    }
+void TimeService::roundTask(void* context) {
+  std::shared_ptr<SntpRound>* owner = static_cast<std::shared_ptr<SntpRound>*>(context);
+  runRound(owner->get());
+  delete owner;
+  vTaskDelete(nullptr);
+}
 
-    delay(100);
+void TimeService::runRound(SntpRound* round) {
+  {
+    NetworkAccounting::Scope accountingScope(NetSubsystem::Ntp);
+    SntpClient::query(round->servers, round->count, kNtpTimeoutMs, &round->samples);
   }
+  portENTER_CRITICAL(&gRoundMux);
+  round->finished = true;
+  portEXIT_CRITICAL(&gRoundMux);
+}
 
-  if (!success) {
-    setState("SYNC_FAILED", "Failed to sync with all NTP servers.");
-    return false;
+bool TimeService::roundFinished() const {
+  portENTER_CRITICAL(&gRoundMux);
+  const bool finished = _round->finished;
+  portEXIT_CRITICAL(&gRoundMux);
+  return finished;
+}
+
+void TimeService::finishRound() {
+  std::shared_ptr<SntpRound> round = _round;
+  _round.reset();
+
+  SntpSample best;
+  if (!SntpClient::selectBest(round->samples, &best)) {
+    // Try the next group of servers on the retry.
+    _serverIndex = (_serverIndex + round->count) % kAliyunNtpServerCount;
+    if (_synced) {
+      _nextSyncDueMs = millis() + kRetryIntervalSeconds * kMillisPerSecond;
+    }
+    setState("SYNC_FAILED", "No NTP server answered.");
+    return;
   }
 
-  const uint32_t nowSeconds = millis() / kMillisPerSecond;
-  _timeOffset = unixTime - nowSeconds;
-  _synced = true;
-  _lastSyncTime = unixTime;
+  const int64_t serverUs = SntpClient::localClockUs() + best.offsetUs;
+  const bool step = _discipline.addSample(serverUs, best.offsetUs, best.delayUs);
+  if (step || !slewClock(best.offsetUs)) {
+    stepClock(best.offsetUs);
+  }
+  if (_discipline.learned()) {
+    ClockDiscipline::save(_discipline.state());
+  }
 
-  struct timeval tv;
-  tv.tv_sec = static_cast<time_t>(unixTime);
-  tv.tv_usec = 0;
-  if (settimeofday(&tv, nullptr) != 0) {
-    Serial.println("[TimeService] Warning: failed to set system clock.");
+  const uint32_t now = millis();
+  _lastDriftSlewMs = now;
+  _nextSyncDueMs = now + _discipline.intervalSeconds() * kMillisPerSecond;
+  _lastOffsetMs = static_cast<int32_t>(best.offsetUs / 1000);
+  _synced = true;
+  _lastSyncTime = static_cast<uint32_t>(serverUs / kMicrosPerSecond);
+  // Start the next round from the server that won this one.
+  for (size_t i = 0; i < kAliyunNtpServerCount; ++i) {
+    if (best.server == kAliyunNtpServers[i]) {
+      _serverIndex = i;
+      break;
+    }
   }
 
-  char stateBuffer[64];
+  char stateBuffer[96];
   snprintf(stateBuffer,
            sizeof(stateBuffer),
-           "Time synced: %u (offset %d seconds)",
-           unixTime,
-           static_cast<int>(_timeOffset));
+           "Time %s via %s (offset %ld ms, delay %ld ms, %u/%u answered)",
+           step ? "stepped" : "slewed",
+           best.server.c_str(),
+           static_cast<long>(best.offsetUs / 1000),
+           static_cast<long>(best.delayUs / 1000),
+           static_cast<unsigned>(round->samples.size()),
+           static_cast<unsigned>(round->count));
   setState("SYNCED", stateBuffer);
-
-
-  time_t rawtime = static_cast<time_t>(unixTime);
-  struct tm* utcTimeInfo = gmtime(&rawtime);
-  struct tm* localTimeInfo = localtime(&rawtime);
-  if (utcTimeInfo != nullptr && localTimeInfo != nullptr) {
-    char utcBuffer[32];
-    char localBuffer[32];
-    strftime(utcBuffer, sizeof(utcBuffer), "%Y-%m-%d %H:%M:%S", utcTimeInfo);
-    strftime(localBuffer, sizeof(localBuffer), "%Y-%m-%d %H:%M:%S", localTimeInfo);
-  }
-
-  return true;
 }
 
 uint32_t TimeService::getUnixTime() const {
-  if (!_synced) {
+  if (!hasValidTime()) {
     return 0;
   }
 
-  const uint32_t nowSeconds = millis() / kMillisPerSecond;
-  return nowSeconds + _timeOffset;
+  return static_cast<uint32_t>(getUnixTimeMs() / kMillisPerSecond);
 }
 
 uint64_t TimeService::getUnixTimeMs() const {
-  if (!_synced) {
+  if (!hasValidTime()) {
     return 0;
   }
 
-  const uint64_t nowMs = millis();
-  const uint64_t nowSeconds = nowMs / kMillisPerSecond;
-  const uint64_t unixSeconds = nowSeconds + _timeOffset;
-  return unixSeconds * kMillisPerSecond + (nowMs % kMillisPerSecond);
+  return static_cast<uint64_t>(SntpClient::localClockUs() / 1000);
 }
 
 String TimeService::getFormattedTime() const {
-  if (!_synced) {
+  if (!hasValidTime()) {
     return "Not synced";
   }
 
@@ -182,91 +283,93 @@ void TimeService::setSyncInterval(uint32_t intervalSeconds) {
   if (intervalSeconds < kMinSyncIntervalSeconds) {
     intervalSeconds = kMinSyncIntervalSeconds;
   }
+  if (intervalSeconds > kMaxSyncIntervalSeconds) {
+    intervalSeconds = kMaxSyncIntervalSeconds;
+  }
 
   _syncIntervalSeconds = intervalSeconds;
+  _discipline.setIntervalBounds(kMinSyncIntervalSeconds, _syncIntervalSeconds);
   _nextSyncDueMs = 0;
 }
 
-bool TimeService::queryNtpServer(const char* server, uint32_t* unixTime) {
-  if (unixTime == nullptr) {
-    return false;
+String TimeService::getTimeSource() const {
+  if (_synced) {
+    return "NTP";
   }
+  return _hasCoarseTime ? "HTTP_DATE" : "NONE";
+}
 
-  WiFiUDP udp;
-  if (!udp.begin(0)) {
-    return false;
-  }
+uint32_t TimeService::getCoarseUncertaintyMs() const {
+  portENTER_CRITICAL(&gDateMux);
+  const uint32_t uncertaintyMs = _coarse.valid() ? _coarse.uncertaintyMs(millis()) : 0;
+  portEXIT_CRITICAL(&gDateMux);
+  return uncertaintyMs;
+}
 
-  uint8_t ntpPacket[48];
-  memset(ntpPacket, 0, sizeof(ntpPacket));
-  ntpPacket[0] = 0b00100011;  // LI=0, Version=4, Mode=3 (client)
+uint8_t TimeService::getCoarseSources() const {
+  portENTER_CRITICAL(&gDateMux);
+  const uint8_t sources = _coarse.sources();
+  portEXIT_CRITICAL(&gDateMux);
+  return sources;
+}
 
-  if (!udp.beginPacket(server, kNtpPort)) {
-    udp.stop();
-    return false;
+void TimeService::onHttpDate(const String& httpDate,
+                             uint32_t requestStartMs,
+                             uint32_t responseAtMs,
+                             void* context) {
+  time_t dateUnix = 0;
+  if (!SharedHttpClient::parseHttpDate(httpDate, &dateUnix)) {
+    return;
   }
+  TimeService* service = static_cast<TimeService*>(context);
+  portENTER_CRITICAL(&gDateMux);
+  service->_coarse.addSample(static_cast<int64_t>(dateUnix), requestStartMs, responseAtMs);
+  portEXIT_CRITICAL(&gDateMux);
+}
 
-  if (udp.write(ntpPacket, sizeof(ntpPacket)) != sizeof(ntpPacket)) {
-    udp.stop();
-    return false;
+void TimeService::applyHttpDate() {
+  const uint32_t now = millis();
+  portENTER_CRITICAL(&gDateMux);
+  _coarse.refresh(now);
+  const CoarseClock coarse = _coarse;
+  portEXIT_CRITICAL(&gDateMux);
+  // Once NTP has set the clock, Date headers have nothing to add.
+  if (_synced) {
+    return;
   }
-
-  if (!udp.endPacket()) {
-    udp.stop();
-    return false;
+  if (!coarse.valid()) {
+    return;
   }
 
-  const uint32_t startWait = millis();
-  while (millis() - startWait < kNtpTimeoutMs) {
-    const int packetSize = udp.parsePacket();
-    if (packetSize >= 48) {
-      uint8_t response[48];
-      udp.read(response, sizeof(response));
-      const uint32_t ntpTime = parseNtpPacket(response, sizeof(response));
-      if (ntpTime != 0) {
-        *unixTime = ntpTime;
-        udp.stop();
-        return true;
-      }
-    }
-    delay(10);
+  const int64_t systemMs = SntpClient::localClockUs() / 1000;
+  if (coarse.contains(systemMs, now)) {
+    _hasCoarseTime = true;
+    return;
   }
-
-  udp.stop();
-  return false;
-}
-
-uint32_t TimeService::ntpToUnix(uint32_t ntpSeconds, uint32_t ntpFraction) {
-  if (ntpSeconds < kNtpEpochOffset) {
-    return 0;
+  // A set clock is only stepped on the word of at least two servers.
+  if (coarse.sources() < 2 && systemMs >= kMinValidUnixMs) {
+    return;
   }
 
-  (void)ntpFraction;
-  return ntpSeconds - kNtpEpochOffset;
+  stepClock((coarse.unixMsAt(now) - systemMs) * 1000);
+  _hasCoarseTime = true;
+  char stateBuffer[96];
+  snprintf(stateBuffer,
+           sizeof(stateBuffer),
+           "Clock set from HTTP Date (within %u ms, %u sources); waiting for NTP.",
+           static_cast<unsigned>(coarse.uncertaintyMs(now)),
+           static_cast<unsigned>(coarse.sources()));
+  setState("COARSE", stateBuffer);
 }
 
-uint32_t TimeService::parseNtpPacket(const uint8_t* packet, size_t length) {
-  if (packet == nullptr || length < 48) {
-    return 0;
-  }
-
-  const uint8_t mode = packet[0] & 0x07;
-  if (mode != 4 && mode != 5) {
-    return 0;
+void TimeService::stepClock(int64_t offsetUs) {
+  if (!Hal::clock().setUnixTimeUs(SntpClient::localClockUs() + offsetUs)) {
+    Serial.println("[TimeService] Warning: failed to set system clock.");
   }
+}
 
-  const uint32_t ntpSeconds = (static_cast<uint32_t>(packet[40]) << 24) |
-                              (static_cast<uint32_t>(packet[41]) << 16) |
-                              (static_cast<uint32_t>(packet[42]) << 8) |
-                              static_cast<uint32_t>(packet[43]);
-
-  const uint32_t ntpFraction = (static_cast<uint32_t>(packet[44]) << 24) |
-                               (static_cast<uint32_t>(packet[45]) << 16) |
-                               (static_cast<uint32_t>(packet[46]) << 8) |
-                               static_cast<uint32_t>(packet[47]);
-
-  const uint32_t unixTime = ntpToUnix(ntpSeconds, ntpFraction);
-  return unixTime;
+bool TimeService::slewClock(int64_t offsetUs) {
+  return Hal::clock().slewUnixTimeUs(offsetUs);
 }
 
 void TimeService::setState(const String& state, const String& message) {
@@ -0,0 +1,314 @@
+#include "UdpPublicIpProbe.h"
+
+#include "DnsCache.h"
+#include "Hal.h"
+#include "NetworkAccounting.h"
+
+namespace {
+constexpr uint16_t kStunBindingRequest = 0x0001;
+constexpr uint16_t kStunBindingSuccess = 0x0101;
+constexpr uint16_t kStunAttrMappedAddress = 0x0001;
+constexpr uint16_t kStunAttrXorMappedAddress = 0x0020;
+constexpr uint8_t kStunFamilyIpv4 = 0x01;
+
+constexpr size_t kDnsHeaderSize = 12;
+constexpr uint16_t kDnsTypeA = 1;
+constexpr uint16_t kDnsClassIn = 1;
+constexpr size_t kMaxDnsLabelLength = 63;
+
+uint16_t readUint16(const uint8_t* data) {
+  return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+uint32_t readUint32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+void writeUint16(uint8_t* data, uint16_t value) {
+  data[0] = static_cast<uint8_t>(value >> 8);
+  data[1] = static_cast<uint8_t>(value & 0xFF);
+}
+
+void writeUint32(uint8_t* data, uint32_t value) {
+  writeUint16(data, static_cast<uint16_t>(value >> 16));
+  writeUint16(data + 2, static_cast<uint16_t>(value & 0xFFFF));
+}
+
+String formatIpv4(uint32_t address) {
+  return String((address >> 24) & 0xFF) + "." + String((address >> 16) & 0xFF) + "." +
+         String((address >> 8) & 0xFF) + "." + String(address & 0xFF);
+}
+
+// Returns the offset just past a (possibly compressed) DNS name, or 0 when malformed.
+size_t skipDnsName(const uint8_t* packet, size_t length, size_t offset) {
+  while (offset < length) {
+    const uint8_t labelLength = packet[offset];
+    if (labelLength == 0) {
+      return offset + 1;
+    }
+    if ((labelLength & 0xC0) == 0xC0) {
+      return offset + 2 <= length ? offset + 2 : 0;
+    }
+    offset += 1 + labelLength;
+  }
+  return 0;
+}
+}  // namespace
+
+bool UdpPublicIpProbe::queryStun(const String& host,
+                                 uint16_t port,
+                                 uint32_t timeoutMs,
+                                 String* ipv4) {
+  if (ipv4 == nullptr || host.isEmpty() || timeoutMs == 0) {
+    return false;
+  }
+
+  uint8_t transactionId[kStunTransactionIdSize];
+  for (size_t i = 0; i < kStunTransactionIdSize; i += 4) {
+    writeUint32(transactionId + i, esp_random());
+  }
+
+  uint8_t request[kStunHeaderSize];
+  const size_t requestLength = buildStunRequest(transactionId, request, sizeof(request));
+  return exchange(host, port, request, requestLength, timeoutMs,
+                  [&transactionId, ipv4](const uint8_t* packet, size_t length) {
+                    return parseStunResponse(packet, length, transactionId, ipv4);
+                  });
+}
+
+bool UdpPublicIpProbe::queryDnsEcho(const String& server,
+                                    uint16_t port,
+                                    const String& name,
+                                    uint32_t timeoutMs,
+                                    String* ipv4) {
+  if (ipv4 == nullptr || server.isEmpty() || name.isEmpty() || timeoutMs == 0) {
+    return false;
+  }
+
+  const uint16_t id = static_cast<uint16_t>(esp_random() & 0xFFFF);
+  uint8_t request[kMaxDatagramSize];
+  const size_t requestLength = buildDnsQuery(id, name, request, sizeof(request));
+  if (requestLength == 0) {
+    return false;
+  }
+  return exchange(server, port, request, requestLength, timeoutMs,
+                  [id, ipv4](const uint8_t* packet, size_t length) {
+                    return parseDnsResponse(packet, length, id, ipv4);
+                  });
+}
+
+size_t UdpPublicIpProbe::buildStunRequest(const uint8_t* transactionId,
+                                          uint8_t* packet,
+                                          size_t capacity) {
+  if (transactionId == nullptr || packet == nullptr || capacity < kStunHeaderSize) {
+    return 0;
+  }
+
+  writeUint16(packet, kStunBindingRequest);
+  writeUint16(packet + 2, 0);
+  writeUint32(packet + 4, kStunMagicCookie);
+  memcpy(packet + 8, transactionId, kStunTransactionIdSize);
+  return kStunHeaderSize;
+}
+
+bool UdpPublicIpProbe::parseStunResponse(const uint8_t* packet,
+                                         size_t length,
+                                         const uint8_t* transactionId,
+                                         String* ipv4) {
+  if (packet == nullptr || transactionId == nullptr || ipv4 == nullptr ||
+      length < kStunHeaderSize) {
+    return false;
+  }
+  if (readUint16(packet) != kStunBindingSuccess || readUint32(packet + 4) != kStunMagicCookie ||
+      memcmp(packet + 8, transactionId, kStunTransactionIdSize) != 0) {
+    return false;
+  }
+
+  const size_t messageEnd = kStunHeaderSize + readUint16(packet + 2);
+  if (messageEnd > length) {
+    return false;
+  }
+
+  // XOR-MAPPED-ADDRESS is preferred; some servers only send the legacy MAPPED-ADDRESS.
+  bool haveMapped = false;
+  uint32_t mappedAddress = 0;
+  size_t offset = kStunHeaderSize;
+  while (offset + 4 <= messageEnd) {
+    const uint16_t type = readUint16(packet + offset);
+    const uint16_t attributeLength = readUint16(packet + offset + 2);
+    const uint8_t* value = packet + offset + 4;
+    if (offset + 4 + attributeLength > messageEnd) {
+      return false;
+    }
+
+    const bool isAddress = attributeLength >= 8 && value[1] == kStunFamilyIpv4;
+    if (isAddress && type == kStunAttrXorMappedAddress) {
+      *ipv4 = formatIpv4(readUint32(value + 4) ^ kStunMagicCookie);
+      return true;
+    }
+    if (isAddress && type == kStunAttrMappedAddress) {
+      haveMapped = true;
+      mappedAddress = readUint32(value + 4);
+    }
+
+    // Attributes are padded to a multiple of four bytes.
+    offset += 4 + ((attributeLength + 3) & ~static_cast<size_t>(3));
+  }
+
+  if (!haveMapped) {
+    return false;
+  }
+  *ipv4 = formatIpv4(mappedAddress);
+  return true;
+}
+
+size_t UdpPublicIpProbe::buildDnsQuery(uint16_t id,
+                                       const String& name,
+                                       uint8_t* packet,
+                                       size_t capacity) {
+  // Header + encoded name (one byte longer than the dotted form, plus the root) + QTYPE/QCLASS.
+  if (packet == nullptr || name.isEmpty() || kDnsHeaderSize + name.length() + 2 + 4 > capacity) {
+    return 0;
+  }
+
+  memset(packet, 0, kDnsHeaderSize);
+  writeUint16(packet, id);
+  packet[2] = 0x01;  // RD: let a forwarding resolver recurse if needed.
+  writeUint16(packet + 4, 1);
+
+  size_t offset = kDnsHeaderSize;
+  int labelStart = 0;
+  while (labelStart <= static_cast<int>(name.length())) {
+    int labelEnd = name.indexOf('.', labelStart);
+    if (labelEnd == -1) {
+      labelEnd = name.length();
+    }
+    const size_t labelLength = static_cast<size_t>(labelEnd - labelStart);
+    if (labelLength == 0 || labelLength > kMaxDnsLabelLength) {
+      return 0;
+    }
+    packet[offset++] = static_cast<uint8_t>(labelLength);
+    memcpy(packet + offset, name.c_str() + labelStart, labelLength);
+    offset += labelLength;
+    labelStart = labelEnd + 1;
+  }
+  packet[offset++] = 0;
+
+  writeUint16(packet + offset, kDnsTypeA);
+  writeUint16(packet + offset + 2, kDnsClassIn);
+  return offset + 4;
+}
+
+bool UdpPublicIpProbe::parseDnsResponse(const uint8_t* packet,
+                                        size_t length,
+                                        uint16_t id,
+                                        String* ipv4) {
+  if (packet == nullptr || ipv4 == nullptr || length < kDnsHeaderSize) {
+    return false;
+  }
+
+  const bool isResponse = (packet[2] & 0x80) != 0;
+  const uint8_t responseCode = packet[3] & 0x0F;
+  if (readUint16(packet) != id || !isResponse || responseCode != 0) {
+    return false;
+  }
+
+  const uint16_t questionCount = readUint16(packet + 4);
+  const uint16_t answerCount = readUint16(packet + 6);
+  size_t offset = kDnsHeaderSize;
+  for (uint16_t i = 0; i < questionCount; ++i) {
+    offset = skipDnsName(packet, length, offset);
+    if (offset == 0 || offset + 4 > length) {
+      return false;
+    }
+    offset += 4;
+  }
+
+  for (uint16_t i = 0; i < answerCount; ++i) {
+    offset = skipDnsName(packet, length, offset);
+    if (offset == 0 || offset + 10 > length) {
+      return false;
+    }
+    const uint16_t type = readUint16(packet + offset);
+    const uint16_t recordClass = readUint16(packet + offset + 2);
+    const uint16_t dataLength = readUint16(packet + offset + 8);
+    offset += 10;
+    if (offset + dataLength > length) {
+      return false;
+    }
+    if (type == kDnsTypeA && recordClass == kDnsClassIn && dataLength == 4) {
+      *ipv4 = formatIpv4(readUint32(packet + offset));
+      return true;
+    }
+    offset += dataLength;
+  }
+  return false;
+}
+
+bool UdpPublicIpProbe::exchange(const String& host,
+                                uint16_t port,
+                                const uint8_t* request,
+                                size_t requestLength,
+                                uint32_t timeoutMs,
+                                const ResponseParser& parse,
+                                bool anyPeer) {
+  if (request == nullptr || requestLength == 0) {
+    return false;
+  }
+
+  const uint32_t startMs = millis();
+  IPAddress address;
+  if (!DnsCache::resolve(host, &address, timeoutMs)) {
+    NetworkAccounting::addFailure();
+    return false;
+  }
+
+  UdpSocket udp;
+  if (!udp.begin(0)) {
+    NetworkAccounting::addFailure();
+    return false;
+  }
+
+  uint32_t bytesOut = 0;
+  uint32_t bytesIn = 0;
+  uint32_t lastSendMs = 0;
+  bool sentOnce = false;
+  bool answered = false;
+  uint8_t response[kMaxDatagramSize];
+  while (millis() - startMs < timeoutMs) {
+    if (!sentOnce || millis() - lastSendMs >= kRetransmitMs) {
+      if (!udp.beginPacket(address, port) || udp.write(request, requestLength) != requestLength ||
+          !udp.endPacket()) {
+        break;
+      }
+      bytesOut += requestLength;
+      lastSendMs = millis();
+      sentOnce = true;
+    }
+
+    const int packetSize = udp.parsePacket();
+    if (packetSize > 0) {
+      const int readLength = udp.read(response, sizeof(response));
+      if (readLength > 0) {
+        bytesIn += static_cast<uint32_t>(readLength);
+      }
+      // Anything that does not parse (late answers to an earlier probe, noise) is ignored.
+      const bool fromPeer = anyPeer || (udp.remoteIP() == address && udp.remotePort() == port);
+      if (readLength > 0 && fromPeer && parse(response, static_cast<size_t>(readLength))) {
+        answered = true;
+        break;
+      }
+      continue;
+    }
+    delay(kPollMs);
+  }
+  udp.stop();
+
+  NetworkAccounting::addTransfer(bytesIn, bytesOut);
+  NetworkAccounting::addBlockedMs(millis() - startMs);
+  if (!answered) {
+    NetworkAccounting::addFailure();
+  }
+  return answered;
+}
@@ -1,9 +1,11 @@
 #include "WakeOnLanService.h"
 
-#include <WiFiUdp.h>
 #include <cctype>
 #include <cstring>
 
+#include "Hal.h"
+#include "NetworkAccounting.h"
+
 namespace {
 bool isHexChar(char c) {
   return std::isxdigit(static_cast<unsigned char>(c)) != 0;
@@ -40,8 +42,10 @@ bool WakeOnLanService::sendMagicPacket(const String& macAddress,
     std::memcpy(packet + (i * 6), mac, 6);
   }
 
-  WiFiUDP udp;
+  NetworkAccounting::Scope accountingScope(NetSubsystem::WakeOnLan);
+  UdpSocket udp;
   if (!udp.beginPacket(broadcastIp, port)) {
+    NetworkAccounting::addFailure();
     if (errorCode != nullptr) {
       *errorCode = "udp_begin_failed";
     }
@@ -49,8 +53,10 @@ bool WakeOnLanService::sendMagicPacket(const String& macAddress,
   }
 
   const size_t written = udp.write(packet, sizeof(packet));
-  const bool sent = udp.endPacket() == 1;
+  const bool sent = udp.endPacket();
+  NetworkAccounting::addTransfer(0, written);
   if (!sent || written != sizeof(packet)) {
+    NetworkAccounting::addFailure();
     if (errorCode != nullptr) {
       *errorCode = "wol_send_failed";
     }
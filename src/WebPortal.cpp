@@ -1,11 +1,20 @@
 #include "WebPortal.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <cstdio>
 #include <vector>
 #include <ESP.h>
+#include "AliyunApiGateway.h"
+#include "AliyunCircuitBreaker.h"
+#include "AsyncHttpClient.h"
+#include "DnsCache.h"
+#include "NetworkAccounting.h"
+#include "GatewayIpProbe.h"
+#include "PublicIpObserver.h"
 #include "PublicIpService.h"
+#include "SharedHttpClient.h"
 
 namespace {
 constexpr const char* kProviderId = "aliyun";
@@ -15,6 +24,27 @@ constexpr uint32_t kMinDdnsIntervalSeconds = 30;
 constexpr uint32_t kMaxDdnsIntervalSeconds = 86400;
 // Web handlers run in AsyncTCP context; keep resolve timeout short to avoid long blocking.
 constexpr uint32_t kAliyunResolveTimeoutMs = 1000;
+// Records per /api/ddns/status or /api/ddns/history page unless the caller asks otherwise.
+constexpr size_t kDdnsStatusPageSize = 16;
+
+// Every portal response goes through these so web traffic shows up in network accounting.
+void sendTracked(AsyncWebServerRequest* request, AsyncWebServerResponse* response,
+                 size_t contentBytes = 0) {
+  NetworkAccounting::addTransferTo(NetSubsystem::WebPortal,
+                                   request->url().length() + request->contentLength(),
+                                   contentBytes);
+  request->send(response);
+}
+
+void sendTracked(AsyncWebServerRequest* request,
+                 int code,
+                 const String& contentType,
+                 const String& content) {
+  NetworkAccounting::addTransferTo(NetSubsystem::WebPortal,
+                                   request->url().length() + request->contentLength(),
+                                   content.length());
+  request->send(code, contentType, content);
+}
 
 bool normalizeMacAddress(const String& source, String* normalized) {
   if (normalized == nullptr) {
@@ -197,6 +227,15 @@ String buildAliyunApiError(const String& errorCode, const String& apiResponse) {
   return "aliyun_api_failed";
 }
 
+int aliyunFailureStatusCode(const AliyunDdnsClient& client) {
+  // Short-circuited or throttled calls are retryable; tell the UI to back off.
+  const String& code = client.getLastErrorCode();
+  if (code == "circuit_open" || code.startsWith("Throttling")) {
+    return 503;
+  }
+  return 500;
+}
+
 bool resolveAliyunRecordValue(String* value,
                               const DdnsRecordConfig& configRecord) {
   if (value == nullptr) {
@@ -207,7 +246,7 @@ bool resolveAliyunRecordValue(String* value,
     return true;
   }
 
-  *value = PublicIpService::resolve(configRecord.useLocalIp, kAliyunResolveTimeoutMs);
+  *value = PublicIpObserver::resolve(configRecord.useLocalIp, kAliyunResolveTimeoutMs);
   value->trim();
   return !value->isEmpty();
 }
@@ -501,6 +540,34 @@ AliyunDdnsListResult fetchAliyunDdnsList(const DdnsConfig& ddnsConfig) {
   return result;
 }
 
+// Record page of the DDNS status and history endpoints.
+void parseDdnsPageParams(AsyncWebServerRequest* request, size_t* offset, size_t* limit) {
+  *offset = 0;
+  *limit = kDdnsStatusPageSize;
+  if (request->hasParam("offset")) {
+    parseIndexParam(request->getParam("offset")->value(), offset);
+  }
+  if (request->hasParam("limit") && parseIndexParam(request->getParam("limit")->value(), limit)) {
+    *limit = std::max<size_t>(1, std::min(*limit, ConfigStore::kMaxDdnsRecords));
+  }
+}
+
+String latencyJson(const DdnsLatency& latency) {
+  return "{\"p50\":" + String(latency.p50) + ",\"p95\":" + String(latency.p95) + "}";
+}
+
+String syncSummaryJson(const DdnsSyncSummary& summary) {
+  String json = "{";
+  json += "\"attempts\":" + String(summary.attempts) + ",";
+  json += "\"failures\":" + String(summary.failures) + ",";
+  json += "\"resolveMs\":" + latencyJson(summary.resolveMs) + ",";
+  json += "\"apiMs\":" + latencyJson(summary.apiMs) + ",";
+  json += "\"totalMs\":" + latencyJson(summary.totalMs) + ",";
+  json += "\"changeToUpdateMs\":" + latencyJson(summary.changeToUpdateMs);
+  json += "}";
+  return json;
+}
+
 }  // namespace
 
 WebPortal::WebPortal(uint16_t port,
@@ -533,17 +600,20 @@ void WebPortal::registerRoutes() {
       return;
     }
     const char* page = dashboardPage();
-    request->send(request->beginResponse(200,
-                                         "text/html; charset=utf-8",
-                                         reinterpret_cast<const uint8_t*>(page),
-                                         std::strlen(page)));
+    const size_t pageLength = std::strlen(page);
+    sendTracked(request,
+                request->beginResponse(200,
+                                       "text/html; charset=utf-8",
+                                       reinterpret_cast<const uint8_t*>(page),
+                                       pageLength),
+                pageLength);
   });
 
   _server.on("/login", HTTP_GET, [this](AsyncWebServerRequest* request) {
     if (_authService.isAuthorized(request)) {
       AsyncWebServerResponse* response = request->beginResponse(302);
       response->addHeader("Location", "/");
-      request->send(response);
+      sendTracked(request, response);
       return;
     }
     String message = "";
@@ -553,7 +623,7 @@ void WebPortal::registerRoutes() {
         message = "固件升级成功，请重新登录";
       }
     }
-    request->send(200, "text/html; charset=utf-8", loginPage(message));
+    sendTracked(request, 200, "text/html; charset=utf-8", loginPage(message));
   });
 
   _server.on("/login", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -570,11 +640,11 @@ void WebPortal::registerRoutes() {
                           "ESPSESSION=" + token +
                               "; Path=/; HttpOnly; SameSite=Lax; Max-Age=" +
                               String(_authService.sessionTtlSeconds()));
-      request->send(response);
+      sendTracked(request, response);
       return;
     }
 
-    request->send(401, "text/html; charset=utf-8", loginPage("用户名或密码错误"));
+    sendTracked(request, 401, "text/html; charset=utf-8", loginPage("用户名或密码错误"));
   });
 
   _server.on("/logout", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -582,7 +652,7 @@ void WebPortal::registerRoutes() {
     AsyncWebServerResponse* response = request->beginResponse(302);
     response->addHeader("Location", "/login");
     response->addHeader("Set-Cookie", "ESPSESSION=deleted; Path=/; Max-Age=0");
-    request->send(response);
+    sendTracked(request, response);
   });
 
   _server.on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -659,6 +729,11 @@ void WebPortal::registerRoutes() {
     body += "\"otaAutoCheckIntervalMinutes\":" +
             String(systemConfig.otaAutoCheckIntervalMinutes) + ",";
     body += "\"ddnsEnabled\":" + String(ddnsConfig.enabled ? "true" : "false") + ",";
+    body += "\"ddnsAdaptiveInterval\":" + String(ddnsConfig.adaptiveInterval ? "true" : "false") + ",";
+    body += "\"ddnsAdaptiveMinSeconds\":" + String(ddnsConfig.adaptiveMinSeconds) + ",";
+    body += "\"ddnsAdaptiveMaxSeconds\":" + String(ddnsConfig.adaptiveMaxSeconds) + ",";
+    body += "\"ddnsLanCoordination\":" + String(ddnsConfig.lanCoordination ? "true" : "false") + ",";
+    body += "\"ddnsMaxRecords\":" + String(static_cast<uint32_t>(ConfigStore::kMaxDdnsRecords)) + ",";
     body += "\"ddnsState\":\"" + jsonEscape(ddnsStatus.state) + "\",";
     body += "\"ddnsMessage\":\"" + jsonEscape(ddnsStatus.message) + "\",";
     body += "\"ddnsActiveRecordCount\":" + String(ddnsStatus.activeRecordCount) + ",";
@@ -669,7 +744,7 @@ void WebPortal::registerRoutes() {
     body += "\"ddnsAliyunDescribeResponses\":" + aliyunList.responsesJson;
     body += "}";
 
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/config", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -690,7 +765,7 @@ void WebPortal::registerRoutes() {
     if (request->hasParam("computerMac", true)) {
       String normalizedMac;
       if (!normalizeMacAddress(request->getParam("computerMac", true)->value(), &normalizedMac)) {
-        request->send(400, "application/json", "{\"success\":false,\"error\":\"invalid_mac\"}");
+        sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"invalid_mac\"}");
         return;
       }
       config.mac = normalizedMac;
@@ -741,6 +816,26 @@ void WebPortal::registerRoutes() {
     if (request->hasParam("ddnsEnabled", true)) {
       ddnsConfig.enabled = parseBoolValue(request->getParam("ddnsEnabled", true)->value(), false);
     }
+    if (request->hasParam("ddnsAdaptiveInterval", true)) {
+      ddnsConfig.adaptiveInterval =
+          parseBoolValue(request->getParam("ddnsAdaptiveInterval", true)->value(), false);
+    }
+    if (request->hasParam("ddnsAdaptiveMinSeconds", true)) {
+      const int parsedSeconds = request->getParam("ddnsAdaptiveMinSeconds", true)->value().toInt();
+      if (parsedSeconds > 0) {
+        ddnsConfig.adaptiveMinSeconds = static_cast<uint32_t>(parsedSeconds);
+      }
+    }
+    if (request->hasParam("ddnsAdaptiveMaxSeconds", true)) {
+      const int parsedSeconds = request->getParam("ddnsAdaptiveMaxSeconds", true)->value().toInt();
+      if (parsedSeconds > 0) {
+        ddnsConfig.adaptiveMaxSeconds = static_cast<uint32_t>(parsedSeconds);
+      }
+    }
+    if (request->hasParam("ddnsLanCoordination", true)) {
+      ddnsConfig.lanCoordination =
+          parseBoolValue(request->getParam("ddnsLanCoordination", true)->value(), false);
+    }
     if (request->hasParam("ddnsRecordCount", true)) {
       const int parsedRecordCount = request->getParam("ddnsRecordCount", true)->value().toInt();
       size_t recordCount = 0;
@@ -850,7 +945,7 @@ void WebPortal::registerRoutes() {
     const bool systemSaved = _configStore.saveSystemConfig(systemConfig);
     const bool ddnsSaved = _configStore.saveDdnsConfig(ddnsConfig);
     if (!computerSaved || !bemfaSaved || !systemSaved || !ddnsSaved) {
-      request->send(500, "application/json", "{\"success\":false,\"error\":\"save_failed\"}");
+      sendTracked(request, 500, "application/json", "{\"success\":false,\"error\":\"save_failed\"}");
       return;
     }
 
@@ -859,7 +954,7 @@ void WebPortal::registerRoutes() {
     _firmwareUpgradeService.updateConfig(bemfaConfig);
     _firmwareUpgradeService.updateAutoCheckConfig(false,
                                                   systemConfig.otaAutoCheckIntervalMinutes);
-    request->send(200, "application/json", "{\"success\":true}");
+    sendTracked(request, 200, "application/json", "{\"success\":true}");
   });
 
   _server.on("/api/wifi/scan", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -891,7 +986,7 @@ void WebPortal::registerRoutes() {
     body += "\"ip\":\"" + jsonEscape(_wifiService.ipAddress()) + "\"";
     body += "}";
 
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/wifi/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -907,7 +1002,7 @@ void WebPortal::registerRoutes() {
     body += "\"ip\":\"" + jsonEscape(_wifiService.ipAddress()) + "\"";
     body += "}";
 
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/wifi/connect", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -921,7 +1016,7 @@ void WebPortal::registerRoutes() {
         request->hasParam("password", true) ? request->getParam("password", true)->value() : "";
 
     if (ssid.isEmpty()) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"ssid_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"ssid_required\"}");
       return;
     }
 
@@ -935,7 +1030,7 @@ void WebPortal::registerRoutes() {
     body += "}";
 
     const int statusCode = accepted ? (_wifiService.isConnected() ? 200 : 202) : 409;
-    request->send(statusCode, "application/json", body);
+    sendTracked(request, statusCode, "application/json", body);
   });
 
   _server.on("/api/power/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -950,7 +1045,7 @@ void WebPortal::registerRoutes() {
     body += "\"error\":\"" + jsonEscape(status.errorCode) + "\",";
     body += "\"busy\":" + String(status.busy ? "true" : "false");
     body += "}";
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/bemfa/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -976,7 +1071,7 @@ void WebPortal::registerRoutes() {
     body += "\"lastPublishAtMs\":" + String(status.lastPublishAtMs);
     body += "}";
 
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/ddns/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -984,8 +1079,14 @@ void WebPortal::registerRoutes() {
       return;
     }
 
+    size_t offset = 0;
+    size_t limit = 0;
+    parseDdnsPageParams(request, &offset, &limit);
+
     const DdnsRuntimeStatus status = _ddnsService.getStatus();
-    const std::vector<DdnsRecordRuntimeStatus> records = _ddnsService.getRecordStatuses();
+    size_t recordTotal = 0;
+    const std::vector<DdnsRecordRuntimeStatus> records =
+        _ddnsService.getRecordStatuses(offset, limit, &recordTotal);
     String body = "{";
     body += "\"enabled\":" + String(status.enabled ? "true" : "false") + ",";
     body += "\"configured\":" + String(status.configured ? "true" : "false") + ",";
@@ -994,6 +1095,18 @@ void WebPortal::registerRoutes() {
     body += "\"message\":\"" + jsonEscape(status.message) + "\",";
     body += "\"activeRecordCount\":" + String(status.activeRecordCount) + ",";
     body += "\"totalUpdateCount\":" + String(status.totalUpdateCount) + ",";
+    body += "\"adaptiveInterval\":" + String(status.adaptiveInterval ? "true" : "false") + ",";
+    body += "\"ipChangeCount\":" + String(status.ipChangeCount) + ",";
+    body += "\"lastIpChangeAt\":" + String(status.lastIpChangeAt) + ",";
+    body += "\"typicalIpChangeGapSeconds\":" + String(status.typicalIpChangeGapSeconds) + ",";
+    body += "\"eventSyncCount\":" + String(status.eventSyncCount) + ",";
+    body += "\"lanCoordination\":" + String(status.lanCoordination ? "true" : "false") + ",";
+    body += "\"lanRole\":\"" + jsonEscape(status.lanRole) + "\",";
+    body += "\"lanLeaderIp\":\"" + jsonEscape(status.lanLeaderIp) + "\",";
+    body += "\"lanPeerCount\":" + String(status.lanPeerCount) + ",";
+    body += "\"recordTotal\":" + String(static_cast<uint32_t>(recordTotal)) + ",";
+    body += "\"recordOffset\":" + String(static_cast<uint32_t>(offset)) + ",";
+    body += "\"recordLimit\":" + String(static_cast<uint32_t>(limit)) + ",";
     body += "\"records\":[";
     for (size_t index = 0; index < records.size(); ++index) {
       const DdnsRecordRuntimeStatus& record = records[index];
@@ -1006,6 +1119,7 @@ void WebPortal::registerRoutes() {
       }
       const String recordType = "A";
       body += "{";
+      body += "\"index\":" + String(static_cast<uint32_t>(offset + index)) + ",";
       body += "\"enabled\":" + String(record.enabled ? "true" : "false") + ",";
       body += "\"configured\":" + String(record.configured ? "true" : "false") + ",";
       body += "\"provider\":\"" + jsonEscape(record.provider) + "\",";
@@ -1016,22 +1130,106 @@ void WebPortal::registerRoutes() {
       body += "\"username\":\"" + jsonEscape(record.username) + "\",";
       body += "\"ttl\":" + String(record.updateIntervalSeconds) + ",";
       body += "\"updateIntervalSeconds\":" + String(record.updateIntervalSeconds) + ",";
+      body += "\"checkIntervalSeconds\":" + String(record.checkIntervalSeconds) + ",";
       body += "\"useLocalIp\":" + String(record.useLocalIp ? "true" : "false") + ",";
       body += "\"state\":\"" + jsonEscape(record.state) + "\",";
       body += "\"message\":\"" + jsonEscape(record.message) + "\",";
       body += "\"lastOldIp\":\"" + jsonEscape(record.lastOldIp) + "\",";
       body += "\"lastNewIp\":\"" + jsonEscape(record.lastNewIp) + "\",";
       body += "\"updateCount\":" + String(record.updateCount) + ",";
+      body += "\"lastUpdateAt\":" + String(record.lastUpdateAt) + ",";
       body += "\"lastUpdateAtMs\":" + String(record.lastUpdateAtMs);
       body += "}";
       if (index + 1 < records.size()) {
         body += ",";
       }
     }
-    body += "]";
+    body += "],";
+
+    const std::vector<AliyunBreakerStatus> breakers = AliyunCircuitBreaker::getStatuses(millis());
+    body += "\"breakers\":[";
+    for (size_t index = 0; index < breakers.size(); ++index) {
+      const AliyunBreakerStatus& breaker = breakers[index];
+      body += "{";
+      body += "\"accessKeyId\":\"" + jsonEscape(breaker.accessKeyId) + "\",";
+      body += "\"state\":\"" + jsonEscape(breaker.state) + "\",";
+      body += "\"lastErrorCode\":\"" + jsonEscape(breaker.lastErrorCode) + "\",";
+      body += "\"lastErrorClass\":\"" + jsonEscape(breaker.lastErrorClass) + "\",";
+      body += "\"consecutiveFailures\":" + String(breaker.consecutiveFailures) + ",";
+      body += "\"openCount\":" + String(breaker.openCount) + ",";
+      body += "\"shortCircuitCount\":" + String(breaker.shortCircuitCount) + ",";
+      body += "\"retryInMs\":" + String(breaker.retryInMs) + ",";
+      body += "\"lastFailureAtMs\":" + String(breaker.lastFailureAtMs);
+      body += "}";
+      if (index + 1 < breakers.size()) {
+        body += ",";
+      }
+    }
+    body += "],";
+
+    const AliyunGatewayStats gateway = AliyunApiGateway::getStats();
+    body += "\"gateway\":{";
+    body += "\"networkCalls\":" + String(gateway.networkCalls) + ",";
+    body += "\"cacheHits\":" + String(gateway.cacheHits) + ",";
+    body += "\"coalescedCalls\":" + String(gateway.coalescedCalls) + ",";
+    body += "\"invalidations\":" + String(gateway.invalidations);
+    body += "}";
     body += "}";
 
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
+  });
+
+  _server.on("/api/ddns/history", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (!ensureAuthorized(request, true)) {
+      return;
+    }
+
+    size_t offset = 0;
+    size_t limit = 0;
+    parseDdnsPageParams(request, &offset, &limit);
+
+    size_t recordTotal = 0;
+    DdnsSyncSummary overall;
+    const std::vector<DdnsRecordSyncHistory> records =
+        _ddnsService.getSyncHistory(offset, limit, &recordTotal, &overall);
+    String body = "{";
+    body += "\"capacity\":" + String(static_cast<uint32_t>(DdnsSyncHistory::kCapacity)) + ",";
+    body += "\"summary\":" + syncSummaryJson(overall) + ",";
+    body += "\"recordTotal\":" + String(static_cast<uint32_t>(recordTotal)) + ",";
+    body += "\"recordOffset\":" + String(static_cast<uint32_t>(offset)) + ",";
+    body += "\"recordLimit\":" + String(static_cast<uint32_t>(limit)) + ",";
+    body += "\"records\":[";
+    for (size_t index = 0; index < records.size(); ++index) {
+      const DdnsRecordSyncHistory& record = records[index];
+      body += "{";
+      body += "\"index\":" + String(static_cast<uint32_t>(offset + index)) + ",";
+      body += "\"domain\":\"" + jsonEscape(record.domain) + "\",";
+      body += "\"summary\":" + syncSummaryJson(record.summary) + ",";
+      body += "\"attempts\":[";
+      for (size_t attemptIndex = 0; attemptIndex < record.attempts.size(); ++attemptIndex) {
+        const DdnsSyncAttempt& attempt = record.attempts[attemptIndex];
+        body += "{";
+        body += "\"atMs\":" + String(attempt.atMs) + ",";
+        body += "\"at\":" + String(attempt.at) + ",";
+        body += "\"outcome\":\"" + String(DdnsSyncHistory::outcomeName(attempt.outcome)) + "\",";
+        body += "\"errorCode\":\"" + jsonEscape(attempt.errorCode) + "\",";
+        body += "\"resolveMs\":" + String(attempt.resolveMs) + ",";
+        body += "\"apiMs\":" + String(attempt.apiMs) + ",";
+        body += "\"totalMs\":" + String(attempt.totalMs) + ",";
+        body += "\"changeToUpdateMs\":" + String(attempt.changeToUpdateMs);
+        body += "}";
+        if (attemptIndex + 1 < record.attempts.size()) {
+          body += ",";
+        }
+      }
+      body += "]}";
+      if (index + 1 < records.size()) {
+        body += ",";
+      }
+    }
+    body += "]}";
+
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/ddns/aliyun/records", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -1040,13 +1238,13 @@ void WebPortal::registerRoutes() {
     }
 
     if (!request->hasParam("configIndex")) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
       return;
     }
 
     size_t configIndex = 0;
     if (!parseIndexParam(request->getParam("configIndex")->value(), &configIndex)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
       return;
     }
 
@@ -1054,7 +1252,7 @@ void WebPortal::registerRoutes() {
     DdnsRecordConfig configRecord;
     String rootDomain;
     if (!resolveAliyunRequestConfig(request, ddnsConfig, configIndex, &configRecord, &rootDomain)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
       return;
     }
 
@@ -1062,9 +1260,10 @@ void WebPortal::registerRoutes() {
     client.begin(configRecord.username, configRecord.password, rootDomain, "@");
     if (!client.describeDomainRecords(rootDomain)) {
       const String errorMessage = buildAliyunApiError("describe_failed", client.getLastApiResponse());
-      request->send(500,
-                    "application/json",
-                    "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) + "\"}");
+      sendTracked(request, aliyunFailureStatusCode(client),
+                           "application/json",
+                           "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) +
+                               "\",\"code\":\"" + jsonEscape(client.getLastErrorCode()) + "\"}");
       return;
     }
 
@@ -1075,7 +1274,7 @@ void WebPortal::registerRoutes() {
     body += "\"rootDomain\":\"" + jsonEscape(rootDomain) + "\",";
     body += "\"records\":" + extractAliyunRecordArray(response);
     body += "}";
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/ddns/aliyun/add", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -1084,13 +1283,13 @@ void WebPortal::registerRoutes() {
     }
 
     if (!request->hasParam("configIndex", true)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
       return;
     }
 
     size_t configIndex = 0;
     if (!parseIndexParam(request->getParam("configIndex", true)->value(), &configIndex)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
       return;
     }
 
@@ -1098,7 +1297,7 @@ void WebPortal::registerRoutes() {
     DdnsRecordConfig configRecord;
     String rootDomain;
     if (!resolveAliyunRequestConfig(request, ddnsConfig, configIndex, &configRecord, &rootDomain)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
       return;
     }
 
@@ -1113,7 +1312,7 @@ void WebPortal::registerRoutes() {
     const String type = normalizeAliyunRecordType(requestedType);
     String value = request->hasParam("value", true) ? request->getParam("value", true)->value() : "";
     if (!resolveAliyunRecordValue(&value, configRecord)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"value_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"value_required\"}");
       return;
     }
 
@@ -1121,9 +1320,10 @@ void WebPortal::registerRoutes() {
     client.begin(configRecord.username, configRecord.password, rootDomain, "@");
     if (!client.addDomainRecord(rootDomain, rr, type, value)) {
       const String errorMessage = buildAliyunApiError("add_failed", client.getLastApiResponse());
-      request->send(500,
-                    "application/json",
-                    "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) + "\"}");
+      sendTracked(request, aliyunFailureStatusCode(client),
+                           "application/json",
+                           "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) +
+                               "\",\"code\":\"" + jsonEscape(client.getLastErrorCode()) + "\"}");
       return;
     }
 
@@ -1133,7 +1333,7 @@ void WebPortal::registerRoutes() {
     body += "\"rootDomain\":\"" + jsonEscape(rootDomain) + "\",";
     body += "\"recordId\":\"" + jsonEscape(client.getLastCreatedRecordId()) + "\"";
     body += "}";
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/ddns/aliyun/update", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -1142,13 +1342,13 @@ void WebPortal::registerRoutes() {
     }
 
     if (!request->hasParam("configIndex", true)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
       return;
     }
 
     size_t configIndex = 0;
     if (!parseIndexParam(request->getParam("configIndex", true)->value(), &configIndex)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
       return;
     }
 
@@ -1156,7 +1356,7 @@ void WebPortal::registerRoutes() {
     DdnsRecordConfig configRecord;
     String rootDomain;
     if (!resolveAliyunRequestConfig(request, ddnsConfig, configIndex, &configRecord, &rootDomain)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
       return;
     }
 
@@ -1164,7 +1364,7 @@ void WebPortal::registerRoutes() {
         request->hasParam("recordId", true) ? request->getParam("recordId", true)->value() : "";
     recordId.trim();
     if (recordId.isEmpty()) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"record_id_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"record_id_required\"}");
       return;
     }
 
@@ -1196,16 +1396,17 @@ void WebPortal::registerRoutes() {
     }
     if (!hasResolvedValue) {
       if (!resolveAliyunRecordValue(&value, configRecord)) {
-        request->send(400, "application/json", "{\"success\":false,\"error\":\"value_required\"}");
+        sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"value_required\"}");
         return;
       }
     }
 
     if (!client.updateDomainRecord(recordId, rr, type, value)) {
       const String errorMessage = buildAliyunApiError("update_failed", client.getLastApiResponse());
-      request->send(500,
-                    "application/json",
-                    "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) + "\"}");
+      sendTracked(request, aliyunFailureStatusCode(client),
+                           "application/json",
+                           "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) +
+                               "\",\"code\":\"" + jsonEscape(client.getLastErrorCode()) + "\"}");
       return;
     }
 
@@ -1215,7 +1416,7 @@ void WebPortal::registerRoutes() {
     body += "\"rootDomain\":\"" + jsonEscape(rootDomain) + "\",";
     body += "\"recordId\":\"" + jsonEscape(recordId) + "\"";
     body += "}";
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/ddns/aliyun/delete", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -1224,13 +1425,13 @@ void WebPortal::registerRoutes() {
     }
 
     if (!request->hasParam("configIndex", true)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"config_index_required\"}");
       return;
     }
 
     size_t configIndex = 0;
     if (!parseIndexParam(request->getParam("configIndex", true)->value(), &configIndex)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"invalid_config_index\"}");
       return;
     }
 
@@ -1238,7 +1439,7 @@ void WebPortal::registerRoutes() {
     DdnsRecordConfig configRecord;
     String rootDomain;
     if (!resolveAliyunRecordConfig(ddnsConfig, configIndex, &configRecord, &rootDomain)) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"ddns_record_incomplete\"}");
       return;
     }
 
@@ -1246,7 +1447,7 @@ void WebPortal::registerRoutes() {
         request->hasParam("recordId", true) ? request->getParam("recordId", true)->value() : "";
     recordId.trim();
     if (recordId.isEmpty()) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"record_id_required\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"record_id_required\"}");
       return;
     }
 
@@ -1254,9 +1455,10 @@ void WebPortal::registerRoutes() {
     client.begin(configRecord.username, configRecord.password, rootDomain, "@");
     if (!client.deleteDomainRecord(recordId)) {
       const String errorMessage = buildAliyunApiError("delete_failed", client.getLastApiResponse());
-      request->send(500,
-                    "application/json",
-                    "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) + "\"}");
+      sendTracked(request, aliyunFailureStatusCode(client),
+                           "application/json",
+                           "{\"success\":false,\"error\":\"" + jsonEscape(errorMessage) +
+                               "\",\"code\":\"" + jsonEscape(client.getLastErrorCode()) + "\"}");
       return;
     }
 
@@ -1266,7 +1468,7 @@ void WebPortal::registerRoutes() {
     body += "\"rootDomain\":\"" + jsonEscape(rootDomain) + "\",";
     body += "\"recordId\":\"" + jsonEscape(recordId) + "\"";
     body += "}";
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/ota/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -1301,7 +1503,7 @@ void WebPortal::registerRoutes() {
     body += "\"lastFinishAtMs\":" + String(status.lastFinishAtMs);
     body += "}";
 
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
   });
 
   _server.on("/api/ota/check", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -1321,7 +1523,7 @@ void WebPortal::registerRoutes() {
     body += "\"error\":\"" + jsonEscape(errorCode.isEmpty() ? status.lastError : errorCode) + "\"";
     body += "}";
 
-    request->send(accepted ? 202 : 400, "application/json", body);
+    sendTracked(request, accepted ? 202 : 400, "application/json", body);
   });
 
   _server.on("/api/ota/upgrade", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -1341,7 +1543,7 @@ void WebPortal::registerRoutes() {
     body += "\"error\":\"" + jsonEscape(errorCode.isEmpty() ? status.lastError : errorCode) + "\"";
     body += "}";
 
-    request->send(accepted ? 202 : 400, "application/json", body);
+    sendTracked(request, accepted ? 202 : 400, "application/json", body);
   });
 
   // Keep backward compatibility with old endpoint.
@@ -1362,7 +1564,7 @@ void WebPortal::registerRoutes() {
     body += "\"error\":\"" + jsonEscape(errorCode.isEmpty() ? status.lastError : errorCode) + "\"";
     body += "}";
 
-    request->send(accepted ? 202 : 400, "application/json", body);
+    sendTracked(request, accepted ? 202 : 400, "application/json", body);
   });
 
   _server.on("/api/system/info", HTTP_GET, [this](AsyncWebServerRequest* request) {
@@ -1395,10 +1597,159 @@ void WebPortal::registerRoutes() {
     body += "\"sketchUsed\":" + String(sketchUsed) + ",";
     body += "\"flashFree\":" + String(flashFree) + ",";
     body += "\"systemTime\":\"" + jsonEscape(_timeService.getFormattedTime()) + "\",";
-    body += "\"systemTimeUnix\":" + String(_timeService.getUnixTime());
+    body += "\"systemTimeUnix\":" + String(_timeService.getUnixTime()) + ",";
+    body += "\"timeSync\":{";
+    body += "\"state\":\"" + jsonEscape(_timeService.getState()) + "\",";
+    body += "\"source\":\"" + _timeService.getTimeSource() + "\",";
+    body += "\"dateUncertaintyMs\":" + String(_timeService.getCoarseUncertaintyMs()) + ",";
+    body += "\"dateSources\":" + String(_timeService.getCoarseSources()) + ",";
+    body += "\"lastOffsetMs\":" + String(_timeService.getLastOffsetMs()) + ",";
+    body += "\"driftPpb\":" + String(_timeService.getDriftPpb()) + ",";
+    body += "\"driftConfidence\":" + String(_timeService.getDriftConfidence()) + ",";
+    body += "\"intervalSeconds\":" + String(_timeService.getSyncIntervalSeconds());
+    body += "},";
+
+    const SharedHttpStats httpStats = SharedHttpClient::getStats();
+    body += "\"httpClient\":{";
+    body += "\"requests\":" + String(httpStats.requests) + ",";
+    body += "\"connectionsOpened\":" + String(httpStats.connectionsOpened) + ",";
+    body += "\"connectionsReused\":" + String(httpStats.connectionsReused) + ",";
+    body += "\"tlsHandshakes\":" + String(httpStats.tlsHandshakes) + ",";
+    body += "\"handshakesAvoided\":" + String(httpStats.handshakesAvoided) + ",";
+    body += "\"staleRetries\":" + String(httpStats.staleRetries) + ",";
+    body += "\"pooledConnections\":" + String(httpStats.pooledConnections);
+    body += "},";
+
+    const AsyncHttpStats asyncStats = AsyncHttpClient::getStats();
+    body += "\"asyncHttp\":{";
+    body += "\"submitted\":" + String(asyncStats.submitted) + ",";
+    body += "\"completed\":" + String(asyncStats.completed) + ",";
+    body += "\"pending\":" + String(asyncStats.pending) + ",";
+    body += "\"abandoned\":" + String(asyncStats.abandoned) + ",";
+    body += "\"inlineFallbacks\":" + String(asyncStats.inlineFallbacks) + ",";
+    body += "\"maxQueueWaitMs\":" + String(asyncStats.maxQueueWaitMs) + ",";
+    body += "\"maxRunMs\":" + String(asyncStats.maxRunMs);
+    body += "},";
+
+    const PublicIpObservation observation = PublicIpObserver::getObservation();
+    const PublicIpObserverStats observerStats = PublicIpObserver::getStats();
+    const uint32_t observedAgeMs =
+        observation.ipv4.isEmpty() ? 0 : millis() - observation.checkedAtMs;
+    body += "\"publicIp\":{";
+    body += "\"ipv4\":\"" + jsonEscape(observation.ipv4) + "\",";
+    body += "\"source\":\"" + jsonEscape(observation.source) + "\",";
+    body += "\"confirmedBy\":\"" + jsonEscape(observation.confirmedBy) + "\",";
+    body += "\"confidence\":\"" +
+            String(PublicIpObserver::confidenceName(observation.confidence)) + "\",";
+    body += "\"ageMs\":" + String(observedAgeMs) + ",";
+    body += "\"requireAgreement\":" +
+            String(PublicIpObserver::getRequireAgreement() ? "true" : "false") + ",";
+    body += "\"lookups\":" + String(observerStats.lookups) + ",";
+    body += "\"cacheHits\":" + String(observerStats.cacheHits) + ",";
+    body += "\"changes\":" + String(observerStats.changes) + ",";
+    body += "\"confirmations\":" + String(observerStats.confirmations) + ",";
+    body += "\"disagreements\":" + String(observerStats.disagreements) + ",";
+    body += "\"heldChanges\":" + String(observerStats.heldChanges);
+    body += "},";
+
+    const std::vector<PublicIpEndpointStats> publicIpStats = PublicIpService::getEndpointStats();
+    body += "\"publicIpEndpoints\":[";
+    for (size_t i = 0; i < publicIpStats.size(); ++i) {
+      const PublicIpEndpointStats& endpoint = publicIpStats[i];
+      if (i > 0) {
+        body += ",";
+      }
+      body += "{";
+      body += "\"url\":\"" + jsonEscape(endpoint.url) + "\",";
+      body += "\"latencyEwmaMs\":" + String(endpoint.latencyEwmaMs) + ",";
+      body += "\"successes\":" + String(endpoint.successes) + ",";
+      body += "\"failures\":" + String(endpoint.failures) + ",";
+      body += "\"wins\":" + String(endpoint.wins);
+      body += "}";
+    }
+    body += "],";
+
+    const PublicIpDiscoveryStats discoveryStats = PublicIpService::getDiscoveryStats();
+    body += "\"publicIpDiscovery\":{";
+    body += "\"gatewayAnswers\":" + String(discoveryStats.gatewayAnswers) + ",";
+    body += "\"stunAnswers\":" + String(discoveryStats.stunAnswers) + ",";
+    body += "\"dnsEchoAnswers\":" + String(discoveryStats.dnsEchoAnswers) + ",";
+    body += "\"udpFailures\":" + String(discoveryStats.udpFailures) + ",";
+    body += "\"udpSkipped\":" + String(discoveryStats.udpSkipped) + ",";
+    body += "\"httpsFallbacks\":" + String(discoveryStats.httpsFallbacks);
+    body += "},";
+
+    const GatewayIpStats gatewayStats = GatewayIpProbe::getStats();
+    body += "\"gatewayIp\":{";
+    body += "\"method\":\"" + jsonEscape(gatewayStats.method) + "\",";
+    body += "\"gateway\":\"" + jsonEscape(gatewayStats.gateway) + "\",";
+    body += "\"natPmpAnswers\":" + String(gatewayStats.natPmpAnswers) + ",";
+    body += "\"upnpAnswers\":" + String(gatewayStats.upnpAnswers) + ",";
+    body += "\"cacheHits\":" + String(gatewayStats.cacheHits) + ",";
+    body += "\"failures\":" + String(gatewayStats.failures) + ",";
+    body += "\"privateWan\":" + String(gatewayStats.privateWan) + ",";
+    body += "\"discoveries\":" + String(gatewayStats.discoveries);
+    body += "},";
+
+    const DnsCacheStats dnsStats = DnsCache::getStats();
+    body += "\"dns\":{";
+    body += "\"hits\":" + String(dnsStats.hits) + ",";
+    body += "\"misses\":" + String(dnsStats.misses) + ",";
+    body += "\"staleFallbacks\":" + String(dnsStats.staleFallbacks) + ",";
+    body += "\"prefetches\":" + String(dnsStats.prefetches) + ",";
+    body += "\"lookups\":" + String(dnsStats.lookups) + ",";
+    body += "\"lookupFailures\":" + String(dnsStats.lookupFailures) + ",";
+    body += "\"lastLookupMs\":" + String(dnsStats.lastLookupMs) + ",";
+    body += "\"maxLookupMs\":" + String(dnsStats.maxLookupMs) + ",";
+    body += "\"avgLookupMs\":" +
+            String(dnsStats.lookups == 0 ? 0 : dnsStats.totalLookupMs / dnsStats.lookups) + ",";
+    body += "\"entries\":" + String(dnsStats.entries);
+    body += "}";
+    body += "}";
+
+    sendTracked(request, 200, "application/json", body);
+  });
+
+  _server.on("/api/network/stats", HTTP_GET, [this](AsyncWebServerRequest* request) {
+    if (!ensureAuthorized(request, true)) {
+      return;
+    }
+
+    String body = "{";
+    body += "\"uptimeMs\":" + String(millis()) + ",";
+    body += "\"subsystems\":[";
+    const size_t subsystemCount = static_cast<size_t>(NetSubsystem::Count);
+    for (size_t index = 0; index < subsystemCount; ++index) {
+      const NetSubsystem subsystem = static_cast<NetSubsystem>(index);
+      const NetSubsystemCounters counters = NetworkAccounting::getCounters(subsystem);
+      body += "{";
+      body += "\"name\":\"" + String(NetworkAccounting::subsystemName(subsystem)) + "\",";
+      body += "\"bytesIn\":" + String(counters.bytesIn) + ",";
+      body += "\"bytesOut\":" + String(counters.bytesOut) + ",";
+      body += "\"requests\":" + String(counters.requests) + ",";
+      body += "\"connections\":" + String(counters.connections) + ",";
+      body += "\"tlsHandshakes\":" + String(counters.tlsHandshakes) + ",";
+      body += "\"dnsLookups\":" + String(counters.dnsLookups) + ",";
+      body += "\"failures\":" + String(counters.failures) + ",";
+      body += "\"blockedMs\":" + String(counters.blockedMs);
+      body += "}";
+      if (index + 1 < subsystemCount) {
+        body += ",";
+      }
+    }
+    body += "]";
     body += "}";
 
-    request->send(200, "application/json", body);
+    sendTracked(request, 200, "application/json", body);
+  });
+
+  _server.on("/api/network/reset", HTTP_POST, [this](AsyncWebServerRequest* request) {
+    if (!ensureAuthorized(request, true)) {
+      return;
+    }
+
+    NetworkAccounting::reset();
+    sendTracked(request, 200, "application/json", "{\"success\":true}");
   });
 
   _server.on("/api/power/on", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -1429,7 +1780,7 @@ void WebPortal::registerRoutes() {
         statusCode = 400;
       }
     }
-    request->send(statusCode, "application/json", body);
+    sendTracked(request, statusCode, "application/json", body);
   });
 
   _server.on("/api/auth/password", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -1448,12 +1799,12 @@ void WebPortal::registerRoutes() {
                                        : "";
 
     if (currentPassword.isEmpty() || newPassword.isEmpty() || confirmPassword.isEmpty()) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"missing_fields\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"missing_fields\"}");
       return;
     }
 
     if (newPassword != confirmPassword) {
-      request->send(400, "application/json", "{\"success\":false,\"error\":\"confirm_not_match\"}");
+      sendTracked(request, 400, "application/json", "{\"success\":false,\"error\":\"confirm_not_match\"}");
       return;
     }
 
@@ -1461,21 +1812,21 @@ void WebPortal::registerRoutes() {
     const bool changed = _authService.updatePassword(currentPassword, newPassword, &errorCode);
     if (!changed) {
       const int statusCode = errorCode == "persist_failed" ? 500 : 400;
-      request->send(statusCode,
-                    "application/json",
-                    "{\"success\":false,\"error\":\"" + jsonEscape(errorCode) + "\"}");
+      sendTracked(request, statusCode,
+                           "application/json",
+                           "{\"success\":false,\"error\":\"" + jsonEscape(errorCode) + "\"}");
       return;
     }
 
-    request->send(200, "application/json", "{\"success\":true,\"relogin\":true}");
+    sendTracked(request, 200, "application/json", "{\"success\":true,\"relogin\":true}");
   });
 
   _server.onNotFound([this](AsyncWebServerRequest* request) {
     if (request->url().startsWith("/api/")) {
-      request->send(404, "application/json", "{\"error\":\"not_found\"}");
+      sendTracked(request, 404, "application/json", "{\"error\":\"not_found\"}");
       return;
     }
-    request->send(404, "text/plain", "Not Found");
+    sendTracked(request, 404, "text/plain", "Not Found");
   });
 }
 
@@ -1488,12 +1839,12 @@ bool WebPortal::ensureAuthorized(AsyncWebServerRequest* request, bool apiRequest
     AsyncWebServerResponse* response =
         request->beginResponse(401, "application/json", "{\"error\":\"unauthorized\"}");
     response->addHeader("Set-Cookie", "ESPSESSION=deleted; Path=/; Max-Age=0");
-    request->send(response);
+    sendTracked(request, response);
   } else {
     AsyncWebServerResponse* response = request->beginResponse(302);
     response->addHeader("Location", "/login");
     response->addHeader("Set-Cookie", "ESPSESSION=deleted; Path=/; Max-Age=0");
-    request->send(response);
+    sendTracked(request, response);
   }
   return false;
 }
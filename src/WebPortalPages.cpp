@@ -488,6 +488,18 @@ const char* WebPortal::dashboardPage() const {
           <input id="ddnsEnabled" name="ddnsEnabled" type="checkbox">
           <label for="ddnsEnabled" style="margin: 0;">启用 DDNS</label>
         </div>
+        <div class="inline-check">
+          <input id="ddnsAdaptiveInterval" name="ddnsAdaptiveInterval" type="checkbox">
+          <label for="ddnsAdaptiveInterval" style="margin: 0;">按历史 IP 变化自适应检查间隔</label>
+        </div>
+        <div class="inline-actions">
+          <input id="ddnsAdaptiveMinSeconds" type="number" min="30" max="86400" placeholder="最短间隔（秒）">
+          <input id="ddnsAdaptiveMaxSeconds" type="number" min="30" max="86400" placeholder="最长间隔（秒）">
+        </div>
+        <div class="inline-check">
+          <input id="ddnsLanCoordination" name="ddnsLanCoordination" type="checkbox">
+          <label for="ddnsLanCoordination" style="margin: 0;">局域网多设备协同（仅由选出的主设备同步）</label>
+        </div>
         <div class="inline-actions">
           <button id="ddnsAddRecordButton" class="secondary" type="button"><span class="icon"><i class="fa-solid fa-plus"></i></span></button>
           <button id="ddnsToggleAllButton" class="secondary" type="button">Collapse All</button>
@@ -745,7 +757,10 @@ const char* WebPortal::dashboardPage() const {
     let statusPollTimer = 0;
     let otaActionPollTimer = 0;
     const ddnsProviders = ["aliyun"];
-    const maxDdnsRecords = 5;
+    let maxDdnsRecords = 64;
+    // Status is polled one page at a time so many records keep each response small.
+    const ddnsStatusPageSize = 16;
+    let ddnsStatusOffset = 0;
     let ddnsRecordsCache = [];
     
     // 时间实时刷新
@@ -1037,6 +1052,10 @@ const char* WebPortal::dashboardPage() const {
     function buildDdnsConfigParams(records) {
       const params = new URLSearchParams();
       params.set("ddnsEnabled", document.getElementById("ddnsEnabled").checked ? "1" : "0");
+      params.set("ddnsAdaptiveInterval", document.getElementById("ddnsAdaptiveInterval").checked ? "1" : "0");
+      params.set("ddnsAdaptiveMinSeconds", document.getElementById("ddnsAdaptiveMinSeconds").value || "60");
+      params.set("ddnsAdaptiveMaxSeconds", document.getElementById("ddnsAdaptiveMaxSeconds").value || "3600");
+      params.set("ddnsLanCoordination", document.getElementById("ddnsLanCoordination").checked ? "1" : "0");
       params.set("ddnsRecordCount", String(records.length));
       records.forEach(function (record, index) {
         const normalized = normalizeDdnsRecord(record);
@@ -1438,7 +1457,7 @@ const char* WebPortal::dashboardPage() const {
     function addDdnsRecord() {
       const currentRecords = collectDdnsRecordsFromForm();
       if (currentRecords.length >= maxDdnsRecords) {
-        setText("ddnsStatus", "Max 5 DDNS records are supported.");
+        setText("ddnsStatus", "Max " + maxDdnsRecords + " DDNS records are supported.");
         return;
       }
       currentRecords.push(createDefaultDdnsRecord());
@@ -1458,6 +1477,7 @@ const char* WebPortal::dashboardPage() const {
       if (state === "DISABLED") return "已禁用";
       if (state === "WAIT_CONFIG") return "待配置";
       if (state === "WAIT_WIFI") return "等待 WiFi";
+      if (state === "STANDBY") return "备用（主设备同步中）";
       if (state === "READY") return "就绪";
       if (state === "RUNNING") return "运行中";
       if (state === "UPDATED") return "已更新";
@@ -1482,9 +1502,9 @@ const char* WebPortal::dashboardPage() const {
 
       const recordStates = Array.isArray(data.records) ? data.records : [];
       const cards = Array.from(document.querySelectorAll("#ddnsRecords .ddns-record"));
-      cards.forEach(function (card, index) {
-        const record = recordStates[index];
-        if (!record) {
+      recordStates.forEach(function (record, position) {
+        const card = cards[record.index !== undefined ? Number(record.index) : position];
+        if (!card) {
           return;
         }
 
@@ -1897,6 +1917,11 @@ const char* WebPortal::dashboardPage() const {
       document.getElementById("bemfaHost").value = data.bemfaHost || "bemfa.com";
       document.getElementById("bemfaPort").value = data.bemfaPort || 9501;
       document.getElementById("ddnsEnabled").checked = !!data.ddnsEnabled;
+      document.getElementById("ddnsAdaptiveInterval").checked = !!data.ddnsAdaptiveInterval;
+      document.getElementById("ddnsAdaptiveMinSeconds").value = data.ddnsAdaptiveMinSeconds || 60;
+      document.getElementById("ddnsAdaptiveMaxSeconds").value = data.ddnsAdaptiveMaxSeconds || 3600;
+      document.getElementById("ddnsLanCoordination").checked = !!data.ddnsLanCoordination;
+      maxDdnsRecords = Number(data.ddnsMaxRecords) || maxDdnsRecords;
       const configRecords = Array.isArray(data.ddnsConfigRecords)
           ? data.ddnsConfigRecords
           : (Array.isArray(data.ddnsRecords) ? data.ddnsRecords : []);
@@ -1947,8 +1972,11 @@ const char* WebPortal::dashboardPage() const {
 
     async function refreshDdnsStatus() {
       try {
-        const data = await api("/api/ddns/status");
+        const data = await api("/api/ddns/status?offset=" + ddnsStatusOffset +
+                               "&limit=" + ddnsStatusPageSize);
         updateDdnsStatus(data);
+        const nextOffset = ddnsStatusOffset + ddnsStatusPageSize;
+        ddnsStatusOffset = nextOffset < Number(data.recordTotal || 0) ? nextOffset : 0;
       } catch (error) {
         setText("ddnsStatus", toMessage(error.message));
       }
@@ -2221,6 +2249,10 @@ const char* WebPortal::dashboardPage() const {
     document.getElementById("ddnsAddRecordButton").addEventListener("click", addDdnsRecord);
     document.getElementById("ddnsToggleAllButton").addEventListener("click", toggleAllDdnsRecords);
     document.getElementById("ddnsEnabled").addEventListener("change", saveDdnsEnabled);
+    document.getElementById("ddnsAdaptiveInterval").addEventListener("change", saveDdnsEnabled);
+    document.getElementById("ddnsAdaptiveMinSeconds").addEventListener("change", saveDdnsEnabled);
+    document.getElementById("ddnsAdaptiveMaxSeconds").addEventListener("change", saveDdnsEnabled);
+    document.getElementById("ddnsLanCoordination").addEventListener("change", saveDdnsEnabled);
     document.getElementById("systemForm").addEventListener("submit", saveSystemConfig);
     document.getElementById("refreshAllButton").addEventListener("click", refreshAllStatusByButton);
     document.getElementById("passwordForm").addEventListener("submit", savePassword);
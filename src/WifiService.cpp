@@ -1,9 +1,10 @@
 #include "WifiService.h"
 
-#include <Preferences.h>
 #include <WiFi.h>
 #include <algorithm>
 
+#include "Hal.h"
+
 namespace {
 constexpr int kWifiScanRunning = WIFI_SCAN_RUNNING;
 constexpr int kWifiScanFailed = WIFI_SCAN_FAILED;
@@ -24,6 +25,29 @@ bool isTerminalConnectionFailureStatus(wl_status_t status) {
 }
 }  // namespace
 
+void WifiService::setLinkEventCallback(WifiLinkEventCallback callback, void* context) {
+  _linkEventCallback = callback;
+  _linkEventContext = context;
+  if (_linkEventsRegistered) {
+    return;
+  }
+  _linkEventsRegistered = true;
+
+  // Reconnect attempts fire DISCONNECTED repeatedly; subscribers debounce.
+  const auto forward = [this](arduino_event_id_t event, arduino_event_info_t info) {
+    (void)info;
+    if (_linkEventCallback == nullptr) {
+      return;
+    }
+    _linkEventCallback(
+        event == ARDUINO_EVENT_WIFI_STA_GOT_IP ? WifiLinkEvent::GotIp : WifiLinkEvent::LostIp,
+        _linkEventContext);
+  };
+  WiFi.onEvent(forward, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  WiFi.onEvent(forward, ARDUINO_EVENT_WIFI_STA_LOST_IP);
+  WiFi.onEvent(forward, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+}
+
 WifiScanResult WifiService::scanNetworks() {
   tick();
   ensureStationEnabled();
@@ -277,7 +301,7 @@ bool WifiService::loadStoredCredentials(String* ssid, String* password) const {
     return false;
   }
 
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kStorageNamespace, true)) {
     return false;
   }
@@ -291,7 +315,7 @@ bool WifiService::loadStoredCredentials(String* ssid, String* password) const {
 }
 
 bool WifiService::persistCredentials(const String& ssid, const String& password) const {
-  Preferences preferences;
+  KeyValueStore preferences;
   if (!preferences.begin(kStorageNamespace, false)) {
     return false;
   }
@@ -8,6 +8,8 @@
 #include "FirmwareUpgradeService.h"
 #include "HostProbeService.h"
 #include "PowerOnService.h"
+#include "PublicIpObserver.h"
+#include "SharedHttpClient.h"
 #include "WakeOnLanService.h"
 #include "WebPortal.h"
 #include "WifiService.h"
@@ -36,6 +38,7 @@ WebPortal webPortal(8080,
                      timeService,
                      firmwareUpgradeService);
 bool setupApRunning = false;
+bool lastWifiConnected = false;
 String lastReportedPowerState = "";
 
 bool isAccessPointModeEnabled() {
@@ -67,6 +70,12 @@ void onFirmwareUpgradeEvent(const FirmwareUpgradeStatus& status, void* context)
   bemfa->publishStatus(payload);
 }
 
+// Runs on the Wi-Fi event task; DdnsService::notify only records the event.
+void onWifiLinkEvent(WifiLinkEvent event, void* context) {
+  DdnsService* ddns = static_cast<DdnsService*>(context);
+  ddns->notify(event == WifiLinkEvent::GotIp ? DdnsTrigger::WifiGotIp : DdnsTrigger::WifiLostIp);
+}
+
 void handleBemfaCommand(bool wifiConnected) {
   String command;
   if (!bemfaService.takeCommand(&command)) {
@@ -201,6 +210,7 @@ void setup() {
   syncSetupAccessPoint(wifiService.isConnected());
   bemfaService.begin();
   ddnsService.begin();
+  wifiService.setLinkEventCallback(onWifiLinkEvent, &ddnsService);
   timeService.begin();
   firmwareUpgradeService.setEventCallback(onFirmwareUpgradeEvent, &bemfaService);
   firmwareUpgradeService.begin();
@@ -222,12 +232,17 @@ void setup() {
 void loop() {
   wifiService.tick();
   const bool wifiConnected = wifiService.isConnected();
+  if (wifiConnected && !lastWifiConnected) {
+    PublicIpObserver::onWifiReconnected();
+  }
+  lastWifiConnected = wifiConnected;
   syncSetupAccessPoint(wifiConnected);
   powerOnService.tick(wifiConnected);
   bemfaService.tick(wifiConnected);
   timeService.tick(wifiConnected);
   ddnsService.tick(wifiConnected);
   firmwareUpgradeService.tick(wifiConnected);
+  SharedHttpClient::closeIdleConnections();
   handleBemfaCommand(wifiConnected);
   reportPowerStateIfChanged();
   delay(100);
@@ -0,0 +1,111 @@
+#if !defined(ARDUINO)
+
+// Host entry point for the native env: runs the network services against the
+// Linux HAL so they can be profiled and sanitized off-device.
+//
+//   ALIYUN_ENDPOINT      Aliyun DNS API base URL (e.g. http://127.0.0.1:8053/)
+//   ESP32APP_RUN_SECONDS how long to tick before exiting (default 60)
+//   ESP32APP_NVS_PATH    file backing the key-value store (default: memory only)
+//   ESP32APP_STUN_SERVER / ESP32APP_DNS_ECHO_SERVER
+//                        host:port of the UDP public IP probes (tools/udp_ip_stub.py)
+//   ESP32APP_GATEWAY     host:port of a NAT-PMP/UPnP gateway (tools/igd_stub.py);
+//                        SSDP goes unicast to the same host
+
+#include <Arduino.h>
+
+#include <cstdlib>
+
+#include "AliyunDdnsClient.h"
+#include "ConfigStore.h"
+#include "DdnsService.h"
+#include "GatewayIpProbe.h"
+#include "Hal.h"
+#include "HostProbeService.h"
+#include "NetworkAccounting.h"
+#include "PowerOnService.h"
+#include "PublicIpService.h"
+#include "SharedHttpClient.h"
+#include "TimeService.h"
+#include "WakeOnLanService.h"
+
+namespace {
+constexpr uint32_t kDefaultRunSeconds = 60;
+constexpr uint32_t kLoopDelayMs = 100;
+
+uint32_t runSeconds() {
+  const char* value = getenv("ESP32APP_RUN_SECONDS");
+  if (value == nullptr || value[0] == '\0') {
+    return kDefaultRunSeconds;
+  }
+  return static_cast<uint32_t>(strtoul(value, nullptr, 10));
+}
+
+// Splits "host:port"; returns false when the variable is unset.
+bool serverFromEnv(const char* name, String* host, uint16_t* port) {
+  const char* value = getenv(name);
+  if (value == nullptr || value[0] == '\0') {
+    return false;
+  }
+  const String server(value);
+  const int separator = server.lastIndexOf(':');
+  *host = separator == -1 ? server : server.substring(0, separator);
+  if (separator != -1) {
+    *port = static_cast<uint16_t>(server.substring(separator + 1).toInt());
+  }
+  return true;
+}
+}  // namespace
+
+int main() {
+  const char* endpoint = getenv("ALIYUN_ENDPOINT");
+  if (endpoint != nullptr && endpoint[0] != '\0') {
+    AliyunDdnsClient::setEndpoint(endpoint);
+  }
+  String host;
+  uint16_t port = UdpPublicIpProbe::kDefaultStunPort;
+  if (serverFromEnv("ESP32APP_STUN_SERVER", &host, &port)) {
+    PublicIpService::setStunServer(host, port);
+  }
+  port = UdpPublicIpProbe::kDefaultDnsPort;
+  if (serverFromEnv("ESP32APP_DNS_ECHO_SERVER", &host, &port)) {
+    PublicIpService::setDnsEchoServer(host, port);
+  }
+  port = GatewayIpProbe::kNatPmpPort;
+  if (serverFromEnv("ESP32APP_GATEWAY", &host, &port)) {
+    GatewayIpProbe::setGateway(host, port);
+  }
+
+  ConfigStore configStore;
+  WakeOnLanService wakeOnLanService;
+  HostProbeService hostProbeService;
+  PowerOnService powerOnService(wakeOnLanService, hostProbeService);
+  DdnsService ddnsService(configStore);
+  TimeService timeService;
+
+  ddnsService.begin();
+  timeService.begin();
+  ddnsService.updateConfig(configStore.loadDdnsConfig());
+
+  Serial.print("Native host run, endpoint: ");
+  Serial.println(AliyunDdnsClient::getEndpoint());
+
+  const uint32_t durationMs = runSeconds() * 1000UL;
+  const uint32_t startedAtMs = millis();
+  while (millis() - startedAtMs < durationMs) {
+    const bool wifiConnected = Hal::wifi().isConnected();
+    powerOnService.tick(wifiConnected);
+    timeService.tick(wifiConnected);
+    ddnsService.tick(wifiConnected);
+    SharedHttpClient::closeIdleConnections();
+    delay(kLoopDelayMs);
+  }
+
+  const DdnsRuntimeStatus status = ddnsService.getStatus();
+  Serial.print("DDNS state: ");
+  Serial.print(status.state);
+  Serial.print(", updates: ");
+  Serial.println(status.totalUpdateCount);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "AliyunApiGateway.h"
+
+namespace {
+constexpr const char* kReadKey = "key-id\nsecret\nGET\nAction=DescribeDomainRecords";
+constexpr uint32_t kWaitMs = 1000;
+
+uint32_t gFetchCount = 0;
+SemaphoreHandle_t gFetchStarted = nullptr;
+SemaphoreHandle_t gReleaseFetch = nullptr;
+SemaphoreHandle_t gLeaderDone = nullptr;
+SemaphoreHandle_t gFollowerDone = nullptr;
+AliyunGatewayResult gLeaderResult;
+
+void fetchSuccess(AliyunGatewayResult* result) {
+  gFetchCount += 1;
+  result->response = "{\"TotalCount\":" + String(gFetchCount) + "}";
+  result->errorCode = "";
+}
+
+void fetchThrottled(AliyunGatewayResult* result) {
+  gFetchCount += 1;
+  result->response = "";
+  result->errorCode = "Throttling.User";
+}
+
+void fetchWhenReleased(AliyunGatewayResult* result) {
+  xSemaphoreGive(gFetchStarted);
+  xSemaphoreTake(gReleaseFetch, portMAX_DELAY);
+  fetchSuccess(result);
+}
+
+void leaderTask(void*) {
+  AliyunApiGateway::execute(kReadKey, fetchWhenReleased, &gLeaderResult, kWaitMs);
+  xSemaphoreGive(gLeaderDone);
+  vTaskDelete(nullptr);
+}
+
+void startBlockedLeader() {
+  gFetchStarted = xSemaphoreCreateBinary();
+  gReleaseFetch = xSemaphoreCreateBinary();
+  gLeaderDone = xSemaphoreCreateBinary();
+  gFollowerDone = xSemaphoreCreateBinary();
+  gLeaderResult = AliyunGatewayResult();
+  xTaskCreate(leaderTask, "gw_leader", 4096, nullptr, 1, nullptr);
+  xSemaphoreTake(gFetchStarted, portMAX_DELAY);
+}
+
+void finishBlockedLeader(bool withFollower) {
+  xSemaphoreGive(gReleaseFetch);
+  xSemaphoreTake(gLeaderDone, portMAX_DELAY);
+  if (withFollower) {
+    xSemaphoreTake(gFollowerDone, portMAX_DELAY);
+  }
+  vSemaphoreDelete(gFetchStarted);
+  vSemaphoreDelete(gReleaseFetch);
+  vSemaphoreDelete(gLeaderDone);
+  vSemaphoreDelete(gFollowerDone);
+}
+
+void followerTask(void* context) {
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, static_cast<AliyunGatewayResult*>(context), kWaitMs);
+  xSemaphoreGive(gFollowerDone);
+  vTaskDelete(nullptr);
+}
+
+// Returns once the follower is waiting on the leader's call.
+void startFollower(AliyunGatewayResult* result) {
+  xTaskCreate(followerTask, "gw_follower", 4096, result, 1, nullptr);
+  while (AliyunApiGateway::getStats().coalescedCalls == 0) {
+    delay(1);
+  }
+}
+}  // namespace
+
+void setUp() {
+  AliyunApiGateway::reset();
+  gFetchCount = 0;
+}
+
+void tearDown() {}
+
+void test_successful_read_is_served_from_cache() {
+  AliyunGatewayResult first;
+  AliyunGatewayResult second;
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, &first, kWaitMs);
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, &second, kWaitMs);
+
+  TEST_ASSERT_EQUAL_UINT32(1, gFetchCount);
+  TEST_ASSERT_EQUAL_STRING(first.response.c_str(), second.response.c_str());
+
+  const AliyunGatewayStats stats = AliyunApiGateway::getStats();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.networkCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.cacheHits);
+}
+
+void test_failed_read_is_not_cached() {
+  AliyunGatewayResult result;
+  AliyunApiGateway::execute(kReadKey, fetchThrottled, &result, kWaitMs);
+  TEST_ASSERT_EQUAL_STRING("Throttling.User", result.errorCode.c_str());
+
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, &result, kWaitMs);
+  TEST_ASSERT_EQUAL_UINT32(2, gFetchCount);
+  TEST_ASSERT_TRUE(result.errorCode.isEmpty());
+}
+
+void test_invalidate_drops_reads_of_same_credentials() {
+  AliyunGatewayResult result;
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, &result, kWaitMs);
+  AliyunApiGateway::invalidate("other-id\nsecret\n");
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, &result, kWaitMs);
+  TEST_ASSERT_EQUAL_UINT32(1, gFetchCount);
+
+  AliyunApiGateway::invalidate("key-id\nsecret\n");
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, &result, kWaitMs);
+  TEST_ASSERT_EQUAL_UINT32(2, gFetchCount);
+}
+
+void test_overlapping_reads_share_one_call() {
+  startBlockedLeader();
+  AliyunGatewayResult follower;
+  startFollower(&follower);
+  finishBlockedLeader(true);
+
+  TEST_ASSERT_EQUAL_UINT32(1, gFetchCount);
+  TEST_ASSERT_EQUAL_STRING(gLeaderResult.response.c_str(), follower.response.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, AliyunApiGateway::getStats().coalescedCalls);
+}
+
+void test_waiter_times_out_instead_of_fetching_again() {
+  startBlockedLeader();
+  AliyunGatewayResult follower;
+  const uint32_t startMs = millis();
+  AliyunApiGateway::execute(kReadKey, fetchSuccess, &follower, 50);
+  TEST_ASSERT_TRUE(millis() - startMs < kWaitMs);
+  TEST_ASSERT_EQUAL_STRING("gateway_timeout", follower.errorCode.c_str());
+  TEST_ASSERT_EQUAL_UINT32(0, gFetchCount);
+
+  finishBlockedLeader(false);
+  TEST_ASSERT_EQUAL_UINT32(1, gFetchCount);
+  TEST_ASSERT_TRUE(gLeaderResult.errorCode.isEmpty());
+}
+
+void test_invalidated_flight_still_answers_its_waiters() {
+  startBlockedLeader();
+  AliyunGatewayResult follower;
+  startFollower(&follower);
+  AliyunApiGateway::invalidate("key-id\nsecret\n");
+  finishBlockedLeader(true);
+
+  TEST_ASSERT_EQUAL_UINT32(1, gFetchCount);
+  TEST_ASSERT_TRUE(follower.errorCode.isEmpty());
+  TEST_ASSERT_EQUAL_STRING(gLeaderResult.response.c_str(), follower.response.c_str());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_successful_read_is_served_from_cache);
+  RUN_TEST(test_failed_read_is_not_cached);
+  RUN_TEST(test_invalidate_drops_reads_of_same_credentials);
+  RUN_TEST(test_overlapping_reads_share_one_call);
+  RUN_TEST(test_waiter_times_out_instead_of_fetching_again);
+  RUN_TEST(test_invalidated_flight_still_answers_its_waiters);
+  UNITY_END();
+}
+
+void loop() {}
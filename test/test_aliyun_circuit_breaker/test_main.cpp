@@ -0,0 +1,83 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "AliyunCircuitBreaker.h"
+
+namespace {
+constexpr const char* kAccessKeyId = "LTAI-test";
+}  // namespace
+
+void setUp() {
+  AliyunCircuitBreaker::reset();
+}
+
+void tearDown() {}
+
+void test_error_codes_are_classified() {
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::classifyError("", 200) == AliyunErrorClass::None);
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::classifyError("network_error", -1) ==
+                   AliyunErrorClass::Transient);
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::classifyError("Throttling.User", 400) ==
+                   AliyunErrorClass::Throttled);
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::classifyError("InvalidTimeStamp.Expired", 400) ==
+                   AliyunErrorClass::ClockSkew);
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::classifyError("SignatureDoesNotMatch", 400) ==
+                   AliyunErrorClass::Auth);
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::classifyError("DomainRecordDuplicate", 400) ==
+                   AliyunErrorClass::Client);
+}
+
+void test_throttling_opens_breaker_immediately() {
+  const uint32_t now = 1000;
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now));
+  AliyunCircuitBreaker::recordResult(kAccessKeyId, AliyunErrorClass::Throttled, "Throttling.User", now);
+
+  TEST_ASSERT_FALSE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now + 1));
+  const std::vector<AliyunBreakerStatus> statuses = AliyunCircuitBreaker::getStatuses(now + 1);
+  TEST_ASSERT_EQUAL_UINT32(1, static_cast<uint32_t>(statuses.size()));
+  TEST_ASSERT_EQUAL_STRING("OPEN", statuses[0].state.c_str());
+  TEST_ASSERT_EQUAL_STRING("Throttling.User", statuses[0].lastErrorCode.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, statuses[0].shortCircuitCount);
+}
+
+void test_transient_failures_trip_after_threshold_and_half_open_recovers() {
+  uint32_t now = 1000;
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    TEST_ASSERT_TRUE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now));
+    AliyunCircuitBreaker::recordResult(kAccessKeyId, AliyunErrorClass::Transient, "network_error", now);
+  }
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now));
+  AliyunCircuitBreaker::recordResult(kAccessKeyId, AliyunErrorClass::Transient, "network_error", now);
+  TEST_ASSERT_FALSE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now));
+
+  // Base backoff with equal jitter never exceeds the un-jittered window.
+  now += 5001;
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now));
+  TEST_ASSERT_FALSE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now));
+  AliyunCircuitBreaker::recordResult(kAccessKeyId, AliyunErrorClass::None, "", now);
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now));
+}
+
+void test_reset_of_one_key_keeps_the_others() {
+  const uint32_t now = 1000;
+  AliyunCircuitBreaker::recordResult(kAccessKeyId, AliyunErrorClass::Throttled, "Throttling.User", now);
+  AliyunCircuitBreaker::recordResult("LTAI-other", AliyunErrorClass::Throttled, "Throttling.User", now);
+
+  AliyunCircuitBreaker::reset("LTAI-other");
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::allowRequest("LTAI-other", now + 1));
+  TEST_ASSERT_FALSE(AliyunCircuitBreaker::allowRequest(kAccessKeyId, now + 1));
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_error_codes_are_classified);
+  RUN_TEST(test_throttling_opens_breaker_immediately);
+  RUN_TEST(test_transient_failures_trip_after_threshold_and_half_open_recovers);
+  RUN_TEST(test_reset_of_one_key_keeps_the_others);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,78 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "AsyncHttpClient.h"
+#include "NetworkAccounting.h"
+
+namespace {
+constexpr uint32_t kWaitTimeoutMs = 2000;
+
+bool waitReady(const AsyncHttpFuture& future) {
+  const uint32_t startMs = millis();
+  while (!future.ready()) {
+    if (millis() - startMs >= kWaitTimeoutMs) {
+      return false;
+    }
+    delay(5);
+  }
+  return true;
+}
+}  // namespace
+
+void setUp() {
+  NetworkAccounting::reset();
+}
+
+void tearDown() {}
+
+void test_job_runs_off_the_calling_task() {
+  volatile bool ran = false;
+  const uint32_t submitStartMs = millis();
+  AsyncHttpFuture future = AsyncHttpClient::submitJob([&ran]() {
+    delay(200);
+    ran = true;
+  });
+
+  // submitJob() must return before the job finishes.
+  TEST_ASSERT_TRUE(millis() - submitStartMs < 100);
+  TEST_ASSERT_TRUE(future.valid());
+  TEST_ASSERT_TRUE(waitReady(future));
+  TEST_ASSERT_TRUE(ran);
+  TEST_ASSERT_TRUE(future.ok());
+  TEST_ASSERT_TRUE(future.elapsedMs() >= 200);
+}
+
+void test_job_keeps_accounting_subsystem_of_submitter() {
+  NetSubsystem seen = NetSubsystem::Other;
+  AsyncHttpFuture future;
+  {
+    NetworkAccounting::Scope scope(NetSubsystem::Ota);
+    future = AsyncHttpClient::submitJob([&seen]() { seen = NetworkAccounting::current(); });
+  }
+
+  TEST_ASSERT_TRUE(waitReady(future));
+  TEST_ASSERT_TRUE(seen == NetSubsystem::Ota);
+}
+
+void test_reset_future_is_not_ready() {
+  AsyncHttpFuture future = AsyncHttpClient::submitJob([]() {});
+  TEST_ASSERT_TRUE(waitReady(future));
+  future.reset();
+
+  TEST_ASSERT_FALSE(future.valid());
+  TEST_ASSERT_FALSE(future.ready());
+  TEST_ASSERT_EQUAL_INT(-1, future.response().httpCode);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_job_runs_off_the_calling_task);
+  RUN_TEST(test_job_keeps_accounting_subsystem_of_submitter);
+  RUN_TEST(test_reset_future_is_not_ready);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "ClockDiscipline.h"
+
+namespace {
+constexpr int64_t kMicrosPerSecond = 1000000;
+constexpr int64_t kHourUs = 3600LL * kMicrosPerSecond;
+constexpr int64_t kBaseUs = 1704067200LL * kMicrosPerSecond;
+constexpr int64_t kDelayUs = 20000;
+
+ClockDiscipline makeDiscipline() {
+  ClockDiscipline discipline;
+  discipline.setIntervalBounds(3600, 4 * 86400);
+  return discipline;
+}
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_first_sample_only_sets_the_clock() {
+  ClockDiscipline discipline = makeDiscipline();
+  TEST_ASSERT_TRUE(discipline.addSample(kBaseUs, 5 * kMicrosPerSecond, kDelayUs));
+  TEST_ASSERT_FALSE(discipline.learned());
+  TEST_ASSERT_EQUAL_INT32(0, discipline.driftPpb());
+  TEST_ASSERT_EQUAL_UINT32(3600, discipline.intervalSeconds());
+
+  ClockDiscipline small = makeDiscipline();
+  TEST_ASSERT_FALSE(small.addSample(kBaseUs, 40000, kDelayUs));
+}
+
+void test_drift_is_learned_and_stretches_the_interval() {
+  ClockDiscipline discipline = makeDiscipline();
+  discipline.addSample(kBaseUs, 0, kDelayUs);
+
+  // Crystal 20 ppm fast: an hour later the clock is 72 ms ahead.
+  TEST_ASSERT_FALSE(discipline.addSample(kBaseUs + kHourUs, -72000, kDelayUs));
+  TEST_ASSERT_TRUE(discipline.learned());
+  TEST_ASSERT_INT32_WITHIN(100, 20000, discipline.driftPpb());
+  TEST_ASSERT_EQUAL_UINT8(0, discipline.confidence());
+  TEST_ASSERT_EQUAL_UINT32(3600, discipline.intervalSeconds());
+  // Slewing the estimate cancels the drift...
+  TEST_ASSERT_INT32_WITHIN(100, -72000, static_cast<int32_t>(discipline.driftCorrectionUs(kHourUs)));
+
+  // ...so the next sync finds almost nothing left and the interval doubles.
+  discipline.addSample(kBaseUs + 2 * kHourUs, -1500, kDelayUs);
+  TEST_ASSERT_EQUAL_UINT8(1, discipline.confidence());
+  TEST_ASSERT_EQUAL_UINT32(7200, discipline.intervalSeconds());
+  discipline.addSample(kBaseUs + 4 * kHourUs, 800, kDelayUs);
+  TEST_ASSERT_EQUAL_UINT8(2, discipline.confidence());
+  TEST_ASSERT_EQUAL_UINT32(14400, discipline.intervalSeconds());
+  TEST_ASSERT_INT32_WITHIN(1000, 20000, discipline.driftPpb());
+}
+
+void test_missed_target_halves_the_interval() {
+  ClockDiscipline discipline = makeDiscipline();
+  ClockDriftState state;
+  state.driftPpb = 20000;
+  state.confidence = 4;
+  state.intervalSeconds = 86400;
+  discipline.restore(state);
+  discipline.addSample(kBaseUs, 0, kDelayUs);
+
+  // The crystal warmed up: 3 ppm more than expected over a day.
+  TEST_ASSERT_TRUE(discipline.addSample(kBaseUs + 24 * kHourUs, -259200, kDelayUs));
+  TEST_ASSERT_EQUAL_UINT8(0, discipline.confidence());
+  TEST_ASSERT_EQUAL_UINT32(43200, discipline.intervalSeconds());
+  TEST_ASSERT_INT32_WITHIN(100, 23000, discipline.driftPpb());
+}
+
+void test_external_clock_changes_are_not_learned() {
+  ClockDiscipline discipline = makeDiscipline();
+  discipline.addSample(kBaseUs, 0, kDelayUs);
+  // Ten minutes off after an hour is far beyond any crystal.
+  TEST_ASSERT_TRUE(discipline.addSample(kBaseUs + kHourUs, 600LL * kMicrosPerSecond, kDelayUs));
+  TEST_ASSERT_EQUAL_INT32(0, discipline.driftPpb());
+
+  // Too short a window says nothing about the rate either.
+  discipline.addSample(kBaseUs + kHourUs + 60LL * kMicrosPerSecond, -50000, kDelayUs);
+  TEST_ASSERT_EQUAL_INT32(0, discipline.driftPpb());
+}
+
+void test_state_round_trips_through_storage() {
+  ClockDriftState state;
+  state.driftPpb = -12345;
+  state.confidence = 3;
+  state.intervalSeconds = 28800;
+  TEST_ASSERT_TRUE(ClockDiscipline::save(state));
+
+  ClockDriftState loaded;
+  TEST_ASSERT_TRUE(ClockDiscipline::load(&loaded));
+  TEST_ASSERT_EQUAL_INT32(-12345, loaded.driftPpb);
+  TEST_ASSERT_EQUAL_UINT8(3, loaded.confidence);
+  TEST_ASSERT_EQUAL_UINT32(28800, loaded.intervalSeconds);
+
+  ClockDiscipline discipline = makeDiscipline();
+  loaded.intervalSeconds = 30 * 86400;
+  discipline.restore(loaded);
+  TEST_ASSERT_EQUAL_UINT32(4 * 86400, discipline.intervalSeconds());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_first_sample_only_sets_the_clock);
+  RUN_TEST(test_drift_is_learned_and_stretches_the_interval);
+  RUN_TEST(test_missed_target_halves_the_interval);
+  RUN_TEST(test_external_clock_changes_are_not_learned);
+  RUN_TEST(test_state_round_trips_through_storage);
+  UNITY_END();
+}
+
+void loop() {}
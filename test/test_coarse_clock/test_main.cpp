@@ -0,0 +1,146 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "CoarseClock.h"
+
+namespace {
+constexpr int64_t kDateSeconds = 1704067200;
+constexpr int64_t kDateMs = kDateSeconds * 1000;
+constexpr uint32_t kNearWrapMs = 0xFFFFFFFFUL - 3600000UL;
+
+// millis() of a crystal running `ppm` fast, `elapsedMs` of true time after kNearWrapMs.
+uint32_t driftedMillis(int64_t elapsedMs, int64_t ppm) {
+  return kNearWrapMs + static_cast<uint32_t>(elapsedMs + elapsedMs * ppm / 1000000);
+}
+
+// One honest server stamping its reply at true time kDateMs + elapsedMs.
+bool addHonestSample(CoarseClock* clock, int64_t elapsedMs, int64_t ppm) {
+  const int64_t stampedMs = kDateMs + elapsedMs;
+  return clock->addSample(stampedMs / 1000, driftedMillis(elapsedMs - 40, ppm),
+                          driftedMillis(elapsedMs + 40, ppm));
+}
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_one_header_bounds_time_by_a_second_plus_round_trip() {
+  CoarseClock clock;
+  TEST_ASSERT_FALSE(clock.valid());
+  TEST_ASSERT_TRUE(clock.addSample(kDateSeconds, 5000, 5200));
+  TEST_ASSERT_TRUE(clock.valid());
+  TEST_ASSERT_EQUAL_UINT8(1, clock.sources());
+  TEST_ASSERT_EQUAL_UINT32(600, clock.uncertaintyMs(5200));
+  TEST_ASSERT_TRUE(clock.unixMsAt(5200) == kDateMs + 600);
+
+  // At the reply the server clock read somewhere in [date, date + 1.2 s).
+  TEST_ASSERT_TRUE(clock.contains(kDateMs, 5200));
+  TEST_ASSERT_TRUE(clock.contains(kDateMs + 1200, 5200));
+  TEST_ASSERT_FALSE(clock.contains(kDateMs - 1, 5200));
+  TEST_ASSERT_FALSE(clock.contains(kDateMs + 1201, 5200));
+}
+
+void test_agreeing_headers_narrow_the_window() {
+  CoarseClock clock;
+  clock.addSample(kDateSeconds, 5000, 5200);
+  // 2.2 s later another server already reads three seconds on: the first
+  // header must have been stamped late in its second.
+  TEST_ASSERT_TRUE(clock.addSample(kDateSeconds + 3, 7300, 7400));
+  TEST_ASSERT_EQUAL_UINT8(2, clock.sources());
+  // 200 ms, plus 1 ms of drift allowance for the 2.2 s between the replies.
+  TEST_ASSERT_EQUAL_UINT32(201, clock.uncertaintyMs(7400));
+  TEST_ASSERT_FALSE(clock.contains(kDateMs, 5200));
+  TEST_ASSERT_TRUE(clock.contains(kDateMs + 900, 5200));
+}
+
+void test_lone_outlier_keeps_the_agreed_window() {
+  CoarseClock clock;
+  clock.addSample(kDateSeconds, 5000, 5200);
+  clock.addSample(kDateSeconds + 3, 7300, 7400);
+  clock.addSample(kDateSeconds + 4, 8100, 8200);
+  TEST_ASSERT_EQUAL_UINT8(3, clock.sources());
+  const int64_t agreedMs = clock.unixMsAt(9100);
+  const uint32_t agreedUncertaintyMs = clock.uncertaintyMs(9100);
+
+  TEST_ASSERT_TRUE(clock.addSample(kDateSeconds + 3600, 9000, 9100));
+  TEST_ASSERT_TRUE(clock.unixMsAt(9100) == agreedMs);
+  TEST_ASSERT_EQUAL_UINT8(3, clock.sources());
+  TEST_ASSERT_EQUAL_UINT32(agreedUncertaintyMs, clock.uncertaintyMs(9100));
+}
+
+void test_outvoted_window_is_replaced() {
+  CoarseClock clock;
+  clock.addSample(kDateSeconds, 5000, 5200);
+  // A tie keeps the first window.
+  clock.addSample(kDateSeconds + 3600, 9000, 9100);
+  TEST_ASSERT_TRUE(clock.contains(kDateMs, 5200));
+
+  // A second server backing the newcomer outvotes it.
+  TEST_ASSERT_TRUE(clock.addSample(kDateSeconds + 3601, 9900, 10000));
+  TEST_ASSERT_EQUAL_UINT8(2, clock.sources());
+  TEST_ASSERT_FALSE(clock.contains(kDateMs, 5200));
+  TEST_ASSERT_TRUE(clock.contains(kDateMs + 3600LL * 1000 + 950, 9100));
+}
+
+void test_honest_headers_keep_agreeing_while_the_crystal_drifts() {
+  CoarseClock clock;
+  constexpr int64_t kPpm = 40;
+  constexpr int64_t kStepMs = 10LL * 60 * 1000 + 37;
+  uint8_t expectedSources = 0;
+  // 48 hours, crossing the millis() wrap in the first hour.
+  for (int64_t elapsedMs = 0; elapsedMs < 48LL * 3600 * 1000; elapsedMs += kStepMs) {
+    TEST_ASSERT_TRUE(addHonestSample(&clock, elapsedMs, kPpm));
+    expectedSources = expectedSources < 255 ? expectedSources + 1 : 255;
+    TEST_ASSERT_EQUAL_UINT8(expectedSources, clock.sources());
+
+    const uint32_t nowMs = driftedMillis(elapsedMs + 40, kPpm);
+    const int64_t trueMs = kDateMs + elapsedMs + 40;
+    TEST_ASSERT_TRUE(clock.contains(trueMs, nowMs));
+    const int64_t errorMs = clock.unixMsAt(nowMs) - trueMs;
+    TEST_ASSERT_TRUE((errorMs < 0 ? -errorMs : errorMs) <= clock.uncertaintyMs(nowMs));
+  }
+}
+
+void test_window_survives_millis_wrap_without_samples() {
+  CoarseClock clock;
+  addHonestSample(&clock, 0, 0);
+  // 60 days of refreshes only: longer than one full millis() period.
+  const int64_t refreshStepMs = 12LL * 3600 * 1000;
+  for (int64_t elapsedMs = refreshStepMs; elapsedMs <= 60LL * 86400 * 1000; elapsedMs += refreshStepMs) {
+    clock.refresh(driftedMillis(elapsedMs, 0));
+  }
+  const int64_t elapsedMs = 60LL * 86400 * 1000;
+  TEST_ASSERT_TRUE(clock.contains(kDateMs + elapsedMs, driftedMillis(elapsedMs, 0)));
+  // 50 ppm of 60 days on each side, plus the original window.
+  TEST_ASSERT_TRUE(clock.uncertaintyMs(driftedMillis(elapsedMs, 0)) <= 260000 + 600);
+}
+
+void test_slow_or_invalid_samples_are_rejected() {
+  CoarseClock clock;
+  TEST_ASSERT_FALSE(clock.addSample(kDateSeconds, 1000, 1000 + CoarseClock::kMaxRoundTripMs + 1));
+  TEST_ASSERT_FALSE(clock.addSample(0, 1000, 1100));
+  TEST_ASSERT_FALSE(clock.valid());
+  TEST_ASSERT_FALSE(clock.contains(kDateMs, 1100));
+
+  clock.addSample(kDateSeconds, 1000, 1100);
+  clock.clear();
+  TEST_ASSERT_FALSE(clock.valid());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_one_header_bounds_time_by_a_second_plus_round_trip);
+  RUN_TEST(test_agreeing_headers_narrow_the_window);
+  RUN_TEST(test_lone_outlier_keeps_the_agreed_window);
+  RUN_TEST(test_outvoted_window_is_replaced);
+  RUN_TEST(test_honest_headers_keep_agreeing_while_the_crystal_drifts);
+  RUN_TEST(test_window_survives_millis_wrap_without_samples);
+  RUN_TEST(test_slow_or_invalid_samples_are_rejected);
+  UNITY_END();
+}
+
+void loop() {}
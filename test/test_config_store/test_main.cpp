@@ -114,6 +114,9 @@ void test_load_default_ddns_config_values() {
   const DdnsConfig config = store.loadDdnsConfig();
 
   TEST_ASSERT_FALSE(config.enabled);
+  TEST_ASSERT_FALSE(config.adaptiveInterval);
+  TEST_ASSERT_EQUAL_UINT32(60, config.adaptiveMinSeconds);
+  TEST_ASSERT_EQUAL_UINT32(3600, config.adaptiveMaxSeconds);
   TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(config.records.size()));
 }
 
@@ -121,6 +124,10 @@ void test_save_and_load_ddns_config_roundtrip() {
   ConfigStore store;
   DdnsConfig expected;
   expected.enabled = true;
+  expected.adaptiveInterval = true;
+  expected.adaptiveMinSeconds = 120;
+  // Below the minimum: raised to it.
+  expected.adaptiveMaxSeconds = 90;
 
   DdnsRecordConfig record0;
   record0.enabled = true;
@@ -146,6 +153,9 @@ void test_save_and_load_ddns_config_roundtrip() {
 
   const DdnsConfig actual = store.loadDdnsConfig();
   TEST_ASSERT_TRUE(actual.enabled);
+  TEST_ASSERT_TRUE(actual.adaptiveInterval);
+  TEST_ASSERT_EQUAL_UINT32(120, actual.adaptiveMinSeconds);
+  TEST_ASSERT_EQUAL_UINT32(120, actual.adaptiveMaxSeconds);
   TEST_ASSERT_EQUAL_UINT32(2, static_cast<uint32_t>(actual.records.size()));
 
   TEST_ASSERT_TRUE(actual.records[0].enabled);
@@ -165,6 +175,58 @@ void test_save_and_load_ddns_config_roundtrip() {
   TEST_ASSERT_TRUE(actual.records[1].useLocalIp);
 }
 
+void test_legacy_ddns_keys_are_loaded_and_converted() {
+  Preferences preferences;
+  TEST_ASSERT_TRUE(preferences.begin(kConfigNamespace, false));
+  preferences.putBool("ddns_en", true);
+  preferences.putUChar("ddns_cnt", 1);
+  preferences.putBool("dd0_en", true);
+  preferences.putString("dd0_pv", "aliyun");
+  preferences.putString("dd0_dm", "www.example.com");
+  preferences.putString("dd0_ur", "key");
+  preferences.putString("dd0_pw", "secret");
+  preferences.putUInt("dd0_iv", 600);
+  preferences.putBool("dd0_li", true);
+  preferences.end();
+
+  ConfigStore store;
+  const DdnsConfig legacy = store.loadDdnsConfig();
+  TEST_ASSERT_EQUAL_UINT32(1, static_cast<uint32_t>(legacy.records.size()));
+  TEST_ASSERT_EQUAL_STRING("www.example.com", legacy.records[0].domain.c_str());
+  TEST_ASSERT_EQUAL_UINT32(600, legacy.records[0].updateIntervalSeconds);
+  TEST_ASSERT_TRUE(legacy.records[0].useLocalIp);
+
+  TEST_ASSERT_TRUE(store.saveDdnsConfig(legacy));
+  TEST_ASSERT_TRUE(preferences.begin(kConfigNamespace, true));
+  TEST_ASSERT_FALSE(preferences.isKey("dd0_dm"));
+  TEST_ASSERT_FALSE(preferences.isKey("ddns_cnt"));
+  preferences.end();
+  TEST_ASSERT_EQUAL_STRING("secret", store.loadDdnsConfig().records[0].password.c_str());
+}
+
+void test_ddns_records_up_to_the_limit_round_trip() {
+  ConfigStore store;
+  DdnsConfig expected;
+  expected.enabled = true;
+  for (size_t index = 0; index < ConfigStore::kMaxDdnsRecords + 1; ++index) {
+    DdnsRecordConfig record;
+    record.enabled = index % 2 == 0;
+    record.domain = "h" + String(static_cast<uint32_t>(index)) + ".example.com";
+    record.username = "key";
+    record.password = "secret";
+    record.updateIntervalSeconds = 60 + index;
+    expected.records.push_back(record);
+  }
+  TEST_ASSERT_TRUE(store.saveDdnsConfig(expected));
+
+  const DdnsConfig actual = store.loadDdnsConfig();
+  TEST_ASSERT_EQUAL_UINT32(ConfigStore::kMaxDdnsRecords, static_cast<uint32_t>(actual.records.size()));
+  const DdnsRecordConfig& last = actual.records[ConfigStore::kMaxDdnsRecords - 1];
+  TEST_ASSERT_EQUAL_STRING("h63.example.com", last.domain.c_str());
+  TEST_ASSERT_FALSE(last.enabled);
+  TEST_ASSERT_EQUAL_UINT32(123, last.updateIntervalSeconds);
+}
+
 void setup() {
   Serial.begin(115200);
   delay(200);
@@ -178,6 +240,8 @@ void setup() {
   RUN_TEST(test_save_and_load_system_config_roundtrip);
   RUN_TEST(test_load_default_ddns_config_values);
   RUN_TEST(test_save_and_load_ddns_config_roundtrip);
+  RUN_TEST(test_legacy_ddns_keys_are_loaded_and_converted);
+  RUN_TEST(test_ddns_records_up_to_the_limit_round_trip);
   UNITY_END();
 }
 
@@ -0,0 +1,225 @@
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <unity.h>
+
+#include "AliyunApiGateway.h"
+#include "AliyunDdnsClient.h"
+#include "ConfigStore.h"
+#include "DdnsService.h"
+#include "WifiService.h"
+
+// Runs DdnsService against tools/aliyun_dns_stub.py. Build with e.g.
+// -DALIYUN_STUB_ENDPOINT=\"http://192.168.1.10:8053/\" and start the stub with the
+// matching --key-id/--key-secret.
+#ifndef ALIYUN_STUB_ENDPOINT
+#define ALIYUN_STUB_ENDPOINT ""
+#endif
+#ifndef ALIYUN_STUB_KEY_ID
+#define ALIYUN_STUB_KEY_ID "test-key-id"
+#endif
+#ifndef ALIYUN_STUB_KEY_SECRET
+#define ALIYUN_STUB_KEY_SECRET "test-key-secret"
+#endif
+
+namespace {
+constexpr uint32_t kWifiReconnectTimeoutMs = 15000;
+constexpr uint32_t kControlTimeoutMs = 3000;
+constexpr const char* kBenchRootDomain = "bench.example";
+constexpr const char* kStaleIp = "0.0.0.0";
+const size_t kRecordCounts[] = {1, 3, ConfigStore::kMaxDdnsRecords};
+
+struct StubStats {
+  long totalCalls = 0;
+  long bytesIn = 0;
+  long bytesOut = 0;
+};
+
+bool ensureWifiConnected(WifiService* wifiService) {
+  if (wifiService == nullptr) {
+    return false;
+  }
+
+  if (wifiService->isConnected()) {
+    return true;
+  }
+
+  if (wifiService->reconnectFromStored(kWifiReconnectTimeoutMs)) {
+    return true;
+  }
+
+  return wifiService->isConnected();
+}
+
+bool callStub(const String& pathAndQuery, String* response) {
+  WiFiClient client;
+  HTTPClient http;
+  http.setConnectTimeout(kControlTimeoutMs);
+  http.setTimeout(kControlTimeoutMs);
+  if (!http.begin(client, String(ALIYUN_STUB_ENDPOINT) + pathAndQuery)) {
+    return false;
+  }
+
+  const int code = pathAndQuery.startsWith("__stats") ? http.GET() : http.POST("");
+  if (response != nullptr) {
+    *response = code > 0 ? http.getString() : "";
+  }
+  http.end();
+  return code == HTTP_CODE_OK;
+}
+
+long readNumberField(const String& json, const char* key) {
+  const String pattern = String("\"") + key + "\":";
+  const int start = json.indexOf(pattern);
+  if (start == -1) {
+    return -1;
+  }
+  return json.substring(start + pattern.length()).toInt();
+}
+
+bool readStubStats(StubStats* stats) {
+  String response;
+  if (stats == nullptr || !callStub("__stats", &response)) {
+    return false;
+  }
+
+  stats->totalCalls = readNumberField(response, "totalCalls");
+  stats->bytesIn = readNumberField(response, "bytesIn");
+  stats->bytesOut = readNumberField(response, "bytesOut");
+  return stats->totalCalls >= 0;
+}
+
+String benchDomain(size_t index) {
+  return "h" + String(static_cast<uint32_t>(index)) + "." + kBenchRootDomain;
+}
+
+DdnsConfig buildBenchConfig(size_t recordCount) {
+  DdnsConfig config;
+  config.enabled = true;
+  for (size_t index = 0; index < recordCount; ++index) {
+    DdnsRecordConfig record;
+    record.enabled = true;
+    record.provider = DdnsService::kProviderId;
+    record.domain = benchDomain(index);
+    record.username = ALIYUN_STUB_KEY_ID;
+    record.password = ALIYUN_STUB_KEY_SECRET;
+    record.updateIntervalSeconds = 300;
+    // Local IP keeps public IP lookups out of the measurement.
+    record.useLocalIp = true;
+    config.records.push_back(record);
+  }
+  return config;
+}
+
+bool runMeasuredCycle(DdnsService* service, StubStats* delta, uint32_t* elapsedMs) {
+  StubStats before;
+  StubStats after;
+  if (!readStubStats(&before)) {
+    return false;
+  }
+
+  // The stub is seeded out of band, so cached reads must not hide it; this also
+  // makes every cycle pay for its own DescribeDomainRecords.
+  AliyunApiGateway::reset();
+  const uint32_t startMs = millis();
+  service->tick(true);
+  // Without begin() the cycle runs inline in tick(); the loop only matters once
+  // the engine task is running.
+  while (service->isSyncInProgress()) {
+    delay(10);
+    service->tick(true);
+  }
+  *elapsedMs = millis() - startMs;
+
+  if (!readStubStats(&after)) {
+    return false;
+  }
+  delta->totalCalls = after.totalCalls - before.totalCalls;
+  delta->bytesIn = after.bytesIn - before.bytesIn;
+  delta->bytesOut = after.bytesOut - before.bytesOut;
+  return true;
+}
+}  // namespace
+
+void setUp() {
+  WiFi.mode(WIFI_STA);
+}
+
+void tearDown() {
+  AliyunDdnsClient::setEndpoint("");
+}
+
+void test_ddns_sync_cycle_cost_scales_with_records() {
+  if (String(ALIYUN_STUB_ENDPOINT).isEmpty()) {
+    TEST_IGNORE_MESSAGE("ALIYUN_STUB_ENDPOINT not defined. Start tools/aliyun_dns_stub.py first.");
+    return;
+  }
+
+  WifiService wifiService;
+  if (!ensureWifiConnected(&wifiService)) {
+    TEST_IGNORE_MESSAGE("WiFi not connected. Save WiFi config first, then rerun this test.");
+    return;
+  }
+
+  AliyunDdnsClient::setEndpoint(ALIYUN_STUB_ENDPOINT);
+  TEST_ASSERT_TRUE_MESSAGE(callStub("__reset", nullptr), "Aliyun DNS stub unreachable.");
+
+
+  // Learn the stub's clock first so a skew retry cannot inflate the counts below.
+  AliyunDdnsClient warmupClient;
+  warmupClient.begin(ALIYUN_STUB_KEY_ID, ALIYUN_STUB_KEY_SECRET, kBenchRootDomain);
+  std::vector<AliyunDomainRecord> zone;
+  TEST_ASSERT_TRUE(warmupClient.describeDomainRecords(kBenchRootDomain, "A", &zone));
+
+  ConfigStore configStore;
+  Serial.println("[DDNS Benchmark] records,cycle,apiCalls,bytesIn,bytesOut,elapsedMs");
+  for (size_t run = 0; run < sizeof(kRecordCounts) / sizeof(kRecordCounts[0]); ++run) {
+    const size_t recordCount = kRecordCounts[run];
+    for (size_t index = 0; index < recordCount; ++index) {
+      const String seedQuery = "__seed?domain=" + String(kBenchRootDomain) +
+                               "&rr=h" + String(static_cast<uint32_t>(index)) +
+                               "&value=" + kStaleIp;
+      TEST_ASSERT_TRUE(callStub(seedQuery, nullptr));
+    }
+
+    DdnsService service(configStore);
+    service.updateConfig(buildBenchConfig(recordCount));
+
+    // Cycle 1 pushes every stale record; cycle 2 is the steady state.
+    for (uint8_t cycle = 1; cycle <= 2; ++cycle) {
+      if (cycle > 1) {
+        service.requestSyncAll();
+      }
+
+      StubStats delta;
+      uint32_t elapsedMs = 0;
+      TEST_ASSERT_TRUE(runMeasuredCycle(&service, &delta, &elapsedMs));
+      Serial.printf("[DDNS Benchmark] %u,%u,%ld,%ld,%ld,%lu\n",
+                    static_cast<unsigned>(recordCount),
+                    static_cast<unsigned>(cycle),
+                    delta.totalCalls,
+                    delta.bytesIn,
+                    delta.bytesOut,
+                    static_cast<unsigned long>(elapsedMs));
+
+      const long expectedCalls = cycle == 1 ? static_cast<long>(recordCount) + 1 : 1;
+      TEST_ASSERT_EQUAL_INT32(expectedCalls, delta.totalCalls);
+    }
+
+    const std::vector<DdnsRecordRuntimeStatus> records = service.getRecordStatuses();
+    for (size_t index = 0; index < records.size(); ++index) {
+      TEST_ASSERT_FALSE(records[index].lastNewIp.isEmpty());
+    }
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_ddns_sync_cycle_cost_scales_with_records);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,143 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#define private public
+#include "DdnsLeaderElection.h"
+#undef private
+
+namespace {
+constexpr uint32_t kCluster = 0x1234;
+const IPAddress kPeerAddress(192, 168, 1, 20);
+
+DdnsLeaderElection::Announcement announcementFrom(uint32_t nodeId, bool leader) {
+  DdnsLeaderElection::Announcement announcement;
+  announcement.clusterId = kCluster;
+  announcement.nodeId = nodeId;
+  announcement.leader = leader;
+  announcement.leaseMs = leader ? static_cast<uint16_t>(DdnsLeaderElection::kLeaseMs) : 0;
+  return announcement;
+}
+
+// Enabled election with a fixed node id; the task is marked as running so
+// isLeader() reports the elected role.
+void prepare(DdnsLeaderElection* election, uint32_t nodeId) {
+  election->_nodeId = nodeId;
+  election->_started = true;
+  election->_enabled = true;
+  election->_clusterId = kCluster;
+  election->resetRole(0);
+}
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_lone_board_claims_after_discovery() {
+  DdnsLeaderElection election;
+  prepare(&election, 100);
+  TEST_ASSERT_TRUE(election.step(0));
+  TEST_ASSERT_FALSE(election.isLeader());
+
+  election.step(DdnsLeaderElection::kDiscoveryMs);
+  TEST_ASSERT_TRUE(election.isLeader());
+  TEST_ASSERT_TRUE(election.ownAnnouncement().leader);
+  election._started = false;
+}
+
+void test_follower_takes_over_when_the_lease_runs_out() {
+  DdnsLeaderElection election;
+  prepare(&election, 200);
+  election.handleAnnouncement(announcementFrom(100, true), kPeerAddress, 500);
+  election.step(DdnsLeaderElection::kDiscoveryMs);
+  TEST_ASSERT_EQUAL(DdnsLanRole::Follower, election._role);
+  TEST_ASSERT_FALSE(election.isLeader());
+  TEST_ASSERT_EQUAL_STRING("192.168.1.20", election.getStatus().leaderIp.c_str());
+
+  // Renewed leases keep it a follower.
+  election.handleAnnouncement(announcementFrom(100, true), kPeerAddress, 4000);
+  election.step(8000);
+  TEST_ASSERT_FALSE(election.isLeader());
+
+  // Silent leader: the next step after its lease claims the role.
+  election.step(4000 + DdnsLeaderElection::kLeaseMs);
+  TEST_ASSERT_TRUE(election.isLeader());
+  TEST_ASSERT_EQUAL_UINT32(1, election.getStatus().takeovers);
+  election._started = false;
+}
+
+void test_lower_live_board_claims_first() {
+  DdnsLeaderElection election;
+  prepare(&election, 200);
+  election.handleAnnouncement(announcementFrom(100, false), kPeerAddress, 2000);
+  election.step(DdnsLeaderElection::kDiscoveryMs);
+  TEST_ASSERT_EQUAL(DdnsLanRole::Candidate, election._role);
+
+  // The lower board went quiet without claiming: its entry ages out.
+  election.step(2000 + DdnsLeaderElection::kLeaseMs);
+  TEST_ASSERT_TRUE(election.isLeader());
+  election._started = false;
+}
+
+void test_higher_leader_steps_down_for_lower_one() {
+  DdnsLeaderElection election;
+  prepare(&election, 200);
+  election.step(DdnsLeaderElection::kDiscoveryMs);
+  TEST_ASSERT_TRUE(election.isLeader());
+
+  election.handleAnnouncement(announcementFrom(300, true), kPeerAddress, 3500);
+  TEST_ASSERT_TRUE(election.isLeader());
+  election.handleAnnouncement(announcementFrom(100, true), kPeerAddress, 3600);
+  TEST_ASSERT_FALSE(election.isLeader());
+  TEST_ASSERT_EQUAL_UINT32(100, election.getStatus().leaderId);
+  election._started = false;
+}
+
+void test_other_clusters_and_bad_packets_are_ignored() {
+  DdnsLeaderElection election;
+  prepare(&election, 200);
+  DdnsLeaderElection::Announcement foreign = announcementFrom(100, true);
+  foreign.clusterId = kCluster + 1;
+  election.handleAnnouncement(foreign, kPeerAddress, 500);
+  TEST_ASSERT_EQUAL_UINT32(0, election.getStatus().peerCount);
+
+  uint8_t packet[DdnsLeaderElection::kPacketSize];
+  const size_t length =
+      DdnsLeaderElection::encode(announcementFrom(100, true), packet, sizeof(packet));
+  DdnsLeaderElection::Announcement decoded;
+  TEST_ASSERT_TRUE(DdnsLeaderElection::decode(packet, length, &decoded));
+  TEST_ASSERT_EQUAL_UINT32(100, decoded.nodeId);
+  TEST_ASSERT_TRUE(decoded.leader);
+  TEST_ASSERT_EQUAL_UINT32(DdnsLeaderElection::kLeaseMs, decoded.leaseMs);
+
+  packet[0] = 'X';
+  TEST_ASSERT_FALSE(DdnsLeaderElection::decode(packet, length, &decoded));
+  TEST_ASSERT_FALSE(DdnsLeaderElection::decode(packet, length - 1, &decoded));
+  election._started = false;
+}
+
+void test_disabled_election_always_leads() {
+  DdnsLeaderElection election;
+  election._started = true;
+  election.configure(false, kCluster);
+  TEST_ASSERT_TRUE(election.isLeader());
+  election.configure(true, kCluster);
+  TEST_ASSERT_FALSE(election.isLeader());
+  election._started = false;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_lone_board_claims_after_discovery);
+  RUN_TEST(test_follower_takes_over_when_the_lease_runs_out);
+  RUN_TEST(test_lower_live_board_claims_first);
+  RUN_TEST(test_higher_leader_steps_down_for_lower_one);
+  RUN_TEST(test_other_clusters_and_bad_packets_are_ignored);
+  RUN_TEST(test_disabled_election_always_leads);
+  UNITY_END();
+}
+
+void loop() {}
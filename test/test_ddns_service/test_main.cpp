@@ -1,12 +1,29 @@
 #include <Arduino.h>
 #include <unity.h>
 
+#define private public
+#include "AliyunDdnsClient.h"
 #include "DdnsService.h"
+#undef private
+#include "AliyunCircuitBreaker.h"
 #include "ConfigStore.h"
+#include "DdnsStateStore.h"
+#include "Hal.h"
+#include "SharedHttpClient.h"
 
 namespace {
 ConfigStore configStore;
 DdnsService service(configStore);
+
+class CountingHttpClient : public HalHttpClient {
+ public:
+  uint32_t calls = 0;
+
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    calls += 1;
+    return false;
+  }
+};
 }
 
 void setUp() {}
@@ -65,6 +82,263 @@ void test_non_aliyun_provider_and_interval_are_normalized() {
   TEST_ASSERT_EQUAL_UINT32(300, records[0].updateIntervalSeconds);
 }
 
+void test_network_event_makes_records_due_after_debounce() {
+  DdnsConfig config;
+  config.enabled = true;
+
+  DdnsRecordConfig record;
+  record.enabled = true;
+  record.provider = "aliyun";
+  record.domain = "www.example.com";
+  record.username = "key";
+  record.password = "secret";
+  record.updateIntervalSeconds = 600;
+  config.records.push_back(record);
+  service.updateConfig(config);
+
+  const uint32_t now = millis();
+  service._runtimeRecords[0].nextSyncDueAtMs = now + 600000UL;
+  service.notify(DdnsTrigger::WifiGotIp);
+  service.notify(DdnsTrigger::WifiLostIp);
+  service.notify(DdnsTrigger::WifiGotIp);
+
+  service.applyPendingEvents(now + 100);
+  TEST_ASSERT_EQUAL_UINT32(now + 600000UL, service._runtimeRecords[0].nextSyncDueAtMs);
+
+  const uint32_t settled = now + DdnsService::kEventDebounceMs + 100;
+  service.applyPendingEvents(settled);
+  TEST_ASSERT_EQUAL_UINT32(settled, service._runtimeRecords[0].nextSyncDueAtMs);
+  TEST_ASSERT_EQUAL_UINT32(1, service._eventSyncCount);
+}
+
+void test_engine_task_publishes_queued_config() {
+  DdnsService engine(configStore);
+  engine.begin();
+
+  DdnsConfig config;
+  config.enabled = true;
+  DdnsRecordConfig record;
+  record.enabled = true;
+  record.provider = "aliyun";
+  record.domain = "www.example.com";
+  record.username = "key";
+  record.password = "secret";
+  config.records.push_back(record);
+  engine.updateConfig(config);
+  engine.tick(false);
+
+  const uint32_t startedAtMs = millis();
+  while (engine.getStatus().state != "WAIT_WIFI" && millis() - startedAtMs < 3000) {
+    delay(10);
+  }
+  const DdnsRuntimeStatus status = engine.getStatus();
+  TEST_ASSERT_EQUAL_STRING("WAIT_WIFI", status.state.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, status.activeRecordCount);
+  TEST_ASSERT_EQUAL_STRING("WAIT_WIFI", engine.getRecordStatuses()[0].state.c_str());
+}
+
+void test_restored_state_skips_aliyun_while_ip_is_unchanged() {
+  const String localIp = Hal::wifi().localIp().toString();
+  if (localIp == "0.0.0.0") {
+    TEST_IGNORE_MESSAGE("No station address to sync.");
+    return;
+  }
+
+  DdnsConfig config;
+  config.enabled = true;
+  DdnsRecordConfig record;
+  record.enabled = true;
+  record.provider = "aliyun";
+  record.domain = "nas.example.com";
+  record.username = "key";
+  record.password = "secret";
+  record.useLocalIp = true;
+  config.records.push_back(record);
+
+  std::vector<DdnsPersistedRecord> saved(1);
+  saved[0].identity = DdnsStateStore::identityOf(record);
+  saved[0].recordId = "1001";
+  saved[0].confirmedIp = localIp;
+  saved[0].updateCount = 4;
+  TEST_ASSERT_TRUE(DdnsStateStore::save(saved));
+
+  // begin() minus the engine task, so the cycle runs inline below.
+  DdnsService rebooted(configStore);
+  rebooted._begun = true;
+  rebooted._bootStatePending = DdnsStateStore::load(&rebooted._bootState);
+  rebooted._savedState = rebooted._bootState;
+  rebooted.updateConfig(config);
+
+  CountingHttpClient http;
+  Hal::setHttpClient(&http);
+  rebooted.tick(true);
+  Hal::setHttpClient(nullptr);
+  DdnsStateStore::clear();
+
+  TEST_ASSERT_EQUAL_UINT32(0, http.calls);
+  const std::vector<DdnsRecordRuntimeStatus> records = rebooted.getRecordStatuses();
+  TEST_ASSERT_EQUAL_STRING(localIp.c_str(), records[0].lastNewIp.c_str());
+  TEST_ASSERT_EQUAL_UINT32(4, records[0].updateCount);
+  TEST_ASSERT_EQUAL_UINT32(4, rebooted.getStatus().totalUpdateCount);
+  TEST_ASSERT_TRUE(records[0].message.startsWith("Record unchanged since last boot"));
+
+  size_t total = 0;
+  DdnsSyncSummary overall;
+  const std::vector<DdnsRecordSyncHistory> history = rebooted.getSyncHistory(0, 16, &total, &overall);
+  TEST_ASSERT_EQUAL_UINT32(1, static_cast<uint32_t>(total));
+  TEST_ASSERT_EQUAL_UINT32(1, static_cast<uint32_t>(history[0].attempts.size()));
+  TEST_ASSERT_EQUAL(DdnsSyncOutcome::Unchanged, history[0].attempts[0].outcome);
+  TEST_ASSERT_EQUAL_UINT32(0, history[0].attempts[0].apiMs);
+  TEST_ASSERT_EQUAL_UINT32(1, overall.attempts);
+}
+
+DdnsRecordConfig makeAliyunRecord(const String& domain) {
+  DdnsRecordConfig record;
+  record.enabled = true;
+  record.provider = "aliyun";
+  record.domain = domain;
+  record.username = "key";
+  record.password = "secret";
+  record.updateIntervalSeconds = 600;
+  return record;
+}
+
+void test_editing_one_record_keeps_the_others() {
+  DdnsService local(configStore);
+  DdnsConfig config;
+  config.enabled = true;
+  config.records.push_back(makeAliyunRecord("www.example.com"));
+  config.records.push_back(makeAliyunRecord("api.example.com"));
+  config.records.push_back(makeAliyunRecord("old.example.com"));
+  local.updateConfig(config);
+
+  const uint32_t now = millis();
+  for (size_t index = 0; index < local._runtimeRecords.size(); ++index) {
+    local._runtimeRecords[index].recordId = String(static_cast<uint32_t>(100 + index));
+    local._runtimeRecords[index].firstSyncPending = false;
+    local._runtimeRecords[index].checkIntervalSeconds = 600;
+    local._runtimeRecords[index].nextSyncDueAtMs = now + 500000UL;
+    local._runtimeRecords[index].updateCount = 1;
+  }
+
+  // Reorder, drop one, add one, change one password and one interval.
+  DdnsConfig edited;
+  edited.enabled = true;
+  edited.records.push_back(makeAliyunRecord("api.example.com"));
+  edited.records.push_back(makeAliyunRecord("www.example.com"));
+  edited.records.push_back(makeAliyunRecord("new.example.com"));
+  edited.records[0].password = "rotated";
+  edited.records[1].updateIntervalSeconds = 300;
+  local.updateConfig(edited);
+
+  TEST_ASSERT_EQUAL_UINT32(3, static_cast<uint32_t>(local._runtimeRecords.size()));
+  const DdnsService::RuntimeRecord& api = local._runtimeRecords[0];
+  TEST_ASSERT_EQUAL_STRING("101", api.recordId.c_str());
+  TEST_ASSERT_TRUE(api.firstSyncPending);
+
+  const DdnsService::RuntimeRecord& www = local._runtimeRecords[1];
+  TEST_ASSERT_EQUAL_STRING("100", www.recordId.c_str());
+  TEST_ASSERT_FALSE(www.firstSyncPending);
+  // Same phase, new interval, within the same +-5% jitter as a regular cycle.
+  TEST_ASSERT_UINT32_WITHIN(15000UL, now + 200000UL, www.nextSyncDueAtMs);
+
+  TEST_ASSERT_TRUE(local._runtimeRecords[2].recordId.isEmpty());
+  TEST_ASSERT_EQUAL_UINT32(2, local.getStatus().totalUpdateCount);
+}
+
+void test_new_secret_resets_only_its_own_breaker() {
+  DdnsService local(configStore);
+  DdnsConfig config;
+  config.enabled = true;
+  config.records.push_back(makeAliyunRecord("www.example.com"));
+  config.records.push_back(makeAliyunRecord("www.example.org"));
+  config.records[1].username = "throttled-key";
+  local.updateConfig(config);
+
+  const uint32_t now = millis();
+  AliyunCircuitBreaker::reset();
+  AliyunCircuitBreaker::recordResult("key", AliyunErrorClass::Auth, "InvalidAccessKeySecret", now);
+  AliyunCircuitBreaker::recordResult("throttled-key", AliyunErrorClass::Throttled, "Throttling.User", now);
+
+  config.records[0].password = "rotated";
+  local.updateConfig(config);
+  TEST_ASSERT_TRUE(AliyunCircuitBreaker::allowRequest("key", now + 1));
+  TEST_ASSERT_FALSE(AliyunCircuitBreaker::allowRequest("throttled-key", now + 1));
+  AliyunCircuitBreaker::reset();
+}
+
+void test_first_syncs_are_spread_by_zone() {
+  DdnsService local(configStore);
+  DdnsConfig config;
+  config.enabled = true;
+  config.records.push_back(makeAliyunRecord("www.example.com"));
+  config.records.push_back(makeAliyunRecord("www.example.org"));
+  config.records.push_back(makeAliyunRecord("api.example.com"));
+  config.records.push_back(makeAliyunRecord("www.example.net"));
+  local.updateConfig(config);
+
+  const uint32_t now = millis();
+  local.staggerFirstSyncs(now);
+  // Same zone and key: one slot, so they still share a DescribeDomainRecords call.
+  TEST_ASSERT_EQUAL_UINT32(now, local._runtimeRecords[0].nextSyncDueAtMs);
+  TEST_ASSERT_EQUAL_UINT32(now, local._runtimeRecords[2].nextSyncDueAtMs);
+  TEST_ASSERT_EQUAL_UINT32(now + 10000UL, local._runtimeRecords[1].nextSyncDueAtMs);
+  TEST_ASSERT_EQUAL_UINT32(now + 20000UL, local._runtimeRecords[3].nextSyncDueAtMs);
+
+  // Already scheduled records keep their slot.
+  local._runtimeRecords[1].nextSyncDueAtMs = now + 99000UL;
+  local.staggerFirstSyncs(now + 5000UL);
+  TEST_ASSERT_EQUAL_UINT32(now + 99000UL, local._runtimeRecords[1].nextSyncDueAtMs);
+}
+
+void test_first_syncs_split_zones_by_secret() {
+  DdnsService local(configStore);
+  DdnsConfig config;
+  config.enabled = true;
+  config.records.push_back(makeAliyunRecord("www.example.com"));
+  config.records.push_back(makeAliyunRecord("api.example.com"));
+  config.records[1].password = "other-secret";
+  local.updateConfig(config);
+
+  // A different secret is a different sync group, so it gets its own slot.
+  const uint32_t now = millis();
+  local.staggerFirstSyncs(now);
+  TEST_ASSERT_EQUAL_UINT32(now, local._runtimeRecords[0].nextSyncDueAtMs);
+  TEST_ASSERT_EQUAL_UINT32(now + 15000UL, local._runtimeRecords[1].nextSyncDueAtMs);
+}
+
+void test_zone_record_list_is_parsed() {
+  const String response =
+      "{\"TotalCount\":2,\"PageSize\":500,\"DomainRecords\":{\"Record\":["
+      "{\"RR\":\"www\",\"Type\":\"A\",\"Value\":\"1.2.3.4\",\"RecordId\":\"101\","
+      "\"Remark\":\"a } b\",\"TTL\":600},"
+      "{\"RR\":\"@\",\"Type\":\"A\",\"Value\":\"5.6.7.8\",\"RecordId\":\"102\",\"TTL\":600}"
+      "]},\"PageNumber\":1}";
+
+  AliyunDdnsClient client;
+  std::vector<AliyunDomainRecord> records;
+  TEST_ASSERT_TRUE(client.parseDomainRecordList(response, &records));
+  TEST_ASSERT_EQUAL_UINT32(2, static_cast<uint32_t>(records.size()));
+  TEST_ASSERT_EQUAL_STRING("www", records[0].rr.c_str());
+  TEST_ASSERT_EQUAL_STRING("101", records[0].recordId.c_str());
+  TEST_ASSERT_EQUAL_STRING("1.2.3.4", records[0].value.c_str());
+  TEST_ASSERT_EQUAL_STRING("@", records[1].rr.c_str());
+  TEST_ASSERT_EQUAL_STRING("5.6.7.8", records[1].value.c_str());
+
+  long totalCount = 0;
+  TEST_ASSERT_TRUE(client.parseJsonNumberField(response, "TotalCount", &totalCount));
+  TEST_ASSERT_EQUAL_INT32(2, totalCount);
+}
+
+void test_http_date_is_parsed() {
+  time_t unixTime = 0;
+  TEST_ASSERT_TRUE(SharedHttpClient::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT", &unixTime));
+  TEST_ASSERT_EQUAL_UINT32(784111777UL, static_cast<uint32_t>(unixTime));
+  TEST_ASSERT_TRUE(SharedHttpClient::parseHttpDate("Tue, 14 Nov 2023 14:13:20 GMT", &unixTime));
+  TEST_ASSERT_EQUAL_UINT32(1699971200UL, static_cast<uint32_t>(unixTime));
+  TEST_ASSERT_FALSE(SharedHttpClient::parseHttpDate("not a date", &unixTime));
+}
+
 void setup() {
   Serial.begin(115200);
   delay(200);
@@ -73,6 +347,15 @@ void setup() {
   RUN_TEST(test_default_status_is_disabled);
   RUN_TEST(test_configured_record_is_exposed);
   RUN_TEST(test_non_aliyun_provider_and_interval_are_normalized);
+  RUN_TEST(test_network_event_makes_records_due_after_debounce);
+  RUN_TEST(test_engine_task_publishes_queued_config);
+  RUN_TEST(test_restored_state_skips_aliyun_while_ip_is_unchanged);
+  RUN_TEST(test_editing_one_record_keeps_the_others);
+  RUN_TEST(test_new_secret_resets_only_its_own_breaker);
+  RUN_TEST(test_first_syncs_are_spread_by_zone);
+  RUN_TEST(test_first_syncs_split_zones_by_secret);
+  RUN_TEST(test_zone_record_list_is_parsed);
+  RUN_TEST(test_http_date_is_parsed);
   UNITY_END();
 }
 
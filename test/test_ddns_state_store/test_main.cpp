@@ -0,0 +1,84 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "DdnsStateStore.h"
+#include "Hal.h"
+
+namespace {
+DdnsRecordConfig makeRecord(const String& domain, bool useLocalIp) {
+  DdnsRecordConfig record;
+  record.enabled = true;
+  record.provider = "aliyun";
+  record.domain = domain;
+  record.username = "key";
+  record.password = "secret";
+  record.useLocalIp = useLocalIp;
+  return record;
+}
+}  // namespace
+
+void setUp() {
+  DdnsStateStore::clear();
+}
+
+void tearDown() {
+  DdnsStateStore::clear();
+}
+
+void test_identity_follows_domain_account_and_source() {
+  const uint32_t identity = DdnsStateStore::identityOf(makeRecord("www.example.com", false));
+  TEST_ASSERT_EQUAL_UINT32(identity, DdnsStateStore::identityOf(makeRecord(" WWW.example.com", false)));
+  TEST_ASSERT_NOT_EQUAL(identity, DdnsStateStore::identityOf(makeRecord("www.example.com", true)));
+  TEST_ASSERT_NOT_EQUAL(identity, DdnsStateStore::identityOf(makeRecord("api.example.com", false)));
+
+  DdnsRecordConfig otherAccount = makeRecord("www.example.com", false);
+  otherAccount.username = "other";
+  TEST_ASSERT_NOT_EQUAL(identity, DdnsStateStore::identityOf(otherAccount));
+}
+
+void test_records_round_trip() {
+  std::vector<DdnsPersistedRecord> saved(2);
+  saved[0].identity = DdnsStateStore::identityOf(makeRecord("www.example.com", false));
+  saved[0].recordId = "12345678901234567890";
+  saved[0].confirmedIp = "203.0.113.7";
+  saved[0].lastUpdateAt = 1700000000;
+  saved[0].updateCount = 3;
+  saved[1].identity = DdnsStateStore::identityOf(makeRecord("nas.example.com", true));
+  TEST_ASSERT_TRUE(DdnsStateStore::save(saved));
+
+  std::vector<DdnsPersistedRecord> loaded;
+  TEST_ASSERT_TRUE(DdnsStateStore::load(&loaded));
+  TEST_ASSERT_EQUAL_UINT32(2, static_cast<uint32_t>(loaded.size()));
+  TEST_ASSERT_EQUAL_UINT32(saved[0].identity, loaded[0].identity);
+  TEST_ASSERT_EQUAL_STRING("12345678901234567890", loaded[0].recordId.c_str());
+  TEST_ASSERT_EQUAL_STRING("203.0.113.7", loaded[0].confirmedIp.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1700000000, loaded[0].lastUpdateAt);
+  TEST_ASSERT_EQUAL_UINT32(3, loaded[0].updateCount);
+  TEST_ASSERT_TRUE(loaded[1].recordId.isEmpty());
+  TEST_ASSERT_TRUE(loaded[1].confirmedIp.isEmpty());
+}
+
+void test_truncated_blob_is_ignored() {
+  const uint8_t truncated[] = {1, 2, 0, 0, 0xAA, 0xBB};
+  KeyValueStore preferences;
+  TEST_ASSERT_TRUE(preferences.begin("ddns_state", false));
+  preferences.putBytes("records", truncated, sizeof(truncated));
+  preferences.end();
+
+  std::vector<DdnsPersistedRecord> loaded(1);
+  TEST_ASSERT_FALSE(DdnsStateStore::load(&loaded));
+  TEST_ASSERT_TRUE(loaded.empty());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_identity_follows_domain_account_and_source);
+  RUN_TEST(test_records_round_trip);
+  RUN_TEST(test_truncated_blob_is_ignored);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,78 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "DdnsSyncHistory.h"
+
+namespace {
+DdnsSyncAttempt makeAttempt(DdnsSyncOutcome outcome, uint32_t totalMs) {
+  DdnsSyncAttempt attempt;
+  attempt.atMs = totalMs;
+  attempt.outcome = outcome;
+  attempt.resolveMs = totalMs / 4;
+  attempt.apiMs = totalMs / 2;
+  attempt.totalMs = totalMs;
+  return attempt;
+}
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_ring_keeps_latest_attempts_oldest_first() {
+  DdnsSyncHistory history;
+  for (uint32_t i = 1; i <= DdnsSyncHistory::kCapacity + 3; ++i) {
+    history.record(makeAttempt(DdnsSyncOutcome::UpToDate, i * 100));
+  }
+
+  const std::vector<DdnsSyncAttempt> attempts = history.attempts();
+  TEST_ASSERT_EQUAL_UINT32(DdnsSyncHistory::kCapacity, static_cast<uint32_t>(attempts.size()));
+  TEST_ASSERT_EQUAL_UINT32(400, attempts.front().atMs);
+  TEST_ASSERT_EQUAL_UINT32((DdnsSyncHistory::kCapacity + 3) * 100, attempts.back().atMs);
+
+  history.clear();
+  TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(history.size()));
+}
+
+void test_summary_uses_nearest_rank_percentiles() {
+  std::vector<DdnsSyncAttempt> attempts;
+  for (uint32_t i = 1; i <= 20; ++i) {
+    attempts.push_back(makeAttempt(DdnsSyncOutcome::UpToDate, i * 100));
+  }
+  attempts.push_back(makeAttempt(DdnsSyncOutcome::ListFailed, 5000));
+  DdnsSyncAttempt updated = makeAttempt(DdnsSyncOutcome::Updated, 800);
+  updated.changeToUpdateMs = 30000;
+  attempts.push_back(updated);
+  // Restored state skipped Aliyun: counts for resolve and total, not for the API.
+  DdnsSyncAttempt unchanged = makeAttempt(DdnsSyncOutcome::Unchanged, 40);
+  unchanged.apiMs = 0;
+  attempts.push_back(unchanged);
+
+  const DdnsSyncSummary summary = DdnsSyncHistory::summarize(attempts);
+  TEST_ASSERT_EQUAL_UINT32(23, summary.attempts);
+  TEST_ASSERT_EQUAL_UINT32(1, summary.failures);
+  TEST_ASSERT_EQUAL_UINT32(1000, summary.totalMs.p50);
+  TEST_ASSERT_EQUAL_UINT32(2000, summary.totalMs.p95);
+  TEST_ASSERT_EQUAL_UINT32(500, summary.apiMs.p50);
+  TEST_ASSERT_EQUAL_UINT32(30000, summary.changeToUpdateMs.p50);
+  TEST_ASSERT_EQUAL_UINT32(30000, summary.changeToUpdateMs.p95);
+}
+
+void test_empty_summary_is_zero() {
+  const DdnsSyncSummary summary = DdnsSyncHistory::summarize({});
+  TEST_ASSERT_EQUAL_UINT32(0, summary.attempts);
+  TEST_ASSERT_EQUAL_UINT32(0, summary.totalMs.p95);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_keeps_latest_attempts_oldest_first);
+  RUN_TEST(test_summary_uses_nearest_rank_percentiles);
+  RUN_TEST(test_empty_summary_is_zero);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,86 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <unity.h>
+
+#include "DnsCache.h"
+#include "WifiService.h"
+
+namespace {
+constexpr uint32_t kWifiReconnectTimeoutMs = 15000;
+constexpr const char* kLookupHost = "alidns.aliyuncs.com";
+
+bool ensureWifiConnected(WifiService* wifiService) {
+  if (wifiService == nullptr) {
+    return false;
+  }
+
+  if (wifiService->isConnected()) {
+    return true;
+  }
+
+  if (wifiService->reconnectFromStored(kWifiReconnectTimeoutMs)) {
+    return true;
+  }
+
+  return wifiService->isConnected();
+}
+}  // namespace
+
+void setUp() {
+  WiFi.mode(WIFI_STA);
+  DnsCache::clear();
+}
+
+void tearDown() {}
+
+void test_host_is_extracted_from_url() {
+  TEST_ASSERT_EQUAL_STRING("alidns.aliyuncs.com",
+                           DnsCache::hostOfUrl("https://alidns.aliyuncs.com/").c_str());
+  TEST_ASSERT_EQUAL_STRING("192.168.1.10",
+                           DnsCache::hostOfUrl("http://192.168.1.10:8053/?a=b").c_str());
+  TEST_ASSERT_EQUAL_STRING("ifconfig.me", DnsCache::hostOfUrl("https://ifconfig.me/ip").c_str());
+}
+
+void test_ip_literal_bypasses_cache() {
+  IPAddress address;
+  TEST_ASSERT_TRUE(DnsCache::resolve("10.0.0.1", &address));
+  TEST_ASSERT_TRUE(address == IPAddress(10, 0, 0, 1));
+
+  const DnsCacheStats stats = DnsCache::getStats();
+  TEST_ASSERT_EQUAL_UINT32(0, stats.misses);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.lookups);
+}
+
+void test_second_resolve_is_a_cache_hit() {
+  WifiService wifiService;
+  if (!ensureWifiConnected(&wifiService)) {
+    TEST_IGNORE_MESSAGE("WiFi not connected. Save WiFi config first, then rerun this test.");
+    return;
+  }
+
+  IPAddress first;
+  IPAddress second;
+  TEST_ASSERT_TRUE(DnsCache::resolve(kLookupHost, &first));
+  TEST_ASSERT_TRUE(DnsCache::resolve(kLookupHost, &second));
+  TEST_ASSERT_TRUE(first == second);
+
+  const DnsCacheStats stats = DnsCache::getStats();
+  Serial.printf("[DNS Cache] lookups=%lu lastLookupMs=%lu\n",
+                static_cast<unsigned long>(stats.lookups),
+                static_cast<unsigned long>(stats.lastLookupMs));
+  TEST_ASSERT_EQUAL_UINT32(1, stats.misses);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.hits);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_host_is_extracted_from_url);
+  RUN_TEST(test_ip_literal_bypasses_cache);
+  RUN_TEST(test_second_resolve_is_a_cache_hit);
+  UNITY_END();
+}
+
+void loop() {}
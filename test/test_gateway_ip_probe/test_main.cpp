@@ -0,0 +1,210 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#define private public
+#include "GatewayIpProbe.h"
+#undef private
+
+#include "Hal.h"
+#include "SharedHttpClient.h"
+
+namespace {
+constexpr uint32_t kQueryTimeoutMs = 1000;
+
+// Answers NAT-PMP external address requests like a home router would.
+class FakeNatPmpSocket : public HalUdpSocket {
+ public:
+  static bool enabled;
+  static uint8_t wanAddress[4];
+  static uint32_t datagramsSent;
+
+  bool begin(uint16_t localPort) override { return true; }
+  void stop() override {}
+  bool beginPacket(const IPAddress& address, uint16_t port) override {
+    _peer = address;
+    _peerPort = port;
+    _outgoingLength = 0;
+    return true;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    if (_outgoingLength + length > sizeof(_outgoing)) {
+      return 0;
+    }
+    memcpy(_outgoing + _outgoingLength, data, length);
+    _outgoingLength += length;
+    return length;
+  }
+  bool endPacket() override {
+    datagramsSent += 1;
+    if (enabled && _outgoingLength == 2 && _outgoing[0] == 0 && _outgoing[1] == 0) {
+      const uint8_t response[12] = {0, 128, 0, 0, 0, 0, 0, 1,
+                                    wanAddress[0], wanAddress[1], wanAddress[2], wanAddress[3]};
+      memcpy(_incoming, response, sizeof(response));
+      _incomingLength = sizeof(response);
+    }
+    return true;
+  }
+  int parsePacket() override {
+    const size_t pending = _incomingLength;
+    _incomingLength = 0;
+    _readLength = pending;
+    return static_cast<int>(pending);
+  }
+  int read(uint8_t* buffer, size_t length) override {
+    const size_t count = length < _readLength ? length : _readLength;
+    memcpy(buffer, _incoming, count);
+    _readLength = 0;
+    return static_cast<int>(count);
+  }
+  IPAddress remoteIP() override { return _peer; }
+  uint16_t remotePort() override { return _peerPort; }
+
+ private:
+  IPAddress _peer;
+  uint16_t _peerPort = 0;
+  uint8_t _outgoing[512];
+  size_t _outgoingLength = 0;
+  uint8_t _incoming[64];
+  size_t _incomingLength = 0;
+  size_t _readLength = 0;
+};
+
+bool FakeNatPmpSocket::enabled = true;
+uint8_t FakeNatPmpSocket::wanAddress[4] = {203, 0, 113, 20};
+uint32_t FakeNatPmpSocket::datagramsSent = 0;
+
+HalUdpSocket* createFakeNatPmpSocket() {
+  return new FakeNatPmpSocket();
+}
+
+// Nothing here speaks UPnP, so discovery falls through quickly after NAT-PMP.
+class RefusingHttpClient : public HalHttpClient {
+ public:
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    response->httpCode = 404;
+    return true;
+  }
+};
+
+RefusingHttpClient gRefusingHttp;
+
+const char* kDescription =
+    "<root><URLBase>http://192.168.1.1:5000/</URLBase><device><serviceList>"
+    "<service><serviceType>urn:schemas-upnp-org:service:Layer3Forwarding:1</serviceType>"
+    "<controlURL>/ctl/L3F</controlURL></service>"
+    "<service><serviceType>urn:schemas-upnp-org:service:WANIPConnection:1</serviceType>"
+    "<controlURL>/ctl/IPConn</controlURL></service>"
+    "</serviceList></device></root>";
+}  // namespace
+
+void setUp() {
+  FakeNatPmpSocket::enabled = true;
+  FakeNatPmpSocket::datagramsSent = 0;
+  const uint8_t publicWan[4] = {203, 0, 113, 20};
+  memcpy(FakeNatPmpSocket::wanAddress, publicWan, sizeof(publicWan));
+  Hal::setUdpSocketFactory(createFakeNatPmpSocket);
+  Hal::setHttpClient(&gRefusingHttp);
+  GatewayIpProbe::setGateway("127.0.0.1");
+}
+
+void tearDown() {
+  GatewayIpProbe::setGateway("");
+  Hal::setUdpSocketFactory(nullptr);
+  Hal::setHttpClient(nullptr);
+}
+
+void test_public_ipv4_excludes_private_ranges() {
+  TEST_ASSERT_TRUE(GatewayIpProbe::isPublicIpv4(IPAddress(203, 0, 113, 20)));
+  TEST_ASSERT_TRUE(GatewayIpProbe::isPublicIpv4(IPAddress(172, 32, 0, 1)));
+  TEST_ASSERT_FALSE(GatewayIpProbe::isPublicIpv4(IPAddress(10, 1, 2, 3)));
+  TEST_ASSERT_FALSE(GatewayIpProbe::isPublicIpv4(IPAddress(172, 16, 0, 1)));
+  TEST_ASSERT_FALSE(GatewayIpProbe::isPublicIpv4(IPAddress(192, 168, 1, 1)));
+  TEST_ASSERT_FALSE(GatewayIpProbe::isPublicIpv4(IPAddress(100, 64, 0, 1)));
+  TEST_ASSERT_FALSE(GatewayIpProbe::isPublicIpv4(IPAddress(0, 0, 0, 0)));
+}
+
+void test_nat_pmp_response_requires_success_result() {
+  uint8_t response[12] = {0, 128, 0, 0, 0, 0, 0, 1, 198, 51, 100, 7};
+  IPAddress external;
+  TEST_ASSERT_TRUE(GatewayIpProbe::parseNatPmpResponse(response, sizeof(response), &external));
+  TEST_ASSERT_EQUAL_STRING("198.51.100.7", external.toString().c_str());
+
+  response[3] = 3;  // Network failure.
+  TEST_ASSERT_FALSE(GatewayIpProbe::parseNatPmpResponse(response, sizeof(response), &external));
+  TEST_ASSERT_FALSE(GatewayIpProbe::parseNatPmpResponse(response, 8, &external));
+}
+
+void test_ssdp_location_and_description_resolve_control_url() {
+  const char* ssdp =
+      "HTTP/1.1 200 OK\r\nST: urn:schemas-upnp-org:device:InternetGatewayDevice:1\r\n"
+      "Location: http://192.168.1.1:5000/rootDesc.xml\r\n\r\n";
+  const String location =
+      GatewayIpProbe::parseSsdpLocation(reinterpret_cast<const uint8_t*>(ssdp), strlen(ssdp));
+  TEST_ASSERT_EQUAL_STRING("http://192.168.1.1:5000/rootDesc.xml", location.c_str());
+
+  String controlUrl;
+  String serviceType;
+  TEST_ASSERT_TRUE(
+      GatewayIpProbe::parseUpnpDescription(location, kDescription, &controlUrl, &serviceType));
+  TEST_ASSERT_EQUAL_STRING("http://192.168.1.1:5000/ctl/IPConn", controlUrl.c_str());
+  TEST_ASSERT_EQUAL_STRING("urn:schemas-upnp-org:service:WANIPConnection:1",
+                           serviceType.c_str());
+}
+
+void test_soap_answer_is_parsed() {
+  IPAddress external;
+  TEST_ASSERT_TRUE(GatewayIpProbe::parseExternalIpResponse(
+      "<s:Body><u:GetExternalIPAddressResponse><NewExternalIPAddress> 203.0.113.5 "
+      "</NewExternalIPAddress></u:GetExternalIPAddressResponse></s:Body>",
+      &external));
+  TEST_ASSERT_EQUAL_STRING("203.0.113.5", external.toString().c_str());
+  TEST_ASSERT_FALSE(GatewayIpProbe::parseExternalIpResponse("<s:Fault/>", &external));
+}
+
+void test_nat_pmp_answer_is_cached_until_reset() {
+  String ipv4;
+  TEST_ASSERT_TRUE(GatewayIpProbe::queryExternalIp(kQueryTimeoutMs, &ipv4));
+  TEST_ASSERT_EQUAL_STRING("203.0.113.20", ipv4.c_str());
+  const uint32_t sentAfterDiscovery = FakeNatPmpSocket::datagramsSent;
+
+  TEST_ASSERT_TRUE(GatewayIpProbe::queryExternalIp(kQueryTimeoutMs, &ipv4));
+  TEST_ASSERT_EQUAL_UINT32(sentAfterDiscovery, FakeNatPmpSocket::datagramsSent);
+
+  GatewayIpStats stats = GatewayIpProbe::getStats();
+  TEST_ASSERT_EQUAL_STRING("NAT_PMP", stats.method.c_str());
+  TEST_ASSERT_EQUAL_STRING("127.0.0.1", stats.gateway.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, stats.cacheHits);
+
+  GatewayIpProbe::reset();
+  TEST_ASSERT_TRUE(GatewayIpProbe::queryExternalIp(kQueryTimeoutMs, &ipv4));
+  TEST_ASSERT_TRUE(FakeNatPmpSocket::datagramsSent > sentAfterDiscovery);
+}
+
+void test_private_wan_parks_the_gateway() {
+  const uint8_t privateWan[4] = {100, 64, 10, 2};
+  memcpy(FakeNatPmpSocket::wanAddress, privateWan, sizeof(privateWan));
+  String ipv4;
+  TEST_ASSERT_FALSE(GatewayIpProbe::queryExternalIp(kQueryTimeoutMs, &ipv4));
+  const uint32_t sentAfterRejection = FakeNatPmpSocket::datagramsSent;
+
+  TEST_ASSERT_FALSE(GatewayIpProbe::queryExternalIp(kQueryTimeoutMs, &ipv4));
+  TEST_ASSERT_EQUAL_UINT32(sentAfterRejection, FakeNatPmpSocket::datagramsSent);
+  TEST_ASSERT_EQUAL_STRING("UNAVAILABLE", GatewayIpProbe::getStats().method.c_str());
+  TEST_ASSERT_TRUE(GatewayIpProbe::getStats().privateWan >= 1);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_public_ipv4_excludes_private_ranges);
+  RUN_TEST(test_nat_pmp_response_requires_success_result);
+  RUN_TEST(test_ssdp_location_and_description_resolve_control_url);
+  RUN_TEST(test_soap_answer_is_parsed);
+  RUN_TEST(test_nat_pmp_answer_is_cached_until_reset);
+  RUN_TEST(test_private_wan_parks_the_gateway);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include <time.h>
+#include <unity.h>
+
+#include "ConfigStore.h"
+#include "Hal.h"
+#include "SharedHttpClient.h"
+
+namespace {
+class FakeHttpClient : public HalHttpClient {
+ public:
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    lastUrl = request.url;
+    calls += 1;
+    response->httpCode = 200;
+    response->body = "203.0.113.7";
+    response->reusedConnection = true;
+    return true;
+  }
+
+  String lastUrl = "";
+  uint32_t calls = 0;
+};
+
+// Accepts every write and answers every read with the caller's default.
+class FakeKeyValueStore : public HalKeyValueStore {
+ public:
+  static String lastNamespace;
+  static uint32_t puts;
+
+  bool begin(const char* name, bool readOnly) override {
+    (void)readOnly;
+    lastNamespace = name;
+    return true;
+  }
+  void end() override {}
+  bool isKey(const char* key) override { return false; }
+  bool remove(const char* key) override { return true; }
+  bool getBool(const char* key, bool defaultValue) override { return defaultValue; }
+  size_t putBool(const char* key, bool value) override { return countPut(1); }
+  uint8_t getUChar(const char* key, uint8_t defaultValue) override { return defaultValue; }
+  size_t putUChar(const char* key, uint8_t value) override { return countPut(1); }
+  uint16_t getUShort(const char* key, uint16_t defaultValue) override { return defaultValue; }
+  size_t putUShort(const char* key, uint16_t value) override { return countPut(2); }
+  int32_t getInt(const char* key, int32_t defaultValue) override { return defaultValue; }
+  size_t putInt(const char* key, int32_t value) override { return countPut(4); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue) override { return defaultValue; }
+  size_t putUInt(const char* key, uint32_t value) override { return countPut(4); }
+  uint32_t getULong(const char* key, uint32_t defaultValue) override { return defaultValue; }
+  size_t putULong(const char* key, uint32_t value) override { return countPut(4); }
+  String getString(const char* key, const String& defaultValue) override { return defaultValue; }
+  size_t putString(const char* key, const String& value) override {
+    return countPut(value.length());
+  }
+  size_t getBytesLength(const char* key) override { return 0; }
+  size_t getBytes(const char* key, void* buffer, size_t length) override { return 0; }
+  size_t putBytes(const char* key, const void* value, size_t length) override {
+    return countPut(length);
+  }
+
+ private:
+  static size_t countPut(size_t length) {
+    puts += 1;
+    return length;
+  }
+};
+
+String FakeKeyValueStore::lastNamespace = "";
+uint32_t FakeKeyValueStore::puts = 0;
+
+HalKeyValueStore* createFakeKeyValueStore() {
+  return new FakeKeyValueStore();
+}
+}  // namespace
+
+void setUp() {
+  FakeKeyValueStore::lastNamespace = "";
+  FakeKeyValueStore::puts = 0;
+}
+
+void tearDown() {
+  Hal::setHttpClient(nullptr);
+  Hal::setKeyValueStoreFactory(nullptr);
+}
+
+void test_injected_http_client_serves_shared_requests() {
+  FakeHttpClient fake;
+  Hal::setHttpClient(&fake);
+
+  SharedHttpRequest request;
+  request.url = "https://api.ipify.org";
+  SharedHttpResponse response;
+
+  TEST_ASSERT_TRUE(SharedHttpClient::perform(request, &response));
+  TEST_ASSERT_EQUAL_UINT32(1, fake.calls);
+  TEST_ASSERT_EQUAL_STRING("https://api.ipify.org", fake.lastUrl.c_str());
+  TEST_ASSERT_EQUAL_INT(200, response.httpCode);
+  TEST_ASSERT_EQUAL_STRING("203.0.113.7", response.body.c_str());
+}
+
+void test_config_store_writes_through_injected_store() {
+  Hal::setKeyValueStoreFactory(createFakeKeyValueStore);
+
+  ConfigStore store;
+  ComputerConfig config;
+  config.ip = "192.168.1.10";
+  config.mac = "AA:BB:CC:DD:EE:FF";
+  config.port = 3389;
+
+  TEST_ASSERT_TRUE(store.saveComputerConfig(config));
+  TEST_ASSERT_EQUAL_STRING("esp32app", FakeKeyValueStore::lastNamespace.c_str());
+  TEST_ASSERT_TRUE(FakeKeyValueStore::puts > 0);
+}
+
+void test_null_override_restores_default() {
+  FakeHttpClient fake;
+  Hal::setHttpClient(&fake);
+  Hal::setHttpClient(nullptr);
+
+  TEST_ASSERT_TRUE(&Hal::http() != &fake);
+}
+
+void test_clock_step_and_slew_move_the_wall_clock() {
+  HalClock& clock = Hal::clock();
+  const int64_t hourUs = 3600LL * 1000000LL;
+  const int64_t beforeUs = clock.unixTimeUs();
+  const time_t hostBefore = time(nullptr);
+
+  TEST_ASSERT_TRUE(clock.setUnixTimeUs(beforeUs + hourUs));
+  TEST_ASSERT_TRUE(clock.unixTimeUs() - beforeUs >= hourUs);
+#if !defined(ARDUINO)
+  // The native clock is an in-process offset; the workstation clock stays put.
+  TEST_ASSERT_TRUE(time(nullptr) - hostBefore < 60);
+  TEST_ASSERT_TRUE(clock.slewUnixTimeUs(-hourUs));
+  TEST_ASSERT_TRUE(clock.unixTimeUs() - beforeUs < hourUs);
+#else
+  (void)hostBefore;
+  clock.setUnixTimeUs(clock.unixTimeUs() - hourUs);
+#endif
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_injected_http_client_serves_shared_requests);
+  RUN_TEST(test_config_store_writes_through_injected_store);
+  RUN_TEST(test_null_override_restores_default);
+  RUN_TEST(test_clock_step_and_slew_move_the_wall_clock);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "Hal.h"
+#include "IpChangeHistory.h"
+
+namespace {
+// 2023-11-14 00:00:00 UTC.
+constexpr uint32_t kDayStart = 1699920000;
+constexpr uint32_t kHour = 3600;
+constexpr uint32_t kDay = 86400;
+constexpr uint32_t kBaseSeconds = 300;
+constexpr uint32_t kMinSeconds = 60;
+constexpr uint32_t kMaxSeconds = 86400;
+
+void forgetPersistedHistory() {
+  KeyValueStore preferences;
+  if (preferences.begin("ddns_hist", false)) {
+    preferences.remove("changes");
+    preferences.end();
+  }
+}
+
+// Address first seen at midnight, then a redial at 03:00 on each of the next `nights`.
+void recordNightlyRedials(IpChangeHistory* history, size_t nights) {
+  history->observe("203.0.113.1", kDayStart);
+  for (size_t night = 1; night <= nights; ++night) {
+    const String ipv4 = night % 2 == 0 ? "203.0.113.1" : "203.0.113.2";
+    TEST_ASSERT_TRUE(history->observe(ipv4, kDayStart + night * kDay + 3 * kHour));
+  }
+}
+}  // namespace
+
+void setUp() {
+  forgetPersistedHistory();
+}
+
+void tearDown() {
+  forgetPersistedHistory();
+}
+
+void test_stable_address_backs_off_within_bounds() {
+  IpChangeHistory history;
+  TEST_ASSERT_FALSE(history.observe("203.0.113.1", kDayStart));
+  TEST_ASSERT_FALSE(history.observe("203.0.113.1", kDayStart + kHour));
+
+  const uint32_t twoDaysLater = kDayStart + 2 * kDay;
+  TEST_ASSERT_EQUAL_UINT32(2 * kHour, history.planIntervalSeconds(twoDaysLater, kBaseSeconds,
+                                                                  kMinSeconds, kMaxSeconds));
+  TEST_ASSERT_EQUAL_UINT32(kHour, history.planIntervalSeconds(twoDaysLater, kBaseSeconds,
+                                                              kMinSeconds, kHour));
+}
+
+void test_fresh_change_returns_to_base_interval() {
+  IpChangeHistory history;
+  history.observe("203.0.113.1", kDayStart);
+  TEST_ASSERT_TRUE(history.observe("203.0.113.2", kDayStart + 10 * kHour));
+  TEST_ASSERT_EQUAL_UINT32(1, history.changeCount());
+  TEST_ASSERT_EQUAL_UINT32(kBaseSeconds,
+                           history.planIntervalSeconds(kDayStart + 10 * kHour + 60, kBaseSeconds,
+                                                       kMinSeconds, kMaxSeconds));
+}
+
+void test_recurring_change_time_is_checked_closely() {
+  IpChangeHistory history;
+  recordNightlyRedials(&history, 3);
+  TEST_ASSERT_EQUAL_UINT32(kDay, history.typicalGapSeconds());
+
+  const uint32_t fourthNight = kDayStart + 4 * kDay;
+  // Inside the 03:00 window: the minimum interval.
+  TEST_ASSERT_EQUAL_UINT32(kMinSeconds,
+                           history.planIntervalSeconds(fourthNight + 2 * kHour + 50 * 60,
+                                                       kBaseSeconds, kMinSeconds, kMaxSeconds));
+  // Shortly before it: wake up when the window opens.
+  TEST_ASSERT_EQUAL_UINT32(10 * 60,
+                           history.planIntervalSeconds(fourthNight + 2 * kHour + 30 * 60,
+                                                       kBaseSeconds, kMinSeconds, kMaxSeconds));
+  // Midday, nine hours after the last redial: relaxed, but capped by the daily gap.
+  TEST_ASSERT_EQUAL_UINT32(9 * kHour / 24,
+                           history.planIntervalSeconds(kDayStart + 3 * kDay + 12 * kHour,
+                                                       kBaseSeconds, kMinSeconds, kMaxSeconds));
+}
+
+void test_history_survives_reload() {
+  IpChangeHistory history;
+  recordNightlyRedials(&history, 2);
+
+  IpChangeHistory reloaded;
+  reloaded.load();
+  TEST_ASSERT_EQUAL_UINT32(2, reloaded.changeCount());
+  TEST_ASSERT_EQUAL_UINT32(history.lastChangeAt(), reloaded.lastChangeAt());
+  TEST_ASSERT_FALSE(reloaded.observe("203.0.113.1", kDayStart + 3 * kDay));
+}
+
+void test_unset_clock_uses_base_interval() {
+  IpChangeHistory history;
+  history.observe("203.0.113.1", 1000);
+  TEST_ASSERT_TRUE(history.observe("203.0.113.2", 2000));
+  TEST_ASSERT_EQUAL_UINT32(0, history.changeCount());
+  TEST_ASSERT_EQUAL_UINT32(kBaseSeconds,
+                           history.planIntervalSeconds(3000, kBaseSeconds, kMinSeconds, kMaxSeconds));
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_stable_address_backs_off_within_bounds);
+  RUN_TEST(test_fresh_change_returns_to_base_interval);
+  RUN_TEST(test_recurring_change_time_is_checked_closely);
+  RUN_TEST(test_history_survives_reload);
+  RUN_TEST(test_unset_clock_uses_base_interval);
+  UNITY_END();
+}
+
+void loop() {}
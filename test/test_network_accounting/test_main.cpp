@@ -0,0 +1,71 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "NetworkAccounting.h"
+
+void setUp() {
+  NetworkAccounting::reset();
+}
+
+void tearDown() {}
+
+void test_nested_scopes_charge_innermost_subsystem() {
+  TEST_ASSERT_TRUE(NetworkAccounting::current() == NetSubsystem::Other);
+  {
+    NetworkAccounting::Scope ddnsScope(NetSubsystem::Ddns);
+    NetworkAccounting::addTransfer(100, 20);
+    {
+      NetworkAccounting::Scope publicIpScope(NetSubsystem::PublicIp);
+      NetworkAccounting::addConnection(true);
+      NetworkAccounting::addTransfer(15, 30);
+    }
+    NetworkAccounting::addFailure();
+  }
+  TEST_ASSERT_TRUE(NetworkAccounting::current() == NetSubsystem::Other);
+
+  const NetSubsystemCounters ddns = NetworkAccounting::getCounters(NetSubsystem::Ddns);
+  TEST_ASSERT_EQUAL_UINT32(100, ddns.bytesIn);
+  TEST_ASSERT_EQUAL_UINT32(20, ddns.bytesOut);
+  TEST_ASSERT_EQUAL_UINT32(1, ddns.failures);
+  TEST_ASSERT_EQUAL_UINT32(0, ddns.connections);
+
+  const NetSubsystemCounters publicIp = NetworkAccounting::getCounters(NetSubsystem::PublicIp);
+  TEST_ASSERT_EQUAL_UINT32(15, publicIp.bytesIn);
+  TEST_ASSERT_EQUAL_UINT32(1, publicIp.connections);
+  TEST_ASSERT_EQUAL_UINT32(1, publicIp.tlsHandshakes);
+}
+
+void test_explicit_subsystem_ignores_scope() {
+  NetworkAccounting::Scope scope(NetSubsystem::Ntp);
+  NetworkAccounting::addTransferTo(NetSubsystem::WebPortal, 10, 2048);
+
+  TEST_ASSERT_EQUAL_UINT32(0, NetworkAccounting::getCounters(NetSubsystem::Ntp).requests);
+  const NetSubsystemCounters web = NetworkAccounting::getCounters(NetSubsystem::WebPortal);
+  TEST_ASSERT_EQUAL_UINT32(1, web.requests);
+  TEST_ASSERT_EQUAL_UINT32(2048, web.bytesOut);
+  TEST_ASSERT_EQUAL_STRING("web_portal", NetworkAccounting::subsystemName(NetSubsystem::WebPortal));
+}
+
+void test_udp_exchange_counts_one_request() {
+  NetworkAccounting::Scope scope(NetSubsystem::Ntp);
+  NetworkAccounting::addTransfer(0, 48);
+  NetworkAccounting::addReceived(48);
+
+  const NetSubsystemCounters ntp = NetworkAccounting::getCounters(NetSubsystem::Ntp);
+  TEST_ASSERT_EQUAL_UINT32(1, ntp.requests);
+  TEST_ASSERT_EQUAL_UINT32(48, ntp.bytesIn);
+  TEST_ASSERT_EQUAL_UINT32(48, ntp.bytesOut);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_nested_scopes_charge_innermost_subsystem);
+  RUN_TEST(test_explicit_subsystem_ignores_scope);
+  RUN_TEST(test_udp_exchange_counts_one_request);
+  UNITY_END();
+}
+
+void loop() {}
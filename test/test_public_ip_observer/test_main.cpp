@@ -0,0 +1,239 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "Hal.h"
+#include "PublicIpObserver.h"
+#include "PublicIpService.h"
+#include "SharedHttpClient.h"
+
+namespace {
+constexpr uint32_t kResolveTimeoutMs = 3000;
+
+// STUN and DNS echo stand-ins, each reporting its own address; "" stays silent.
+class FakeUdpSocket : public HalUdpSocket {
+ public:
+  static String stunIp;
+  static String dnsIp;
+  static uint32_t datagramsSent;
+
+  bool begin(uint16_t localPort) override { return true; }
+  void stop() override {}
+  bool beginPacket(const IPAddress& address, uint16_t port) override {
+    _peer = address;
+    _peerPort = port;
+    _outgoingLength = 0;
+    return true;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    if (_outgoingLength + length > sizeof(_outgoing)) {
+      return 0;
+    }
+    memcpy(_outgoing + _outgoingLength, data, length);
+    _outgoingLength += length;
+    return length;
+  }
+  bool endPacket() override {
+    datagramsSent += 1;
+    const bool isStun = _outgoingLength == 20 && _outgoing[0] == 0x00 && _outgoing[1] == 0x01;
+    IPAddress reported;
+    if (isStun && reported.fromString(stunIp)) {
+      answerStun(reported);
+    } else if (!isStun && reported.fromString(dnsIp)) {
+      answerDns(reported);
+    }
+    return true;
+  }
+  int parsePacket() override {
+    const size_t pending = _incomingLength;
+    _incomingLength = 0;
+    _readLength = pending;
+    return static_cast<int>(pending);
+  }
+  int read(uint8_t* buffer, size_t length) override {
+    const size_t count = length < _readLength ? length : _readLength;
+    memcpy(buffer, _incoming, count);
+    _readLength = 0;
+    return static_cast<int>(count);
+  }
+  IPAddress remoteIP() override { return _peer; }
+  uint16_t remotePort() override { return _peerPort; }
+
+ private:
+  void answerStun(const IPAddress& reported) {
+    const uint8_t header[] = {0x01, 0x01, 0x00, 0x0C, 0x21, 0x12, 0xA4, 0x42};
+    const uint8_t attribute[] = {0x00, 0x01, 0x00, 0x08, 0x00, 0x01, 0x9C, 0x40,
+                                 reported[0], reported[1], reported[2], reported[3]};
+    memcpy(_incoming, header, sizeof(header));
+    memcpy(_incoming + 8, _outgoing + 8, 12);
+    memcpy(_incoming + 20, attribute, sizeof(attribute));
+    _incomingLength = 20 + sizeof(attribute);
+  }
+
+  void answerDns(const IPAddress& reported) {
+    memcpy(_incoming, _outgoing, _outgoingLength);
+    _incoming[2] = 0x81;
+    _incoming[3] = 0x80;
+    _incoming[7] = 1;
+    const uint8_t answer[] = {0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+                              0x00, 0x00, 0x00, 0x04,
+                              reported[0], reported[1], reported[2], reported[3]};
+    memcpy(_incoming + _outgoingLength, answer, sizeof(answer));
+    _incomingLength = _outgoingLength + sizeof(answer);
+  }
+
+  IPAddress _peer;
+  uint16_t _peerPort = 0;
+  uint8_t _outgoing[512];
+  size_t _outgoingLength = 0;
+  uint8_t _incoming[512];
+  size_t _incomingLength = 0;
+  size_t _readLength = 0;
+};
+
+String FakeUdpSocket::stunIp = "";
+String FakeUdpSocket::dnsIp = "";
+uint32_t FakeUdpSocket::datagramsSent = 0;
+
+HalUdpSocket* createFakeUdpSocket() {
+  return new FakeUdpSocket();
+}
+
+class FakeEchoClient : public HalHttpClient {
+ public:
+  String reportedIp = "";
+
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    response->httpCode = reportedIp.isEmpty() ? 503 : 200;
+    response->body = reportedIp;
+    return true;
+  }
+};
+
+FakeEchoClient gFakeEcho;
+
+uint32_t gChangeNotifications = 0;
+
+void countChange(void* context) {
+  *static_cast<uint32_t*>(context) += 1;
+}
+
+String resolveNow() {
+  return PublicIpObserver::resolve(false, kResolveTimeoutMs, 0);
+}
+}  // namespace
+
+void setUp() {
+  FakeUdpSocket::stunIp = "203.0.113.10";
+  FakeUdpSocket::dnsIp = "";
+  FakeUdpSocket::datagramsSent = 0;
+  gFakeEcho.reportedIp = "";
+  Hal::setUdpSocketFactory(createFakeUdpSocket);
+  Hal::setHttpClient(&gFakeEcho);
+  PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode::UdpFirst);
+  PublicIpService::setStunServer("127.0.0.1", 3478);
+  PublicIpService::setDnsEchoServer("127.0.0.1", 5353);
+  PublicIpService::resetEndpointStats();
+  PublicIpObserver::reset();
+  PublicIpObserver::setRequireAgreement(true);
+  gChangeNotifications = 0;
+}
+
+void tearDown() {
+  Hal::setUdpSocketFactory(nullptr);
+  Hal::setHttpClient(nullptr);
+  PublicIpService::setStunServer("");
+  PublicIpService::setDnsEchoServer("");
+  PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode::GatewayFirst);
+  PublicIpObserver::removeChangeListener(&gChangeNotifications);
+}
+
+void test_fresh_observation_is_served_from_cache() {
+  TEST_ASSERT_EQUAL_STRING("203.0.113.10", PublicIpObserver::resolve().c_str());
+  const uint32_t sentAfterLookup = FakeUdpSocket::datagramsSent;
+
+  TEST_ASSERT_EQUAL_STRING("203.0.113.10", PublicIpObserver::resolve().c_str());
+  TEST_ASSERT_EQUAL_UINT32(sentAfterLookup, FakeUdpSocket::datagramsSent);
+
+  const PublicIpObservation observation = PublicIpObserver::getObservation();
+  TEST_ASSERT_EQUAL_STRING("STUN", observation.source.c_str());
+  TEST_ASSERT_EQUAL(PublicIpConfidence::Single, observation.confidence);
+  TEST_ASSERT_EQUAL_UINT32(1, PublicIpObserver::getStats().lookups);
+  TEST_ASSERT_EQUAL_UINT32(1, PublicIpObserver::getStats().cacheHits);
+}
+
+void test_change_confirmed_by_second_source_is_adopted() {
+  resolveNow();
+  FakeUdpSocket::stunIp = "203.0.113.20";
+  FakeUdpSocket::dnsIp = "203.0.113.20";
+
+  TEST_ASSERT_EQUAL_STRING("203.0.113.20", resolveNow().c_str());
+  const PublicIpObservation observation = PublicIpObserver::getObservation();
+  TEST_ASSERT_EQUAL(PublicIpConfidence::Agreed, observation.confidence);
+  TEST_ASSERT_EQUAL_STRING("DNS_ECHO", observation.confirmedBy.c_str());
+  TEST_ASSERT_EQUAL_UINT32(1, PublicIpObserver::getStats().changes);
+}
+
+void test_contradicted_change_is_held() {
+  resolveNow();
+  FakeUdpSocket::stunIp = "198.51.100.66";
+  FakeUdpSocket::dnsIp = "203.0.113.10";
+  gFakeEcho.reportedIp = "203.0.113.10";
+
+  TEST_ASSERT_EQUAL_STRING("203.0.113.10", resolveNow().c_str());
+  TEST_ASSERT_EQUAL_STRING("203.0.113.10", resolveNow().c_str());
+
+  const PublicIpObserverStats stats = PublicIpObserver::getStats();
+  TEST_ASSERT_EQUAL_UINT32(0, stats.changes);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.disagreements);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.heldChanges);
+}
+
+void test_unconfirmable_change_needs_a_repeat() {
+  resolveNow();
+  FakeUdpSocket::stunIp = "203.0.113.30";
+
+  TEST_ASSERT_EQUAL_STRING("203.0.113.10", resolveNow().c_str());
+  TEST_ASSERT_EQUAL_STRING("203.0.113.30", resolveNow().c_str());
+  TEST_ASSERT_EQUAL(PublicIpConfidence::Single, PublicIpObserver::getObservation().confidence);
+  TEST_ASSERT_EQUAL_UINT32(1, PublicIpObserver::getStats().heldChanges);
+}
+
+void test_change_is_immediate_without_agreement() {
+  PublicIpObserver::setRequireAgreement(false);
+  resolveNow();
+  FakeUdpSocket::stunIp = "203.0.113.40";
+  FakeUdpSocket::dnsIp = "203.0.113.10";
+
+  TEST_ASSERT_EQUAL_STRING("203.0.113.40", resolveNow().c_str());
+  TEST_ASSERT_EQUAL_UINT32(0, PublicIpObserver::getStats().confirmations);
+}
+
+void test_listener_hears_adopted_changes_only() {
+  PublicIpObserver::setChangeListener(countChange, &gChangeNotifications);
+  resolveNow();
+  TEST_ASSERT_EQUAL_UINT32(0, gChangeNotifications);
+
+  FakeUdpSocket::stunIp = "203.0.113.50";
+  resolveNow();
+  TEST_ASSERT_EQUAL_UINT32(0, gChangeNotifications);
+  resolveNow();
+  TEST_ASSERT_EQUAL_UINT32(1, gChangeNotifications);
+  resolveNow();
+  TEST_ASSERT_EQUAL_UINT32(1, gChangeNotifications);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_fresh_observation_is_served_from_cache);
+  RUN_TEST(test_change_confirmed_by_second_source_is_adopted);
+  RUN_TEST(test_contradicted_change_is_held);
+  RUN_TEST(test_unconfirmable_change_needs_a_repeat);
+  RUN_TEST(test_change_is_immediate_without_agreement);
+  RUN_TEST(test_listener_hears_adopted_changes_only);
+  UNITY_END();
+}
+
+void loop() {}
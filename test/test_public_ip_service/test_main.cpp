@@ -2,7 +2,9 @@
 #include <WiFi.h>
 #include <unity.h>
 
+#include "Hal.h"
 #include "PublicIpService.h"
+#include "SharedHttpClient.h"
 #include "WifiService.h"
 
 namespace {
@@ -26,6 +28,34 @@ bool ensureWifiConnected(WifiService* wifiService) {
   return wifiService->isConnected();
 }
 
+constexpr uint32_t kSlowEndpointDelayMs = 3000;
+
+// Serves both echo endpoints; one of them can be made slow or broken.
+class FakeEchoClient : public HalHttpClient {
+ public:
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    const bool slow = !slowHost.isEmpty() && request.url.indexOf(slowHost) != -1;
+    const bool broken = !brokenHost.isEmpty() && request.url.indexOf(brokenHost) != -1;
+    if (slow) {
+      delay(kSlowEndpointDelayMs);
+    }
+    if (broken) {
+      response->httpCode = 503;
+      response->body = "";
+      return true;
+    }
+    response->httpCode = 200;
+    response->body = slow ? "198.51.100.1" : "203.0.113.7";
+    return true;
+  }
+
+  String slowHost = "";
+  String brokenHost = "";
+};
+
+// Slow attempts keep running after a resolve returns, so the fake outlives every test.
+FakeEchoClient gFakeEcho;
+
 bool isValidIpv4Literal(const String& value) {
   if (value.isEmpty()) {
     return false;
@@ -38,9 +68,86 @@ bool isValidIpv4Literal(const String& value) {
 
 void setUp() {
   WiFi.mode(WIFI_STA);
+  // The hedging tests serve HTTPS from a fake; keep real UDP probes out of them.
+  PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode::HttpsOnly);
+}
+
+void tearDown() {
+  Hal::setHttpClient(nullptr);
+  PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode::GatewayFirst);
+}
+
+void test_hedged_resolve_skips_hanging_endpoint() {
+  PublicIpService::resetEndpointStats();
+  gFakeEcho.slowHost = "ip.3322.net";
+  gFakeEcho.brokenHost = "";
+  Hal::setHttpClient(&gFakeEcho);
+
+  const uint32_t startMs = millis();
+  const String ipv4 = PublicIpService::resolveIpv4(false, kIpv4ResolveTimeoutMs);
+  const uint32_t elapsedMs = millis() - startMs;
+
+  TEST_ASSERT_EQUAL_STRING("203.0.113.7", ipv4.c_str());
+  TEST_ASSERT_TRUE(elapsedMs < kSlowEndpointDelayMs);
+
+  const std::vector<PublicIpEndpointStats> stats = PublicIpService::getEndpointStats();
+  TEST_ASSERT_EQUAL_UINT32(2, stats.size());
+  TEST_ASSERT_EQUAL_UINT32(0, stats[0].wins);
+  TEST_ASSERT_EQUAL_UINT32(1, stats[1].wins);
+  delay(kSlowEndpointDelayMs);
 }
 
-void tearDown() {}
+void test_failed_endpoint_fires_next_without_waiting() {
+  PublicIpService::resetEndpointStats();
+  gFakeEcho.slowHost = "";
+  gFakeEcho.brokenHost = "ip.3322.net";
+  Hal::setHttpClient(&gFakeEcho);
+
+  const uint32_t startMs = millis();
+  const String ipv4 = PublicIpService::resolveIpv4(false, kIpv4ResolveTimeoutMs);
+  const uint32_t elapsedMs = millis() - startMs;
+
+  TEST_ASSERT_EQUAL_STRING("203.0.113.7", ipv4.c_str());
+  // Well under the minimum hedge delay: the failure itself triggers the next endpoint.
+  TEST_ASSERT_TRUE(elapsedMs < 200);
+  TEST_ASSERT_EQUAL_UINT32(1, PublicIpService::getEndpointStats()[0].failures);
+}
+
+void test_fastest_endpoint_is_tried_first() {
+  PublicIpService::resetEndpointStats();
+  gFakeEcho.slowHost = "ip.3322.net";
+  gFakeEcho.brokenHost = "";
+  Hal::setHttpClient(&gFakeEcho);
+
+  PublicIpService::resolveIpv4(false, kIpv4ResolveTimeoutMs);
+  delay(kSlowEndpointDelayMs + 100);
+  const std::vector<PublicIpEndpointStats> learned = PublicIpService::getEndpointStats();
+  TEST_ASSERT_TRUE(learned[1].latencyEwmaMs < learned[0].latencyEwmaMs);
+
+  // With ifconfig.me ranked first the slow endpoint is never started.
+  PublicIpService::resolveIpv4(false, kIpv4ResolveTimeoutMs);
+  const std::vector<PublicIpEndpointStats> stats = PublicIpService::getEndpointStats();
+  TEST_ASSERT_EQUAL_UINT32(learned[0].successes, stats[0].successes);
+  TEST_ASSERT_EQUAL_UINT32(2, stats[1].wins);
+}
+
+void test_only_one_hedge_is_pending_across_resolves() {
+  PublicIpService::resetEndpointStats();
+  gFakeEcho.slowHost = ".";
+  gFakeEcho.brokenHost = "";
+  Hal::setHttpClient(&gFakeEcho);
+
+  // Both endpoints hang: the first resolve leaves its primary and its hedge running.
+  TEST_ASSERT_TRUE(PublicIpService::resolveIpv4(false, 2500).isEmpty());
+  // The second one may start its primary, but its hedge finds the slot taken.
+  TEST_ASSERT_TRUE(PublicIpService::resolveIpv4(false, 2200).isEmpty());
+  delay(kSlowEndpointDelayMs + 500);
+
+  const std::vector<PublicIpEndpointStats> stats = PublicIpService::getEndpointStats();
+  const uint32_t attempts =
+      stats[0].successes + stats[0].failures + stats[1].successes + stats[1].failures;
+  TEST_ASSERT_EQUAL_UINT32(3, attempts);
+}
 
 void test_can_get_local_ipv4() {
   WifiService wifiService;
@@ -65,6 +172,7 @@ void test_public_ipv4_resolve_latency() {
     return;
   }
 
+  PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode::GatewayFirst);
   uint32_t totalElapsedMs = 0;
   uint32_t bestElapsedMs = UINT32_MAX;
   uint32_t worstElapsedMs = 0;
@@ -113,6 +221,10 @@ void setup() {
   delay(200);
 
   UNITY_BEGIN();
+  RUN_TEST(test_hedged_resolve_skips_hanging_endpoint);
+  RUN_TEST(test_failed_endpoint_fires_next_without_waiting);
+  RUN_TEST(test_fastest_endpoint_is_tried_first);
+  RUN_TEST(test_only_one_hedge_is_pending_across_resolves);
   RUN_TEST(test_can_get_local_ipv4);
   RUN_TEST(test_public_ipv4_resolve_latency);
   UNITY_END();
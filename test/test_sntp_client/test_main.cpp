@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <cstring>
+
+#include "SntpClient.h"
+
+namespace {
+constexpr int64_t kMicrosPerSecond = 1000000;
+// 2024-01-01 00:00:00 UTC.
+constexpr int64_t kBaseUs = 1704067200LL * kMicrosPerSecond;
+
+void writeUint64(uint8_t* data, uint64_t value) {
+  for (size_t i = 8; i > 0; --i) {
+    data[i - 1] = static_cast<uint8_t>(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+// Server reply to a request sent at t1, received at t2 and answered at t3.
+void buildReply(uint8_t* packet, uint64_t requestNtp, int64_t t2Us, int64_t t3Us) {
+  memset(packet, 0, SntpClient::kPacketSize);
+  packet[0] = (4 << 3) | 4;
+  packet[1] = 2;
+  writeUint64(packet + 24, requestNtp);
+  writeUint64(packet + 32, SntpClient::unixUsToNtp(t2Us));
+  writeUint64(packet + 40, SntpClient::unixUsToNtp(t3Us));
+}
+
+SntpSample makeSample(const char* server, int64_t delayUs, uint8_t stratum) {
+  SntpSample sample;
+  sample.server = server;
+  sample.delayUs = delayUs;
+  sample.stratum = stratum;
+  return sample;
+}
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_ntp_timestamps_round_trip_to_the_microsecond() {
+  const int64_t unixUs = kBaseUs + 123456;
+  const uint64_t ntp = SntpClient::unixUsToNtp(unixUs);
+  TEST_ASSERT_EQUAL_UINT32(1704067200UL + 2208988800UL, static_cast<uint32_t>(ntp >> 32));
+  const int64_t back = SntpClient::ntpToUnixUs(ntp);
+  TEST_ASSERT_TRUE(back == unixUs || back == unixUs - 1);
+
+  // 2040 lies in NTP era 1, where the seconds field has wrapped.
+  const int64_t era1Us = 2208988800LL * kMicrosPerSecond;
+  TEST_ASSERT_TRUE(SntpClient::ntpToUnixUs(SntpClient::unixUsToNtp(era1Us)) == era1Us);
+}
+
+void test_offset_and_delay_use_all_four_timestamps() {
+  // Local clock 2 s behind; 40 ms each way, 5 ms held by the server.
+  const int64_t t1 = kBaseUs;
+  const int64_t t2 = t1 + 2 * kMicrosPerSecond + 40000;
+  const int64_t t3 = t2 + 5000;
+  const int64_t t4 = t1 + 85000;
+  const uint64_t requestNtp = SntpClient::unixUsToNtp(t1);
+
+  uint8_t packet[SntpClient::kPacketSize];
+  buildReply(packet, requestNtp, t2, t3);
+  SntpSample sample;
+  TEST_ASSERT_TRUE(SntpClient::parseResponse(packet, sizeof(packet), requestNtp, t1, t4, &sample));
+  TEST_ASSERT_INT32_WITHIN(2, 2000000, static_cast<int32_t>(sample.offsetUs));
+  TEST_ASSERT_INT32_WITHIN(2, 80000, static_cast<int32_t>(sample.delayUs));
+  TEST_ASSERT_EQUAL_UINT8(2, sample.stratum);
+}
+
+void test_invalid_replies_are_rejected() {
+  const int64_t t1 = kBaseUs;
+  const uint64_t requestNtp = SntpClient::unixUsToNtp(t1);
+  uint8_t packet[SntpClient::kPacketSize];
+  SntpSample sample;
+
+  // Answer to some other request.
+  buildReply(packet, requestNtp + 1, t1, t1);
+  TEST_ASSERT_FALSE(SntpClient::parseResponse(packet, sizeof(packet), requestNtp, t1, t1, &sample));
+
+  // Kiss-o'-death.
+  buildReply(packet, requestNtp, t1, t1);
+  packet[1] = 0;
+  TEST_ASSERT_FALSE(SntpClient::parseResponse(packet, sizeof(packet), requestNtp, t1, t1, &sample));
+
+  // Unsynchronized server.
+  buildReply(packet, requestNtp, t1, t1);
+  packet[0] |= 0xC0;
+  TEST_ASSERT_FALSE(SntpClient::parseResponse(packet, sizeof(packet), requestNtp, t1, t1, &sample));
+
+  // Our own request looped back.
+  SntpClient::buildRequest(requestNtp, packet);
+  TEST_ASSERT_FALSE(SntpClient::parseResponse(packet, sizeof(packet), requestNtp, t1, t1, &sample));
+
+  buildReply(packet, requestNtp, t1, t1);
+  TEST_ASSERT_FALSE(SntpClient::parseResponse(packet, 47, requestNtp, t1, t1, &sample));
+}
+
+void test_best_sample_has_the_lowest_delay() {
+  std::vector<SntpSample> samples;
+  SntpSample best;
+  TEST_ASSERT_FALSE(SntpClient::selectBest(samples, &best));
+
+  samples.push_back(makeSample("ntp1", 30000, 1));
+  samples.push_back(makeSample("ntp2", 12000, 3));
+  samples.push_back(makeSample("ntp3", 12000, 2));
+  samples.push_back(makeSample("ntp4", 50000, 1));
+  TEST_ASSERT_TRUE(SntpClient::selectBest(samples, &best));
+  TEST_ASSERT_EQUAL_STRING("ntp3", best.server.c_str());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_ntp_timestamps_round_trip_to_the_microsecond);
+  RUN_TEST(test_offset_and_delay_use_all_four_timestamps);
+  RUN_TEST(test_invalid_replies_are_rejected);
+  RUN_TEST(test_best_sample_has_the_lowest_delay);
+  UNITY_END();
+}
+
+void loop() {}
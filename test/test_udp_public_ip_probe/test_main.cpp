@@ -0,0 +1,225 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#define private public
+#include "UdpPublicIpProbe.h"
+#undef private
+
+#include "Hal.h"
+#include "PublicIpService.h"
+#include "SharedHttpClient.h"
+
+namespace {
+constexpr uint32_t kProbeTimeoutMs = 1000;
+const uint8_t kTransactionId[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+
+// Answers STUN Binding requests and A queries like a local stand-in would.
+class FakeUdpSocket : public HalUdpSocket {
+ public:
+  static bool stunEnabled;
+  static bool dnsEnabled;
+  static uint32_t datagramsSent;
+
+  bool begin(uint16_t localPort) override { return true; }
+  void stop() override {}
+  bool beginPacket(const IPAddress& address, uint16_t port) override {
+    _peer = address;
+    _peerPort = port;
+    _outgoingLength = 0;
+    return true;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    if (_outgoingLength + length > sizeof(_outgoing)) {
+      return 0;
+    }
+    memcpy(_outgoing + _outgoingLength, data, length);
+    _outgoingLength += length;
+    return length;
+  }
+  bool endPacket() override {
+    datagramsSent += 1;
+    const bool isStun = _outgoingLength == 20 && _outgoing[0] == 0x00 && _outgoing[1] == 0x01;
+    if (isStun && stunEnabled) {
+      answerStun();
+    } else if (!isStun && dnsEnabled) {
+      answerDns();
+    }
+    return true;
+  }
+  int parsePacket() override {
+    const size_t pending = _incomingLength;
+    _incomingLength = 0;
+    _readLength = pending;
+    return static_cast<int>(pending);
+  }
+  int read(uint8_t* buffer, size_t length) override {
+    const size_t count = length < _readLength ? length : _readLength;
+    memcpy(buffer, _incoming, count);
+    _readLength = 0;
+    return static_cast<int>(count);
+  }
+  IPAddress remoteIP() override { return _peer; }
+  uint16_t remotePort() override { return _peerPort; }
+
+ private:
+  void answerStun() {
+    // Binding success with XOR-MAPPED-ADDRESS 203.0.113.9:40000.
+    const uint8_t header[] = {0x01, 0x01, 0x00, 0x0C, 0x21, 0x12, 0xA4, 0x42};
+    const uint8_t attribute[] = {0x00, 0x20, 0x00, 0x08, 0x00, 0x01, 0xBC, 0x52,
+                                 203 ^ 0x21, 0 ^ 0x12, 113 ^ 0xA4, 9 ^ 0x42};
+    memcpy(_incoming, header, sizeof(header));
+    memcpy(_incoming + 8, _outgoing + 8, 12);
+    memcpy(_incoming + 20, attribute, sizeof(attribute));
+    _incomingLength = 20 + sizeof(attribute);
+  }
+
+  void answerDns() {
+    // Echo the query, flag it as a response and append one A record (198.51.100.4).
+    memcpy(_incoming, _outgoing, _outgoingLength);
+    _incoming[2] = 0x81;
+    _incoming[3] = 0x80;
+    _incoming[7] = 1;
+    const uint8_t answer[] = {0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+                              0x00, 0x00, 0x00, 0x04, 198, 51, 100, 4};
+    memcpy(_incoming + _outgoingLength, answer, sizeof(answer));
+    _incomingLength = _outgoingLength + sizeof(answer);
+  }
+
+  IPAddress _peer;
+  uint16_t _peerPort = 0;
+  uint8_t _outgoing[512];
+  size_t _outgoingLength = 0;
+  uint8_t _incoming[512];
+  size_t _incomingLength = 0;
+  size_t _readLength = 0;
+};
+
+bool FakeUdpSocket::stunEnabled = true;
+bool FakeUdpSocket::dnsEnabled = true;
+uint32_t FakeUdpSocket::datagramsSent = 0;
+
+HalUdpSocket* createFakeUdpSocket() {
+  return new FakeUdpSocket();
+}
+
+class FakeEchoClient : public HalHttpClient {
+ public:
+  bool perform(const SharedHttpRequest& request, SharedHttpResponse* response) override {
+    response->httpCode = 200;
+    response->body = "192.0.2.55";
+    return true;
+  }
+};
+
+FakeEchoClient gFakeEcho;
+}  // namespace
+
+void setUp() {
+  FakeUdpSocket::stunEnabled = true;
+  FakeUdpSocket::dnsEnabled = true;
+  FakeUdpSocket::datagramsSent = 0;
+  Hal::setUdpSocketFactory(createFakeUdpSocket);
+  Hal::setHttpClient(&gFakeEcho);
+  PublicIpService::setStunServer("127.0.0.1", 3478);
+  PublicIpService::setDnsEchoServer("127.0.0.1", 5353);
+  PublicIpService::resetEndpointStats();
+  PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode::UdpFirst);
+}
+
+void tearDown() {
+  Hal::setUdpSocketFactory(nullptr);
+  Hal::setHttpClient(nullptr);
+  PublicIpService::setStunServer("");
+  PublicIpService::setDnsEchoServer("");
+  PublicIpService::setDiscoveryMode(PublicIpDiscoveryMode::GatewayFirst);
+}
+
+void test_stun_request_layout() {
+  uint8_t packet[20];
+  TEST_ASSERT_EQUAL_UINT32(20, UdpPublicIpProbe::buildStunRequest(kTransactionId, packet,
+                                                                  sizeof(packet)));
+  TEST_ASSERT_EQUAL_UINT8(0x00, packet[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x01, packet[1]);
+  TEST_ASSERT_EQUAL_UINT8(0x00, packet[3]);
+  TEST_ASSERT_EQUAL_UINT8(0x21, packet[4]);
+  TEST_ASSERT_EQUAL_UINT8(0x42, packet[7]);
+  TEST_ASSERT_EQUAL_UINT8(12, packet[19]);
+}
+
+void test_stun_response_rejects_foreign_transaction() {
+  uint8_t response[32] = {0x01, 0x01, 0x00, 0x0C, 0x21, 0x12, 0xA4, 0x42};
+  memcpy(response + 8, kTransactionId, sizeof(kTransactionId));
+  const uint8_t attribute[] = {0x00, 0x01, 0x00, 0x08, 0x00, 0x01, 0x1F, 0x90, 10, 0, 0, 7};
+  memcpy(response + 20, attribute, sizeof(attribute));
+
+  String ipv4;
+  TEST_ASSERT_TRUE(UdpPublicIpProbe::parseStunResponse(response, sizeof(response),
+                                                       kTransactionId, &ipv4));
+  TEST_ASSERT_EQUAL_STRING("10.0.0.7", ipv4.c_str());
+
+  response[19] ^= 0xFF;
+  TEST_ASSERT_FALSE(UdpPublicIpProbe::parseStunResponse(response, sizeof(response),
+                                                        kTransactionId, &ipv4));
+}
+
+void test_dns_query_encodes_labels() {
+  uint8_t packet[64];
+  const size_t length = UdpPublicIpProbe::buildDnsQuery(0xBEEF, "myip.opendns.com", packet,
+                                                        sizeof(packet));
+  TEST_ASSERT_EQUAL_UINT32(12 + 18 + 4, length);
+  TEST_ASSERT_EQUAL_UINT8(0xBE, packet[0]);
+  TEST_ASSERT_EQUAL_UINT8(4, packet[12]);
+  TEST_ASSERT_EQUAL_UINT8(7, packet[17]);
+  TEST_ASSERT_EQUAL_UINT8(3, packet[25]);
+  TEST_ASSERT_EQUAL_UINT8(0, packet[29]);
+  TEST_ASSERT_EQUAL_UINT32(0, UdpPublicIpProbe::buildDnsQuery(1, "bad..name", packet,
+                                                              sizeof(packet)));
+}
+
+void test_stun_exchange_returns_mapped_address() {
+  String ipv4;
+  TEST_ASSERT_TRUE(UdpPublicIpProbe::queryStun("127.0.0.1", 3478, kProbeTimeoutMs, &ipv4));
+  TEST_ASSERT_EQUAL_STRING("203.0.113.9", ipv4.c_str());
+}
+
+void test_resolve_falls_back_to_dns_echo_then_https() {
+  FakeUdpSocket::stunEnabled = false;
+  TEST_ASSERT_EQUAL_STRING("198.51.100.4", PublicIpService::resolveIpv4().c_str());
+
+  FakeUdpSocket::dnsEnabled = false;
+  TEST_ASSERT_EQUAL_STRING("192.0.2.55", PublicIpService::resolveIpv4().c_str());
+
+  const PublicIpDiscoveryStats stats = PublicIpService::getDiscoveryStats();
+  TEST_ASSERT_EQUAL_UINT32(0, stats.stunAnswers);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.dnsEchoAnswers);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.udpFailures);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.httpsFallbacks);
+}
+
+void test_unanswered_udp_is_skipped_during_backoff() {
+  FakeUdpSocket::stunEnabled = false;
+  FakeUdpSocket::dnsEnabled = false;
+  PublicIpService::resolveIpv4();
+  const uint32_t sentAfterFailure = FakeUdpSocket::datagramsSent;
+
+  FakeUdpSocket::stunEnabled = true;
+  TEST_ASSERT_EQUAL_STRING("192.0.2.55", PublicIpService::resolveIpv4().c_str());
+  TEST_ASSERT_EQUAL_UINT32(sentAfterFailure, FakeUdpSocket::datagramsSent);
+  TEST_ASSERT_EQUAL_UINT32(1, PublicIpService::getDiscoveryStats().udpSkipped);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(200);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_stun_request_layout);
+  RUN_TEST(test_stun_response_rejects_foreign_transaction);
+  RUN_TEST(test_dns_query_encodes_labels);
+  RUN_TEST(test_stun_exchange_returns_mapped_address);
+  RUN_TEST(test_resolve_falls_back_to_dns_echo_then_https);
+  RUN_TEST(test_unanswered_udp_is_skipped_during_backoff);
+  UNITY_END();
+}
+
+void loop() {}
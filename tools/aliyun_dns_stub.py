@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Aliyun DNS RPC API (alidns.aliyuncs.com, 2015-01-09).
+
+Implements DescribeDomainRecords, DescribeDomainRecordInfo, AddDomainRecord,
+UpdateDomainRecord and DeleteDomainRecord with HMAC-SHA1 signature checks,
+Timestamp / SignatureNonce validation, configurable latency and injectable
+error codes. Point the firmware at it with AliyunDdnsClient::setEndpoint().
+
+Control endpoints (no signature required):
+  GET  /__stats                      per-action call counts, bytes in/out
+  POST /__reset                      clear stats (records are kept)
+  POST /__seed?domain=&rr=&value=    create or overwrite an A record
+  POST /__inject?code=&count=&action= return `code` for the next `count` calls
+  POST /__latency?ms=                change the artificial latency
+
+Example:
+  python tools/aliyun_dns_stub.py --port 8053 --key-id test --key-secret secret
+"""
+import argparse
+import base64
+import hashlib
+import hmac
+import json
+import threading
+import time
+import urllib.parse
+import uuid
+from datetime import datetime, timezone
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+SUPPORTED_ACTIONS = (
+    "DescribeDomainRecords",
+    "DescribeDomainRecordInfo",
+    "AddDomainRecord",
+    "UpdateDomainRecord",
+    "DeleteDomainRecord",
+)
+TIMESTAMP_TOLERANCE_SECONDS = 15 * 60
+
+
+def percent_encode(value):
+    return urllib.parse.quote(value, safe="-_.~")
+
+
+def sign(method, params, secret):
+    canonical = "&".join(
+        f"{percent_encode(key)}={percent_encode(params[key])}" for key in sorted(params)
+    )
+    string_to_sign = f"{method}&{percent_encode('/')}&{percent_encode(canonical)}"
+    digest = hmac.new((secret + "&").encode(), string_to_sign.encode(), hashlib.sha1).digest()
+    return base64.b64encode(digest).decode()
+
+
+class StubState:
+    def __init__(self, key_id, key_secret, latency_ms):
+        self.lock = threading.Lock()
+        self.key_id = key_id
+        self.key_secret = key_secret
+        self.latency_ms = latency_ms
+        self.records = {}
+        self.next_record_id = 100000
+        self.nonces = set()
+        self.injections = []
+        self.reset_stats()
+
+    def reset_stats(self):
+        self.stats = {"calls": {}, "totalCalls": 0, "bytesIn": 0, "bytesOut": 0}
+
+    def add_record(self, domain, rr, record_type, value):
+        record_id = str(self.next_record_id)
+        self.next_record_id += 1
+        self.records[record_id] = {
+            "RecordId": record_id,
+            "DomainName": domain,
+            "RR": rr,
+            "Type": record_type,
+            "Value": value,
+            "TTL": 600,
+            "Line": "default",
+            "Status": "ENABLE",
+            "Locked": False,
+        }
+        return record_id
+
+    def take_injection(self, action):
+        for injection in self.injections:
+            if injection["action"] in ("", action) and injection["count"] > 0:
+                injection["count"] -= 1
+                code = injection["code"]
+                self.injections = [item for item in self.injections if item["count"] > 0]
+                return code
+        return None
+
+
+class StubHandler(BaseHTTPRequestHandler):
+    server_version = "AliyunDnsStub/1.0"
+    state = None
+
+    def log_message(self, fmt, *args):
+        if self.server.verbose:
+            super().log_message(fmt, *args)
+
+    def do_GET(self):
+        self.handle_request("GET")
+
+    def do_POST(self):
+        self.handle_request("POST")
+
+    def handle_request(self, method):
+        parsed = urllib.parse.urlsplit(self.path)
+        length = int(self.headers.get("Content-Length") or 0)
+        body = self.rfile.read(length).decode() if length > 0 else ""
+        request_bytes = len(self.requestline) + 2 + len(str(self.headers)) + length
+
+        if parsed.path.startswith("/__"):
+            self.handle_control(parsed.path, dict(urllib.parse.parse_qsl(parsed.query)))
+            return
+
+        query = parsed.query if method == "GET" else body
+        params = dict(urllib.parse.parse_qsl(query, keep_blank_values=True))
+        action = params.get("Action", "")
+
+        if self.state.latency_ms > 0:
+            time.sleep(self.state.latency_ms / 1000.0)
+
+        with self.state.lock:
+            status, payload = self.dispatch(method, action, params)
+            data = json.dumps(payload, separators=(",", ":")).encode()
+            stats = self.state.stats
+            stats["calls"][action] = stats["calls"].get(action, 0) + 1
+            stats["totalCalls"] += 1
+            stats["bytesIn"] += request_bytes
+            stats["bytesOut"] += len(data)
+
+        self.send_json(status, data)
+
+    def dispatch(self, method, action, params):
+        request_id = str(uuid.uuid4()).upper()
+        error = self.verify(method, params)
+        if error is None:
+            error = self.state.take_injection(action)
+            if error is not None:
+                error = (503 if error.startswith("Throttling") else 400, error)
+        if error is not None:
+            status, code = error
+            return status, {
+                "RequestId": request_id,
+                "HostId": "alidns.aliyuncs.com",
+                "Code": code,
+                "Message": f"Stub error: {code}",
+            }
+
+        handler = getattr(self, "action_" + action, None)
+        if handler is None:
+            return 400, {"RequestId": request_id, "Code": "InvalidAction.NotFound",
+                         "Message": f"Unsupported action {action}"}
+        status, payload = handler(params)
+        payload["RequestId"] = request_id
+        return status, payload
+
+    def verify(self, method, params):
+        if params.get("Action") not in SUPPORTED_ACTIONS:
+            return None
+        for key in ("AccessKeyId", "Signature", "SignatureNonce", "Timestamp"):
+            if key not in params:
+                return 400, "MissingParameter"
+        if params["AccessKeyId"] != self.state.key_id:
+            return 404, "InvalidAccessKeyId.NotFound"
+
+        unsigned = {key: value for key, value in params.items() if key != "Signature"}
+        if sign(method, unsigned, self.state.key_secret) != params["Signature"]:
+            return 400, "SignatureDoesNotMatch"
+
+        try:
+            signed_at = datetime.strptime(params["Timestamp"], "%Y-%m-%dT%H:%M:%SZ")
+        except ValueError:
+            return 400, "InvalidTimeStamp.Format"
+        skew = abs(signed_at.replace(tzinfo=timezone.utc).timestamp() - time.time())
+        if skew > TIMESTAMP_TOLERANCE_SECONDS:
+            return 400, "InvalidTimeStamp.Expired"
+
+        nonce = params["SignatureNonce"]
+        if nonce in self.state.nonces:
+            return 400, "SignatureNonceUsed"
+        self.state.nonces.add(nonce)
+        return None
+
+    def action_DescribeDomainRecords(self, params):
+        domain = params.get("DomainName", "")
+        rr_keyword = params.get("RRKeyWord", "")
+        type_keyword = params.get("TypeKeyWord", "")
+        page_number = max(1, int(params.get("PageNumber", "1")))
+        page_size = min(500, max(1, int(params.get("PageSize", "20"))))
+        matches = [
+            record for record in self.state.records.values()
+            if record["DomainName"] == domain
+            and (not rr_keyword or rr_keyword in record["RR"])
+            and (not type_keyword or record["Type"] == type_keyword)
+        ]
+        page = matches[(page_number - 1) * page_size:page_number * page_size]
+        return 200, {
+            "TotalCount": len(matches),
+            "PageNumber": page_number,
+            "PageSize": page_size,
+            "DomainRecords": {"Record": page},
+        }
+
+    def action_DescribeDomainRecordInfo(self, params):
+        record = self.state.records.get(params.get("RecordId", ""))
+        if record is None:
+            return 400, {"Code": "DomainRecordNotBelongToUser", "Message": "Record not found"}
+        return 200, dict(record)
+
+    def action_AddDomainRecord(self, params):
+        domain, rr = params.get("DomainName", ""), params.get("RR", "")
+        record_type, value = params.get("Type", "A"), params.get("Value", "")
+        for record in self.state.records.values():
+            if (record["DomainName"], record["RR"], record["Type"], record["Value"]) == \
+                    (domain, rr, record_type, value):
+                return 400, {"Code": "DomainRecordDuplicate", "Message": "Record exists"}
+        return 200, {"RecordId": self.state.add_record(domain, rr, record_type, value)}
+
+    def action_UpdateDomainRecord(self, params):
+        record = self.state.records.get(params.get("RecordId", ""))
+        if record is None:
+            return 400, {"Code": "DomainRecordNotBelongToUser", "Message": "Record not found"}
+        if record["RR"] == params.get("RR") and record["Value"] == params.get("Value"):
+            return 400, {"Code": "DomainRecordDuplicate", "Message": "Record unchanged"}
+        record.update(RR=params.get("RR", record["RR"]),
+                      Type=params.get("Type", record["Type"]),
+                      Value=params.get("Value", record["Value"]))
+        return 200, {"RecordId": record["RecordId"]}
+
+    def action_DeleteDomainRecord(self, params):
+        record = self.state.records.pop(params.get("RecordId", ""), None)
+        if record is None:
+            return 400, {"Code": "DomainRecordNotBelongToUser", "Message": "Record not found"}
+        return 200, {"RecordId": record["RecordId"]}
+
+    def handle_control(self, path, args):
+        state = self.state
+        with state.lock:
+            if path == "/__stats":
+                payload = dict(state.stats, recordCount=len(state.records))
+            elif path == "/__reset":
+                state.reset_stats()
+                payload = {"success": True}
+            elif path == "/__seed":
+                domain, rr = args.get("domain", ""), args.get("rr", "@")
+                value = args.get("value", "0.0.0.0")
+                existing = [record for record in state.records.values()
+                            if record["DomainName"] == domain and record["RR"] == rr]
+                if existing:
+                    existing[0]["Value"] = value
+                    record_id = existing[0]["RecordId"]
+                else:
+                    record_id = state.add_record(domain, rr, "A", value)
+                payload = {"success": True, "recordId": record_id}
+            elif path == "/__inject":
+                state.injections.append({"code": args.get("code", "Throttling.User"),
+                                         "count": int(args.get("count", "1")),
+                                         "action": args.get("action", "")})
+                payload = {"success": True}
+            elif path == "/__latency":
+                state.latency_ms = int(args.get("ms", "0"))
+                payload = {"success": True}
+            else:
+                payload = {"success": False, "error": "not_found"}
+        self.send_json(200, json.dumps(payload).encode())
+
+    def send_json(self, status, data):
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json;charset=utf-8")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8053)
+    parser.add_argument("--key-id", default="test-key-id")
+    parser.add_argument("--key-secret", default="test-key-secret")
+    parser.add_argument("--latency-ms", type=int, default=0)
+    parser.add_argument("--verbose", action="store_true")
+    args = parser.parse_args()
+
+    StubHandler.state = StubState(args.key_id, args.key_secret, args.latency_ms)
+    server = ThreadingHTTPServer((args.host, args.port), StubHandler)
+    server.verbose = args.verbose
+    print(f"Aliyun DNS stub listening on http://{args.host}:{args.port}/")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Local stand-in for a home router's NAT-PMP and UPnP IGD services.
+
+Answers NAT-PMP external address requests (RFC 6886), unicast SSDP M-SEARCH
+for InternetGatewayDevice:1 and the WANIPConnection GetExternalIPAddress SOAP
+action, all reporting --ip as the WAN address. Point the firmware at it with
+GatewayIpProbe::setGateway(), or ESP32APP_GATEWAY on the native build.
+
+Example:
+  python tools/igd_stub.py --ip 203.0.113.20 --no-natpmp
+"""
+import argparse
+import http.server
+import socket
+import struct
+import threading
+
+SERVICE_TYPE = "urn:schemas-upnp-org:service:WANIPConnection:1"
+DEVICE_TYPE = "urn:schemas-upnp-org:device:InternetGatewayDevice:1"
+
+
+def natpmp_response(request, wan_ip):
+    if len(request) < 2 or request[0] != 0 or request[1] != 0:
+        return None
+    return struct.pack("!BBHI", 0, 128, 0, 0) + socket.inet_aton(wan_ip)
+
+
+def serve_natpmp(port, wan_ip):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", port))
+    print(f"NAT-PMP stub listening on udp://0.0.0.0:{port}/", flush=True)
+    while True:
+        request, address = sock.recvfrom(2048)
+        response = natpmp_response(request, wan_ip)
+        if response is not None:
+            sock.sendto(response, address)
+
+
+def serve_ssdp(port, http_port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", port))
+    print(f"SSDP stub listening on udp://0.0.0.0:{port}/", flush=True)
+    while True:
+        request, address = sock.recvfrom(2048)
+        text = request.decode("ascii", "replace")
+        if not text.startswith("M-SEARCH") or DEVICE_TYPE not in text:
+            continue
+        location = f"http://127.0.0.1:{http_port}/rootDesc.xml"
+        response = (
+            "HTTP/1.1 200 OK\r\n"
+            "CACHE-CONTROL: max-age=120\r\n"
+            f"ST: {DEVICE_TYPE}\r\n"
+            f"LOCATION: {location}\r\n"
+            "\r\n"
+        )
+        sock.sendto(response.encode("ascii"), address)
+
+
+def make_handler(wan_ip):
+    description = f"""<?xml version="1.0"?>
+<root xmlns="urn:schemas-upnp-org:device-1-0">
+<device><deviceType>{DEVICE_TYPE}</deviceType>
+<deviceList><device><deviceType>urn:schemas-upnp-org:device:WANDevice:1</deviceType>
+<deviceList><device><deviceType>urn:schemas-upnp-org:device:WANConnectionDevice:1</deviceType>
+<serviceList><service>
+<serviceType>{SERVICE_TYPE}</serviceType>
+<controlURL>/ctl/IPConn</controlURL>
+</service></serviceList>
+</device></deviceList></device></deviceList></device>
+</root>
+"""
+    answer = f"""<?xml version="1.0"?>
+<s:Envelope xmlns:s="http://schemas.xmlsoap.org/soap/envelope/"><s:Body>
+<u:GetExternalIPAddressResponse xmlns:u="{SERVICE_TYPE}">
+<NewExternalIPAddress>{wan_ip}</NewExternalIPAddress>
+</u:GetExternalIPAddressResponse></s:Body></s:Envelope>
+"""
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def _reply(self, code, body):
+            data = body.encode("utf-8")
+            self.send_response(code)
+            self.send_header("Content-Type", "text/xml")
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def do_GET(self):
+            if self.path == "/rootDesc.xml":
+                self._reply(200, description)
+            else:
+                self._reply(404, "")
+
+        def do_POST(self):
+            length = int(self.headers.get("Content-Length", "0"))
+            self.rfile.read(length)
+            action = self.headers.get("SOAPAction", "")
+            if self.path == "/ctl/IPConn" and "GetExternalIPAddress" in action:
+                self._reply(200, answer)
+            else:
+                self._reply(500, "")
+
+        def log_message(self, fmt, *args):
+            print("%s %s" % (self.address_string(), fmt % args), flush=True)
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--ip", default="203.0.113.20", help="WAN address to report")
+    parser.add_argument("--natpmp-port", type=int, default=5351)
+    parser.add_argument("--ssdp-port", type=int, default=1900)
+    parser.add_argument("--http-port", type=int, default=5000)
+    parser.add_argument("--no-natpmp", action="store_true")
+    parser.add_argument("--no-upnp", action="store_true")
+    args = parser.parse_args()
+
+    threads = []
+    if not args.no_natpmp:
+        threads.append(threading.Thread(target=serve_natpmp, args=(args.natpmp_port, args.ip),
+                                        daemon=True))
+    if not args.no_upnp:
+        server = http.server.ThreadingHTTPServer(("0.0.0.0", args.http_port),
+                                                 make_handler(args.ip))
+        print(f"IGD description on http://0.0.0.0:{args.http_port}/rootDesc.xml", flush=True)
+        threads.append(threading.Thread(target=server.serve_forever, daemon=True))
+        threads.append(threading.Thread(target=serve_ssdp, args=(args.ssdp_port, args.http_port),
+                                        daemon=True))
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Local stand-in for the UDP public IP probes used by PublicIpService.
+
+Answers STUN Binding requests (RFC 5389, XOR-MAPPED-ADDRESS) and DNS A queries
+for myip.opendns.com with the requester's address, or with --ip when given.
+Point the firmware at it with PublicIpService::setStunServer() and
+setDnsEchoServer(), or ESP32APP_STUN_SERVER / ESP32APP_DNS_ECHO_SERVER on the
+native build.
+
+Example:
+  python tools/udp_ip_stub.py --stun-port 3478 --dns-port 5353 --ip 203.0.113.9
+"""
+import argparse
+import socket
+import struct
+import threading
+
+STUN_MAGIC_COOKIE = 0x2112A442
+STUN_BINDING_REQUEST = 0x0001
+STUN_BINDING_SUCCESS = 0x0101
+STUN_ATTR_XOR_MAPPED_ADDRESS = 0x0020
+DNS_ECHO_NAME = "myip.opendns.com"
+
+
+def stun_response(request, address, reported_ip):
+    if len(request) < 20:
+        return None
+    message_type, _, cookie = struct.unpack("!HHI", request[:8])
+    if message_type != STUN_BINDING_REQUEST or cookie != STUN_MAGIC_COOKIE:
+        return None
+    transaction_id = request[8:20]
+    ip = struct.unpack("!I", socket.inet_aton(reported_ip or address[0]))[0]
+    port = address[1]
+    attribute = struct.pack(
+        "!HHBBHI",
+        STUN_ATTR_XOR_MAPPED_ADDRESS,
+        8,
+        0,
+        0x01,
+        port ^ (STUN_MAGIC_COOKIE >> 16),
+        ip ^ STUN_MAGIC_COOKIE,
+    )
+    header = struct.pack("!HHI", STUN_BINDING_SUCCESS, len(attribute), STUN_MAGIC_COOKIE)
+    return header + transaction_id + attribute
+
+
+def parse_question(request):
+    labels = []
+    offset = 12
+    while offset < len(request):
+        length = request[offset]
+        offset += 1
+        if length == 0:
+            break
+        labels.append(request[offset:offset + length].decode("ascii", "replace"))
+        offset += length
+    return ".".join(labels).lower(), offset + 4
+
+
+def dns_response(request, address, reported_ip):
+    if len(request) < 12:
+        return None
+    query_id, flags, question_count = struct.unpack("!HHH", request[:6])
+    if flags & 0x8000 or question_count != 1:
+        return None
+    name, question_end = parse_question(request)
+    question = request[12:question_end]
+    if name != DNS_ECHO_NAME:
+        # NXDOMAIN for anything but the echo name.
+        return struct.pack("!HHHHHH", query_id, 0x8183, 1, 0, 0, 0) + question
+    header = struct.pack("!HHHHHH", query_id, 0x8180, 1, 1, 0, 0)
+    answer = struct.pack("!HHHIH", 0xC00C, 1, 1, 0, 4)
+    answer += socket.inet_aton(reported_ip or address[0])
+    return header + question + answer
+
+
+def serve(port, builder, reported_ip, label):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", port))
+    print(f"{label} stub listening on udp://0.0.0.0:{port}/", flush=True)
+    while True:
+        request, address = sock.recvfrom(2048)
+        response = builder(request, address, reported_ip)
+        if response is not None:
+            sock.sendto(response, address)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--stun-port", type=int, default=3478)
+    parser.add_argument("--dns-port", type=int, default=5353)
+    parser.add_argument("--ip", default="", help="address to report instead of the requester's")
+    args = parser.parse_args()
+
+    threads = [
+        threading.Thread(target=serve, args=(args.stun_port, stun_response, args.ip, "STUN"),
+                         daemon=True),
+        threading.Thread(target=serve, args=(args.dns_port, dns_response, args.ip, "DNS echo"),
+                         daemon=True),
+    ]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+
+if __name__ == "__main__":
+    main()